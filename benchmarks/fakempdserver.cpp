@@ -0,0 +1,265 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "fakempdserver.h"
+#include "support/thread.h"
+#include <QFile>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+static const QByteArray constGreeting("OK MPD 0.23.5\n");
+static const QByteArray constOk("OK\n");
+static const QByteArray constListOk("list_OK\n");
+
+// Repeat the entries of a reply, as if they were from a larger collection. Paths of each copy are
+// placed into their own folder, and ids/positions are offset so that they remain unique.
+static QByteArray repeated(const QByteArray& reply, int times)
+{
+	if (!reply.endsWith(constOk)) {
+		return reply;
+	}
+
+	QList<QByteArray> lines = reply.left(reply.length() - constOk.length()).split('\n');
+	if (!lines.isEmpty() && lines.last().isEmpty()) {
+		lines.removeLast();
+	}
+	int maxId = 0;
+	int maxPos = 0;
+	for (const QByteArray& line : lines) {
+		if (line.startsWith("Id: ")) {
+			maxId = qMax(maxId, line.mid(4).toInt());
+		}
+		else if (line.startsWith("Pos: ") || line.startsWith("cpos: ")) {
+			maxPos = qMax(maxPos, line.mid(line.indexOf(' ') + 1).toInt());
+		}
+	}
+
+	QByteArray data;
+	data.reserve(reply.length() * times);
+	for (int copy = 0; copy < times; ++copy) {
+		QByteArray folder = "copy" + QByteArray::number(copy) + '/';
+		for (const QByteArray& line : lines) {
+			int sep = line.indexOf(": ");
+			QByteArray key = -1 == sep ? QByteArray() : line.left(sep);
+			if (0 == copy || -1 == sep) {
+				data += line;
+			}
+			else if ("file" == key || "directory" == key || "playlist" == key) {
+				data += key + ": " + folder + line.mid(sep + 2);
+			}
+			else if ("Id" == key) {
+				data += key + ": " + QByteArray::number(line.mid(sep + 2).toInt() + copy * (maxId + 1));
+			}
+			else if ("Pos" == key || "cpos" == key) {
+				data += key + ": " + QByteArray::number(line.mid(sep + 2).toInt() + copy * (maxPos + 1));
+			}
+			else {
+				data += line;
+			}
+			data += '\n';
+		}
+	}
+	data += constOk;
+	return data;
+}
+
+FakeMpdServer::FakeMpdServer()
+	: QObject(nullptr), server(nullptr), repeat(1), latency(0)
+{
+	thread = new Thread(metaObject()->className());
+	moveToThread(thread);
+	thread->start();
+}
+
+FakeMpdServer::~FakeMpdServer()
+{
+	QMetaObject::invokeMethod(this, "close", Qt::BlockingQueuedConnection);
+	thread->stop();
+}
+
+bool FakeMpdServer::loadTranscript(const QString& fileName)
+{
+	QFile f(fileName);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QByteArray command;
+	QByteArray data;
+	while (!f.atEnd()) {
+		QByteArray line = f.readLine();
+		if (!line.endsWith('\n')) {
+			line += '\n';
+		}
+		if (line.startsWith("> ")) {
+			command = line.mid(2).trimmed();
+			data.clear();
+		}
+		else if (!command.isEmpty()) {
+			data += line;
+			if (line.startsWith("OK") || line.startsWith("ACK")) {
+				replies.insert(command, data);
+				command.clear();
+			}
+		}
+	}
+	return true;
+}
+
+quint16 FakeMpdServer::start()
+{
+	if (repeat > 1) {
+		for (auto it = replies.begin(), end = replies.end(); it != end; ++it) {
+			it.value() = repeated(it.value(), repeat);
+		}
+	}
+	quint16 port = 0;
+	QMetaObject::invokeMethod(this, "listen", Qt::BlockingQueuedConnection, Q_RETURN_ARG(quint16, port));
+	return port;
+}
+
+quint16 FakeMpdServer::listen()
+{
+	server = new QTcpServer(this);
+	connect(server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+	return server->listen(QHostAddress::LocalHost, 0) ? server->serverPort() : 0;
+}
+
+void FakeMpdServer::close()
+{
+	qDeleteAll(connections.keys());
+	connections.clear();
+	delete server;
+	server = nullptr;
+}
+
+void FakeMpdServer::newConnection()
+{
+	while (server && server->hasPendingConnections()) {
+		QTcpSocket* socket = server->nextPendingConnection();
+		connections.insert(socket, Connection());
+		connect(socket, SIGNAL(readyRead()), this, SLOT(readCommands()));
+		connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+		send(socket, constGreeting);
+	}
+}
+
+void FakeMpdServer::socketDisconnected()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	if (socket && connections.remove(socket)) {
+		socket->deleteLater();
+	}
+}
+
+void FakeMpdServer::readCommands()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	if (!socket || !connections.contains(socket)) {
+		return;
+	}
+
+	Connection& conn = connections[socket];
+	conn.buffer += socket->readAll();
+	int eol = -1;
+	while (-1 != (eol = conn.buffer.indexOf('\n'))) {
+		QByteArray command = conn.buffer.left(eol).trimmed();
+		conn.buffer.remove(0, eol + 1);
+
+		if (conn.inCommandList) {
+			if ("command_list_end" != command) {
+				conn.commandList.append(command);
+				continue;
+			}
+			QByteArray data;
+			bool failed = false;
+			for (const QByteArray& cmd : conn.commandList) {
+				QByteArray r = reply(cmd);
+				if (!r.endsWith(constOk)) {
+					// MPD stops processing a command list at the first error
+					data += r;
+					failed = true;
+					break;
+				}
+				data += r.left(r.length() - constOk.length());
+				if (conn.listOk) {
+					data += constListOk;
+				}
+			}
+			if (!failed) {
+				data += constOk;
+			}
+			conn.inCommandList = false;
+			conn.commandList.clear();
+			send(socket, data);
+		}
+		else if ("command_list_begin" == command || "command_list_ok_begin" == command) {
+			conn.inCommandList = true;
+			conn.listOk = "command_list_ok_begin" == command;
+		}
+		else if ("idle" == command || command.startsWith("idle ")) {
+			// Nothing ever changes, so only reply once cancelled
+			conn.idle = true;
+		}
+		else if ("noidle" == command) {
+			if (conn.idle) {
+				conn.idle = false;
+				send(socket, constOk);
+			}
+		}
+		else if ("close" == command) {
+			socket->disconnectFromHost();
+			return;
+		}
+		else if (!command.isEmpty()) {
+			send(socket, reply(command));
+		}
+	}
+}
+
+QByteArray FakeMpdServer::reply(const QByteArray& command) const
+{
+	QHash<QByteArray, QByteArray>::ConstIterator it = replies.constFind(command);
+	if (replies.constEnd() == it) {
+		int space = command.indexOf(' ');
+		if (space > 0) {
+			it = replies.constFind(command.left(space));
+		}
+	}
+	return replies.constEnd() == it ? constOk : it.value();
+}
+
+void FakeMpdServer::send(QTcpSocket* socket, const QByteArray& data)
+{
+	if (latency > 0) {
+		// Timers with the same interval fire in order, so replies still arrive in sequence
+		QTimer::singleShot(latency, socket, [socket, data]() { socket->write(data); });
+	}
+	else {
+		socket->write(data);
+	}
+}
+
+#include "moc_fakempdserver.cpp"
@@ -0,0 +1,99 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FAKE_MPD_SERVER_H
+#define FAKE_MPD_SERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class QTcpServer;
+class QTcpSocket;
+class Thread;
+
+// A minimal MPD server that replays canned replies, so that the client side of the protocol can be
+// benchmarked without a real MPD instance or music collection. It runs in its own thread, so that
+// the blocking socket calls used by the client do not stall it.
+//
+// Replies are either set directly, or loaded from a transcript. A transcript holds each command
+// (prefixed with "> ") followed by the reply exactly as MPD sent it, including its final OK line:
+//
+//   > lsinfo "Artist"
+//   directory: Artist/Album
+//   file: Artist/Single.mp3
+//   Time: 213
+//   OK
+//
+// Commands are looked up in full first, and then by their first word - so that one recorded
+// "plchangesposid" reply serves all versions. Unknown commands receive an empty reply. Replies may
+// be repeated, to replay a small transcript as if it were from a larger collection, and are sent
+// after the configured latency.
+//
+// Replies, repeat, and latency must all be set before the server is started.
+class FakeMpdServer : public QObject {
+	Q_OBJECT
+
+public:
+	FakeMpdServer();
+	~FakeMpdServer() override;
+
+	bool loadTranscript(const QString& fileName);
+	void setReply(const QByteArray& command, const QByteArray& reply) { replies.insert(command, reply); }
+	void setRepeat(int r) { repeat = r < 1 ? 1 : r; }
+	void setLatency(int msecs) { latency = msecs < 0 ? 0 : msecs; }
+	bool hasReply(const QByteArray& command) const { return replies.contains(command); }
+
+	// Listen on a free port of the loopback interface. Returns the port, or 0 on failure.
+	quint16 start();
+
+private Q_SLOTS:
+	quint16 listen();
+	void close();
+	void newConnection();
+	void socketDisconnected();
+	void readCommands();
+
+private:
+	QByteArray reply(const QByteArray& command) const;
+	void send(QTcpSocket* socket, const QByteArray& data);
+
+private:
+	struct Connection {
+		QByteArray buffer;
+		QList<QByteArray> commandList;
+		bool inCommandList = false;
+		bool listOk = false;
+		bool idle = false;
+	};
+
+	Thread* thread;
+	QTcpServer* server;
+	QHash<QTcpSocket*, Connection> connections;
+	QHash<QByteArray, QByteArray> replies;
+	int repeat;
+	int latency;
+};
+
+#endif
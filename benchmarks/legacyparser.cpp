@@ -0,0 +1,160 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "legacyparser.h"
+#include "support/utils.h"
+#include <QDateTime>
+
+static const QByteArray constTimeKey("Time: ");
+static const QByteArray constAlbumKey("Album: ");
+static const QByteArray constArtistKey("Artist: ");
+static const QByteArray constAlbumArtistKey("AlbumArtist: ");
+static const QByteArray constGroupingKey("Grouping: ");
+static const QByteArray constAlbumSortKey("AlbumSort: ");
+static const QByteArray constArtistSortKey("ArtistSort: ");
+static const QByteArray constAlbumArtistSortKey("AlbumArtistSort: ");
+static const QByteArray constComposerKey("Composer: ");
+static const QByteArray constTitleKey("Title: ");
+static const QByteArray constTrackKey("Track: ");
+static const QByteArray constDiscKey("Disc: ");
+static const QByteArray constDateKey("Date: ");
+static const QByteArray constOriginalDateKey("OriginalDate: ");
+static const QByteArray constGenreKey("Genre: ");
+static const QByteArray constNameKey("Name: ");
+static const QByteArray constAlbumId("MUSICBRAINZ_ALBUMID: ");
+static const QByteArray constFileKey("file: ");
+static const QByteArray constPlaylistKey("playlist: ");
+static const QByteArray constLastModifiedKey("Last-Modified: ");
+static const QByteArray constOkValue("OK");
+
+static Song parseSong(const QList<QByteArray>& lines)
+{
+	Song song;
+	for (const QByteArray& line : lines) {
+		if (line.startsWith(constFileKey)) {
+			song.file = QString::fromUtf8(line.mid(constFileKey.length()));
+		}
+		else if (line.startsWith(constTimeKey)) {
+			song.time = line.mid(constTimeKey.length()).toUInt();
+		}
+		else if (line.startsWith(constAlbumKey)) {
+			song.album = QString::fromUtf8(line.mid(constAlbumKey.length()));
+		}
+		else if (line.startsWith(constArtistKey)) {
+			song.artist = QString::fromUtf8(line.mid(constArtistKey.length()));
+		}
+		else if (line.startsWith(constAlbumArtistKey)) {
+			song.albumartist = QString::fromUtf8(line.mid(constAlbumArtistKey.length()));
+		}
+		else if (line.startsWith(constGroupingKey)) {
+			song.setGrouping(QString::fromUtf8(line.mid(constGroupingKey.length())));
+		}
+		else if (line.startsWith(constComposerKey)) {
+			song.setComposer(QString::fromUtf8(line.mid(constComposerKey.length())));
+		}
+		else if (line.startsWith(constTitleKey)) {
+			song.title = QString::fromUtf8(line.mid(constTitleKey.length()));
+		}
+		else if (line.startsWith(constTrackKey)) {
+			int v = line.mid(constTrackKey.length()).split('/').at(0).toInt();
+			song.track = v < 0 ? 0 : v;
+		}
+		else if (line.startsWith(constDiscKey)) {
+			int v = line.mid(constDiscKey.length()).split('/').at(0).toInt();
+			song.disc = v < 0 ? 0 : v;
+		}
+		else if (line.startsWith(constDateKey)) {
+			QByteArray value = line.mid(constDateKey.length());
+			int v = value.length() > 4 ? value.left(4).toUInt() : value.toUInt();
+			song.year = v < 0 ? 0 : v;
+		}
+		else if (line.startsWith(constOriginalDateKey)) {
+			QByteArray value = line.mid(constOriginalDateKey.length());
+			int v = value.length() > 4 ? value.left(4).toUInt() : value.toUInt();
+			song.origYear = v < 0 ? 0 : v;
+		}
+		else if (line.startsWith(constGenreKey)) {
+			song.addGenre(QString::fromUtf8(line.mid(constGenreKey.length())));
+		}
+		else if (line.startsWith(constNameKey)) {
+			song.setName(QString::fromUtf8(line.mid(constNameKey.length())));
+		}
+		else if (line.startsWith(constPlaylistKey)) {
+			song.file = QString::fromUtf8(line.mid(constPlaylistKey.length()));
+			song.title = Utils::getFile(song.file);
+			song.type = Song::Playlist;
+		}
+		else if (line.startsWith(constAlbumId)) {
+			song.setMbAlbumId(QString::fromUtf8(line.mid(constAlbumId.length())));
+		}
+		else if (line.startsWith(constLastModifiedKey)) {
+			song.lastModified = QDateTime::fromString(QString::fromUtf8(line.mid(constLastModifiedKey.length())), Qt::ISODate).toSecsSinceEpoch();
+		}
+		else if (line.startsWith(constAlbumSortKey)) {
+			song.setAlbumSort(QString::fromUtf8(line.mid(constAlbumSortKey.length())));
+		}
+		else if (line.startsWith(constArtistSortKey)) {
+			song.setArtistSort(QString::fromUtf8(line.mid(constArtistSortKey.length())));
+		}
+		else if (line.startsWith(constAlbumArtistSortKey)) {
+			song.setAlbumArtistSort(QString::fromUtf8(line.mid(constAlbumArtistSortKey.length())));
+		}
+	}
+
+	if (Song::Playlist != song.type && song.genres[0].isEmpty()) {
+		song.addGenre(Song::unknown());
+	}
+	song.guessTags();
+	song.fillEmptyFields();
+	return song;
+}
+
+namespace LegacyParser {
+
+QList<Song> parseLibrarySongs(const QByteArray& data)
+{
+	QList<Song> songs;
+	QList<QByteArray> currentItem;
+	QList<QByteArray> lines = data.split('\n');
+	int amountOfLines = lines.size();
+
+	for (int i = 0; i < amountOfLines; i++) {
+		const QByteArray& line = lines.at(i);
+		if (constOkValue == line) {
+			continue;
+		}
+		if (!line.isEmpty()) {
+			currentItem.append(line);
+		}
+		if (i == lines.size() - 1 || lines.at(i + 1).startsWith(constFileKey)) {
+			Song song = parseSong(currentItem);
+			if (!song.file.isEmpty()) {
+				songs.append(song);
+			}
+			currentItem.clear();
+		}
+	}
+	return songs;
+}
+
+}// namespace LegacyParser
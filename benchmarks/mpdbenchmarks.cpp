@@ -0,0 +1,357 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "mpdbenchmarks.h"
+#include "config.h"
+#include "db/librarydb.h"
+#include "fakempdserver.h"
+#include "legacyparser.h"
+#include "models/playqueuemodel.h"
+#include "models/playqueueproxymodel.h"
+#include "mpd-interface/mpdconnection.h"
+#include "mpd-interface/mpdparseutils.h"
+#include "synthetic.h"
+#include <QDebug>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+#include <algorithm>
+
+static const int constLoadBatchSize = 5000;
+static const int constSocketTimeout = 30000;
+
+static int envValue(const char* name, int def)
+{
+	bool ok = false;
+	int val = qEnvironmentVariableIntValue(name, &ok);
+	return ok ? val : def;
+}
+
+// Pass the songs to the database in batches, as MPDConnection does when listing the library
+static void loadLibrary(LibraryDb& db, const QList<Song>& songs, time_t version)
+{
+	db.updateStarted(version);
+	for (int i = 0; i < songs.count(); i += constLoadBatchSize) {
+		db.insertSongs(new QList<Song>(songs.mid(i, constLoadBatchSize)));
+	}
+	db.updateFinished();
+}
+
+MpdBenchmarks::MpdBenchmarks()
+	: server(nullptr), socket(nullptr), filterDb(nullptr), tempDir(nullptr)
+{
+}
+
+void MpdBenchmarks::initTestCase()
+{
+	int songs = envValue("CANTATA_BENCH_SONGS", 100000);
+	int queueSize = envValue("CANTATA_BENCH_QUEUE", 10000);
+	QString transcript = qEnvironmentVariable("CANTATA_BENCH_TRANSCRIPT");
+
+	server = new FakeMpdServer();
+	server->setReply("listallinfo", Synthetic::listAllInfo(songs));
+	server->setReply("lsinfo", Synthetic::lsInfo(qMin(songs, 1000), 10));
+	server->setReply("playlistinfo", Synthetic::playlistInfo(queueSize));
+	server->setReply("plchangesposid", Synthetic::plChangesPosId(queueSize));
+	if (!transcript.isEmpty()) {
+		QVERIFY2(server->loadTranscript(transcript), qPrintable("Failed to read " + transcript));
+		server->setRepeat(envValue("CANTATA_BENCH_REPEAT", 1));
+	}
+	server->setLatency(envValue("CANTATA_BENCH_LATENCY", 0));
+	quint16 port = server->start();
+	QVERIFY(0 != port);
+
+	socket = new MpdSocket(this);
+	socket->connectToHost(QLatin1String("127.0.0.1"), port);
+	QVERIFY(socket->waitForConnected(constSocketTimeout));
+	QVERIFY(fetch(QByteArray()).startsWith("OK MPD"));
+
+	// Take all data via the server, so that transcripts are used everywhere
+	listAllInfo = fetch("listallinfo");
+	lsInfo = fetch("lsinfo");
+	playlistInfo = fetch("playlistinfo");
+	plChanges = fetch("plchangesposid 0");
+	queue = MPDParseUtils::parseSongs(playlistInfo, MPDParseUtils::Loc_PlayQueue);
+	QVERIFY(!queue.isEmpty());
+
+	tempDir = new QTemporaryDir();
+	QVERIFY(tempDir->isValid());
+	qInfo() << "Library:" << listAllInfo.size() << "bytes, queue:" << queue.count() << "songs";
+}
+
+void MpdBenchmarks::cleanupTestCase()
+{
+	delete socket;
+	socket = nullptr;
+	delete filterDb;
+	filterDb = nullptr;
+	delete server;
+	server = nullptr;
+	delete tempDir;
+	tempDir = nullptr;
+}
+
+void MpdBenchmarks::parseSongs_data()
+{
+	QTest::addColumn<bool>("legacy");
+	QTest::newRow("streaming") << false;
+	QTest::newRow("legacy") << true;
+}
+
+void MpdBenchmarks::parseSongs()
+{
+	QFETCH(bool, legacy);
+	int count = 0;
+	if (legacy) {
+		QBENCHMARK { count = LegacyParser::parseLibrarySongs(listAllInfo).count(); }
+	}
+	else {
+		QBENCHMARK { count = MPDParseUtils::parseSongs(listAllInfo, MPDParseUtils::Loc_Library).count(); }
+	}
+	QVERIFY(count > 0);
+}
+
+void MpdBenchmarks::parseDirItems()
+{
+	QList<Song> songs;
+	QStringList subDirs;
+	QBENCHMARK
+	{
+		songs.clear();
+		subDirs.clear();
+		MPDParseUtils::parseDirItems(lsInfo, QString(), CANTATA_MAKE_VERSION(0, 23, 0), songs, QString(), subDirs, MPDParseUtils::Loc_Library);
+	}
+	QVERIFY(!songs.isEmpty() || !subDirs.isEmpty());
+}
+
+void MpdBenchmarks::parseChanges()
+{
+	int count = 0;
+	QBENCHMARK { count = MPDParseUtils::parseChanges(plChanges).count(); }
+	QVERIFY(count > 0);
+}
+
+void MpdBenchmarks::fetchAndParse_data()
+{
+	QTest::addColumn<QByteArray>("command");
+	QTest::addColumn<int>("location");
+	QTest::newRow("listallinfo") << QByteArray("listallinfo") << (int)MPDParseUtils::Loc_Library;
+	QTest::newRow("playlistinfo") << QByteArray("playlistinfo") << (int)MPDParseUtils::Loc_PlayQueue;
+	QTest::newRow("plchangesposid") << QByteArray("plchangesposid 0") << -1;
+}
+
+void MpdBenchmarks::fetchAndParse()
+{
+	QFETCH(QByteArray, command);
+	QFETCH(int, location);
+	int count = 0;
+	QBENCHMARK
+	{
+		QByteArray data = fetch(command);
+		count = -1 == location
+				? MPDParseUtils::parseChanges(data).count()
+				: MPDParseUtils::parseSongs(data, (MPDParseUtils::Location)location).count();
+	}
+	QVERIFY(count > 0);
+}
+
+enum LoadType {
+	Load_Initial,
+	Load_Unchanged,
+	Load_Modified
+};
+
+void MpdBenchmarks::libraryLoad_data()
+{
+	QTest::addColumn<int>("type");
+	QTest::newRow("initial") << (int)Load_Initial;
+	QTest::newRow("resync unchanged") << (int)Load_Unchanged;
+	QTest::newRow("resync 10% modified") << (int)Load_Modified;
+}
+
+void MpdBenchmarks::libraryLoad()
+{
+	QFETCH(int, type);
+	LibraryDb db(nullptr, QLatin1String("benchmark-load"));
+	QVERIFY(db.init(tempDir->filePath(QLatin1String("load.sql"))));
+	db.setIncrementalSync(Load_Initial != type);
+	if (Load_Initial != type) {
+		QList<Song> stored = MPDParseUtils::parseSongs(listAllInfo, MPDParseUtils::Loc_Library);
+		if (Load_Modified == type) {
+			for (int i = 0; i < stored.count(); i += 10) {
+				stored[i].lastModified--;
+			}
+		}
+		loadLibrary(db, stored, 1);
+	}
+
+	// Everything from sending the command to the database commit
+	QBENCHMARK_ONCE
+	{
+		loadLibrary(db, MPDParseUtils::parseSongs(fetch("listallinfo"), MPDParseUtils::Loc_Library), 2);
+	}
+	QVERIFY(db.trackCount() > 0);
+	db.erase();
+}
+
+LibraryDb* MpdBenchmarks::loadedDb()
+{
+	if (!filterDb) {
+		filterDb = new LibraryDb(nullptr, QLatin1String("benchmark-filter"));
+		if (filterDb->init(tempDir->filePath(QLatin1String("filter.sql")))) {
+			loadLibrary(*filterDb, MPDParseUtils::parseSongs(listAllInfo, MPDParseUtils::Loc_Library), 1);
+		}
+	}
+	return filterDb;
+}
+
+void MpdBenchmarks::libraryFilter_data()
+{
+	QTest::addColumn<QString>("filter");
+	QTest::newRow("common word") << QString("track");
+	QTest::newRow("artist") << QString("artist 00042");
+	QTest::newRow("no match") << QString("zzzzzz");
+	QTest::newRow("year") << QString("#1970-1979");
+}
+
+void MpdBenchmarks::libraryFilter()
+{
+	QFETCH(QString, filter);
+	LibraryDb* db = loadedDb();
+	QVERIFY(db->trackCount() > 0);
+	QBENCHMARK
+	{
+		db->setFilter(filter);
+		db->getArtists();
+	}
+	db->setFilter(QString());
+}
+
+enum QueueChange {
+	Queue_Append,
+	Queue_Remove,
+	Queue_MoveBlock,
+	Queue_Reverse,
+	Queue_Shuffle
+};
+
+void MpdBenchmarks::playQueueDiff_data()
+{
+	QTest::addColumn<int>("change");
+	QTest::newRow("append 10%") << (int)Queue_Append;
+	QTest::newRow("remove 10%") << (int)Queue_Remove;
+	QTest::newRow("move 10% block") << (int)Queue_MoveBlock;
+	QTest::newRow("reverse") << (int)Queue_Reverse;
+	QTest::newRow("shuffle") << (int)Queue_Shuffle;
+}
+
+void MpdBenchmarks::playQueueDiff()
+{
+	QFETCH(int, change);
+	QList<Song> changed = queue;
+	int tenth = qMax(1, queue.count() / 10);
+	switch (change) {
+	case Queue_Append: {
+		qint32 maxId = 0;
+		for (const Song& s : queue) {
+			maxId = qMax(maxId, s.id);
+		}
+		for (int i = 0; i < tenth; ++i) {
+			Song s = queue.at(i % queue.count());
+			s.id = ++maxId;
+			changed.append(s);
+		}
+		break;
+	}
+	case Queue_Remove:
+		for (int i = changed.count() - 1; i >= 0; i -= 10) {
+			changed.removeAt(i);
+		}
+		break;
+	case Queue_MoveBlock:
+		changed = queue.mid(tenth) + queue.mid(0, tenth);
+		break;
+	case Queue_Reverse:
+		std::reverse(changed.begin(), changed.end());
+		break;
+	case Queue_Shuffle: {
+		QRandomGenerator rand(1);
+		std::shuffle(changed.begin(), changed.end(), rand);
+		break;
+	}
+	}
+
+	PlayQueueModel model;
+	model.update(queue, false);
+	// Each iteration applies the change, and then reverts it
+	QBENCHMARK
+	{
+		model.update(changed, false);
+		model.update(queue, false);
+	}
+	QCOMPARE(model.rowCount(), (int)queue.count());
+}
+
+void MpdBenchmarks::playQueueFilter_data()
+{
+	QTest::addColumn<QStringList>("keystrokes");
+	QTest::newRow("typing") << QStringList({"a", "ar", "art", "arti", "artis", "artist", "artist 0", "artist 00003"});
+	QTest::newRow("common word") << QStringList({"track"});
+	QTest::newRow("no match") << QStringList({"zzzzzz"});
+}
+
+void MpdBenchmarks::playQueueFilter()
+{
+	QFETCH(QStringList, keystrokes);
+	PlayQueueModel model;
+	model.update(queue, false);
+	PlayQueueProxyModel proxy;
+	proxy.setSourceModel(&model);
+	// Time from the first keystroke until the filter has been cleared again
+	QBENCHMARK
+	{
+		for (const QString& text : keystrokes) {
+			proxy.update(text);
+		}
+		proxy.update(QString());
+	}
+	QCOMPARE(proxy.rowCount(), (int)queue.count());
+}
+
+QByteArray MpdBenchmarks::fetch(const QByteArray& command)
+{
+	if (!command.isEmpty()) {
+		socket->write(command + '\n');
+	}
+	QByteArray data;
+	while (!socket->takeReply(data)) {
+		if (!socket->waitForReadyRead(constSocketTimeout)) {
+			return QByteArray();
+		}
+	}
+	return data;
+}
+
+QTEST_MAIN(MpdBenchmarks)
+
+#include "moc_mpdbenchmarks.cpp"
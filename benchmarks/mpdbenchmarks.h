@@ -0,0 +1,88 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MPD_BENCHMARKS_H
+#define MPD_BENCHMARKS_H
+
+#include "mpd-interface/song.h"
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+
+class FakeMpdServer;
+class LibraryDb;
+class MpdSocket;
+class QTemporaryDir;
+
+// Benchmarks of the MPD protocol, library, and play queue paths. Replies are served by a FakeMpdServer,
+// and are either generated or taken from a transcript. The following environment variables control them:
+//   CANTATA_BENCH_SONGS       Number of songs in generated replies (default 100000)
+//   CANTATA_BENCH_QUEUE       Number of songs in the play queue (default 10000)
+//   CANTATA_BENCH_LATENCY     Delay, in milliseconds, before the server sends each reply (default 0)
+//   CANTATA_BENCH_TRANSCRIPT  Transcript to replay, its replies replace the generated ones
+//   CANTATA_BENCH_REPEAT      Number of times to repeat the entries of each transcript reply (default 1)
+//
+// Results use the usual Qt Test output options, e.g. "-o results.csv,csv" or "-o results.xml,xml"
+// for machine readable output.
+class MpdBenchmarks : public QObject {
+	Q_OBJECT
+
+public:
+	MpdBenchmarks();
+
+private Q_SLOTS:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void parseSongs_data();
+	void parseSongs();
+	void parseDirItems();
+	void parseChanges();
+	void fetchAndParse_data();
+	void fetchAndParse();
+	void libraryLoad_data();
+	void libraryLoad();
+	void libraryFilter_data();
+	void libraryFilter();
+	void playQueueDiff_data();
+	void playQueueDiff();
+	void playQueueFilter_data();
+	void playQueueFilter();
+
+private:
+	QByteArray fetch(const QByteArray& command);
+	LibraryDb* loadedDb();
+
+private:
+	FakeMpdServer* server;
+	MpdSocket* socket;
+	LibraryDb* filterDb;
+	QTemporaryDir* tempDir;
+	QByteArray listAllInfo;
+	QByteArray lsInfo;
+	QByteArray playlistInfo;
+	QByteArray plChanges;
+	QList<Song> queue;
+};
+
+#endif
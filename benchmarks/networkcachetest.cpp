@@ -0,0 +1,196 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "networkcachetest.h"
+#include "network/networkaccessmanager.h"
+#include "network/networkcache.h"
+#include <QDateTime>
+#include <QLocale>
+#include <QNetworkProxy>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+
+static const QByteArray constETag("\"cantata-test-1\"");
+static const QByteArray constBody("Cached response body");
+static const int constTimeout = 10000;
+
+HttpStubServer::HttpStubServer()
+	: server(nullptr), maxAge(3600), numRequests(0), numNotModified(0)
+{
+}
+
+HttpStubServer::~HttpStubServer()
+{
+	delete server;
+}
+
+quint16 HttpStubServer::start()
+{
+	server = new QTcpServer(this);
+	connect(server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+	return server->listen(QHostAddress::LocalHost) ? server->serverPort() : 0;
+}
+
+void HttpStubServer::newConnection()
+{
+	while (server->hasPendingConnections()) {
+		QTcpSocket* socket = server->nextPendingConnection();
+		connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+		connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+	}
+}
+
+void HttpStubServer::readRequest()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	if (!socket) {
+		return;
+	}
+	QByteArray request = socket->peek(socket->bytesAvailable());
+	if (!request.contains("\r\n\r\n")) {
+		return;
+	}
+	socket->readAll();
+	numRequests++;
+
+	bool matches = false;
+	const QList<QByteArray> lines = request.split('\n');
+	for (const QByteArray& line : lines) {
+		if (line.toLower().startsWith("if-none-match:") && line.mid(14).trimmed() == constETag) {
+			matches = true;
+		}
+	}
+
+	// Fixed Last-Modified, in the past, so that both validators are sent
+	static const QByteArray lastModified("Mon, 01 Jan 2024 00:00:00 GMT");
+	QByteArray headers = "ETag: " + constETag + "\r\n"
+	                     "Last-Modified: " + lastModified + "\r\n"
+	                     "Cache-Control: max-age=" + QByteArray::number(maxAge) + "\r\n"
+	                     "Date: " + QLocale::c().toString(QDateTime::currentDateTimeUtc(), QLatin1String("ddd, dd MMM yyyy hh:mm:ss 'GMT'")).toLatin1() + "\r\n"
+	                     "Connection: close\r\n";
+	if (matches) {
+		numNotModified++;
+		socket->write("HTTP/1.1 304 Not Modified\r\n" + headers + "\r\n");
+	}
+	else {
+		socket->write("HTTP/1.1 200 OK\r\n" + headers + "Content-Type: text/plain\r\nContent-Length: " + QByteArray::number(constBody.size()) + "\r\n\r\n" + constBody);
+	}
+	socket->disconnectFromHost();
+}
+
+NetworkCacheTest::NetworkCacheTest()
+	: server(nullptr), manager(nullptr), tempDir(nullptr), port(0)
+{
+}
+
+void NetworkCacheTest::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+	tempDir = new QTemporaryDir();
+	QVERIFY(tempDir->isValid());
+	NetworkCache::setDirectory(tempDir->path());
+
+	server = new HttpStubServer();
+	port = server->start();
+	QVERIFY(0 != port);
+	manager = new NetworkAccessManager();
+	// Loopback requests must not go via any proxy set in the environment
+	manager->setProxy(QNetworkProxy::NoProxy);
+}
+
+void NetworkCacheTest::cleanupTestCase()
+{
+	delete manager;
+	manager = nullptr;
+	delete server;
+	server = nullptr;
+	delete tempDir;
+	tempDir = nullptr;
+}
+
+NetworkCacheTest::Reply NetworkCacheTest::fetch(const QString& path)
+{
+	Reply reply;
+	NetworkJob* job = manager->getCached(QUrl(QLatin1String("http://127.0.0.1:") + QString::number(port) + path), NetworkCache::Context);
+	QSignalSpy spy(job, SIGNAL(finished()));
+	if (spy.wait(constTimeout)) {
+		reply.ok = job->ok();
+		reply.fromCache = job->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+		reply.body = job->readAll();
+	}
+	job->deleteLater();
+	return reply;
+}
+
+void NetworkCacheTest::servedFromCache()
+{
+	server->setMaxAge(3600);
+	int requests = server->requests();
+	NetworkCache::Stats before = NetworkCache::stats(NetworkCache::Context);
+
+	Reply first = fetch(QLatin1String("/fresh"));
+	QVERIFY(first.ok);
+	QVERIFY(!first.fromCache);
+	QCOMPARE(first.body, constBody);
+	QCOMPARE(server->requests(), requests + 1);
+	QCOMPARE(NetworkCache::stats(NetworkCache::Context).stored, before.stored + 1);
+
+	Reply second = fetch(QLatin1String("/fresh"));
+	QVERIFY(second.ok);
+	QVERIFY(second.fromCache);
+	QCOMPARE(second.body, constBody);
+	QCOMPARE(server->requests(), requests + 1);
+	QCOMPARE(NetworkCache::stats(NetworkCache::Context).hits, before.hits + 1);
+}
+
+void NetworkCacheTest::revalidatedAfterExpiry()
+{
+	server->setMaxAge(1);
+	int requests = server->requests();
+	int notModified = server->notModified();
+	NetworkCache::Stats before = NetworkCache::stats(NetworkCache::Context);
+
+	Reply first = fetch(QLatin1String("/expiring"));
+	QVERIFY(first.ok);
+	QCOMPARE(first.body, constBody);
+	QCOMPARE(server->requests(), requests + 1);
+
+	// HTTP dates have a resolution of one second, so wait long enough for the response to be stale
+	QTest::qWait(2500);
+
+	Reply second = fetch(QLatin1String("/expiring"));
+	QVERIFY(second.ok);
+	QVERIFY(second.fromCache);
+	QCOMPARE(second.body, constBody);
+	QCOMPARE(server->requests(), requests + 2);
+	QCOMPARE(server->notModified(), notModified + 1);
+	QCOMPARE(NetworkCache::stats(NetworkCache::Context).validated, before.validated + 1);
+}
+
+QTEST_GUILESS_MAIN(NetworkCacheTest)
+
+#include "moc_networkcachetest.cpp"
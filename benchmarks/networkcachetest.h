@@ -0,0 +1,91 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef NETWORK_CACHE_TEST_H
+#define NETWORK_CACHE_TEST_H
+
+#include <QByteArray>
+#include <QObject>
+
+class NetworkAccessManager;
+class QTcpServer;
+class QTemporaryDir;
+
+// Serves one fixed response over HTTP, with an ETag, Last-Modified, and a max-age set by the test. Requests
+// that send a matching If-None-Match are answered with 304. Each connection handles a single request.
+class HttpStubServer : public QObject {
+	Q_OBJECT
+
+public:
+	HttpStubServer();
+	~HttpStubServer() override;
+
+	// Listen on a free port of the loopback interface. Returns the port, or 0 on failure.
+	quint16 start();
+	void setMaxAge(int secs) { maxAge = secs; }
+	int requests() const { return numRequests; }
+	int notModified() const { return numNotModified; }
+
+private Q_SLOTS:
+	void newConnection();
+	void readRequest();
+
+private:
+	QTcpServer* server;
+	int maxAge;
+	int numRequests;
+	int numNotModified;
+};
+
+// Checks that responses fetched via NetworkAccessManager::getCached() are stored by NetworkCache, served from it
+// whilst fresh, and revalidated with the server once they have expired.
+class NetworkCacheTest : public QObject {
+	Q_OBJECT
+
+public:
+	NetworkCacheTest();
+
+private Q_SLOTS:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void servedFromCache();
+	void revalidatedAfterExpiry();
+
+private:
+	struct Reply {
+		bool ok = false;
+		bool fromCache = false;
+		QByteArray body;
+	};
+
+	Reply fetch(const QString& path);
+
+private:
+	HttpStubServer* server;
+	NetworkAccessManager* manager;
+	QTemporaryDir* tempDir;
+	quint16 port;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "replaygain/sampleconvert.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures the throughput of the ReplayGain sample conversion and peak kernels, for each implementation
+// supported by this CPU. Output is one tab separated line per format/implementation:
+//   <format> <implementation> <million samples per second> <speed relative to scalar>
+
+static const unsigned int constChannels = 2;
+static const size_t constFrames = 4096;// Roughly the size of a decoded ffmpeg frame
+static int msecsPerTest = 250;
+
+static double measure(const std::function<void()>& func)
+{
+	QElapsedTimer timer;
+	quint64 runs = 0;
+	// Warm the caches first
+	func();
+	timer.start();
+	do {
+		for (int i = 0; i < 64; ++i) {
+			func();
+		}
+		runs += 64;
+	} while (timer.elapsed() < msecsPerTest);
+	return (runs * constFrames * constChannels) / (timer.nsecsElapsed() / 1000.0);
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	QStringList args = app.arguments();
+	int idx = args.indexOf(QLatin1String("--msecs"));
+	if (-1 != idx && idx + 1 < args.count()) {
+		msecsPerTest = qMax(1, args.at(idx + 1).toInt());
+	}
+
+	const size_t count = constFrames * constChannels;
+	QVector<int16_t> s16(count);
+	QVector<int32_t> s32(count);
+	QVector<float> flt(count);
+	QVector<double> dbl(count);
+	QVector<float> out(count);
+	srand(1);
+	for (size_t i = 0; i < count; ++i) {
+		s16[i] = (int16_t)(rand() & 0xFFFF);
+		s32[i] = (int32_t)(((quint32)rand() << 16) ^ (quint32)rand());
+		dbl[i] = (rand() / (double)RAND_MAX) * 2.0 - 1.0;
+		flt[i] = (float)dbl[i];
+	}
+	const int16_t* s16Planes[constChannels] = {s16.constData(), s16.constData() + constFrames};
+	const int32_t* s32Planes[constChannels] = {s32.constData(), s32.constData() + constFrames};
+	const float* fltPlanes[constChannels] = {flt.constData(), flt.constData() + constFrames};
+	const double* dblPlanes[constChannels] = {dbl.constData(), dbl.constData() + constFrames};
+	volatile float peak = 0.0f;
+
+	const SampleConvert::Impl impls[] = {SampleConvert::Scalar, SampleConvert::Sse2, SampleConvert::Avx2, SampleConvert::Neon};
+	const char* formats[] = {"s16", "s32", "dbl", "s16p", "s32p", "fltp", "dblp", "peak"};
+	const int numFormats = sizeof(formats) / sizeof(formats[0]);
+
+	printf("format\timpl\tmsamples_per_sec\tspeedup\n");
+	for (int f = 0; f < numFormats; ++f) {
+		double scalar = 0.0;
+		for (SampleConvert::Impl impl: impls) {
+			if (!SampleConvert::isSupported(impl)) {
+				continue;
+			}
+			const SampleConvert::Kernels& k = SampleConvert::kernels(impl);
+			std::function<void()> func;
+			switch (f) {
+			case 0: func = [&]() { k.s16(out.data(), s16.constData(), count); }; break;
+			case 1: func = [&]() { k.s32(out.data(), s32.constData(), count); }; break;
+			case 2: func = [&]() { k.dbl(out.data(), dbl.constData(), count); }; break;
+			case 3: func = [&]() { k.s16p(out.data(), s16Planes, constChannels, constFrames); }; break;
+			case 4: func = [&]() { k.s32p(out.data(), s32Planes, constChannels, constFrames); }; break;
+			case 5: func = [&]() { k.fltp(out.data(), fltPlanes, constChannels, constFrames); }; break;
+			case 6: func = [&]() { k.dblp(out.data(), dblPlanes, constChannels, constFrames); }; break;
+			default: func = [&]() { peak = k.peak(flt.constData(), count); }; break;
+			}
+			double rate = measure(func);
+			if (SampleConvert::Scalar == impl) {
+				scalar = rate;
+			}
+			printf("%s\t%s\t%.1f\t%.2f\n", formats[f], SampleConvert::name(impl), rate, scalar > 0.0 ? rate / scalar : 1.0);
+		}
+	}
+	return 0;
+}
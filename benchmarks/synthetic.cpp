@@ -0,0 +1,123 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "synthetic.h"
+
+static const int constTracksPerAlbum = 10;
+static const int constAlbumsPerArtist = 10;
+static const int constGenres = 25;
+
+static QByteArray padded(int value, int width)
+{
+	return QByteArray::number(value).rightJustified(width, '0');
+}
+
+static QByteArray artistName(int song)
+{
+	return "Artist " + padded(song / (constTracksPerAlbum * constAlbumsPerArtist), 5);
+}
+
+static QByteArray albumFolder(int song)
+{
+	return artistName(song) + "/Album " + padded(song / constTracksPerAlbum, 6);
+}
+
+static void appendSong(QByteArray& data, int song)
+{
+	int track = (song % constTracksPerAlbum) + 1;
+	int time = 120 + ((song * 37) % 300);
+	QByteArray title = "Track " + padded(song, 7);
+	data += "file: " + albumFolder(song) + '/' + padded(track, 2) + " - " + title + ".flac\n";
+	data += "Last-Modified: 2021-" + padded(1 + (song % 12), 2) + '-' + padded(1 + (song % 28), 2) + "T12:34:56Z\n";
+	data += "Format: 44100:16:2\n";
+	data += "Time: " + QByteArray::number(time) + '\n';
+	data += "duration: " + QByteArray::number(time) + ".123\n";
+	data += "Artist: " + artistName(song) + '\n';
+	data += "AlbumArtist: " + artistName(song) + '\n';
+	data += "Title: " + title + '\n';
+	data += "Album: Album " + padded(song / constTracksPerAlbum, 6) + '\n';
+	data += "Track: " + QByteArray::number(track) + '\n';
+	data += "Date: " + QByteArray::number(1960 + ((song / constTracksPerAlbum) % 60)) + '\n';
+	data += "Genre: Genre " + QByteArray::number((song / constTracksPerAlbum) % constGenres) + '\n';
+	data += "Disc: 1\n";
+}
+
+namespace Synthetic {
+
+QByteArray listAllInfo(int songs)
+{
+	QByteArray data;
+	data.reserve(songs * 400);
+	for (int i = 0; i < songs; ++i) {
+		if (0 == i % (constTracksPerAlbum * constAlbumsPerArtist)) {
+			data += "directory: " + artistName(i) + '\n';
+		}
+		if (0 == i % constTracksPerAlbum) {
+			data += "directory: " + albumFolder(i) + '\n';
+		}
+		appendSong(data, i);
+	}
+	data += "OK\n";
+	return data;
+}
+
+QByteArray lsInfo(int songs, int folders)
+{
+	QByteArray data;
+	data.reserve(songs * 400 + folders * 40);
+	for (int i = 0; i < folders; ++i) {
+		data += "directory: " + albumFolder(0) + "/CD " + QByteArray::number(i + 1) + '\n';
+	}
+	for (int i = 0; i < songs; ++i) {
+		appendSong(data, i);
+	}
+	data += "OK\n";
+	return data;
+}
+
+QByteArray playlistInfo(int songs, int firstId)
+{
+	QByteArray data;
+	data.reserve(songs * 420);
+	for (int i = 0; i < songs; ++i) {
+		appendSong(data, i);
+		data += "Pos: " + QByteArray::number(i) + '\n';
+		data += "Id: " + QByteArray::number(firstId + i) + '\n';
+	}
+	data += "OK\n";
+	return data;
+}
+
+QByteArray plChangesPosId(int songs, int firstId)
+{
+	QByteArray data;
+	data.reserve(songs * 24);
+	for (int i = 0; i < songs; ++i) {
+		data += "cpos: " + QByteArray::number(i) + '\n';
+		data += "Id: " + QByteArray::number(firstId + i) + '\n';
+	}
+	data += "OK\n";
+	return data;
+}
+
+}// namespace Synthetic
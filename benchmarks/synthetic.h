@@ -0,0 +1,42 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <QByteArray>
+
+// Generated MPD replies, used when no transcript has been given. Every album has 10 tracks, and every
+// artist 10 albums. Song n is always described the same way, so replies can be compared by position.
+namespace Synthetic {
+// Reply to "listallinfo"
+extern QByteArray listAllInfo(int songs);
+// Reply to "lsinfo" of a folder containing the given number of songs and sub-folders
+extern QByteArray lsInfo(int songs, int folders);
+// Reply to "playlistinfo". Song n is at position n, and has id firstId+n
+extern QByteArray playlistInfo(int songs, int firstId = 1);
+// Reply to "plchangesposid", with every position changed
+extern QByteArray plChangesPosId(int songs, int firstId = 1);
+}// namespace Synthetic
+
+#endif
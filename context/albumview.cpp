@@ -54,7 +54,7 @@ const QLatin1String AlbumView::constInfoExt(".html.gz");
 
 static const QLatin1String constScheme("cantata");
 
-static QString cacheFileName(const QString& artist, const QString& album, const QString& lang, bool createDir)
+QString AlbumView::cacheFileName(const QString& artist, const QString& album, const QString& lang, bool createDir)
 {
 	return Utils::cacheDir(AlbumView::constCacheDir, createDir) + Covers::encodeName(artist) + QLatin1String(" - ") + Covers::encodeName(album) + "." + lang + AlbumView::constInfoExt;
 }
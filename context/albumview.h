@@ -40,6 +40,8 @@ public:
 	static const QLatin1String constCacheDir;
 	static const QLatin1String constInfoExt;
 
+	static QString cacheFileName(const QString& artist, const QString& album, const QString& lang, bool createDir);
+
 	AlbumView(QWidget* p);
 	~AlbumView() override;
 
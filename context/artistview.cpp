@@ -56,7 +56,7 @@ const QLatin1String ArtistView::constCacheDir("artists/");
 const QLatin1String ArtistView::constInfoExt(".html.gz");
 const QLatin1String ArtistView::constSimilarInfoExt(".txt");
 
-static QString cacheFileName(const QString& artist, const QString& lang, bool similar, bool createDir)
+QString ArtistView::cacheFileName(const QString& artist, const QString& lang, bool similar, bool createDir)
 {
 	return Utils::cacheDir(ArtistView::constCacheDir, createDir) + Covers::encodeName(artist) + (similar ? "-similar" : ("." + lang)) + (similar ? ArtistView::constSimilarInfoExt : ArtistView::constInfoExt);
 }
@@ -286,17 +286,7 @@ void ArtistView::handleSimilarReply()
 			if (!artists.isEmpty()) {
 				buildSimilar(artists);
 				setBio();
-				QFile f(cacheFileName(reply->property(constNameKey).toString(), QString(), true, true));
-				if (f.open(QIODevice::WriteOnly | QIODevice::Text)) {
-					QTextStream stream(&f);
-#ifdef Q_OS_WIN
-					stream.setEncoding(QStringConverter::Utf8);
-					stream.setGenerateByteOrderMark(true);
-#endif
-					for (const QString& artist : artists) {
-						stream << artist << CANTATA_ENDL;
-					}
-				}
+				saveSimilarArtists(reply->property(constNameKey).toString(), artists);
 			}
 		}
 		else {
@@ -355,19 +345,38 @@ void ArtistView::setBio()
 	setHtml(html);
 }
 
-void ArtistView::requestSimilar()
+QUrl ArtistView::similarArtistsUrl(const QString& artist)
 {
-	abort();
 	QUrl url("http://ws.audioscrobbler.com/2.0/");
 	QUrlQuery query;
 
 	query.addQueryItem("method", "artist.getSimilar");
 	ApiKeys::self()->addKey(query, ApiKeys::LastFm);
 	query.addQueryItem("autocorrect", "1");
-	query.addQueryItem("artist", Covers::fixArtist(currentSong.artist));
+	query.addQueryItem("artist", Covers::fixArtist(artist));
 	url.setQuery(query);
+	return url;
+}
 
-	currentSimilarJob = NetworkAccessManager::self()->get(url);
+void ArtistView::saveSimilarArtists(const QString& artist, const QStringList& artists)
+{
+	QFile f(cacheFileName(artist, QString(), true, true));
+	if (f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		QTextStream stream(&f);
+#ifdef Q_OS_WIN
+		stream.setEncoding(QStringConverter::Utf8);
+		stream.setGenerateByteOrderMark(true);
+#endif
+		for (const QString& a : artists) {
+			stream << a << CANTATA_ENDL;
+		}
+	}
+}
+
+void ArtistView::requestSimilar()
+{
+	abort();
+	currentSimilarJob = NetworkAccessManager::self()->getCached(similarArtistsUrl(currentSong.artist), NetworkCache::Context);
 	currentSimilarJob->setProperty(constNameKey, currentSong.artist);
 	connect(currentSimilarJob, SIGNAL(finished()), this, SLOT(handleSimilarReply()));
 }
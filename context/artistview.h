@@ -47,6 +47,11 @@ public:
 	static const QLatin1String constInfoExt;
 	static const QLatin1String constSimilarInfoExt;
 
+	static QString cacheFileName(const QString& artist, const QString& lang, bool similar, bool createDir);
+	static QUrl similarArtistsUrl(const QString& artist);
+	static QStringList parseSimilarResponse(const QByteArray& resp);
+	static void saveSimilarArtists(const QString& artist, const QStringList& artists);
+
 	ArtistView(QWidget* parent);
 	~ArtistView() override { abort(); }
 
@@ -74,7 +79,6 @@ private:
 	void loadBio();
 	void loadSimilar();
 	void requestSimilar();
-	QStringList parseSimilarResponse(const QByteArray& resp);
 	void buildSimilar(const QStringList& artists);
 	void abort() override;
 
@@ -0,0 +1,332 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "contextprefetcher.h"
+#include "albumview.h"
+#include "artistview.h"
+#include "contextengine.h"
+#include "gui/covers.h"
+#include "lyricsfetcher.h"
+#include "network/networkaccessmanager.h"
+#include "songview.h"
+#include "support/utils.h"
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#ifdef BUNDLED_KARCHIVE
+#include <kcompressiondevice.h>
+#else
+#include <KCompressionDevice>
+#endif
+
+static bool debugEnabled = false;
+#define DBUG \
+	if (debugEnabled) qWarning() << "ContextPrefetcher" << __FUNCTION__
+void ContextPrefetcher::enableDebug()
+{
+	debugEnabled = true;
+}
+
+// Give the lookups for a new current song a head start
+static const int constStartDelay = 5000;
+static const int constTaskGap = 1500;
+
+// The views look for a cached response in each of the engine's languages
+static QStringList cachePrefixes(ContextEngine* engine)
+{
+	QStringList prefixes;
+	for (const QString& lang : engine->getLangs()) {
+		prefixes.append(engine->getPrefix(lang));
+	}
+	return prefixes;
+}
+
+static void saveCompressed(const QString& fileName, const QString& data)
+{
+	KCompressionDevice f(fileName, KCompressionDevice::GZip);
+	if (f.open(QIODevice::WriteOnly)) {
+		f.write(data.toUtf8().constData());
+	}
+}
+
+ContextPrefetcher::ContextPrefetcher(QObject* p)
+	: QObject(p), running(false), job(nullptr), lyricsId(0)
+{
+	engine = ContextEngine::create(this);
+	connect(engine, SIGNAL(searchResult(QString, QString)), this, SLOT(engineResponse(QString, QString)));
+	lyricsFetcher = new LyricsFetcher(this);
+	connect(lyricsFetcher, SIGNAL(lyricsReady(int, QString)), this, SLOT(lyricsReady(int, QString)));
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	connect(timer, SIGNAL(timeout()), this, SLOT(startNext()));
+}
+
+ContextPrefetcher::~ContextPrefetcher()
+{
+	cancel();
+}
+
+void ContextPrefetcher::setSongs(const QList<Song>& songs)
+{
+	QStringList keys;
+	for (const Song& s : songs) {
+		keys.append(s.file + QLatin1Char('\n') + s.artist + QLatin1Char('\n') + s.title);
+	}
+	if (keys == songKeys) {
+		return;
+	}
+
+	cancel();
+	songKeys = keys;
+	for (const Song& s : songs) {
+		if (s.isEmpty() || Song::OnlineSvrTrack == s.type) {
+			continue;
+		}
+		DBUG << s.artist << s.album << s.title;
+		// Order by how visible each item is when the track changes
+		tasks.append(Task(Task_Covers, s));
+		tasks.append(Task(Task_Lyrics, s));
+		tasks.append(Task(Task_ArtistBio, s));
+		tasks.append(Task(Task_AlbumDetails, s));
+		tasks.append(Task(Task_SimilarArtists, s));
+		tasks.append(Task(Task_TrackInfo, s));
+	}
+	if (!tasks.isEmpty()) {
+		timer->start(constStartDelay);
+	}
+}
+
+void ContextPrefetcher::cancel()
+{
+	timer->stop();
+	if (running) {
+		DBUG << "Cancel" << taskKey(current);
+		// Not completed, so allow this to be looked up again
+		done.remove(taskKey(current));
+		engine->cancel();
+		if (job) {
+			job->cancelAndDelete();
+			job = nullptr;
+		}
+		lyricsFetcher->reset();
+		running = false;
+	}
+	tasks.clear();
+	songKeys.clear();
+}
+
+void ContextPrefetcher::startNext()
+{
+	while (!tasks.isEmpty()) {
+		current = tasks.takeFirst();
+		QString key = taskKey(current);
+		if (done.contains(key)) {
+			continue;
+		}
+		done.insert(key);
+		if (start(current)) {
+			DBUG << key;
+			return;
+		}
+	}
+}
+
+bool ContextPrefetcher::start(const Task& task)
+{
+	const Song& song = task.song;
+
+	switch (task.type) {
+	case Task_Covers: {
+		// Covers has its own download queue, so just ask it to locate or download the images
+		if (!song.album.isEmpty()) {
+			Covers::self()->requestImage(song);
+		}
+		QString artist = song.basicArtist(true);
+		if (!artist.isEmpty()) {
+			Song s;
+			s.setArtistImageRequest();
+			s.albumartist = artist;
+			if (!song.isVariousArtists()) {
+				s.file = song.file;
+			}
+			Covers::self()->requestImage(s);
+		}
+		taskFinished();
+		return true;
+	}
+	case Task_ArtistBio: {
+		QString artist = song.basicArtist(true);
+		if (artist.isEmpty()) {
+			return false;
+		}
+		for (const QString& prefix : cachePrefixes(engine)) {
+			if (QFile::exists(ArtistView::cacheFileName(artist, prefix, false, false))) {
+				return false;
+			}
+		}
+		running = true;
+		engine->search(QStringList() << artist, ContextEngine::Artist);
+		return true;
+	}
+	case Task_SimilarArtists: {
+		QString artist = song.basicArtist(true);
+		if (artist.isEmpty() || QFile::exists(ArtistView::cacheFileName(artist, QString(), true, false))) {
+			return false;
+		}
+		running = true;
+		job = NetworkAccessManager::self()->getCached(ArtistView::similarArtistsUrl(artist), NetworkCache::Context);
+		connect(job, SIGNAL(finished()), this, SLOT(similarResponse()));
+		return true;
+	}
+	case Task_AlbumDetails: {
+		if (song.album.isEmpty() || song.albumArtistOrComposer().isEmpty()) {
+			return false;
+		}
+		QString artist = Covers::fixArtist(song.albumArtistOrComposer());
+		for (const QString& prefix : cachePrefixes(engine)) {
+			if (QFile::exists(AlbumView::cacheFileName(artist, song.album, prefix, false))) {
+				return false;
+			}
+		}
+		running = true;
+		engine->search(QStringList() << song.albumArtistOrComposer() << song.album, ContextEngine::Album);
+		return true;
+	}
+	case Task_TrackInfo: {
+		if (song.artist.isEmpty() || song.title.isEmpty()) {
+			return false;
+		}
+		for (const QString& prefix : cachePrefixes(engine)) {
+			if (QFile::exists(SongView::infoCacheFileName(song, prefix, false))) {
+				return false;
+			}
+		}
+		running = true;
+		engine->search(QStringList() << song.basicArtist() << song.basicTitle(), ContextEngine::Track);
+		return true;
+	}
+	case Task_Lyrics: {
+		if (song.artist.isEmpty() || song.title.isEmpty() || QFile::exists(SongView::lyricsCacheFileName(song))) {
+			return false;
+		}
+		if (!song.isNonMPD()) {
+			QString mpdLyrics = SongView::mpdLyricsFilePath(song);
+			if (QFile::exists(mpdLyrics) || QFile::exists(Utils::changeExtension(mpdLyrics, ".txt"))) {
+				return false;
+			}
+		}
+		lyricsFetcher->reset();
+		if (lyricsFetcher->fetch(++lyricsId, song).isEmpty()) {
+			return false;
+		}
+		running = true;
+		return true;
+	}
+	}
+	return false;
+}
+
+void ContextPrefetcher::taskFinished()
+{
+	running = false;
+	timer->start(constTaskGap);
+}
+
+QString ContextPrefetcher::taskKey(const Task& task) const
+{
+	const Song& s = task.song;
+	switch (task.type) {
+	case Task_Covers: return QLatin1String("covers:") + s.albumArtistOrComposer() + QLatin1Char('\n') + s.album + QLatin1Char('\n') + s.basicArtist(true);
+	case Task_ArtistBio: return QLatin1String("bio:") + s.basicArtist(true);
+	case Task_SimilarArtists: return QLatin1String("similar:") + s.basicArtist(true);
+	case Task_AlbumDetails: return QLatin1String("album:") + s.albumArtistOrComposer() + QLatin1Char('\n') + s.album;
+	case Task_TrackInfo: return QLatin1String("track:") + s.basicArtist() + QLatin1Char('\n') + s.basicTitle();
+	case Task_Lyrics: return QLatin1String("lyrics:") + s.basicArtist() + QLatin1Char('\n') + s.basicTitle();
+	}
+	return QString();
+}
+
+void ContextPrefetcher::engineResponse(const QString& resp, const QString& lang)
+{
+	if (!running) {
+		return;
+	}
+
+	// The views cache the untranslated response, so do the same here
+	if (!resp.isEmpty() && !lang.isEmpty()) {
+		const Song& song = current.song;
+		switch (current.type) {
+		case Task_ArtistBio: saveCompressed(ArtistView::cacheFileName(song.basicArtist(true), lang, false, true), resp); break;
+		case Task_AlbumDetails: saveCompressed(AlbumView::cacheFileName(Covers::fixArtist(song.albumArtistOrComposer()), song.album, lang, true), resp); break;
+		case Task_TrackInfo: saveCompressed(SongView::infoCacheFileName(song, lang, true), resp); break;
+		default: break;
+		}
+	}
+	taskFinished();
+}
+
+void ContextPrefetcher::similarResponse()
+{
+	NetworkJob* reply = qobject_cast<NetworkJob*>(sender());
+	if (!reply) {
+		return;
+	}
+	reply->deleteLater();
+	if (reply != job) {
+		return;
+	}
+	job = nullptr;
+	if (reply->ok()) {
+		QStringList artists = ArtistView::parseSimilarResponse(reply->readAll());
+		if (!artists.isEmpty()) {
+			ArtistView::saveSimilarArtists(current.song.basicArtist(true), artists);
+		}
+	}
+	taskFinished();
+}
+
+void ContextPrefetcher::lyricsReady(int id, const QString& lyrics)
+{
+	if (!running || id != lyricsId) {
+		return;
+	}
+
+	// Always save to the cache folder - SongView only writes into the music folder when the user has
+	// asked for lyrics for the song being played.
+	QString plain = LyricsFetcher::toPlainText(lyrics);
+	if (!plain.isEmpty()) {
+		QFile f(SongView::lyricsCacheFileName(current.song, true));
+		if (f.open(QIODevice::WriteOnly)) {
+			QTextStream stream(&f);
+#ifdef Q_OS_WIN
+			stream.setEncoding(QStringConverter::Utf8);
+			stream.setGenerateByteOrderMark(true);
+#endif
+			stream << plain;
+		}
+	}
+	taskFinished();
+}
+
+#include "moc_contextprefetcher.cpp"
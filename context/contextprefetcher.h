@@ -0,0 +1,97 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CONTEXT_PREFETCHER_H
+#define CONTEXT_PREFETCHER_H
+
+#include "mpd-interface/song.h"
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class ContextEngine;
+class LyricsFetcher;
+class NetworkJob;
+class QTimer;
+
+// Fills the context caches (artist biography and similar artists, album details, track information
+// and lyrics) and the cover cache for the songs that are due to play next - so that when the track
+// changes the context views can be populated from the cache, rather than waiting on the network.
+//
+// Lookups are made one at a time, with a pause between each, and only start a while after the
+// queue changes so that they do not compete with those for the current song. Anything that is
+// already cached is skipped.
+class ContextPrefetcher : public QObject {
+	Q_OBJECT
+
+	enum Type {
+		Task_Covers,
+		Task_ArtistBio,
+		Task_SimilarArtists,
+		Task_AlbumDetails,
+		Task_TrackInfo,
+		Task_Lyrics
+	};
+
+	struct Task {
+		Task(Type t = Task_Covers, const Song& s = Song()) : type(t), song(s) {}
+		Type type;
+		Song song;
+	};
+
+public:
+	static void enableDebug();
+
+	ContextPrefetcher(QObject* p);
+	~ContextPrefetcher() override;
+
+	// Songs expected to play next, in order. Lookups for songs no longer in the list are cancelled.
+	void setSongs(const QList<Song>& songs);
+	void cancel();
+
+private Q_SLOTS:
+	void startNext();
+	void engineResponse(const QString& resp, const QString& lang);
+	void similarResponse();
+	void lyricsReady(int id, const QString& lyrics);
+
+private:
+	bool start(const Task& task);
+	void taskFinished();
+	QString taskKey(const Task& task) const;
+
+private:
+	QStringList songKeys;
+	QList<Task> tasks;
+	Task current;
+	bool running;
+	QSet<QString> done;// Lookups attempted this session, successful or not
+	ContextEngine* engine;
+	LyricsFetcher* lyricsFetcher;
+	NetworkJob* job;
+	QTimer* timer;
+	int lyricsId;
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include "contextwidget.h"
 #include "albumview.h"
 #include "artistview.h"
+#include "contextprefetcher.h"
 #include "gui/apikeys.h"
 #include "gui/covers.h"
 #include "gui/settings.h"
@@ -245,7 +246,7 @@ void ThinSplitter::reset()
 }
 
 ContextWidget::ContextWidget(QWidget* parent)
-	: QWidget(parent), shown(false), job(nullptr), alwaysCollapsed(false), backdropType(PlayQueueView::BI_Cover), darkBackground(false), fadeValue(1.0), isWide(false), stack(nullptr), onlineContext(nullptr), splitter(nullptr), viewSelector(nullptr)
+	: QWidget(parent), shown(false), job(nullptr), alwaysCollapsed(false), backdropType(PlayQueueView::BI_Cover), darkBackground(false), fadeValue(1.0), isWide(false), stack(nullptr), onlineContext(nullptr), splitter(nullptr), viewSelector(nullptr), prefetcher(nullptr)
 {
 	QHBoxLayout* layout = new QHBoxLayout(this);
 	mainStack = new QStackedWidget(this);
@@ -600,7 +601,7 @@ void ContextWidget::search()
 	}
 }
 
-void ContextWidget::update(const Song& s)
+static Song contextSong(const Song& s)
 {
 	Song sng = s;
 	if (sng.isVariousArtists()) {
@@ -614,6 +615,12 @@ void ContextWidget::update(const Song& s)
 			sng.title = sng.title.mid(pos + 3);
 		}
 	}
+	return sng;
+}
+
+void ContextWidget::update(const Song& s)
+{
+	Song sng = contextSong(s);
 
 	if (s.albumArtist() != currentSong.albumArtist()) {
 		cancel();
@@ -650,6 +657,28 @@ void ContextWidget::update(const Song& s)
 	}
 }
 
+void ContextWidget::prefetch(const QList<Song>& songs)
+{
+	// Only worth fetching if the context view is being shown
+	if (!isVisible()) {
+		if (prefetcher) {
+			prefetcher->cancel();
+		}
+		return;
+	}
+	if (!prefetcher) {
+		prefetcher = new ContextPrefetcher(this);
+	}
+	QList<Song> fixed;
+	for (const Song& s : songs) {
+		// Streams have nothing to prefetch, their details change as they play
+		if (!s.isStream()) {
+			fixed.append(contextSong(s));
+		}
+	}
+	prefetcher->setSongs(fixed);
+}
+
 void ContextWidget::cancel()
 {
 	if (job) {
@@ -764,7 +793,7 @@ void ContextWidget::getMusicbrainzId(const QString& artist)
 	query.addQueryItem("query", "artist:" + artist);
 	url.setQuery(query);
 
-	job = NetworkAccessManager::self()->get(url);
+	job = NetworkAccessManager::self()->getCached(url, NetworkCache::Context);
 	DBUG << url.toString();
 	job->setProperty(constArtistProp, artist);
 	connect(job, SIGNAL(finished()), this, SLOT(musicbrainzResponse()));
@@ -834,7 +863,7 @@ void ContextWidget::musicbrainzResponse()
 		ApiKeys::self()->addKey(query, ApiKeys::FanArt);
 		url.setQuery(query);
 
-		job = NetworkAccessManager::self()->get(url);
+		job = NetworkAccessManager::self()->getCached(url, NetworkCache::Context);
 		DBUG << url.toString();
 		connect(job, SIGNAL(finished()), this, SLOT(fanArtResponse()));
 	}
@@ -42,6 +42,7 @@ class QToolButton;
 class QButtonGroup;
 class QWheelEvent;
 class OnlineView;
+class ContextPrefetcher;
 
 class ViewSelector : public QWidget {
 	Q_OBJECT
@@ -98,6 +99,7 @@ public:
 	void saveConfig();
 	void useDarkBackground(bool u);
 	void update(const Song& s);
+	void prefetch(const QList<Song>& songs);
 	void showEvent(QShowEvent* e) override;
 	void paintEvent(QPaintEvent* e) override;
 	float fade() { return fadeValue; }
@@ -159,6 +161,7 @@ private:
 	OnlineView* onlineContext;
 	ThinSplitter* splitter;
 	ViewSelector* viewSelector;
+	ContextPrefetcher* prefetcher;
 };
 
 #endif
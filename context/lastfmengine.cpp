@@ -89,7 +89,7 @@ void LastFmEngine::search(const QStringList& query, Mode mode)
 
 	url.setQuery(urlQuery);
 
-	job = NetworkAccessManager::self()->get(url);
+	job = NetworkAccessManager::self()->getCached(url, NetworkCache::Context);
 	job->setProperty(constModeProperty, (int)mode);
 
 	QStringList queryString;
@@ -0,0 +1,380 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "lyricsfetcher.h"
+#include "songview.h"
+#include "support/utils.h"
+#include "ultimatelyrics.h"
+#include "ultimatelyricsprovider.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QTextDocument>
+#include <QTimer>
+#include <algorithm>
+
+static bool debugEnabled = false;
+#define DBUG \
+	if (debugEnabled) qWarning() << "LyricsFetcher" << __FUNCTION__
+void LyricsFetcher::enableDebug()
+{
+	debugEnabled = true;
+}
+
+static const int constParallel = 3;
+static const int constMaxParallel = 5;// Including hedged requests
+static const qint64 constTimeout = 15000;
+static const qint64 constGracePeriod = 1500;
+static const qint64 constMinHedgeTime = 2000;
+static const quint32 constDefaultLatency = 3000;
+static const quint32 constMaxHistory = 50;
+static const quint32 constStatsVersion = 1;
+static const QLatin1String constStatsFile("providers.stats");
+
+struct ProviderStats {
+	ProviderStats() : attempts(0), successes(0), latency(0) {}
+	quint32 attempts;
+	quint32 successes;
+	quint32 latency;// Average response time in ms, 0 if not yet known
+};
+
+static QHash<QString, ProviderStats> stats;
+static bool statsLoaded = false;
+static bool statsModified = false;
+static int lastRequestId = 0;
+
+struct Candidate {
+	Candidate(UltimateLyricsProvider* p, int pr, double sc) : provider(p), priority(pr), score(sc) {}
+	UltimateLyricsProvider* provider;
+	int priority;
+	double score;
+};
+
+static bool compareCandidates(const Candidate& a, const Candidate& b)
+{
+	return a.score < b.score;
+}
+
+static QString statsFileName(bool createDir)
+{
+	QString dir = Utils::cacheDir(SongView::constLyricsDir, createDir);
+	return dir.isEmpty() ? QString() : dir + constStatsFile;
+}
+
+static void loadStats()
+{
+	statsLoaded = true;
+	QString fileName = statsFileName(false);
+	if (fileName.isEmpty()) {
+		return;
+	}
+	QFile f(fileName);
+	if (f.open(QIODevice::ReadOnly)) {
+		QDataStream stream(&f);
+		quint32 version = 0;
+		quint32 count = 0;
+		stream >> version >> count;
+		if (constStatsVersion != version) {
+			return;
+		}
+		for (quint32 i = 0; i < count && QDataStream::Ok == stream.status(); ++i) {
+			QString name;
+			ProviderStats s;
+			stream >> name >> s.attempts >> s.successes >> s.latency;
+			if (QDataStream::Ok == stream.status()) {
+				stats.insert(name, s);
+			}
+		}
+	}
+}
+
+static void saveStats()
+{
+	if (!statsModified) {
+		return;
+	}
+	QString fileName = statsFileName(true);
+	if (fileName.isEmpty()) {
+		return;
+	}
+	QFile f(fileName);
+	if (f.open(QIODevice::WriteOnly)) {
+		QDataStream stream(&f);
+		stream << constStatsVersion << (quint32)stats.count();
+		for (auto it = stats.constBegin(), end = stats.constEnd(); it != end; ++it) {
+			stream << it.key() << it.value().attempts << it.value().successes << it.value().latency;
+		}
+		statsModified = false;
+	}
+}
+
+static void record(const QString& name, bool ok, qint64 time)
+{
+	ProviderStats& s = stats[name];
+	s.attempts++;
+	if (ok) {
+		s.successes++;
+	}
+	s.latency = (quint32)(s.latency ? ((s.latency * 3) + time) / 4 : time);
+	// Halve counts, so that recent behaviour has more effect
+	if (s.attempts > constMaxHistory) {
+		s.attempts /= 2;
+		s.successes /= 2;
+	}
+	statsModified = true;
+	DBUG << name << ok << time << s.successes << s.attempts << s.latency;
+}
+
+static qint64 expectedTime(const QString& name)
+{
+	quint32 latency = stats.value(name).latency;
+	return qMax(constMinHedgeTime, 2 * (qint64)(latency ? latency : constDefaultLatency));
+}
+
+QString LyricsFetcher::toPlainText(const QString& lyrics)
+{
+	// Same conversion as SongView uses for display
+	QString html = QString(lyrics).replace("\\n", "\n").replace("\\t", " ").replace("\t", " ").replace(QLatin1String("\n\n\n"), QLatin1String("\n\n")).replace("\n", "<br/>");
+	QTextDocument doc;
+	doc.setHtml(html);
+	return doc.toPlainText().trimmed();
+}
+
+LyricsFetcher::LyricsFetcher(QObject* p)
+	: QObject(p), currentId(-1), requestId(0), firstResult(0), starting(false)
+{
+	timer = new QTimer(this);
+	timer->setInterval(250);
+	connect(timer, SIGNAL(timeout()), SLOT(checkAttempts()));
+	clock.start();
+	if (!statsLoaded) {
+		loadStats();
+	}
+}
+
+LyricsFetcher::~LyricsFetcher()
+{
+	// Providers are owned by UltimateLyrics, which may already have released them - so just save.
+	saveStats();
+}
+
+QStringList LyricsFetcher::fetch(int id, const Song& song)
+{
+	abort();
+
+	// Order providers by expected time to a successful result. Use the user's order to break ties, and
+	// as a slight bias, so that with no history the providers are queried in the configured order.
+	QList<Candidate> candidates;
+	int priority = 0;
+	for (UltimateLyricsProvider* provider : UltimateLyrics::self()->getProviders()) {
+		if (!provider->isEnabled()) {
+			continue;
+		}
+		if (!tried.contains(provider->getName())) {
+			const ProviderStats s = stats.value(provider->getName());
+			double rate = (s.successes + 1.0) / (s.attempts + 2.0);
+			double latency = s.latency ? s.latency : constDefaultLatency;
+			candidates.append(Candidate(provider, priority, (latency / rate) * (1.0 + (0.25 * priority))));
+		}
+		priority++;
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), compareCandidates);
+	for (const Candidate& c : candidates) {
+		queue.append(qMakePair(c.provider, c.priority));
+	}
+
+	if (queue.isEmpty()) {
+		return QStringList();
+	}
+
+	currentId = id;
+	requestId = ++lastRequestId;
+	currentSong = song;
+	QStringList names;
+	// A provider may fail from within fetchInfo(), so hold off on choosing a result until the caller
+	// has been given the list of providers.
+	starting = true;
+	while (running.count() < constParallel && !queue.isEmpty()) {
+		names.append(queue.first().first->displayName());
+		startNext();
+	}
+	starting = false;
+	timer->start();
+	QMetaObject::invokeMethod(this, "checkAttempts", Qt::QueuedConnection);
+	return names;
+}
+
+void LyricsFetcher::abort()
+{
+	timer->stop();
+	for (const Attempt& a : running) {
+		if (a.provider) {
+			a.provider->abort(requestId);
+		}
+	}
+	running.clear();
+	queue.clear();
+	results.clear();
+	resultProviders.clear();
+	currentId = -1;
+}
+
+void LyricsFetcher::reset()
+{
+	abort();
+	tried.clear();
+}
+
+void LyricsFetcher::providerReady(int id, const QString& data)
+{
+	UltimateLyricsProvider* provider = qobject_cast<UltimateLyricsProvider*>(sender());
+	if (!provider || !isActive() || id != requestId) {
+		return;
+	}
+
+	int idx = -1;
+	for (int i = 0; i < running.count() && -1 == idx; ++i) {
+		if (running.at(i).provider == provider) {
+			idx = i;
+		}
+	}
+	if (-1 == idx) {
+		return;
+	}
+
+	Attempt a = running.takeAt(idx);
+	bool ok = !toPlainText(data).isEmpty();
+	record(provider->getName(), ok, clock.elapsed() - a.started);
+	tried.insert(provider->getName());
+	if (ok) {
+		if (results.isEmpty()) {
+			firstResult = clock.elapsed();
+		}
+		results.insert(a.priority, data.trimmed());
+		resultProviders.insert(a.priority, provider->getName());
+	}
+	fill();
+	decide();
+}
+
+void LyricsFetcher::checkAttempts()
+{
+	if (!isActive()) {
+		timer->stop();
+		return;
+	}
+
+	qint64 now = clock.elapsed();
+	bool allOverdue = !running.isEmpty();
+	for (int i = 0; i < running.count();) {
+		const Attempt& a = running.at(i);
+		qint64 time = now - a.started;
+		if (!a.provider || time >= constTimeout) {
+			if (a.provider) {
+				DBUG << a.provider->getName() << "timed out";
+				record(a.provider->getName(), false, time);
+				tried.insert(a.provider->getName());
+				a.provider->abort(requestId);
+			}
+			running.removeAt(i);
+			continue;
+		}
+		if (time < a.expected) {
+			allOverdue = false;
+		}
+		++i;
+	}
+
+	// Every running request is slower than usual, so hedge with another provider
+	if (allOverdue && results.isEmpty() && running.count() < constMaxParallel && !queue.isEmpty()) {
+		DBUG << "Hedging with" << queue.first().first->getName();
+		startNext();
+	}
+	fill();
+	decide();
+}
+
+void LyricsFetcher::startNext()
+{
+	QPair<UltimateLyricsProvider*, int> next = queue.takeFirst();
+	Attempt a;
+	a.provider = next.first;
+	a.priority = next.second;
+	a.started = clock.elapsed();
+	a.expected = expectedTime(next.first->getName());
+	// Add before calling fetchInfo(), as this may fail at once and call providerReady()
+	running.append(a);
+	DBUG << next.first->getName() << a.priority << a.expected;
+	connect(next.first, SIGNAL(lyricsReady(int, QString)), this, SLOT(providerReady(int, QString)), Qt::UniqueConnection);
+	next.first->fetchInfo(requestId, currentSong);
+}
+
+void LyricsFetcher::fill()
+{
+	// Once there is a result only higher priority providers that are already running are waited on
+	while (!starting && isActive() && results.isEmpty() && running.count() < constParallel && !queue.isEmpty()) {
+		startNext();
+	}
+}
+
+void LyricsFetcher::decide()
+{
+	if (starting || !isActive()) {
+		return;
+	}
+
+	if (!results.isEmpty()) {
+		int best = results.firstKey();
+		bool higherRunning = false;
+		for (const Attempt& a : running) {
+			if (a.priority < best) {
+				higherRunning = true;
+				break;
+			}
+		}
+		if (!higherRunning || clock.elapsed() - firstResult >= constGracePeriod) {
+			DBUG << "Using" << resultProviders.value(best);
+			// Any other results were not shown, so allow a refresh to fetch these again
+			for (auto it = resultProviders.constBegin(), end = resultProviders.constEnd(); it != end; ++it) {
+				if (it.key() != best) {
+					tried.remove(it.value());
+				}
+			}
+			finish(results.value(best));
+		}
+	}
+	else if (running.isEmpty() && queue.isEmpty()) {
+		DBUG << "No lyrics found";
+		finish(QString());
+	}
+}
+
+void LyricsFetcher::finish(const QString& lyrics)
+{
+	int id = currentId;
+	abort();
+	emit lyricsReady(id, lyrics);
+}
+
+#include "moc_lyricsfetcher.cpp"
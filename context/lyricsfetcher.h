@@ -0,0 +1,110 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LYRICS_FETCHER_H
+#define LYRICS_FETCHER_H
+
+#include "mpd-interface/song.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+class UltimateLyricsProvider;
+class QTimer;
+
+// Queries several lyrics providers at once, rather than waiting for each one to fail in turn.
+//
+// Up to constParallel providers are queried together, and if these are all slower than expected a
+// further one is started (a 'hedged' request). Results are accepted in the user's provider order -
+// a result from a lower priority provider is only used once all of the higher priority providers
+// that are still running have failed, or after a short grace period. Once a result is chosen all
+// other requests are cancelled.
+//
+// The success rate and response time of each provider are recorded, and used to decide which
+// providers are started first, so that unreliable or slow providers are only tried once the
+// others have failed. These statistics are shared by all LyricsFetcher instances, and are saved in the
+// lyrics cache folder.
+class LyricsFetcher : public QObject {
+	Q_OBJECT
+
+	struct Attempt {
+		QPointer<UltimateLyricsProvider> provider;
+		int priority;
+		qint64 started;
+		qint64 expected;
+	};
+
+public:
+	static void enableDebug();
+	// Lyrics as they will be displayed, and saved, by SongView
+	static QString toPlainText(const QString& lyrics);
+
+	LyricsFetcher(QObject* p);
+	~LyricsFetcher() override;
+
+	// Start fetching lyrics for song, using only those providers that have not already returned a
+	// result (or failed) since the last call to reset(). This allows a refresh to cycle through the
+	// lyrics offered by each provider. Returns the display names of the providers queried, or an
+	// empty list if there are none left to try.
+	QStringList fetch(int id, const Song& song);
+	bool isActive() const { return -1 != currentId; }
+	// Cancel any outstanding requests
+	void abort();
+	// Cancel, and forget which providers have been tried
+	void reset();
+
+Q_SIGNALS:
+	// lyrics is empty if no provider found any
+	void lyricsReady(int id, const QString& lyrics);
+
+private Q_SLOTS:
+	void providerReady(int id, const QString& data);
+	void checkAttempts();
+
+private:
+	void startNext();
+	void fill();
+	void decide();
+	void finish(const QString& lyrics);
+
+private:
+	int currentId;
+	int requestId;// Id passed to providers, unique across all instances as these share the providers
+	Song currentSong;
+	QList<QPair<UltimateLyricsProvider*, int> > queue;
+	QList<Attempt> running;
+	QMap<int, QString> results;// Acceptable results, keyed on provider priority
+	QMap<int, QString> resultProviders;
+	qint64 firstResult;
+	bool starting;
+	QSet<QString> tried;
+	QElapsedTimer clock;
+	QTimer* timer;
+};
+
+#endif
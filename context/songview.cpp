@@ -26,11 +26,11 @@
 #include "gui/covers.h"
 #include "gui/settings.h"
 #include "lyricsdialog.h"
+#include "lyricsfetcher.h"
 #include "support/messagebox.h"
 #include "support/squeezedtextlabel.h"
 #include "support/utils.h"
 #include "ultimatelyrics.h"
-#include "ultimatelyricsprovider.h"
 #ifdef TagLib_FOUND
 #include "tags/tags.h"
 #endif
@@ -63,7 +63,7 @@ const QLatin1String SongView::constExtension(".lyrics");
 const QLatin1String SongView::constCacheDir("tracks/");
 const QLatin1String SongView::constInfoExt(".html.gz");
 
-static QString infoCacheFileName(const Song& song, const QString& lang, bool createDir)
+QString SongView::infoCacheFileName(const Song& song, const QString& lang, bool createDir)
 {
 	QString dir = Utils::cacheDir(SongView::constCacheDir + Covers::encodeName(song.basicArtist()) + Utils::constDirSep, createDir);
 	if (dir.isEmpty()) {
@@ -72,7 +72,7 @@ static QString infoCacheFileName(const Song& song, const QString& lang, bool cre
 	return dir + Covers::encodeName(song.basicTitle()) + "." + lang + SongView::constInfoExt;
 }
 
-static QString lyricsCacheFileName(const Song& song, bool createDir = false)
+QString SongView::lyricsCacheFileName(const Song& song, bool createDir)
 {
 	QString dir = Utils::cacheDir(SongView::constLyricsDir + Covers::encodeName(song.basicArtist()) + Utils::constDirSep, createDir);
 	if (dir.isEmpty()) {
@@ -88,7 +88,7 @@ static QString lyricsOtherFileName(const Song& song)
 }
 #endif
 
-static inline QString mpdLyricsFilePath(const Song& song)
+QString SongView::mpdLyricsFilePath(const Song& song)
 {
 	return Utils::changeExtension(song.filePath(MPDConnection::self()->getDetails().dir), SongView::constExtension);
 }
@@ -99,7 +99,7 @@ static inline QString fixNewLines(const QString& o)
 }
 
 SongView::SongView(QWidget* p)
-	: View(p, QStringList() << tr("Lyrics") << tr("Information") << tr("Metadata")), scrollTimer(nullptr), songPos(0), currentProvider(-1), currentRequest(0), mode(Mode_Display), job(nullptr), currentProv(nullptr), lyricsNeedsUpdating(true), infoNeedsUpdating(true), metadataNeedsUpdating(true)
+	: View(p, QStringList() << tr("Lyrics") << tr("Information") << tr("Metadata")), scrollTimer(nullptr), songPos(0), currentRequest(0), mode(Mode_Display), job(nullptr), lyricsNeedsUpdating(true), infoNeedsUpdating(true), metadataNeedsUpdating(true)
 {
 	scrollAction = ActionCollection::get()->createAction("scrolllyrics", tr("Scroll Lyrics"), Icons::self()->downIcon);
 	refreshAction = ActionCollection::get()->createAction("refreshlyrics", tr("Refresh Lyrics"), Icons::self()->refreshIcon);
@@ -112,7 +112,8 @@ SongView::SongView(QWidget* p)
 	connect(refreshAction, SIGNAL(triggered()), SLOT(update()));
 	connect(editAction, SIGNAL(triggered()), SLOT(edit()));
 	connect(delAction, SIGNAL(triggered()), SLOT(del()));
-	connect(UltimateLyrics::self(), SIGNAL(lyricsReady(int, QString)), SLOT(lyricsReady(int, QString)));
+	lyricsFetcher = new LyricsFetcher(this);
+	connect(lyricsFetcher, SIGNAL(lyricsReady(int, QString)), SLOT(lyricsReady(int, QString)));
 
 	engine = ContextEngine::create(this);
 	refreshInfoAction = ActionCollection::get()->createAction("refreshtrack", tr("Refresh Track Information"), Icons::self()->refreshIcon);
@@ -139,6 +140,7 @@ SongView::SongView(QWidget* p)
 
 SongView::~SongView()
 {
+	lyricsFetcher->reset();
 	UltimateLyrics::self()->release();
 }
 
@@ -720,11 +722,9 @@ void SongView::abort()
 		job->cancelAndDelete();
 		job = nullptr;
 	}
-	currentProvider = -1;
-	if (currentProv) {
-		currentProv->abort();
-		currentProv = nullptr;
-
+	bool fetchingLyrics = lyricsFetcher->isActive();
+	lyricsFetcher->reset();
+	if (fetchingLyrics) {
 		text->setText(QString());
 		// Set lyrics file anyway - so that editing is enabled!
 		lyricsFile = Settings::self()->storeLyricsInMpdDir() && !currentSong.isNonMPD()
@@ -777,7 +777,7 @@ void SongView::update(const Song& s, bool force)
 		// changed. Otherwise we'll keep the provider so the user can cycle through the lyrics
 		// offered by the various providers.
 		if (!force || songChanged) {
-			currentProvider = -1;
+			lyricsFetcher->reset();
 		}
 	}
 
@@ -883,15 +883,14 @@ QString SongView::cacheFileName() const
 
 void SongView::getLyrics()
 {
-	currentProv = UltimateLyrics::self()->getNext(currentProvider);
-	if (currentProv) {
-		text->setText(tr("Fetching lyrics via %1").arg(currentProv->displayName()));
-		currentProv->fetchInfo(currentRequest, currentSong);
+	QStringList providers = lyricsFetcher->fetch(currentRequest, currentSong);
+	if (!providers.isEmpty()) {
+		text->setText(tr("Fetching lyrics via %1").arg(providers.join(QLatin1String(", "))));
 		showSpinner();
 	}
 	else {
 		text->setText(QString());
-		currentProvider = -1;
+		lyricsFetcher->reset();
 		// Set lyrics file anyway - so that editing is enabled!
 		lyricsFile = Settings::self()->storeLyricsInMpdDir() && !currentSong.isNonMPD()
 				? mpdLyricsFilePath(currentSong)
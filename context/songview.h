@@ -28,7 +28,7 @@
 #include "view.h"
 #include <QWidget>
 
-class UltimateLyricsProvider;
+class LyricsFetcher;
 class QImage;
 class Action;
 class NetworkJob;
@@ -55,6 +55,10 @@ public:
 	static const QLatin1String constCacheDir;
 	static const QLatin1String constInfoExt;
 
+	static QString infoCacheFileName(const Song& song, const QString& lang, bool createDir);
+	static QString lyricsCacheFileName(const Song& song, bool createDir = false);
+	static QString mpdLyricsFilePath(const Song& song);
+
 	SongView(QWidget* p);
 	~SongView() override;
 
@@ -111,7 +115,6 @@ private:
 private:
 	QTimer* scrollTimer;
 	qint32 songPos;
-	int currentProvider;
 	int currentRequest;
 	Action* scrollAction;
 	Action* refreshAction;
@@ -121,7 +124,7 @@ private:
 	QString lyricsFile;
 	QString preEdit;
 	NetworkJob* job;
-	UltimateLyricsProvider* currentProv;
+	LyricsFetcher* lyricsFetcher;
 
 	bool lyricsNeedsUpdating;
 	bool infoNeedsUpdating;
@@ -135,21 +135,6 @@ UltimateLyricsProvider* UltimateLyrics::providerByName(const QString& name) cons
 	return nullptr;
 }
 
-UltimateLyricsProvider* UltimateLyrics::getNext(int& index)
-{
-	load();
-	index++;
-	if (index > -1 && index < providers.count()) {
-		for (int i = index; i < providers.count(); ++i) {
-			if (providers.at(i)->isEnabled()) {
-				index = i;
-				return providers.at(i);
-			}
-		}
-	}
-	return nullptr;
-}
-
 void UltimateLyrics::load()
 {
 	if (!providers.isEmpty()) {
@@ -184,7 +169,6 @@ void UltimateLyrics::load()
 						UltimateLyricsProvider* provider = parseProvider(&reader);
 						if (provider) {
 							providers << provider;
-							connect(provider, SIGNAL(lyricsReady(int, QString)), this, SIGNAL(lyricsReady(int, QString)));
 							providerNames.insert(name);
 						}
 					}
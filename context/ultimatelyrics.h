@@ -35,14 +35,10 @@ public:
 	static UltimateLyrics* self();
 	UltimateLyrics() {}
 
-	UltimateLyricsProvider* getNext(int& index);
 	const QList<UltimateLyricsProvider*> getProviders();
 	void release();
 	void setEnabled(const QStringList& enabled);
 
-Q_SIGNALS:
-	void lyricsReady(int id, const QString& data);
-
 private:
 	UltimateLyricsProvider* providerByName(const QString& name) const;
 	void load();
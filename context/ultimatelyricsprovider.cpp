@@ -245,7 +245,7 @@ void UltimateLyricsProvider::fetchInfo(int id, Song metadata, bool removeThe)
 		query.addQueryItem(QLatin1String("fmt"), QLatin1String("xml"));
 		url.setQuery(query);
 
-		NetworkJob* reply = NetworkAccessManager::self()->get(url);
+		NetworkJob* reply = NetworkAccessManager::self()->getCached(url, NetworkCache::Context);
 		requests[reply] = id;
 		connect(reply, SIGNAL(finished()), this, SLOT(wikiMediaSearchResponse()));
 		return;
@@ -285,7 +285,7 @@ void UltimateLyricsProvider::fetchInfo(int id, Song metadata, bool removeThe)
 
 	QNetworkRequest req(url);
 	req.setRawHeader("User-Agent", "Mozilla/5.0 (X11; Linux i686; rv:6.0) Gecko/20100101 Firefox/6.0");
-	NetworkJob* reply = NetworkAccessManager::self()->get(req);
+	NetworkJob* reply = NetworkAccessManager::self()->getCached(req, NetworkCache::Context);
 	requests[reply] = id;
 	connect(reply, SIGNAL(finished()), this, SLOT(lyricsFetched()));
 }
@@ -302,6 +302,22 @@ void UltimateLyricsProvider::abort()
 	songs.clear();
 }
 
+void UltimateLyricsProvider::abort(int id)
+{
+	QHash<NetworkJob*, int>::Iterator it(requests.begin());
+
+	while (it != requests.end()) {
+		if (it.value() == id) {
+			it.key()->cancelAndDelete();
+			it = requests.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	songs.remove(id);
+}
+
 void UltimateLyricsProvider::wikiMediaSearchResponse()
 {
 	NetworkJob* reply = qobject_cast<NetworkJob*>(sender());
@@ -340,7 +356,7 @@ void UltimateLyricsProvider::wikiMediaSearchResponse()
 		QString path = url.path();
 		QByteArray u = url.scheme().toLatin1() + "://" + url.host().toLatin1() + "/api.php?action=query&prop=revisions&rvprop=content&format=xml&titles=";
 		QByteArray titles = QUrl::toPercentEncoding(path.startsWith(QLatin1Char('/')) ? path.mid(1) : path).replace('+', "%2b");
-		NetworkJob* reply = NetworkAccessManager::self()->get(QUrl::fromEncoded(u + titles));
+		NetworkJob* reply = NetworkAccessManager::self()->getCached(QUrl::fromEncoded(u + titles), NetworkCache::Context);
 		requests[reply] = id;
 		connect(reply, SIGNAL(finished()), this, SLOT(wikiMediaLyricsFetched()));
 	}
@@ -61,6 +61,7 @@ public:
 	bool isEnabled() const { return enabled; }
 	void setEnabled(bool e) { enabled = e; }
 	void abort();
+	void abort(int id);
 
 Q_SIGNALS:
 	void lyricsReady(int id, const QString& data);
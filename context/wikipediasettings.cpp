@@ -173,7 +173,7 @@ void WikipediaSettings::getLangs()
 
 	url.setQuery(q);
 
-	job = NetworkAccessManager::self()->get(url);
+	job = NetworkAccessManager::self()->getCached(url, NetworkCache::Context);
 	connect(job, SIGNAL(finished()), this, SLOT(parseLangs()));
 }
 
@@ -22,6 +22,7 @@
  */
 
 #include "librarydb.h"
+#include "support/perfstats.h"
 #include "support/utils.h"
 #include <QCoreApplication>
 #include <QDebug>
@@ -33,7 +34,7 @@
 #include <QSqlQuery>
 #include <algorithm>
 
-static const int constSchemaVersion = 5;
+static const int constSchemaVersion = 6;
 
 bool LibraryDb::dbgEnabled = false;
 #define DBUG \
@@ -388,11 +389,54 @@ static QString albumSort(const Song& s)
 	return Song::sortString(s.album);
 }
 
+// Add an album - or merge it into the entry with the same key. If haveUniqueId is set then the album is grouped
+// purely by its id, and the names of all of its artists are collected so that they can be joined afterwards.
+static void addAlbum(QMap<QString, LibraryDb::Album>& entries, QMap<QString, QSet<QString>>& albumIdArtists, const QString& key, const LibraryDb::Album& album)
+{
+	QMap<QString, LibraryDb::Album>::iterator it = entries.find(key);
+
+	if (it == entries.end()) {
+		entries.insert(key, album);
+	}
+	else {
+		LibraryDb::Album& al = it.value();
+		al.lastModified = qMax(al.lastModified, album.lastModified);
+		al.year = qMax(al.year, album.year);
+		al.duration += album.duration;
+		al.trackCount += album.trackCount;
+	}
+	if (album.identifyById) {
+		QMap<QString, QSet<QString>>::iterator aIt = albumIdArtists.find(key);
+		if (aIt == albumIdArtists.end()) {
+			albumIdArtists.insert(key, QSet<QString>() << album.artist);
+		}
+		else {
+			aIt.value().insert(album.artist);
+		}
+	}
+}
+
+static QList<LibraryDb::Album> albumList(QMap<QString, LibraryDb::Album>& entries, const QMap<QString, QSet<QString>>& albumIdArtists)
+{
+	QMap<QString, QSet<QString>>::ConstIterator aIt = albumIdArtists.constBegin();
+	QMap<QString, QSet<QString>>::ConstIterator aEnd = albumIdArtists.constEnd();
+	for (; aIt != aEnd; ++aIt) {
+		if (aIt.value().count() > 1) {
+			QStringList artists = aIt.value().values();
+			artists.sort();
+			LibraryDb::Album& al = entries.find(aIt.key()).value();
+			al.artist = artists.join(", ");
+			al.artistSort = QString();
+		}
+	}
+	return entries.values();
+}
+
 // Code taken from Clementine's LibraryQuery
 class SqlQuery {
 public:
 	SqlQuery(const QString& colSpec, QSqlDatabase& database)
-		: db(database), fts(false), columSpec(colSpec), limit(0)
+		: db(database), fts(false), columSpec(colSpec), limit(0), offset(0)
 	{
 	}
 
@@ -454,6 +498,11 @@ public:
 		limit = l;
 	}
 
+	void setOffset(int o)
+	{
+		offset = o;
+	}
+
 	bool exec()
 	{
 		QString sql = fts
@@ -468,6 +517,9 @@ public:
 		}
 		if (limit > 0) {
 			sql += " LIMIT " + QString::number(limit);
+			if (offset > 0) {
+				sql += " OFFSET " + QString::number(offset);
+			}
 		}
 		query = QSqlQuery(db);
 		query.prepare(sql);
@@ -493,10 +545,11 @@ private:
 	QVariantList boundValues;
 	QString order;
 	int limit;
+	int offset;
 };
 
 LibraryDb::LibraryDb(QObject* p, const QString& name)
-	: QObject(p), dbName(name), currentVersion(0), newVersion(0), db(nullptr), insertSongQuery(nullptr)
+	: QObject(p), dbName(name), currentVersion(0), newVersion(0), fileInstance(0), db(nullptr), insertSongQuery(nullptr), updateSongQuery(nullptr), insertFtsQuery(nullptr), updateFtsQuery(nullptr), incrementalSync(false), syncing(false), rebuildSummaries(false), storedAlbumQuery(nullptr)
 {
 	DBUG;
 }
@@ -521,6 +574,7 @@ void LibraryDb::erase()
 	reset();
 	if (!dbFileName.isEmpty() && QFile::exists(dbFileName)) {
 		QFile::remove(dbFileName);
+		fileInstance++;
 	}
 }
 
@@ -632,56 +686,133 @@ bool LibraryDb::init(const QString& dbFile)
 		DBUG << "Failed to create songs table";
 		return false;
 	}
+
+	// Summary tables, maintained by updateSummaries(). A genre of "" holds the totals across all genres.
+	QString albumsTable = "albums (genre text, artistId text, albumId text, album text, albumSort text, artistSort text, artist text, albumArtist text, composer text, ";
+	for (int i = 0; i < Song::constNumGenres; ++i) {
+		albumsTable += "genre" + QString::number(i + 1) + " text, ";
+	}
+	albumsTable += "type integer, year integer, origYear integer, tracks integer, time integer, lastModified integer)";
+	if (!createTable(albumsTable) || !createTable("artists (genre text, artistId text, artistSort text, albums integer)") || !createTable("genres (genre text, artists integer)")) {
+		DBUG << "Failed to create summary tables";
+		return false;
+	}
+	QSqlQuery(*db).exec("create index if not exists albums_idx on albums(genre, artistId)");
+	QSqlQuery(*db).exec("create index if not exists albums_album_idx on albums(artistId, albumId)");
+	QSqlQuery(*db).exec("create index if not exists artists_idx on artists(genre)");
+	// Used to find the tracks of changed albums when updating the summaries
+	QSqlQuery(*db).exec("create index if not exists songs_album_idx on songs(artistId, albumId)");
+	rebuildSummaries = 0 == currentVersion;
 	emit libraryUpdated();
 	DBUG << "Created";
 	return true;
 }
 
-void LibraryDb::insertSong(const Song& s)
+// Open an existing database for querying only, e.g. from another thread whilst the main connection updates it.
+// The version and instance should be those of the main connection, as the versions table is only read by init().
+// If the main connection has since deleted and recreated the file, the old connection would still be reading the
+// deleted file - so reopen.
+bool LibraryDb::openReadOnly(const QString& dbFile, time_t version, quint32 instance)
 {
+	if (dbFile != dbFileName || instance != fileInstance) {
+		reset();
+		dbFileName = dbFile;
+		fileInstance = instance;
+	}
 	if (!db) {
-		return;
+		DBUG << dbFile << dbName;
+		db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", dbName));
+		db->setDatabaseName(dbFile);
+		db->setConnectOptions("QSQLITE_OPEN_READONLY");
+		if (!db->open()) {
+			DBUG << "Failed to open";
+			delete db;
+			db = nullptr;
+			QSqlDatabase::removeDatabase(dbName);
+			return false;
+		}
+	}
+	currentVersion = version;
+	return true;
+}
+
+static void bindSong(QSqlQuery* query, const Song& s)
+{
+	QString albumId = s.albumId();
+	query->bindValue(":file", s.file);
+	query->bindValue(":artist", s.artist);
+	query->bindValue(":artistId", s.albumArtistOrComposer());
+	query->bindValue(":albumArtist", s.albumartist);
+	query->bindValue(":artistSort", artistSort(s));
+	query->bindValue(":composer", s.composer());
+	query->bindValue(":album", s.album == albumId ? QString() : s.album);
+	query->bindValue(":albumId", albumId);
+	query->bindValue(":albumSort", albumSort(s));
+	query->bindValue(":title", s.title);
+	for (int i = 0; i < Song::constNumGenres; ++i) {
+		query->bindValue(":genre" + QString::number(i + 1), s.genres[i].isEmpty() ? LibraryDb::constNullGenre : s.genres[i]);
+	}
+	query->bindValue(":track", s.track);
+	query->bindValue(":disc", s.disc);
+	query->bindValue(":time", s.time);
+	query->bindValue(":year", s.year);
+	query->bindValue(":origYear", s.origYear);
+	query->bindValue(":type", s.type);
+	query->bindValue(":lastModified", s.lastModified);
+}
+
+// Bind the FTS columns - these MUST match what updateFinished() copies from the songs table
+static void bindFts(QSqlQuery* query, qint64 rowId, const Song& s)
+{
+	QString albumId = s.albumId();
+	query->bindValue(":rowId", rowId);
+	query->bindValue(":artist", s.artist);
+	query->bindValue(":artistId", s.albumArtistOrComposer());
+	query->bindValue(":album", s.album == albumId ? QString() : s.album);
+	query->bindValue(":albumId", albumId);
+	query->bindValue(":title", s.title);
+}
+
+bool LibraryDb::insertSong(const Song& s)
+{
+	if (!db) {
+		return false;
 	}
 	if (!insertSongQuery) {
 		insertSongQuery = new QSqlQuery(*db);
 		insertSongQuery->prepare("insert into songs(file, artist, artistId, albumArtist, artistSort, composer, album, albumId, albumSort, title, genre1, genre2, genre3, genre4, track, disc, time, year, origYear, type, lastModified) "
 		                         "values(:file, :artist, :artistId, :albumArtist, :artistSort, :composer, :album, :albumId, :albumSort, :title, :genre1, :genre2, :genre3, :genre4, :track, :disc, :time, :year, :origYear, :type, :lastModified)");
 	}
-	QString albumId = s.albumId();
-	insertSongQuery->bindValue(":file", s.file);
-	insertSongQuery->bindValue(":artist", s.artist);
-	insertSongQuery->bindValue(":artistId", s.albumArtistOrComposer());
-	insertSongQuery->bindValue(":albumArtist", s.albumartist);
-	insertSongQuery->bindValue(":artistSort", artistSort(s));
-	insertSongQuery->bindValue(":composer", s.composer());
-	insertSongQuery->bindValue(":album", s.album == albumId ? QString() : s.album);
-	insertSongQuery->bindValue(":albumId", albumId);
-	insertSongQuery->bindValue(":albumSort", albumSort(s));
-	insertSongQuery->bindValue(":title", s.title);
-	for (int i = 0; i < Song::constNumGenres; ++i) {
-		insertSongQuery->bindValue(":genre" + QString::number(i + 1), s.genres[i].isEmpty() ? constNullGenre : s.genres[i]);
-	}
-	insertSongQuery->bindValue(":track", s.track);
-	insertSongQuery->bindValue(":disc", s.disc);
-	insertSongQuery->bindValue(":time", s.time);
-	insertSongQuery->bindValue(":year", s.year);
-	insertSongQuery->bindValue(":origYear", s.origYear);
-	insertSongQuery->bindValue(":type", s.type);
-	insertSongQuery->bindValue(":lastModified", s.lastModified);
+	bindSong(insertSongQuery, s);
 	if (!insertSongQuery->exec()) {
 		qWarning() << "insert failed" << insertSongQuery->lastError().text() << newVersion << s.file;
+		return false;
 	}
+	return true;
 }
 
 QList<LibraryDb::Genre> LibraryDb::getGenres()
 {
+	PerfStats::Scope perf(PerfStats::Database, "getGenres");
 	DBUG;
 	QList<LibraryDb::Genre> genres;
 	if (!db) {
 		return genres;
 	}
 	QMap<QString, QSet<QString>> map;
-	if (0 != currentVersion && db) {
+	if (0 != currentVersion && filter.isEmpty() && yearFilter.isEmpty()) {
+		QSqlQuery query(*db);
+		query.setForwardOnly(true);
+		if (query.exec("select genre, artists from genres")) {
+			while (query.next()) {
+				genres.append(Genre(query.value(0).toString(), query.value(1).toInt()));
+			}
+		}
+		else {
+			DBUG << query.lastError().text();
+		}
+	}
+	else if (0 != currentVersion) {
 		QString queryStr("distinct ");
 		for (int i = 0; i < Song::constNumGenres; ++i) {
 			queryStr += "genre" + QString::number(i + 1) + ", ";
@@ -714,6 +845,7 @@ QList<LibraryDb::Genre> LibraryDb::getGenres()
 
 QList<LibraryDb::Artist> LibraryDb::getArtists(const QString& genre)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getArtists");
 	DBUG << genre;
 	QList<LibraryDb::Artist> artists;
 	if (!db) {
@@ -721,7 +853,21 @@ QList<LibraryDb::Artist> LibraryDb::getArtists(const QString& genre)
 	}
 	QMap<QString, QString> sortMap;
 	QMap<QString, int> albumMap;
-	if (0 != currentVersion && db) {
+	if (0 != currentVersion && filter.isEmpty() && yearFilter.isEmpty()) {
+		QSqlQuery query(*db);
+		query.setForwardOnly(true);
+		query.prepare("select artistId, artistSort, albums from artists where genre=:genre");
+		query.bindValue(":genre", genre.isEmpty() ? genreFilter : genre);
+		if (query.exec()) {
+			while (query.next()) {
+				artists.append(Artist(query.value(0).toString(), query.value(1).toString(), query.value(2).toInt()));
+			}
+		}
+		else {
+			DBUG << query.lastError().text();
+		}
+	}
+	else if (0 != currentVersion) {
 		SqlQuery query("distinct artistId, albumId, artistSort", *db);
 		query.setFilter(filter, yearFilter);
 		if (!genre.isEmpty()) {
@@ -751,13 +897,17 @@ QList<LibraryDb::Artist> LibraryDb::getArtists(const QString& genre)
 
 QList<LibraryDb::Album> LibraryDb::getAlbums(const QString& artistId, const QString& genre, AlbumSort sort)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getAlbums");
 	timer.start();
 	DBUG << artistId << genre;
 	QList<Album> albums;
 	if (!db) {
 		return albums;
 	}
-	if (0 != currentVersion && db) {
+	if (0 != currentVersion && db && filter.isEmpty() && yearFilter.isEmpty()) {
+		albums = getSummaryAlbums(artistId, genre.isEmpty() ? genreFilter : genre);
+	}
+	else if (0 != currentVersion && db) {
 		bool wantModified = AS_Modified == sort;
 		bool wantArtist = artistId.isEmpty();
 		QString queryString = "album, albumId, albumSort, artist, albumArtist, composer";
@@ -822,44 +972,10 @@ QList<LibraryDb::Album> LibraryDb::getAlbums(const QString& artistId, const QStr
 			// Issue #1025
 			bool haveUniqueId = wantArtist && !albumId.isEmpty() && !album.isEmpty() && albumId != album;
 			QString key = haveUniqueId ? albumId : ('{' + albumId + "}{" + (wantArtist ? artist : artistId) + '}');
-			QMap<QString, Album>::iterator it = entries.find(key);
-
-			if (it == entries.end()) {
-				entries.insert(key, Album(album.isEmpty() ? albumId : album, albumId, albumSort, artist, artistSort, s.displayYear(), 1, time, lastModified, haveUniqueId));
-			}
-			else {
-				Album& al = it.value();
-				if (wantModified) {
-					al.lastModified = qMax(al.lastModified, lastModified);
-				}
-				al.year = qMax(al.year, (int)s.displayYear());
-				al.duration += time;
-				al.trackCount++;
-			}
-			if (haveUniqueId) {
-				QMap<QString, QSet<QString>>::iterator aIt = albumIdArtists.find(key);
-				if (aIt == albumIdArtists.end()) {
-					albumIdArtists.insert(key, QSet<QString>() << artist);
-				}
-				else {
-					aIt.value().insert(artist);
-				}
-			}
+			addAlbum(entries, albumIdArtists, key, Album(album.isEmpty() ? albumId : album, albumId, albumSort, artist, artistSort, s.displayYear(), 1, time, lastModified, haveUniqueId));
 		}
 
-		QMap<QString, QSet<QString>>::ConstIterator aIt = albumIdArtists.constBegin();
-		QMap<QString, QSet<QString>>::ConstIterator aEnd = albumIdArtists.constEnd();
-		for (; aIt != aEnd; ++aIt) {
-			if (aIt.value().count() > 1) {
-				QStringList artists = aIt.value().values();
-				artists.sort();
-				Album& al = entries.find(aIt.key()).value();
-				al.artist = artists.join(", ");
-				al.artistSort = QString();
-			}
-		}
-
-		albums = entries.values();
+		albums = albumList(entries, albumIdArtists);
 		DBUG << count << albums.count();
 	}
 
@@ -893,8 +1009,84 @@ QList<LibraryDb::Album> LibraryDb::getAlbums(const QString& artistId, const QStr
 	return albums;
 }
 
+// Read albums from the summary table built by updateSummaries(). This has one row per artist, album, and genre -
+// so there is no need to scan the tracks when the view is not filtered by text or year.
+QList<LibraryDb::Album> LibraryDb::getSummaryAlbums(const QString& artistId, const QString& genre)
+{
+	PerfStats::Scope perf(PerfStats::Database, "getSummaryAlbums");
+	bool wantArtist = artistId.isEmpty();
+	QString queryString = "select artistId, albumId, album, albumSort, artistSort, artist, albumArtist, composer";
+	for (int i = 0; i < Song::constNumGenres; ++i) {
+		queryString += ", genre" + QString::number(i + 1);
+	}
+	queryString += ", type, year, origYear, tracks, time, lastModified from albums where genre=:genre";
+	if (!wantArtist) {
+		queryString += " and artistId=:artistId";
+	}
+
+	QSqlQuery query(*db);
+	query.setForwardOnly(true);
+	query.prepare(queryString);
+	query.bindValue(":genre", genre);
+	if (!wantArtist) {
+		query.bindValue(":artistId", artistId);
+	}
+	if (!query.exec()) {
+		DBUG << query.lastError().text();
+		return QList<Album>();
+	}
+
+	bool useOrigYear = Song::useOriginalYear();
+	QMap<QString, Album> entries;
+	QMap<QString, QSet<QString>> albumIdArtists;// Map of albumId -> albumartists/composers
+	while (query.next()) {
+		int col = 0;
+		QString artist = query.value(col++).toString();
+		QString albumId = query.value(col++).toString();
+		QString album = query.value(col++).toString();
+		QString albumSort = query.value(col++).toString();
+		QString artistSort = query.value(col++).toString();
+		if (!wantArtist) {
+			artist = artistSort = QString();
+		}
+
+		// Details of the album's first track, as used to name the album
+		Song s;
+		s.artist = query.value(col++).toString();
+		s.albumartist = query.value(col++).toString();
+		s.setComposer(query.value(col++).toString());
+		s.album = album.isEmpty() ? albumId : album;
+		for (int i = 0; i < Song::constNumGenres; ++i) {
+			QString genre = query.value(col++).toString();
+			if (genre != constNullGenre) {
+				s.addGenre(genre);
+			}
+		}
+		s.type = (Song::Type)query.value(col++).toInt();
+		if (Song::SingleTracks == s.type) {
+			s.album = Song::singleTracks();
+			s.albumartist = Song::variousArtists();
+		}
+		album = s.albumName();
+		int year = query.value(col++).toInt();
+		int origYear = query.value(col++).toInt();
+		int trackCount = query.value(col++).toInt();
+		int time = query.value(col++).toInt();
+		int lastModified = query.value(col++).toInt();
+
+		bool haveUniqueId = wantArtist && !albumId.isEmpty() && !album.isEmpty() && albumId != album;
+		QString key = haveUniqueId ? albumId : ('{' + albumId + "}{" + (wantArtist ? artist : artistId) + '}');
+		addAlbum(entries, albumIdArtists, key, Album(album.isEmpty() ? albumId : album, albumId, albumSort, artist, artistSort, useOrigYear ? origYear : year, trackCount, time, lastModified, haveUniqueId));
+	}
+
+	QList<Album> albums = albumList(entries, albumIdArtists);
+	DBUG << albums.count();
+	return albums;
+}
+
 QList<Song> LibraryDb::getTracks(const QString& artistId, const QString& albumId, const QString& genre, AlbumSort sort, bool useFilter, int maxTracks)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getTracks");
 	DBUG << artistId << albumId << genre << sort;
 	QList<Song> songs;
 	if (!db) {
@@ -949,12 +1141,15 @@ QList<Song> LibraryDb::getTracks(const QString& artistId, const QString& albumId
 
 QList<Song> LibraryDb::getTracks(int rowFrom, int count)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getTracks(rows)");
 	QList<Song> songList;
 	if (db) {
+		// Incremental updates leave gaps in the rowids, so page by position rather than rowid
 		SqlQuery query("*", *db);
-		query.addWhere("rowid", rowFrom, ">");
-		query.addWhere("rowid", rowFrom + count, "<=");
 		query.addWhere("type", 0);
+		query.setOrder("rowid");
+		query.setLimit(count);
+		query.setOffset(rowFrom);
 		query.exec();
 		DBUG << query.executedQuery();
 		while (query.next()) {
@@ -1001,6 +1196,7 @@ QList<Song> LibraryDb::songs(const QStringList& files, bool allowPlaylists) cons
 
 QList<LibraryDb::Album> LibraryDb::getAlbumsWithArtistOrComposer(const QString& artist)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getAlbumsWithArtistOrComposer");
 	QList<LibraryDb::Album> albums;
 	if (0 != currentVersion && db) {
 		SqlQuery query("distinct album, albumId, albumSort", *db);
@@ -1034,6 +1230,7 @@ QList<LibraryDb::Album> LibraryDb::getAlbumsWithArtistOrComposer(const QString&
 
 LibraryDb::Album LibraryDb::getRandomAlbum(const QString& genre, const QString& artist)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getRandomAlbum");
 	Album al;
 	if (0 != currentVersion && db) {
 		SqlQuery query("artistId, albumId", *db);
@@ -1061,6 +1258,7 @@ LibraryDb::Album LibraryDb::getRandomAlbum(const QString& genre, const QString&
 	return al;
 }
 
+// Timed by the overload above, which runs each query
 LibraryDb::Album LibraryDb::getRandomAlbum(const QStringList& genres, const QStringList& artists)
 {
 	if (genres.isEmpty() && artists.isEmpty()) {
@@ -1086,6 +1284,7 @@ LibraryDb::Album LibraryDb::getRandomAlbum(const QStringList& genres, const QStr
 
 QSet<QString> LibraryDb::get(const QString& type)
 {
+	PerfStats::Scope perf(PerfStats::Database, "get");
 	if (detailsCache.contains(type)) {
 		return detailsCache[type];
 	}
@@ -1148,6 +1347,7 @@ QSet<QString> LibraryDb::get(const QString& type)
 
 void LibraryDb::getDetails(QSet<QString>& artists, QSet<QString>& albumArtists, QSet<QString>& composers, QSet<QString>& albums, QSet<QString>& genres)
 {
+	PerfStats::Scope perf(PerfStats::Database, "getDetails");
 	artists = get("artist");
 	albumArtists = get("albumArtist");
 	composers = get("composer");
@@ -1176,6 +1376,7 @@ static QRegularExpression longStringRegex = QRegularExpression("\\s+");
 
 bool LibraryDb::setFilter(const QString& f, const QString& genre)
 {
+	PerfStats::Scope perf(PerfStats::Database, "setFilter");
 	QString newFilter = f.trimmed().toLower();
 	QString year;
 	if (!f.isEmpty()) {
@@ -1239,8 +1440,15 @@ void LibraryDb::updateStarted(time_t ver)
 	}
 	newVersion = ver;
 	timer.start();
+	syncStats = SyncStats();
 	db->transaction();
-	if (currentVersion > 0) {
+	// Only worth diffing if we already have something stored - for an empty db a plain
+	// insert, followed by a single FTS fill, is quicker.
+	syncing = incrementalSync && currentVersion > 0;
+	if (syncing) {
+		loadStoredSongs();
+	}
+	else if (currentVersion > 0) {
 		clearSongs(false);
 	}
 }
@@ -1253,7 +1461,15 @@ void LibraryDb::insertSongs(QList<Song>* songs)
 	}
 
 	for (const Song& s : *songs) {
-		insertSong(s);
+		if (syncing) {
+			syncSong(s);
+		}
+		else if (insertSong(s)) {
+			syncStats.inserted++;
+			if (!rebuildSummaries) {
+				albumChanged(s);
+			}
+		}
 	}
 	delete songs;
 }
@@ -1264,22 +1480,270 @@ void LibraryDb::updateFinished()
 		return;
 	}
 	DBUG << timer.elapsed();
-	DBUG << "update fts" << timer.elapsed();
-	QSqlQuery(*db).exec("insert into songs_fts(fts_artist, fts_artistId, fts_album, fts_albumId, fts_title) "
-	                    "select artist, artistId, album, albumId, title from songs");
+	if (syncing) {
+		removeStaleSongs();
+		DBUG << "removed stale" << timer.elapsed();
+	}
+	else {
+		DBUG << "update fts" << timer.elapsed();
+		QSqlQuery(*db).exec("insert into songs_fts(fts_artist, fts_artistId, fts_album, fts_albumId, fts_title) "
+		                    "select artist, artistId, album, albumId, title from songs");
+	}
+	if (rebuildSummaries || !changedAlbums.isEmpty()) {
+		updateSummaries();
+		DBUG << "updated summaries" << timer.elapsed();
+	}
 	QSqlQuery(*db).exec("update versions set collection =" + QString::number(newVersion));
 	DBUG << "commit" << timer.elapsed();
 	db->commit();
 	currentVersion = newVersion;
-	DBUG << "complete" << timer.elapsed();
+	syncing = false;
+	syncStats.elapsed = timer.elapsed();
+	DBUG << "complete" << syncStats.elapsed << "inserted:" << syncStats.inserted << "updated:" << syncStats.updated
+		 << "removed:" << syncStats.removed << "unchanged:" << syncStats.unchanged;
 	emit libraryUpdated();
 }
 
+// Commit the songs inserted so far, and start a new transaction for the rest of the update. Only the
+// summary tables are refreshed, the full-text search table is still only filled by updateFinished(). After
+// the first commit, only the summaries of albums inserted since the previous commit are updated.
+// The new version is only used in memory, so that the songs can be queried - the stored version is set to 0
+// until updateFinished(), so that an update interrupted by a crash is not taken as complete on the next start.
+void LibraryDb::commitUpdate()
+{
+	if (!db || syncing) {
+		return;
+	}
+	DBUG << "partial" << syncStats.inserted << timer.elapsed();
+	updateSummaries();
+	QSqlQuery(*db).exec("update versions set collection = 0");
+	db->commit();
+	currentVersion = newVersion;
+	emit libraryUpdated();
+	db->transaction();
+}
+
 void LibraryDb::abortUpdate()
 {
 	if (db) {
 		db->rollback();
 	}
+	syncing = false;
+	storedSongs.clear();
+	changedAlbums.clear();
+}
+
+void LibraryDb::loadStoredSongs()
+{
+	storedSongs.clear();
+	QSqlQuery query(*db);
+	query.setForwardOnly(true);
+	if (!query.exec("select rowid, file, lastModified, artistId, artistSort, albumSort from songs")) {
+		DBUG << "Failed to read stored songs" << query.lastError().text();
+		return;
+	}
+	while (query.next()) {
+		storedSongs.insert(query.value(1).toString(), StoredSong(query.value(0).toLongLong(), query.value(2).toUInt(), query.value(3).toString(),
+		                                                         query.value(4).toString(), query.value(5).toString()));
+	}
+	DBUG << "stored" << storedSongs.count() << timer.elapsed();
+}
+
+void LibraryDb::syncSong(const Song& s)
+{
+	QHash<QString, StoredSong>::Iterator it = storedSongs.find(s.file);
+	if (it == storedSongs.end()) {
+		if (insertSong(s)) {
+			insertFts(insertSongQuery->lastInsertId().toLongLong(), s);
+			syncStats.inserted++;
+			albumChanged(s);
+			detailsCache.clear();
+		}
+		return;
+	}
+
+	const StoredSong& stored = it.value();
+	if (stored.lastModified != s.lastModified || stored.artistId != s.albumArtistOrComposer() || stored.artistSort != artistSort(s) || stored.albumSort != albumSort(s)) {
+		// Song may have moved album, so both old and new albums need their summaries updated
+		storedAlbumChanged(it.value().rowId);
+		updateSong(it.value().rowId, s);
+		albumChanged(s);
+		syncStats.updated++;
+		detailsCache.clear();
+	}
+	else {
+		syncStats.unchanged++;
+	}
+	// Whatever is left in storedSongs when the update finishes is no longer in the library
+	storedSongs.erase(it);
+}
+
+void LibraryDb::updateSong(qint64 rowId, const Song& s)
+{
+	if (!updateSongQuery) {
+		updateSongQuery = new QSqlQuery(*db);
+		updateSongQuery->prepare("update songs set file=:file, artist=:artist, artistId=:artistId, albumArtist=:albumArtist, artistSort=:artistSort, composer=:composer, "
+		                         "album=:album, albumId=:albumId, albumSort=:albumSort, title=:title, genre1=:genre1, genre2=:genre2, genre3=:genre3, genre4=:genre4, "
+		                         "track=:track, disc=:disc, time=:time, year=:year, origYear=:origYear, type=:type, lastModified=:lastModified "
+		                         "where rowid=:rowId");
+	}
+	bindSong(updateSongQuery, s);
+	updateSongQuery->bindValue(":rowId", rowId);
+	if (!updateSongQuery->exec()) {
+		qWarning() << "update failed" << updateSongQuery->lastError().text() << newVersion << s.file;
+		return;
+	}
+
+	if (!updateFtsQuery) {
+		updateFtsQuery = new QSqlQuery(*db);
+		updateFtsQuery->prepare("update songs_fts set fts_artist=:artist, fts_artistId=:artistId, fts_album=:album, fts_albumId=:albumId, fts_title=:title "
+		                        "where docid=:rowId");
+	}
+	bindFts(updateFtsQuery, rowId, s);
+	if (!updateFtsQuery->exec()) {
+		DBUG << "fts update failed" << updateFtsQuery->lastError().text() << s.file;
+	}
+}
+
+void LibraryDb::insertFts(qint64 rowId, const Song& s)
+{
+	// FTS rows are joined to songs on ROWID, so the docid must match that of the new song row
+	if (!insertFtsQuery) {
+		insertFtsQuery = new QSqlQuery(*db);
+		insertFtsQuery->prepare("insert into songs_fts(docid, fts_artist, fts_artistId, fts_album, fts_albumId, fts_title) "
+		                        "values(:rowId, :artist, :artistId, :album, :albumId, :title)");
+	}
+	bindFts(insertFtsQuery, rowId, s);
+	if (!insertFtsQuery->exec()) {
+		DBUG << "fts insert failed" << insertFtsQuery->lastError().text() << s.file;
+	}
+}
+
+void LibraryDb::removeStaleSongs()
+{
+	if (storedSongs.isEmpty()) {
+		return;
+	}
+
+	QSqlQuery removeSong(*db);
+	QSqlQuery removeFts(*db);
+	removeSong.prepare("delete from songs where rowid=:rowId");
+	removeFts.prepare("delete from songs_fts where docid=:rowId");
+	QHash<QString, StoredSong>::ConstIterator it = storedSongs.constBegin();
+	QHash<QString, StoredSong>::ConstIterator end = storedSongs.constEnd();
+	for (; it != end; ++it) {
+		storedAlbumChanged(it.value().rowId);
+		removeSong.bindValue(":rowId", it.value().rowId);
+		removeFts.bindValue(":rowId", it.value().rowId);
+		if (removeSong.exec()) {
+			removeFts.exec();
+			syncStats.removed++;
+		}
+		else {
+			qWarning() << "delete failed" << removeSong.lastError().text() << newVersion << it.key();
+		}
+	}
+	storedSongs.clear();
+	detailsCache.clear();
+}
+
+void LibraryDb::storedAlbumChanged(qint64 rowId)
+{
+	if (!storedAlbumQuery) {
+		storedAlbumQuery = new QSqlQuery(*db);
+		storedAlbumQuery->prepare("select artistId, albumId from songs where rowid=:rowId");
+	}
+	storedAlbumQuery->bindValue(":rowId", rowId);
+	if (storedAlbumQuery->exec() && storedAlbumQuery->next()) {
+		changedAlbums.insert(qMakePair(storedAlbumQuery->value(0).toString(), storedAlbumQuery->value(1).toString()));
+	}
+	storedAlbumQuery->finish();
+}
+
+// Update the albums, artists, and genres tables from songs - called within the update transaction. Each track is
+// counted once for "" (i.e. all genres), and once for each of its distinct genres. The text of an album row (name,
+// sort, first genres, etc.) comes from its first track, as getAlbums() would use when aggregating the tracks itself.
+// If the tables are empty they are built from all songs, otherwise only the rows of changed albums are replaced,
+// along with the rows of their artists and genres.
+void LibraryDb::updateSummaries()
+{
+	QSqlQuery query(*db);
+	bool all = rebuildSummaries;
+	rebuildSummaries = false;
+	if (all) {
+		query.exec("delete from albums");
+		query.exec("delete from artists");
+		query.exec("delete from genres");
+	}
+	else {
+		if (changedAlbums.isEmpty()) {
+			return;
+		}
+		query.exec("create temp table if not exists changed_albums(artistId text, albumId text, primary key(artistId, albumId))");
+		query.exec("create temp table if not exists changed_genres(genre text primary key)");
+		query.exec("delete from changed_albums");
+		query.exec("delete from changed_genres");
+		QSqlQuery insert(*db);
+		insert.prepare("insert into changed_albums(artistId, albumId) values(:artistId, :albumId)");
+		for (const QPair<QString, QString>& album : std::as_const(changedAlbums)) {
+			insert.bindValue(":artistId", album.first);
+			insert.bindValue(":albumId", album.second);
+			insert.exec();
+		}
+		// Genres of the old rows - an album may no longer have tracks of a genre
+		query.exec("insert or ignore into changed_genres select a.genre from albums as a "
+		           "inner join changed_albums as c on a.artistId is c.artistId and a.albumId is c.albumId");
+		query.exec("delete from albums where exists (select 1 from changed_albums as c where c.artistId is albums.artistId and c.albumId is albums.albumId)");
+		query.exec("delete from artists where exists (select 1 from changed_albums as c where c.artistId is artists.artistId)");
+	}
+	changedAlbums.clear();
+
+	QString changedSongs = all ? QString("select rowid as id, * from songs")
+	                           : QString("select s.rowid as id, s.* from songs as s inner join changed_albums as c on s.artistId is c.artistId and s.albumId is c.albumId");
+	QString songGenres = "select id, '' from cs";
+	QString genreCols;
+	for (int i = 0; i < Song::constNumGenres; ++i) {
+		QString col = "genre" + QString::number(i + 1);
+		songGenres += " union select id, " + col + " from cs where " + col + " != '" + constNullGenre + "'";
+		genreCols += ", s." + col;
+	}
+	QString singleTracks = QString::number(Song::SingleTracks);
+	QString albums = "with cs as (" + changedSongs + "), sg(id, genre) as (" + songGenres + ") "
+	                 "insert into albums select a.genre, a.artistId, a.albumId, s.album, s.albumSort, s.artistSort, s.artist, s.albumArtist, s.composer" + genreCols + ", "
+	                 "s.type, a.year, a.origYear, a.tracks, a.time, a.lastModified from "
+	                 "(select sg.genre as genre, t.artistId as artistId, t.albumId as albumId, min(t.rowid) as first, "
+	                 "max(case when t.type = " + singleTracks + " then 0 else t.year end) as year, "
+	                 "max(case when t.type = " + singleTracks + " then 0 when t.origYear > 0 then t.origYear else t.year end) as origYear, "
+	                 "count() as tracks, sum(t.time) as time, max(t.lastModified) as lastModified "
+	                 "from sg inner join songs as t on t.rowid = sg.id group by sg.genre, t.artistId, t.albumId) as a "
+	                 "inner join songs as s on s.rowid = a.first";
+	if (!query.exec(albums)) {
+		qWarning() << "Failed to update albums" << query.lastError().text();
+		return;
+	}
+	if (all) {
+		if (!query.exec("insert into artists select genre, artistId, min(artistSort), count() from albums group by genre, artistId")) {
+			qWarning() << "Failed to update artists" << query.lastError().text();
+			return;
+		}
+		if (!query.exec("insert into genres select genre, count() from artists where genre != '' group by genre")) {
+			qWarning() << "Failed to update genres" << query.lastError().text();
+		}
+		return;
+	}
+
+	if (!query.exec("insert into artists select genre, artistId, min(artistSort), count() from albums "
+	                "where exists (select 1 from changed_albums as c where c.artistId is albums.artistId) group by genre, artistId")) {
+		qWarning() << "Failed to update artists" << query.lastError().text();
+		return;
+	}
+	// ...and genres of the new rows
+	query.exec("insert or ignore into changed_genres select a.genre from albums as a "
+	           "inner join changed_albums as c on a.artistId is c.artistId and a.albumId is c.albumId");
+	query.exec("delete from genres where genre in (select genre from changed_genres)");
+	if (!query.exec("insert into genres select genre, count() from artists where genre != '' and genre in (select genre from changed_genres) group by genre")) {
+		qWarning() << "Failed to update genres" << query.lastError().text();
+	}
 }
 
 bool LibraryDb::createTable(const QString& q)
@@ -1341,12 +1805,23 @@ void LibraryDb::reset()
 {
 	bool removeDb = nullptr != db;
 	delete insertSongQuery;
+	delete updateSongQuery;
+	delete insertFtsQuery;
+	delete updateFtsQuery;
+	delete storedAlbumQuery;
 	if (db) {
 		db->close();
 	}
 	delete db;
 
 	insertSongQuery = nullptr;
+	updateSongQuery = nullptr;
+	insertFtsQuery = nullptr;
+	updateFtsQuery = nullptr;
+	storedAlbumQuery = nullptr;
+	syncing = false;
+	storedSongs.clear();
+	changedAlbums.clear();
 	db = nullptr;
 	if (removeDb) {
 		QSqlDatabase::removeDatabase(dbName);
@@ -1363,7 +1838,12 @@ void LibraryDb::clearSongs(bool startTransaction)
 	}
 	QSqlQuery(*db).exec("delete from songs");
 	QSqlQuery(*db).exec("delete from songs_fts");
+	QSqlQuery(*db).exec("delete from albums");
+	QSqlQuery(*db).exec("delete from artists");
+	QSqlQuery(*db).exec("delete from genres");
 	detailsCache.clear();
+	changedAlbums.clear();
+	rebuildSummaries = true;
 	if (startTransaction) {
 		db->commit();
 	}
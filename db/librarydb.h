@@ -27,6 +27,7 @@
 #include "mpd-interface/song.h"
 #include "support/utils.h"
 #include <QElapsedTimer>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QObject>
@@ -108,13 +109,34 @@ public:
 		bool identifyById;// Should we jsut use albumId to locate tracks - Issue #1025
 	};
 
+	// Summary of the last incremental update, see setIncrementalSync()
+	struct SyncStats {
+		SyncStats()
+			: inserted(0), updated(0), removed(0), unchanged(0), elapsed(0) {}
+		int touched() const { return inserted + updated + removed; }
+		int inserted;
+		int updated;
+		int removed;
+		int unchanged;
+		qint64 elapsed;
+	};
+
 	LibraryDb(QObject* p, const QString& name);
 	~LibraryDb() override;
 
 	void clear();
 	void erase();
 	virtual bool init(const QString& dbFile);
-	void insertSong(const Song& s);
+	bool openReadOnly(const QString& dbFile, time_t version, quint32 instance);
+	const QString& databaseFile() const { return dbFileName; }
+	// Incremented each time the database file is deleted, so that read-only connections know to reopen it
+	quint32 databaseInstance() const { return fileInstance; }
+	bool insertSong(const Song& s);
+	// When enabled, an update only writes the rows (and FTS entries) of songs whose file or
+	// lastModified differ from what is stored, instead of clearing and re-inserting everything.
+	void setIncrementalSync(bool on) { incrementalSync = on; }
+	bool isIncrementalSync() const { return incrementalSync; }
+	const SyncStats& lastSyncStats() const { return syncStats; }
 	QList<Genre> getGenres();
 	QList<Artist> getArtists(const QString& genre = QString());
 	QList<Album> getAlbums(const QString& artistId = QString(), const QString& genre = QString(), AlbumSort sort = AS_YrAlAr);
@@ -149,6 +171,30 @@ protected:
 protected:
 	virtual void reset();
 	void clearSongs(bool startTransaction = true);
+	void commitUpdate();
+
+private:
+	// Stored rows are updated if the file has been modified, or if the values derived from the tags (which depend upon
+	// the composer genres and ignored prefixes settings) have changed.
+	struct StoredSong {
+		StoredSong(qint64 r = 0, uint lm = 0, const QString& ai = QString(), const QString& ars = QString(), const QString& als = QString())
+			: rowId(r), lastModified(lm), artistId(ai), artistSort(ars), albumSort(als) {}
+		qint64 rowId;
+		uint lastModified;
+		QString artistId;
+		QString artistSort;
+		QString albumSort;
+	};
+
+	void loadStoredSongs();
+	void syncSong(const Song& s);
+	void updateSong(qint64 rowId, const Song& s);
+	void insertFts(qint64 rowId, const Song& s);
+	void removeStaleSongs();
+	void albumChanged(const Song& s) { changedAlbums.insert(qMakePair(s.albumArtistOrComposer(), s.albumId())); }
+	void storedAlbumChanged(qint64 rowId);
+	void updateSummaries();
+	QList<Album> getSummaryAlbums(const QString& artistId, const QString& genre);
 
 protected:
 	static bool dbgEnabled;
@@ -157,8 +203,19 @@ protected:
 	QString dbFileName;
 	time_t currentVersion;
 	time_t newVersion;
+	quint32 fileInstance;
 	QSqlDatabase* db;
 	QSqlQuery* insertSongQuery;
+	QSqlQuery* updateSongQuery;
+	QSqlQuery* insertFtsQuery;
+	QSqlQuery* updateFtsQuery;
+	bool incrementalSync;
+	bool syncing;
+	QHash<QString, StoredSong> storedSongs;
+	QSet<QPair<QString, QString>> changedAlbums;// artistId, albumId of albums whose summary rows need updating
+	bool rebuildSummaries;// Summary tables are empty, so rebuild in one go rather than per album
+	QSqlQuery* storedAlbumQuery;
+	SyncStats syncStats;
 	QElapsedTimer timer;
 	QString filter;
 	QString genreFilter;
@@ -68,6 +68,8 @@ void MpdLibraryDb::removeUnusedDbs()
 MpdLibraryDb::MpdLibraryDb(QObject* p)
 	: LibraryDb(p, "MPD"), loading(false), coverQuery(nullptr), albumIdOnlyCoverQuery(nullptr), artistImageQuery(nullptr)
 {
+	// MPD lists the whole library on every database change, so only write what has actually changed
+	setIncrementalSync(true);
 	connect(MPDConnection::self(), SIGNAL(updatingLibrary(time_t)), this, SLOT(updateStarted(time_t)));
 	connect(MPDConnection::self(), SIGNAL(librarySongs(QList<Song>*)), this, SLOT(insertSongs(QList<Song>*)));
 	connect(MPDConnection::self(), SIGNAL(updatedLibrary()), this, SLOT(updateFinished()));
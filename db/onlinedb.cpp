@@ -26,9 +26,10 @@
 #include <QVariant>
 
 static const QString subDir("online");
+static const qint64 constCommitInterval = 5000;
 
 OnlineDb::OnlineDb(const QString& serviceName, QObject* p)
-	: LibraryDb(p, serviceName), insertCoverQuery(nullptr), getCoverQuery(nullptr)
+	: LibraryDb(p, serviceName), insertCoverQuery(nullptr), getCoverQuery(nullptr), partiallyCommitted(false)
 {
 }
 
@@ -59,13 +60,40 @@ void OnlineDb::startUpdate()
 	}
 	QSqlQuery(*db).exec("delete from covers");
 	QSqlQuery(*db).exec("drop index genre_idx");
+	commitTimer.start();
+	partiallyCommitted = false;
+}
+
+void OnlineDb::storeSongs(QList<Song>* songs)
+{
+	insertSongs(songs);
+	// Listings are parsed as they are downloaded, so periodically commit what we have to allow the catalogue to
+	// be browsed before it is complete.
+	if (db && commitTimer.isValid() && commitTimer.elapsed() > constCommitInterval) {
+		commitUpdate();
+		partiallyCommitted = true;
+		commitTimer.restart();
+	}
 }
 
 void OnlineDb::endUpdate()
 {
+	commitTimer.invalidate();
 	updateFinished();
 }
 
+void OnlineDb::cancelUpdate()
+{
+	commitTimer.invalidate();
+	abortUpdate();
+	if (partiallyCommitted) {
+		// Don't leave a partial listing, as it would be taken as complete the next time
+		partiallyCommitted = false;
+		clear();
+		emit libraryUpdated();
+	}
+}
+
 void OnlineDb::insertStats(int numArtists)
 {
 	if (!db) {
@@ -25,6 +25,7 @@
 #define ONLINE_DB_H
 
 #include "librarydb.h"
+#include <QElapsedTimer>
 
 class OnlineDb : public LibraryDb {
 	Q_OBJECT
@@ -39,7 +40,9 @@ public:
 
 public Q_SLOTS:
 	void startUpdate();
+	void storeSongs(QList<Song>* songs);
 	void endUpdate();
+	void cancelUpdate();
 	void storeCoverUrl(const QString& artistId, const QString& albumId, const QString& url);
 	void insertStats(int numArtists);
 
@@ -49,6 +52,8 @@ private:
 private:
 	QSqlQuery* insertCoverQuery;
 	QSqlQuery* getCoverQuery;
+	QElapsedTimer commitTimer;
+	bool partiallyCommitted;
 };
 
 #endif
@@ -35,14 +35,19 @@
 #include "mpd-interface/mpdparseutils.h"
 #include "support/thread.h"
 #include "support/utils.h"
+#include "tags/taghelperiface.h"
 #include "tags/tags.h"
 #include "transcodingjob.h"
 #include "umsdevice.h"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QTextStream>
+#include <QThreadPool>
 #include <QTimer>
+#include <QWaitCondition>
 
 const QLatin1String FsDevice::constCantataCacheFile("/.cache");
 const QLatin1String FsDevice::constCantataSettingsFile("/.cantata");
@@ -72,12 +77,35 @@ MusicScanner::~MusicScanner()
 	stop();
 }
 
+// Caches used to be stored as gzip'ed XML - these are now only read to import them into the binary cache.
+static const QLatin1String constBinaryCacheExt(".bin");
+static const QLatin1String constXmlCacheExt(".xml.gz");
+
+static QString xmlCacheFile(const QString& cacheFile)
+{
+	return cacheFile.endsWith(constBinaryCacheExt) ? cacheFile.left(cacheFile.length() - constBinaryCacheExt.size()) + constXmlCacheExt : QString();
+}
+
 void MusicScanner::scan(const QString& folder, const QString& cacheFile, bool readCache, const QSet<FileOnlySong>& existingSongs)
 {
 	if (!cacheFile.isEmpty() && readCache) {
 		MusicLibraryItemRoot* lib = new MusicLibraryItemRoot;
 		readProgress(0.0);
-		if (lib->fromXML(cacheFile, folder)) {
+		bool loaded = lib->fromCache(cacheFile, folder, this);
+		if (!loaded && !stopRequested) {
+			QString xmlFile = xmlCacheFile(cacheFile);
+			if (!xmlFile.isEmpty() && QFile::exists(xmlFile)) {
+				lib->clearItems();
+				loaded = lib->fromXML(xmlFile, folder);
+				if (loaded && !stopRequested) {
+					writeProgress(0.0);
+					if (lib->toCache(cacheFile, this)) {
+						QFile::remove(xmlFile);
+					}
+				}
+			}
+		}
+		if (loaded) {
 			if (!stopRequested) {
 				emit libraryUpdated(lib);
 			}
@@ -99,12 +127,12 @@ void MusicScanner::scan(const QString& folder, const QString& cacheFile, bool re
 	QString topLevel = Utils::fixPath(QDir(folder).absolutePath());
 	QSet<FileOnlySong> existing = existingSongs;
 	timer.start();
-	scanFolder(library, topLevel, topLevel, existing, 0);
+	scanFolder(library, topLevel, existing);
 
 	if (!stopRequested) {
 		if (!cacheFile.isEmpty()) {
 			writeProgress(0.0);
-			library->toXML(cacheFile, this);
+			library->toCache(cacheFile, this);
 		}
 		emit libraryUpdated(library);
 	}
@@ -116,7 +144,7 @@ void MusicScanner::scan(const QString& folder, const QString& cacheFile, bool re
 void MusicScanner::saveCache(const QString& cache, MusicLibraryItemRoot* lib)
 {
 	writeProgress(0.0);
-	lib->toXML(cache, this);
+	lib->toCache(cache, this);
 	emit cacheSaved();
 }
 
@@ -127,8 +155,55 @@ void MusicScanner::stop()
 	thread = nullptr;
 }
 
-void MusicScanner::scanFolder(MusicLibraryItemRoot* library, const QString& topLevel, const QString& f,
-                              QSet<FileOnlySong>& existing, int level)
+// Tags are read by the tag helper, in batches that it processes with its own pool of threads - so reading is bound by
+// the helper, and not by the number of readers here. Two readers are used so that the next batch is ready to send as
+// soon as the helper has finished the current one.
+static const int constTagReaders = 2;
+static const int constTagReadBatchSize = 32;
+// Maximum number of files waiting to be read - the walk pauses when this many are queued
+static const int constMaxQueuedReads = constTagReaders * constTagReadBatchSize * 4;
+
+struct MusicScanner::ScanJob {
+	ScanJob(MusicLibraryItemRoot* lib)
+		: library(lib), artistItem(nullptr), albumItem(nullptr), merged(0), walkDone(false) {}
+	MusicLibraryItemRoot* library;
+	MusicLibraryItemArtist* artistItem;
+	MusicLibraryItemAlbum* albumItem;
+	// Files found so far, in walk order - only accessed by the scanner's thread
+	QList<ScanItem> items;
+	int merged;
+	// Shared with the readers
+	QMutex mutex;
+	QWaitCondition cond;
+	QList<QPair<int, QString>> queue;// Index into items, and path, of files to be read
+	QHash<int, Song> results;
+	bool walkDone;
+};
+
+// The walk, tag reading, and building of the library all overlap. As the walk finds files that need their tags
+// read they are queued for the readers, and after each folder the songs that are ready are added to the library.
+void MusicScanner::scanFolder(MusicLibraryItemRoot* library, const QString& topLevel, QSet<FileOnlySong>& existing)
+{
+	ScanJob job(library);
+	QThreadPool pool;
+	// Make sure the helper interface is created here, and not raced for by the readers.
+	TagHelperIface::self();
+	pool.setMaxThreadCount(constTagReaders);
+	for (int i = 0; i < constTagReaders; ++i) {
+		pool.start([this, &job]() { readTags(&job); });
+	}
+
+	walkFolder(&job, topLevel, topLevel, existing, 0);
+	{
+		QMutexLocker locker(&job.mutex);
+		job.walkDone = true;
+		job.cond.wakeAll();
+	}
+	mergeItems(&job, true);
+	pool.waitForDone();
+}
+
+void MusicScanner::walkFolder(ScanJob* job, const QString& topLevel, const QString& f, QSet<FileOnlySong>& existing, int level)
 {
 	if (stopRequested) {
 		return;
@@ -136,53 +211,116 @@ void MusicScanner::scanFolder(MusicLibraryItemRoot* library, const QString& topL
 	if (level < 4) {
 		QDir d(f);
 		QFileInfoList entries = d.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Dirs | QDir::NoDotAndDotDot);
-		MusicLibraryItemArtist* artistItem = nullptr;
-		MusicLibraryItemAlbum* albumItem = nullptr;
 		for (const QFileInfo& info : entries) {
 			if (stopRequested) {
 				return;
 			}
 			if (info.isDir()) {
-				scanFolder(library, topLevel, info.absoluteFilePath(), existing, level + 1);
+				walkFolder(job, topLevel, info.absoluteFilePath(), existing, level + 1);
 			}
 			else if (info.isReadable()) {
-				Song song;
+				ScanItem item;
 				QString fname = info.absoluteFilePath().mid(topLevel.length());
 
 				if (fname.endsWith(".jpg", Qt::CaseInsensitive) || fname.endsWith(".png", Qt::CaseInsensitive) || fname.endsWith(".lyrics", Qt::CaseInsensitive) || fname.endsWith(".pamp", Qt::CaseInsensitive)) {
 					continue;
 				}
-				song.file = fname;
-				QSet<FileOnlySong>::iterator it = existing.find(song);
+				item.song.file = fname;
+				item.size = info.size();
+				QSet<FileOnlySong>::iterator it = existing.find(item.song);
 				if (existing.end() == it) {
-					song = Tags::read(info.absoluteFilePath());
-					song.file = fname;
+					item.needsRead = true;
+					QMutexLocker locker(&job->mutex);
+					while (job->queue.size() >= constMaxQueuedReads && !stopRequested) {
+						job->cond.wait(&job->mutex, 250);
+					}
+					job->queue.append(qMakePair(job->items.size(), info.absoluteFilePath()));
+					job->cond.wakeAll();
 				}
 				else {
-					song = *it;
+					item.song = *it;
 					existing.erase(it);
 				}
-				if (song.isEmpty()) {
-					continue;
-				}
-				count++;
-				if (timer.elapsed() >= 1500 || 0 == (count % 5)) {
-					timer.restart();
-					emit songCount(count);
-				}
+				job->items.append(item);
+			}
+		}
+		mergeItems(job, false);
+	}
+}
 
-				song.fillEmptyFields();
-				song.populateSorts();
-				song.size = info.size();
-				if (!artistItem || song.albumArtistOrComposer() != artistItem->data()) {
-					artistItem = library->artist(song);
-				}
-				if (!albumItem || albumItem->parentItem() != artistItem || song.albumName() != albumItem->data()) {
-					albumItem = artistItem->album(song);
+void MusicScanner::readTags(ScanJob* job)
+{
+	while (!stopRequested) {
+		QList<QPair<int, QString>> batch;
+		{
+			QMutexLocker locker(&job->mutex);
+			while (!stopRequested && !job->walkDone && job->queue.size() < constTagReadBatchSize) {
+				if (!job->cond.wait(&job->mutex, 250) && !job->queue.isEmpty()) {
+					break;// Walk is slow, so read what there is
 				}
-				albumItem->append(new MusicLibraryItemSong(song, albumItem));
 			}
+			if (stopRequested || job->queue.isEmpty()) {
+				return;
+			}
+			batch = job->queue.mid(0, constTagReadBatchSize);
+			job->queue.remove(0, batch.size());
+			job->cond.wakeAll();
+		}
+
+		QStringList paths;
+		for (const QPair<int, QString>& entry : batch) {
+			paths.append(entry.second);
+		}
+		// Any files the helper failed to reply for are returned as empty songs, and so treated as unreadable
+		QList<Song> songs = Tags::readBatch(paths);
+		QMutexLocker locker(&job->mutex);
+		for (int i = 0; i < batch.size(); ++i) {
+			job->results.insert(batch.at(i).first, i < songs.size() ? songs.at(i) : Song());
+		}
+		job->cond.wakeAll();
+	}
+}
+
+// Add songs to the library in walk order, so that it is built exactly as a sequential scan would have built it. If
+// wait is false, this stops at the first song whose tags have not yet been read.
+void MusicScanner::mergeItems(ScanJob* job, bool wait)
+{
+	while (job->merged < job->items.size() && !stopRequested) {
+		ScanItem& item = job->items[job->merged];
+		if (item.needsRead) {
+			QMutexLocker locker(&job->mutex);
+			while (wait && !stopRequested && !job->results.contains(job->merged)) {
+				job->cond.wait(&job->mutex, 250);
+			}
+			if (!job->results.contains(job->merged)) {
+				return;
+			}
+			QString fname = item.song.file;
+			item.song = job->results.take(job->merged);
+			item.song.file = fname;
 		}
+		job->merged++;
+
+		Song& song = item.song;
+		if (song.isEmpty()) {
+			continue;
+		}
+		count++;
+		if (timer.elapsed() >= 1500 || 0 == (count % 5)) {
+			timer.restart();
+			emit songCount(count);
+		}
+
+		song.fillEmptyFields();
+		song.populateSorts();
+		song.size = item.size;
+		if (!job->artistItem || song.albumArtistOrComposer() != job->artistItem->data()) {
+			job->artistItem = job->library->artist(song);
+		}
+		if (!job->albumItem || job->albumItem->parentItem() != job->artistItem || song.albumName() != job->albumItem->data()) {
+			job->albumItem = job->artistItem->album(song);
+		}
+		job->albumItem->append(new MusicLibraryItemSong(song, job->albumItem));
 	}
 }
 
@@ -731,7 +869,13 @@ QString FsDevice::cacheFileName() const
 	if (audioFolder.isEmpty()) {
 		setAudioFolder();
 	}
-	return audioFolder + constCantataCacheFile + ".xml.gz";
+	return audioFolder + constCantataCacheFile + constBinaryCacheExt;
+}
+
+bool FsDevice::hasCache() const
+{
+	QString cacheFile(cacheFileName());
+	return QFile::exists(cacheFile) || QFile::exists(xmlCacheFile(cacheFile));
 }
 
 void FsDevice::saveCache()
@@ -754,8 +898,10 @@ void FsDevice::savedCache()
 void FsDevice::removeCache()
 {
 	QString cacheFile(cacheFileName());
-	if (QFile::exists(cacheFile)) {
-		QFile::remove(cacheFile);
+	for (const QString& file : { cacheFile, xmlCacheFile(cacheFile) }) {
+		if (QFile::exists(file)) {
+			QFile::remove(file);
+		}
 	}
 }
 
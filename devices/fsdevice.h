@@ -71,7 +71,20 @@ Q_SIGNALS:
 	void savingCache(int pc);
 
 private:
-	void scanFolder(MusicLibraryItemRoot* library, const QString& topLevel, const QString& f, QSet<FileOnlySong>& existing, int level);
+	// A file found by the directory walk. Songs already known to the device are resolved
+	// during the walk, all others are filled in by the tag reader pool.
+	struct ScanItem {
+		Song song;
+		qint64 size = 0;
+		bool needsRead = false;
+	};
+
+	struct ScanJob;
+
+	void scanFolder(MusicLibraryItemRoot* library, const QString& topLevel, QSet<FileOnlySong>& existing);
+	void walkFolder(ScanJob* job, const QString& topLevel, const QString& f, QSet<FileOnlySong>& existing, int level);
+	void readTags(ScanJob* job);
+	void mergeItems(ScanJob* job, bool wait);
 
 private:
 	Thread* thread;
@@ -123,6 +136,7 @@ public:
 	void cleanDirs(const QSet<QString>& dirs) override;
 	Covers::Image requestCover(const Song& s) override;
 	QString cacheFileName() const;
+	bool hasCache() const;
 	virtual void setAudioFolder() const {}
 	void saveCache() override;
 	void removeCache() override;
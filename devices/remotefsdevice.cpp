@@ -414,7 +414,7 @@ bool RemoteFsDevice::isConnected() const
 		return false;
 	}
 
-	if (opts.useCache && !audioFolder.isEmpty() && QFile::exists(cacheFileName())) {
+	if (opts.useCache && !audioFolder.isEmpty() && hasCache()) {
 		currentMountStatus = true;
 		return true;
 	}
@@ -30,13 +30,18 @@
 #include "context/wikipediasettings.h"
 #include "covers.h"
 #include "models/streamsmodel.h"
+#include "network/networkcache.h"
 #include "online/podcastsearchdialog.h"
 #include "settings.h"
 #include "support/messagebox.h"
 #include "support/squeezedtextlabel.h"
 #include "support/thread.h"
 #include "support/utils.h"
+#include "thumbnailstore.h"
 #include "widgets/basicitemdelegate.h"
+#ifdef ENABLE_REPLAYGAIN_SUPPORT
+#include "replaygain/albumscanner.h"
+#endif
 #ifdef ENABLE_SCROBBLING
 #include "scrobbling/scrobbler.h"
 #endif
@@ -261,7 +266,8 @@ CacheSettings::CacheSettings(QWidget* parent)
 	              tree,
 	              CacheItem::Type_Covers);
 	new CacheItem(tr("Scaled Covers"), Utils::cacheDir(Covers::constScaledCoverDir, false), QStringList() << "*.jpg"
-	                                                                                                      << "*.png",
+	                                                                                                      << "*.png"
+	                                                                                                      << ThumbnailStore::constFileName,
 	              tree,
 	              CacheItem::Type_ScaledCovers);
 	new CacheItem(tr("Backdrops"), Utils::cacheDir(ContextWidget::constCacheDir, false), QStringList() << "*.jpg"
@@ -276,6 +282,10 @@ CacheSettings::CacheSettings(QWidget* parent)
 	new CacheItem(tr("Stream Listings"), Utils::cacheDir(StreamsModel::constSubDir, false), QStringList() << "*" + StreamsModel::constCacheExt, tree);
 	new CacheItem(tr("Podcast Directories"), Utils::cacheDir(PodcastSearchDialog::constCacheDir, false), QStringList() << "*" + PodcastSearchDialog::constExt, tree);
 	new CacheItem(tr("Wikipedia Languages"), Utils::cacheDir(WikipediaSettings::constSubDir, false), QStringList() << "*.xml.gz", tree);
+	new CacheItem(tr("Web Responses"), Utils::cacheDir(NetworkCache::constCacheDir, false), QStringList() << "*" + NetworkCache::constExt, tree);
+#ifdef ENABLE_REPLAYGAIN_SUPPORT
+	new CacheItem(tr("ReplayGain Scans"), Utils::cacheDir(AlbumScanner::constCacheDir, false), QStringList() << "*.cache", tree);
+#endif
 #ifdef ENABLE_SCROBBLING
 	new CacheItem(tr("Scrobble Tracks"), Utils::cacheDir(Scrobbler::constCacheDir, false), QStringList() << "*.xml.gz", tree);
 #endif
@@ -847,7 +847,7 @@ void CoverDialog::clearTempFiles()
 void CoverDialog::sendQueryRequest(const QUrl& url, const QString& host)
 {
 	DBUG << url.toString();
-	NetworkJob* j = NetworkAccessManager::self()->get(QNetworkRequest(url));
+	NetworkJob* j = NetworkAccessManager::self()->getCached(url, NetworkCache::Covers);
 	j->setProperty(constHostProperty, host.isEmpty() ? url.host() : host);
 	j->setProperty(constTypeProperty, (int)DL_Query);
 	connect(j, SIGNAL(finished()), this, SLOT(queryJobFinished()));
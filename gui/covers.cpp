@@ -32,6 +32,7 @@
 #include "settings.h"
 #include "support/thread.h"
 #include "support/utils.h"
+#include "thumbnailstore.h"
 #ifdef ENABLE_DEVICES_SUPPORT
 #include "devices/device.h"
 #include "models/devicesmodel.h"
@@ -40,6 +41,7 @@
 #include "tags/tags.h"
 #endif
 #include "support/globalstatic.h"
+#include "support/perfstats.h"
 #include "widgets/icons.h"
 #include <QApplication>
 #include <QDir>
@@ -71,6 +73,7 @@ static int debugLevel = 0;
 void Covers::enableDebug(bool verbose)
 {
 	debugLevel = verbose ? 2 : 1;
+	ThumbnailStore::enableDebug();
 }
 
 bool Covers::debugEnabled()
@@ -97,6 +100,11 @@ static bool fetchCovers = true;
 static QString constNoCover = QLatin1String("{nocover}");
 
 static double devicePixelRatio = 1.0;
+// If set, scaled covers are kept in one file - and not one file per cover and size.
+static ThumbnailStore* thumbnailStore = nullptr;
+// Pixmap cache hit rates, shown in the performance statistics
+static PerfStats::Counter scaledCoverCounter(PerfStats::Covers, "getScaledCover");
+static PerfStats::Counter coverCounter(PerfStats::Covers, "get");
 // Only scale images to device pixel ratio if un-scaled size is less then 300pixels.
 static const int constRetinaScaleMaxSize = 300;
 
@@ -296,6 +304,10 @@ static QString getScaledCoverName(const Song& song, int size, bool createDir)
 
 static void clearScaledCache(const Song& song)
 {
+	if (thumbnailStore) {
+		thumbnailStore->removeAllSizes(songKey(song));
+	}
+
 	QString dirName = Utils::cacheDir(Covers::constScaledCoverDir, false);
 	if (dirName.isEmpty()) {
 		return;
@@ -338,12 +350,24 @@ static void clearScaledCache(const Song& song)
 
 static QImage loadScaledCover(const Song& song, int size)
 {
+	if (thumbnailStore) {
+		QImage img = thumbnailStore->load(cacheKey(song, size));
+		if (!img.isNull()) {
+			VERBOSE_DBUG_CLASS("Covers") << song.albumArtist() << song.albumId() << size << "scaled cover found in store";
+			return img;
+		}
+	}
+
 	QString fileName = getScaledCoverName(song, size, false);
 	if (!fileName.isEmpty()) {
 		if (QFile::exists(fileName)) {
 			QImage img(fileName, constScaledFormat);
 			if (!img.isNull() && (img.width() == size || img.height() == size)) {
 				DBUG_CLASS("Covers") << song.albumArtist() << song.albumId() << size << "scaled cover found" << fileName;
+				// Move covers from the per-file layout into the store as they are used
+				if (thumbnailStore && thumbnailStore->save(cacheKey(song, size), img)) {
+					QFile::remove(fileName);
+				}
 				return img;
 			}
 		}
@@ -719,7 +743,7 @@ void CoverDownloader::downloadViaRemote(Job& job)
 		query.addQueryItem("artist", Covers::fixArtist(job.song.albumArtist()));
 		url.setQuery(query);
 
-		NetworkJob* j = network()->get(url);
+		NetworkJob* j = network()->getCached(url, NetworkCache::Covers);
 		connect(j, SIGNAL(finished()), this, SLOT(lastFmArtistCallFinished()));
 		job.type = JobRemote;
 		jobs.insert(j, job);
@@ -733,7 +757,7 @@ void CoverDownloader::downloadViaRemote(Job& job)
 		query.addQueryItem("media", "music");
 		query.addQueryItem("entity", "album");
 		url.setQuery(query);
-		NetworkJob* j = network()->get(url);
+		NetworkJob* j = network()->getCached(url, NetworkCache::Covers);
 		connect(j, SIGNAL(finished()), this, SLOT(remoteCallFinished()));
 		job.type = JobRemote;
 		jobs.insert(j, job);
@@ -1160,120 +1184,193 @@ NetworkAccessManager* CoverDownloader::network()
 	return manager;
 }
 
-CoverLocator::CoverLocator()
-	: timer(nullptr)
+// Requests made within the same period (e.g. during one paint of a view) are processed in the order
+// they were made, but the most recent period is always processed first.
+static const int constRequestPeriod = 50;
+// Views repaint after each delivery, so allow for a delivery to be emitted before the previous repaint
+static const int constStaleDeliveries = 3;
+
+CoverWorkQueue::CoverWorkQueue(bool cs)
+	: cancelStale(cs), stopped(false), activeWorkers(0), nextSeq(0)
 {
-	thread = new Thread(metaObject()->className());
-	moveToThread(thread);
-	thread->start();
+	clock.start();
+	pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
 }
 
-void CoverLocator::stop()
+void CoverWorkQueue::stop()
 {
-	thread->stop();
+	mutex.lock();
+	stopped = true;
+	requests.clear();
+	parked.clear();
+	order.clear();
+	mutex.unlock();
+	pool.waitForDone();
+	deleteLater();
 }
 
-void CoverLocator::startTimer(int interval)
+void CoverWorkQueue::request(const Song& song, const QString& key)
 {
-	if (!timer) {
-		timer = thread->createTimer(this);
-		timer->setSingleShot(true);
-		connect(timer, SIGNAL(timeout()), this, SLOT(locate()), Qt::QueuedConnection);
+	QMutexLocker locker(&mutex);
+	if (stopped) {
+		return;
+	}
+	parked.remove(key);
+	QHash<QString, Request>::Iterator it = requests.find(key);
+	if (it == requests.end()) {
+		Request req;
+		req.song = song;
+		queue(key, req);
+		requests.insert(key, req);
 	}
-	timer->start(interval);
+	else {
+		order.remove(it.value().priority);
+		queue(key, it.value());
+	}
+	startWorker();
 }
 
-void CoverLocator::locate(const Song& s)
+bool CoverWorkQueue::prioritise(const QString& key)
 {
-	queue.append(s);
-	startTimer(0);
+	QMutexLocker locker(&mutex);
+	QHash<QString, Request>::Iterator it = requests.find(key);
+	if (it != requests.end()) {
+		order.remove(it.value().priority);
+		queue(key, it.value());
+		return true;
+	}
+	it = parked.find(key);
+	if (it == parked.end()) {
+		return false;
+	}
+	// Item has been painted again, so is visible after all
+	Request req = it.value();
+	parked.erase(it);
+	queue(key, req);
+	requests.insert(key, req);
+	startWorker();
+	return true;
 }
 
-// To improve responsiveness of views, we only process a max of X images per even loop iteration.
-// If more images are asked for, we place these into a list, and get them on the next iteration
-// of the loop. This way things appear smoother.
-static const int constMaxCoverUpdatePerIteration = 10;
+void CoverWorkQueue::delivered(int size)
+{
+	QMutexLocker locker(&mutex);
+	deliveries[size]++;
+}
 
-void CoverLocator::locate()
+void CoverWorkQueue::queue(const QString& key, Request& req)
 {
-	QList<Song> toDo;
-	for (int i = 0; i < constMaxCoverUpdatePerIteration && !queue.isEmpty(); ++i) {
-		toDo.append(queue.takeFirst());
-	}
-	if (toDo.isEmpty()) {
-		return;
-	}
-	QList<LocatedCover> covers;
-	for (const Song& s : toDo) {
-		DBUG << s.file << s.artist << s.albumartist << s.album;
-		Covers::Image img = Covers::locateImage(s);
-		covers.append(LocatedCover(s, img.img, img.fileName));
-	}
-	if (!covers.isEmpty()) {
-		DBUG << "located" << covers.count();
-		emit located(covers);
+	req.seen = deliveries.value(req.song.size);
+	req.priority = Priority(-(clock.elapsed() / constRequestPeriod), nextSeq++);
+	order.insert(req.priority, key);
+}
+
+// Called with mutex locked
+void CoverWorkQueue::startWorker()
+{
+	if (activeWorkers < pool.maxThreadCount()) {
+		activeWorkers++;
+		pool.start([this]() { run(); });
 	}
+}
 
-	if (!queue.isEmpty()) {
-		startTimer(0);
+void CoverWorkQueue::run()
+{
+	for (;;) {
+		Song song;
+		bool haveSong = false;
+		mutex.lock();
+		while (!haveSong && !order.isEmpty()) {
+			QString key = order.take(order.firstKey());
+			Request req = requests.take(key);
+			if (cancelStale && deliveries.value(req.song.size) - req.seen >= constStaleDeliveries) {
+				DBUG << "parked" << key;
+				parked.insert(key, req);
+			}
+			else {
+				song = req.song;
+				haveSong = true;
+			}
+		}
+		if (!haveSong) {
+			activeWorkers--;
+		}
+		mutex.unlock();
+
+		if (!haveSong) {
+			return;
+		}
+		process(song);
 	}
 }
 
-CoverLoader::CoverLoader()
-	: timer(nullptr)
+CoverLocator::CoverLocator()
+	: CoverWorkQueue(false)
 {
-	thread = new Thread(metaObject()->className());
-	moveToThread(thread);
-	thread->start();
 }
 
-void CoverLoader::stop()
+// Results from all workers are collected, and emitted in one go from the GUI thread - so that
+// views are updated once per event loop iteration, and not once per cover.
+void CoverLocator::process(const Song& song)
 {
-	thread->stop();
+	DBUG << song.file << song.artist << song.albumartist << song.album;
+	Covers::Image img = Covers::locateImage(song);
+	QMutexLocker locker(&resultsMutex);
+	results.append(LocatedCover(song, img.img, img.fileName));
+	if (1 == results.count()) {
+		QMetaObject::invokeMethod(this, "emitLocated", Qt::QueuedConnection);
+	}
 }
 
-void CoverLoader::startTimer(int interval)
+void CoverLocator::emitLocated()
 {
-	if (!timer) {
-		timer = thread->createTimer(this);
-		timer->setSingleShot(true);
-		connect(timer, SIGNAL(timeout()), this, SLOT(load()), Qt::QueuedConnection);
+	resultsMutex.lock();
+	QList<LocatedCover> covers = results;
+	results.clear();
+	resultsMutex.unlock();
+	if (!covers.isEmpty()) {
+		DBUG << "located" << covers.count();
+		emit located(covers);
 	}
-	timer->start(interval);
 }
 
-void CoverLoader::load(const Song& song)
+CoverLoader::CoverLoader()
+	: CoverWorkQueue(true)
 {
-	queue.append(LoadedCover(song));
-	startTimer(0);
 }
 
-void CoverLoader::load()
+void CoverLoader::process(const Song& song)
 {
-	QList<LoadedCover> toDo;
-	for (int i = 0; i < constMaxCoverUpdatePerIteration && !queue.isEmpty(); ++i) {
-		toDo.append(queue.takeFirst());
-	}
-	if (toDo.isEmpty()) {
-		return;
+	DBUG << song.albumArtist() << song.albumId() << song.size;
+	int size = song.size;
+	if (size < constRetinaScaleMaxSize) {
+		size *= devicePixelRatio;
 	}
-	QList<LoadedCover> covers;
-	for (const LoadedCover& s : toDo) {
-		DBUG << s.song.albumArtist() << s.song.albumId() << s.song.size;
-		int size = s.song.size;
-		if (size < constRetinaScaleMaxSize) {
-			size *= devicePixelRatio;
-		}
-		covers.append(LoadedCover(s.song, loadScaledCover(s.song, size)));
+	QImage img = loadScaledCover(song, size);
+	QMutexLocker locker(&resultsMutex);
+	results.append(LoadedCover(song, img));
+	if (1 == results.count()) {
+		QMetaObject::invokeMethod(this, "emitLoaded", Qt::QueuedConnection);
 	}
+}
+
+void CoverLoader::emitLoaded()
+{
+	resultsMutex.lock();
+	QList<LoadedCover> covers = results;
+	results.clear();
+	resultsMutex.unlock();
 	if (!covers.isEmpty()) {
 		DBUG << "loaded" << covers.count();
+		QSet<int> sizes;
+		for (const LoadedCover& cover : covers) {
+			sizes.insert(cover.song.size);
+		}
+		for (int size : sizes) {
+			delivered(size);
+		}
 		emit loaded(covers);
 	}
-
-	if (!queue.isEmpty()) {
-		startTimer(0);
-	}
 }
 
 Covers::Covers()
@@ -1299,6 +1396,12 @@ void Covers::readConfig()
 	if (albumCoverName.isEmpty()) {
 		albumCoverName = constFileName;
 	}
+	if (!thumbnailStore && Settings::self()->coverThumbnailStore()) {
+		QString dir = Utils::cacheDir(constScaledCoverDir, true);
+		if (!dir.isEmpty()) {
+			thumbnailStore = new ThumbnailStore(dir + ThumbnailStore::constFileName);
+		}
+	}
 }
 
 void Covers::stop()
@@ -1325,6 +1428,12 @@ void Covers::stop()
 #endif
 }
 
+void Covers::closeThumbnailStore()
+{
+	delete thumbnailStore;
+	thumbnailStore = nullptr;
+}
+
 static inline Song setSizeRequest(Song s, int size)
 {
 	s.setSpecificSizeRequest(size);
@@ -1341,6 +1450,9 @@ void Covers::clearNameCache()
 void Covers::clearScaleCache()
 {
 	cache.clear();
+	if (thumbnailStore) {
+		thumbnailStore->clear();
+	}
 }
 
 QPixmap* Covers::getScaledCover(const Song& song, int size)
@@ -1351,7 +1463,9 @@ QPixmap* Covers::getScaledCover(const Song& song, int size)
 	//    DBUG_CLASS("Covers") << song.albumArtist() << song.album << song.mbAlbumId() << size;
 	QString key = cacheKey(song, size);
 	QPixmap* pix(cache.object(key));
+	scaledCoverCounter.record(nullptr != pix);
 	if (!pix) {
+		PerfStats::Scope perf(PerfStats::Covers, "loadScaledCover");
 		QImage img = loadScaledCover(song, size);
 		if (!img.isNull()) {
 			pix = new QPixmap(QPixmap::fromImage(img));
@@ -1376,9 +1490,15 @@ QPixmap* Covers::saveScaledCover(const QImage& img, const Song& song, int size)
 	}
 
 	if (!isOnlineServiceImage(song)) {
-		QString fileName = getScaledCoverName(song, size, true);
-		bool status = img.save(fileName, constScaledFormat);
-		DBUG_CLASS("Covers") << song.albumArtist() << song.album << song.mbAlbumId() << size << fileName << status;
+		if (thumbnailStore) {
+			bool status = thumbnailStore->save(cacheKey(song, size), img);
+			DBUG_CLASS("Covers") << song.albumArtist() << song.album << song.mbAlbumId() << size << "store" << status;
+		}
+		else {
+			QString fileName = getScaledCoverName(song, size, true);
+			bool status = img.save(fileName, constScaledFormat);
+			DBUG_CLASS("Covers") << song.albumArtist() << song.album << song.mbAlbumId() << size << fileName << status;
+		}
 	}
 	QPixmap* pix = new QPixmap(QPixmap::fromImage(img));
 	cache.insert(cacheKey(song, size), pix, pix->width() * pix->height() * (pix->depth() / 8));
@@ -1437,6 +1557,7 @@ QPixmap* Covers::get(const Song& song, int size, bool urgent)
 	if (!song.isUnknownAlbum() || song.isStandardStream()) {
 		key = cacheKey(song, size);
 		pix = cache.object(key);
+		coverCounter.record(nullptr != pix);
 
 		if (!pix) {
 			/*if (song.isArtistImageRequest() && song.isVariousArtists()) {
@@ -1494,7 +1615,7 @@ QPixmap* Covers::get(const Song& song, int size, bool urgent)
 				}
 			}
 			VERBOSE_DBUG << "Cached cover not found";
-			tryToLoad(setSizeRequest(song, origSize));
+			tryToLoad(setSizeRequest(song, origSize), key);
 
 			// Create a dummy image so that we dont keep on locating/loading/downloading files that do not exist!
 			pix = new QPixmap(1, 1);
@@ -1510,6 +1631,11 @@ QPixmap* Covers::get(const Song& song, int size, bool urgent)
 			VERBOSE_DBUG << "Found cached pixmap" << pix->width();
 			return pix;
 		}
+		if (loader) {
+			// Item is being painted, so if its cover is still waiting to be loaded (or was parked as the item
+			// looked to have scrolled out of view) move it to the front.
+			loader->prioritise(key);
+		}
 	}
 	VERBOSE_DBUG << "Use default pixmap";
 	return defaultPix(song, size, origSize);
@@ -1580,9 +1706,8 @@ void Covers::tryToLocate(const Song& song)
 		qRegisterMetaType<QList<LocatedCover>>("QList<LocatedCover>");
 		locator = new CoverLocator();
 		connect(locator, SIGNAL(located(QList<LocatedCover>)), this, SLOT(located(QList<LocatedCover>)), Qt::QueuedConnection);
-		connect(this, SIGNAL(locate(Song)), locator, SLOT(locate(Song)), Qt::QueuedConnection);
 	}
-	emit locate(song);
+	locator->request(song, songKey(song) + QLatin1Char(':') + QString::number(song.size));
 }
 
 void Covers::tryToDownload(const Song& song)
@@ -1601,16 +1726,15 @@ void Covers::tryToDownload(const Song& song)
 	emit download(song);
 }
 
-void Covers::tryToLoad(const Song& song)
+void Covers::tryToLoad(const Song& song, const QString& key)
 {
 	if (!loader) {
 		qRegisterMetaType<LoadedCover>("LoadedCover");
 		qRegisterMetaType<QList<LoadedCover>>("QList<LoadedCover>");
 		loader = new CoverLoader();
 		connect(loader, SIGNAL(loaded(QList<LoadedCover>)), this, SLOT(loaded(QList<LoadedCover>)), Qt::QueuedConnection);
-		connect(this, SIGNAL(load(Song)), loader, SLOT(load(Song)), Qt::QueuedConnection);
 	}
-	emit load(song);
+	loader->request(song, key);
 }
 
 Covers::Image Covers::findImage(const Song& song, bool emitResult)
@@ -27,6 +27,7 @@
 #include "config.h"
 #include "mpd-interface/song.h"
 #include <QCache>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QImage>
 #include <QMap>
@@ -34,6 +35,7 @@
 #include <QObject>
 #include <QPixmap>
 #include <QSet>
+#include <QThreadPool>
 
 class QString;
 class Thread;
@@ -112,28 +114,73 @@ struct LocatedCover {
 	QString fileName;
 };
 
-class CoverLocator : public QObject {
+// Queue of cover requests, processed by a pool of threads. Requests made most recently (i.e. for
+// items that have just been painted) are processed first, and requests for a key that is already
+// queued are merged. If cancelStale is set, requests for items that are no longer visible are
+// parked when they reach the front, and only re-queued if the item is painted again. An item is
+// taken to be no longer visible if views showing covers of its size have repainted after
+// constStaleDeliveries results were delivered, without asking for it again.
+class CoverWorkQueue : public QObject {
 	Q_OBJECT
 public:
-	CoverLocator();
-	~CoverLocator() override {}
+	CoverWorkQueue(bool cancelStale);
+	~CoverWorkQueue() override {}
 
 	void stop();
+	void request(const Song& song, const QString& key);
+	// Move an already queued, or parked, request back to the front, returns false if key is not queued.
+	bool prioritise(const QString& key);
+
+protected:
+	// Called from a worker thread
+	virtual void process(const Song& song) = 0;
+	// Called from the GUI thread, as results for covers of this size are emitted
+	void delivered(int size);
+
+private:
+	typedef QPair<qint64, quint64> Priority;
+	struct Request {
+		Song song;
+		Priority priority;
+		int seen;// Number of deliveries for the song's size when last requested
+	};
+
+	void queue(const QString& key, Request& req);
+	void startWorker();
+	void run();
+
+private:
+	bool cancelStale;
+	bool stopped;
+	int activeWorkers;
+	quint64 nextSeq;
+	QElapsedTimer clock;
+	QMutex mutex;
+	QHash<QString, Request> requests;
+	QHash<QString, Request> parked;
+	QHash<int, int> deliveries;
+	QMap<Priority, QString> order;
+	QThreadPool pool;
+};
+
+class CoverLocator : public CoverWorkQueue {
+	Q_OBJECT
+public:
+	CoverLocator();
+	~CoverLocator() override {}
 
 Q_SIGNALS:
 	void located(const QList<LocatedCover>& covers);
 
-public Q_SLOTS:
-	void locate(const Song& s);
-	void locate();
+private Q_SLOTS:
+	void emitLocated();
 
 private:
-	void startTimer(int interval);
+	void process(const Song& song) override;
 
 private:
-	Thread* thread;
-	QTimer* timer;
-	QList<Song> queue;
+	QMutex resultsMutex;
+	QList<LocatedCover> results;
 };
 
 struct LoadedCover {
@@ -143,28 +190,24 @@ struct LoadedCover {
 	QImage img;
 };
 
-class CoverLoader : public QObject {
+class CoverLoader : public CoverWorkQueue {
 	Q_OBJECT
 public:
 	CoverLoader();
 	~CoverLoader() override {}
 
-	void stop();
-
 Q_SIGNALS:
 	void loaded(const QList<LoadedCover>& covers);
 
-public Q_SLOTS:
-	void load(const Song& song);
-	void load();
+private Q_SLOTS:
+	void emitLoaded();
 
 private:
-	void startTimer(int interval);
+	void process(const Song& song) override;
 
 private:
-	Thread* thread;
-	QTimer* timer;
-	QList<LoadedCover> queue;
+	QMutex resultsMutex;
+	QList<LoadedCover> results;
 };
 
 class Covers : public QObject {
@@ -209,6 +252,8 @@ public:
 	Covers();
 	void readConfig();
 	void stop();
+	// Release the scaled cover store, only to be called once the cover threads have stopped.
+	void closeThumbnailStore();
 
 	void clearNameCache();
 	void clearScaleCache();
@@ -235,8 +280,6 @@ public:
 
 Q_SIGNALS:
 	void download(const Song& s);
-	void locate(const Song& s);
-	void load(const Song& song);
 	void loaded(const Song& song, int s);
 	void cover(const Song& song, const QImage& img, const QString& file);
 	void coverUpdated(const Song& song, const QImage& img, const QString& file);
@@ -254,7 +297,7 @@ private:
 	QPixmap* defaultPix(const Song& song, int size, int origSize);
 	void tryToLocate(const Song& song);
 	void tryToDownload(const Song& song);
-	void tryToLoad(const Song& song);
+	void tryToLoad(const Song& song, const QString& key);
 	Image findImage(const Song& song, bool emitResult);
 	bool updateCache(const Song& song, const QImage& img, bool dummyEntriesOnly);
 	void gotAlbumCover(const Song& song, const QImage& img, const QString& fileName, bool emitResult = true);
@@ -28,6 +28,7 @@
 #include "mainwindow.h"
 #include "mpd-interface/song.h"
 #include "settings.h"
+#include "support/perfstats.h"
 #include "support/thread.h"
 #include "support/utils.h"
 #include <QDir>
@@ -48,7 +49,9 @@
 #ifdef ENABLE_DEVICES_SUPPORT
 #include "models/devicesmodel.h"
 #endif
+#include "context/contextprefetcher.h"
 #include "context/contextwidget.h"
+#include "context/lyricsfetcher.h"
 #include "context/ultimatelyricsprovider.h"
 #include "http/httpserver.h"
 #include "network/networkaccessmanager.h"
@@ -204,6 +207,7 @@ static void installDebugMessageHandler(const QString& cmdLine)
 		}
 		if (all || QLatin1String("context-widget") == area) {
 			ContextWidget::enableDebug();
+			ContextPrefetcher::enableDebug();
 		}
 		if (all || QLatin1String("dynamic") == area) {
 			DynamicPlaylists::enableDebug();
@@ -222,6 +226,7 @@ static void installDebugMessageHandler(const QString& cmdLine)
 		}
 		if (all || QLatin1String("context-lyrics") == area) {
 			UltimateLyricsProvider::enableDebug();
+			LyricsFetcher::enableDebug();
 		}
 		if (all || QLatin1String("threads") == area) {
 			ThreadCleaner::enableDebug();
@@ -377,11 +382,14 @@ int main(int argc, char* argv[])
 	QCommandLineOption fullscreenOption(QStringList() << "F"
 	                                                  << "fullscreen",
 	                                    QObject::tr("Start full screen"), "", "false");
+	QCommandLineOption perfOption(QStringList() << "perf",
+	                              QObject::tr("Record timings of MPD commands, database queries, cover loading and model updates"));
 	cmdLineParser.addOption(debugOption);
 	cmdLineParser.addOption(debugToFileOption);
 	cmdLineParser.addOption(noNetworkOption);
 	cmdLineParser.addOption(collectionOption);
 	cmdLineParser.addOption(fullscreenOption);
+	cmdLineParser.addOption(perfOption);
 	cmdLineParser.process(app);
 	QStringList files = cmdLineParser.positionalArguments();
 
@@ -392,6 +400,9 @@ int main(int argc, char* argv[])
 	if (cmdLineParser.isSet(noNetworkOption)) {
 		NetworkAccessManager::disableNetworkAccess();
 	}
+	if (cmdLineParser.isSet(perfOption)) {
+		PerfStats::setEnabled(true);
+	}
 
 // Set the permissions on the config file on Unix - it can contain passwords
 // for internet services so it's important that other users can't read it.
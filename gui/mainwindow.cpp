@@ -33,9 +33,11 @@
 #include "models/playlistsmodel.h"
 #include "mpd-interface/mpdparseutils.h"
 #include "mpd-interface/mpdstats.h"
+#include "perfstatsdialog.h"
 #include "preferencesdialog.h"
 #include "support/inputdialog.h"
 #include "support/messagebox.h"
+#include "support/perfstats.h"
 #include "support/thread.h"
 #include "trayitem.h"
 #ifdef ENABLE_SIMPLE_MPD_SUPPORT
@@ -66,6 +68,7 @@
 #endif
 #include "http/httpserver.h"
 #include "online/onlineservicespage.h"
+#include "online/podcastservice.h"
 #ifdef TagLib_FOUND
 #include "tags/tageditor.h"
 #include "tags/tags.h"
@@ -273,6 +276,11 @@ MainWindow::MainWindow(QWidget* parent)
 	serverInfoAction = ActionCollection::get()->createAction("mpdinfo", tr("Server information..."), Icon::fa()->icon(fa::fa_solid, fa::fa_server));
 	connect(serverInfoAction, SIGNAL(triggered()), this, SLOT(showServerInfo()));
 	serverInfoAction->setEnabled(Settings::self()->firstRun());
+	perfStatsAction = nullptr;
+	if (PerfStats::enabled()) {
+		perfStatsAction = ActionCollection::get()->createAction("perfstats", tr("Performance statistics..."), Icon::fa()->icon(fa::fa_solid, fa::fa_gauge));
+		connect(perfStatsAction, SIGNAL(triggered()), this, SLOT(showPerfStats()));
+	}
 	refreshDbAction = ActionCollection::get()->createAction("refresh", tr("Refresh Database"), Icons::self()->refreshIcon);
 	doDbRefreshAction = new Action(refreshDbAction->icon(), tr("Refresh"), this);
 	refreshDbAction->setEnabled(false);
@@ -686,6 +694,9 @@ MainWindow::MainWindow(QWidget* parent)
 #endif
 		menu = new QMenu(tr("&Help"), this);
 		addMenuAction(menu, serverInfoAction);
+		if (perfStatsAction) {
+			addMenuAction(menu, perfStatsAction);
+		}
 		addMenuAction(menu, aboutAction);
 		menuBar()->addMenu(menu);
 	}
@@ -715,6 +726,9 @@ MainWindow::MainWindow(QWidget* parent)
 	mainMenu->addAction(searchPlayQueueAction);
 	mainMenu->addSeparator();
 	mainMenu->addAction(serverInfoAction);
+	if (perfStatsAction) {
+		mainMenu->addAction(perfStatsAction);
+	}
 	mainMenu->addAction(aboutAction);
 	mainMenu->addSeparator();
 	mainMenu->addAction(quitAction);
@@ -1003,6 +1017,7 @@ MainWindow::~MainWindow()
 	//    playlistsPage->saveConfig();
 	context->saveConfig();
 	StreamsModel::self()->save();
+	PodcastService::self()->stop();
 	nowPlaying->saveConfig();
 	Settings::self()->saveForceSingleClick(TreeView::getForceSingleClick());
 	if (Utils::useSystemTray()) {
@@ -1039,6 +1054,7 @@ MainWindow::~MainWindow()
 	Tags::stop();
 #endif
 	ThreadCleaner::self()->stopAll();
+	Covers::self()->closeThumbnailStore();
 	Configuration(playQueuePage->metaObject()->className()).set(ItemView::constSearchActiveKey, playQueueSearchWidget->isActive());
 }
 
@@ -1803,6 +1819,15 @@ void MainWindow::showServerInfo()
 	                        tr("Server Information"));
 }
 
+void MainWindow::showPerfStats()
+{
+	if (PerfStatsDialog::instanceCount()) {
+		return;
+	}
+	PerfStatsDialog* dlg = new PerfStatsDialog(this);
+	dlg->show();
+}
+
 void MainWindow::enableStopActions(bool enable)
 {
 	StdActions::self()->stopAfterCurrentTrackAction->setEnabled(enable);
@@ -2097,6 +2122,7 @@ void MainWindow::updateStatus(MPDStatus* const status)
 	singlePlayQueueAction->setChecked(status->single());
 	consumePlayQueueAction->setChecked(status->consume());
 	updateNextTrack(status->nextSongId());
+	prefetchContext(status->nextSongId());
 
 	if (status->timeElapsed() < 64800 && (!currentIsStream() || (status->timeTotal() > 0 && status->timeElapsed() <= status->timeTotal()))) {
 		if (status->state() == MPDState_Stopped || status->state() == MPDState_Inactive) {
@@ -2861,6 +2887,22 @@ void MainWindow::updateNextTrack(int nextTrackId)
 	}
 }
 
+void MainWindow::prefetchContext(int nextTrackId)
+{
+	// Prefetch context for the next song, and - if the order is known - the one after that.
+	QList<Song> songs;
+	if (-1 != nextTrackId && MPDState_Playing == MPDStatus::self()->state()) {
+		int row = PlayQueueModel::self()->getRowById(nextTrackId);
+		if (row >= 0) {
+			songs.append(PlayQueueModel::self()->getSongByRow(row));
+			if (!MPDStatus::self()->random() && row + 1 < PlayQueueModel::self()->rowCount()) {
+				songs.append(PlayQueueModel::self()->getSongByRow(row + 1));
+			}
+		}
+	}
+	context->prefetch(songs);
+}
+
 void MainWindow::updateActionToolTips()
 {
 	ActionCollection::get()->updateToolTips();
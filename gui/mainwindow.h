@@ -176,6 +176,7 @@ public Q_SLOTS:
 	void streamUrl(const QString& u);
 	void refreshDbPromp();
 	void showServerInfo();
+	void showPerfStats();
 	void stopPlayback();
 	void stopAfterCurrentTrack();
 	void stopAfterTrack();
@@ -267,6 +268,7 @@ private:
 	void updateWindowTitle();
 	void showTab(int page) { tabWidget->setCurrentIndex(page); }
 	void updateNextTrack(int nextTrackId);
+	void prefetchContext(int nextTrackId);
 	void updateActionToolTips();
 	void startContextTimer();
 	int calcMinHeight();
@@ -335,6 +337,7 @@ private:
 	Action* expandAllAction;
 	Action* collapseAllAction;
 	Action* serverInfoAction;
+	Action* perfStatsAction;
 	Action* cancelAction;
 	Action* ratingAction;
 	TrayItem* trayItem;
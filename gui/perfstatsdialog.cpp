@@ -0,0 +1,158 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "perfstatsdialog.h"
+#include "support/messagebox.h"
+#include "support/perfstats.h"
+#include "support/utils.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+static int iCount = 0;
+
+int PerfStatsDialog::instanceCount()
+{
+	return iCount;
+}
+
+enum Columns {
+	COL_CATEGORY,
+	COL_NAME,
+	COL_COUNT,
+	COL_TOTAL,
+	COL_MEAN,
+	COL_MAX,
+	COL_BYTES,
+	COL_HIT_RATE,
+
+	COL_COUNT_COLUMNS
+};
+
+static double toMs(qint64 ns)
+{
+	return qRound64(ns / 10000.0) / 100.0;
+}
+
+PerfStatsDialog::PerfStatsDialog(QWidget* parent)
+	: Dialog(parent, "PerfStatsDialog", QSize(800, 500))
+{
+	iCount++;
+	setAttribute(Qt::WA_DeleteOnClose);
+	setCaption(tr("Performance Statistics"));
+	setButtons(User1 | User2 | Close);
+	setButtonText(User1, tr("Export Trace..."));
+	setButtonText(User2, tr("Clear"));
+
+	QWidget* mw = new QWidget(this);
+	QVBoxLayout* layout = new QVBoxLayout(mw);
+	tree = new QTreeWidget(mw);
+	tree->setHeaderLabels(QStringList() << tr("Category") << tr("Name") << tr("Count") << tr("Total (ms)") << tr("Mean (ms)")
+	                                    << tr("Max (ms)") << tr("Bytes") << tr("Hit Rate"));
+	tree->setRootIsDecorated(false);
+	tree->setSortingEnabled(true);
+	tree->sortByColumn(COL_TOTAL, Qt::DescendingOrder);
+	tree->header()->setSectionResizeMode(COL_NAME, QHeaderView::Stretch);
+	status = new QLabel(mw);
+	layout->addWidget(tree);
+	layout->addWidget(status);
+	layout->setContentsMargins(0, 0, 0, 0);
+	setMainWidget(mw);
+
+	timer = new QTimer(this);
+	connect(timer, SIGNAL(timeout()), this, SLOT(refresh()));
+	timer->start(1000);
+	refresh();
+}
+
+PerfStatsDialog::~PerfStatsDialog()
+{
+	iCount--;
+}
+
+void PerfStatsDialog::refresh()
+{
+	const QList<PerfStats::Summary> summaries = PerfStats::summarise();
+	tree->setSortingEnabled(false);
+	tree->clear();
+	for (const PerfStats::Summary& s : summaries) {
+		QTreeWidgetItem* item = new QTreeWidgetItem(tree);
+		item->setText(COL_CATEGORY, QLatin1String(PerfStats::categoryName(s.category)));
+		item->setText(COL_NAME, s.detail.isEmpty() ? s.name : (s.name + QLatin1String(": ") + s.detail));
+		if (s.count) {
+			item->setData(COL_COUNT, Qt::DisplayRole, s.count);
+			item->setData(COL_TOTAL, Qt::DisplayRole, toMs(s.totalNs));
+			item->setData(COL_MEAN, Qt::DisplayRole, toMs(s.totalNs / (qint64)s.count));
+			item->setData(COL_MAX, Qt::DisplayRole, toMs(s.maxNs));
+		}
+		if (s.bytes) {
+			item->setText(COL_BYTES, Utils::formatByteSize(s.bytes));
+		}
+		if (s.hits || s.misses) {
+			item->setText(COL_HIT_RATE, tr("%1% (%2 of %3)").arg((s.hits * 100) / (s.hits + s.misses)).arg(s.hits).arg(s.hits + s.misses));
+		}
+		for (int c = COL_COUNT; c < COL_COUNT_COLUMNS; ++c) {
+			item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+		}
+	}
+	tree->setSortingEnabled(true);
+
+	quint64 dropped = 0;
+	int held = PerfStats::events(&dropped).count();
+	status->setText(dropped ? tr("Timings are from the most recent %1 events, %2 older events have been discarded.").arg(held).arg(dropped)
+	                        : tr("Timings are from %1 events.").arg(held));
+}
+
+void PerfStatsDialog::slotButtonClicked(int button)
+{
+	switch (button) {
+	case User1:
+		exportTrace();
+		break;
+	case User2:
+		PerfStats::clear();
+		refresh();
+		break;
+	default:
+		Dialog::slotButtonClicked(button);
+		break;
+	}
+}
+
+void PerfStatsDialog::exportTrace()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Export Trace"), QDir::homePath() + QLatin1String("/cantata-trace.json"),
+	                                                tr("Chrome Trace (*.json)"));
+	if (fileName.isEmpty()) {
+		return;
+	}
+	if (!PerfStats::exportTrace(fileName)) {
+		MessageBox::error(this, tr("Failed to write %1").arg(fileName));
+	}
+}
+
+#include "moc_perfstatsdialog.cpp"
@@ -0,0 +1,55 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PERF_STATS_DIALOG_H
+#define PERF_STATS_DIALOG_H
+
+#include "support/dialog.h"
+
+class QLabel;
+class QTimer;
+class QTreeWidget;
+
+// Live view of the timings recorded by PerfStats (when started with --perf)
+class PerfStatsDialog : public Dialog {
+	Q_OBJECT
+public:
+	static int instanceCount();
+
+	PerfStatsDialog(QWidget* parent);
+	~PerfStatsDialog() override;
+
+private Q_SLOTS:
+	void refresh();
+
+private:
+	void slotButtonClicked(int button) override;
+	void exportTrace();
+
+private:
+	QTreeWidget* tree;
+	QLabel* status;
+	QTimer* timer;
+};
+
+#endif
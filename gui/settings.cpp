@@ -665,6 +665,11 @@ bool Settings::fetchCovers()
 	return cfg.get("fetchCovers", true);
 }
 
+bool Settings::coverThumbnailStore()
+{
+	return cfg.get("coverThumbnailStore", false);
+}
+
 QString Settings::lang()
 {
 	return cfg.get("lang", QString());
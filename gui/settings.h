@@ -135,6 +135,7 @@ public:
 	StartupState startupState();
 	QString searchCategory();
 	bool fetchCovers();
+	bool coverThumbnailStore();
 	QString lang();
 	bool showCoverWidget();
 	bool showStopButton();
@@ -0,0 +1,389 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "thumbnailstore.h"
+#include "config.h"
+#include <QBuffer>
+#include <QStringList>
+#include <QThreadPool>
+#include <cstring>
+
+#include <QDebug>
+static bool debugEnabled = false;
+#define DBUG \
+	if (debugEnabled) qWarning() << "ThumbnailStore" << __FUNCTION__
+
+void ThumbnailStore::enableDebug()
+{
+	debugEnabled = true;
+}
+
+const QLatin1String ThumbnailStore::constFileName("thumbnails.store");
+
+#ifdef USE_JPEG_FOR_SCALED_CACHE
+static const char* constEncodedFormat = "JPG";
+#else
+static const char* constEncodedFormat = "PNG";
+#endif
+
+static const QByteArray constMagic("CTHUMBS1");
+static const int constHeaderSize = 16;
+// Thumbnails up to 128x128 are stored as raw ARGB32 data
+static const int constMaxRawBytes = 128 * 128 * 4;
+static const qint64 constMinCompactWaste = 8 * 1024 * 1024;
+
+enum Format {
+	Format_Removed,
+	Format_Argb,
+	Format_Encoded
+};
+
+struct RecordHeader {
+	quint32 keyLength;
+	quint32 dataLength;
+	quint16 width;
+	quint16 height;
+	quint16 format;
+	quint16 reserved;
+};
+
+// Keep key and data 4 byte aligned, so that ARGB data can be used in-place. Sizes are calculated as
+// qint64, so that lengths read from a corrupt file cannot wrap around.
+static inline qint64 pad(qint64 v)
+{
+	return (v + 3) & ~Q_INT64_C(3);
+}
+
+static inline qint64 recordSize(qint64 keyLength, qint64 dataLength)
+{
+	return sizeof(RecordHeader) + pad(keyLength) + pad(dataLength);
+}
+
+static bool writeHeader(QFile& f)
+{
+	QByteArray header = constMagic;
+	header.append(constHeaderSize - constMagic.length(), '\0');
+	return f.write(header) == header.length();
+}
+
+static bool writeRecord(QFile& f, const QByteArray& key, const char* data, quint32 length, quint16 width, quint16 height, quint16 format)
+{
+	RecordHeader hdr = {(quint32)key.length(), length, width, height, format, 0};
+	QByteArray rec;
+	rec.reserve(recordSize(hdr.keyLength, length));
+	rec.append(reinterpret_cast<const char*>(&hdr), sizeof(RecordHeader));
+	rec.append(key);
+	rec.append(pad(hdr.keyLength) - hdr.keyLength, '\0');
+	rec.append(data, length);
+	rec.append(pad(length) - length, '\0');
+	return f.write(rec) == rec.length();
+}
+
+ThumbnailStore::Mapping::Mapping(const QString& fileName, qint64 sz)
+	: data(nullptr), size(sz)
+{
+	file.setFileName(fileName);
+	if (file.open(QIODevice::ReadOnly)) {
+		data = file.map(0, size);
+	}
+}
+
+ThumbnailStore::Mapping::~Mapping()
+{
+	if (data) {
+		file.unmap(data);
+	}
+	file.close();
+}
+
+ThumbnailStore::ThumbnailStore(const QString& fn)
+	: fileName(fn), opened(false), compacting(false), generation(0), wasted(0)
+{
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+	QMutexLocker locker(&mutex);
+	while (compacting) {
+		compacted.wait(&mutex);
+	}
+	close();
+}
+
+QImage ThumbnailStore::load(const QString& key)
+{
+	QSharedPointer<Mapping> m;
+	Entry entry;
+	{
+		QMutexLocker locker(&mutex);
+		if (!open()) {
+			return QImage();
+		}
+		QHash<QString, Entry>::ConstIterator it = entries.constFind(key);
+		if (it == entries.constEnd()) {
+			return QImage();
+		}
+		entry = it.value();
+		m = mapping(entry.offset + entry.length);
+		if (!m) {
+			return QImage();
+		}
+	}
+
+	const uchar* data = m->data + entry.offset;
+	if (Format_Argb == entry.format) {
+#ifdef Q_OS_WIN
+		// Windows cannot replace a file that is still mapped, so images must not keep the mapping alive.
+		return QImage(data, entry.width, entry.height, entry.width * 4, QImage::Format_ARGB32_Premultiplied).copy();
+#else
+		// Image refers directly to the mapped data, and keeps the mapping alive until it is released.
+		return QImage(data, entry.width, entry.height, entry.width * 4, QImage::Format_ARGB32_Premultiplied,
+		              releaseMapping, new QSharedPointer<Mapping>(m));
+#endif
+	}
+	return QImage::fromData(data, entry.length);
+}
+
+bool ThumbnailStore::save(const QString& key, const QImage& img)
+{
+	if (img.isNull() || img.width() > 0xFFFF || img.height() > 0xFFFF) {
+		return false;
+	}
+
+	QByteArray data;
+	quint16 format;
+	if (img.width() * img.height() * 4 <= constMaxRawBytes) {
+		QImage argb = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		data = QByteArray(reinterpret_cast<const char*>(argb.constBits()), argb.sizeInBytes());
+		format = Format_Argb;
+	}
+	else {
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+		if (!img.save(&buffer, constEncodedFormat)) {
+			return false;
+		}
+		format = Format_Encoded;
+	}
+
+	QMutexLocker locker(&mutex);
+	return open() && append(key, data, img.width(), img.height(), format);
+}
+
+void ThumbnailStore::removeAllSizes(const QString& prefix)
+{
+	QMutexLocker locker(&mutex);
+	if (!open()) {
+		return;
+	}
+	QStringList keys;
+	for (auto it = entries.constBegin(), end = entries.constEnd(); it != end; ++it) {
+		const QString& key = it.key();
+		if (key.length() > prefix.length() && key.startsWith(prefix)) {
+			bool isSize = false;
+			key.mid(prefix.length()).toUInt(&isSize);
+			if (isSize) {
+				keys.append(key);
+			}
+		}
+	}
+	for (const QString& key : keys) {
+		append(key, QByteArray(), 0, 0, Format_Removed);
+	}
+}
+
+void ThumbnailStore::clear()
+{
+	QMutexLocker locker(&mutex);
+	close();
+	QFile::remove(fileName);
+	generation++;
+}
+
+bool ThumbnailStore::open()
+{
+	if (opened) {
+		return true;
+	}
+
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::ReadWrite)) {
+		DBUG << "Failed to open" << fileName;
+		return false;
+	}
+	if (file.size() < constHeaderSize || file.read(constMagic.length()) != constMagic) {
+		DBUG << "Creating" << fileName;
+		file.resize(0);
+		if (!writeHeader(file)) {
+			file.close();
+			return false;
+		}
+		file.flush();
+	}
+	else {
+		scan();
+	}
+	opened = true;
+	return true;
+}
+
+void ThumbnailStore::close()
+{
+	if (file.isOpen()) {
+		file.close();
+	}
+	map.clear();
+	entries.clear();
+	wasted = 0;
+	opened = false;
+}
+
+// Build the index from the records in the file. A truncated record at the end (e.g. from a crash
+// whilst writing) is removed, as is everything from the first record that does not fit in the file.
+void ThumbnailStore::scan()
+{
+	qint64 size = file.size();
+	QSharedPointer<Mapping> m = mapping(size);
+	qint64 pos = constHeaderSize;
+	if (m) {
+		while (pos + (qint64)sizeof(RecordHeader) <= size) {
+			RecordHeader hdr;
+			memcpy(&hdr, m->data + pos, sizeof(RecordHeader));
+			qint64 end = pos + recordSize(hdr.keyLength, hdr.dataLength);
+			if (end > size || hdr.format > Format_Encoded || (Format_Argb == hdr.format && hdr.dataLength != (quint32)hdr.width * hdr.height * 4)) {
+				break;
+			}
+			QString key = QString::fromUtf8(reinterpret_cast<const char*>(m->data + pos + sizeof(RecordHeader)), hdr.keyLength);
+			QHash<QString, Entry>::Iterator it = entries.find(key);
+			if (it != entries.end()) {
+				wasted += it.value().recordSize;
+			}
+			if (Format_Removed == hdr.format) {
+				wasted += recordSize(hdr.keyLength, 0);
+				if (it != entries.end()) {
+					entries.erase(it);
+				}
+			}
+			else {
+				Entry entry = {pos + (qint64)sizeof(RecordHeader) + pad(hdr.keyLength), hdr.dataLength, hdr.width, hdr.height, hdr.format, recordSize(hdr.keyLength, hdr.dataLength)};
+				entries.insert(key, entry);
+			}
+			pos = end;
+		}
+	}
+	if (pos != size) {
+		DBUG << "Truncating" << fileName << "from" << size << "to" << pos;
+		map.clear();
+		file.resize(pos);
+	}
+	DBUG << fileName << entries.count() << "entries" << wasted << "bytes wasted";
+}
+
+bool ThumbnailStore::append(const QString& key, const QByteArray& data, quint16 width, quint16 height, quint16 format)
+{
+	QByteArray k = key.toUtf8();
+	qint64 start = file.size();
+	if (!file.seek(start) || !writeRecord(file, k, data.constData(), data.length(), width, height, format) || !file.flush()) {
+		DBUG << "Failed to write" << key;
+		file.resize(start);
+		return false;
+	}
+
+	QHash<QString, Entry>::Iterator it = entries.find(key);
+	if (it != entries.end()) {
+		wasted += it.value().recordSize;
+	}
+	if (Format_Removed == format) {
+		wasted += recordSize(k.length(), 0);
+		if (it != entries.end()) {
+			entries.erase(it);
+		}
+	}
+	else {
+		Entry entry = {start + (qint64)sizeof(RecordHeader) + pad(k.length()), (quint32)data.length(), width, height, format, recordSize(k.length(), data.length())};
+		entries.insert(key, entry);
+	}
+	generation++;
+
+	if (!compacting && wasted > constMinCompactWaste && wasted * 2 > file.size()) {
+		compacting = true;
+		QThreadPool::globalInstance()->start([this]() { compact(); });
+	}
+	return true;
+}
+
+// Map the whole file, if the current mapping does not reach end.
+QSharedPointer<ThumbnailStore::Mapping> ThumbnailStore::mapping(qint64 end)
+{
+	if (!map || map->size < end) {
+		map = QSharedPointer<Mapping>(new Mapping(fileName, file.size()));
+		if (!map->data) {
+			DBUG << "Failed to map" << fileName;
+			map.clear();
+		}
+	}
+	return map;
+}
+
+// Copy the current entries to a new file, without holding the lock. If anything was written in the
+// meantime then the copy is discarded - compaction will be tried again on the next write.
+void ThumbnailStore::compact()
+{
+	mutex.lock();
+	quint64 gen = generation;
+	QHash<QString, Entry> current = entries;
+	QSharedPointer<Mapping> m = opened ? mapping(file.size()) : QSharedPointer<Mapping>();
+	mutex.unlock();
+
+	DBUG << "Compacting" << fileName << current.count();
+	QString tmpName = fileName + QLatin1String(".tmp");
+	QFile tmp(tmpName);
+	bool ok = m && tmp.open(QIODevice::WriteOnly | QIODevice::Truncate) && writeHeader(tmp);
+	for (auto it = current.constBegin(), end = current.constEnd(); ok && it != end; ++it) {
+		const Entry& entry = it.value();
+		ok = writeRecord(tmp, it.key().toUtf8(), reinterpret_cast<const char*>(m->data + entry.offset), entry.length, entry.width, entry.height, entry.format);
+	}
+	tmp.close();
+	m.clear();
+
+	QMutexLocker locker(&mutex);
+	if (ok && gen == generation) {
+		// Unmap and close the file before replacing it, it is mapped again when re-opened.
+		close();
+		if (!QFile::remove(fileName) || !QFile::rename(tmpName, fileName)) {
+			DBUG << "Failed to replace" << fileName;
+			QFile::remove(tmpName);
+		}
+		open();
+	}
+	else {
+		QFile::remove(tmpName);
+	}
+	compacting = false;
+	compacted.wakeAll();
+}
+
+void ThumbnailStore::releaseMapping(void* info)
+{
+	delete static_cast<QSharedPointer<Mapping>*>(info);
+}
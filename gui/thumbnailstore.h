@@ -0,0 +1,95 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef THUMBNAIL_STORE_H
+#define THUMBNAIL_STORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QWaitCondition>
+
+// Single file store for scaled covers, used instead of one file per cover and size. Small
+// thumbnails are kept as raw ARGB32 data, and are returned as QImages that point straight
+// into a memory mapping of the file. Larger ones are kept encoded.
+//
+// The file is a log of records, the last record for a key wins. Replaced and removed records
+// are reclaimed by compacting the file in the background once they make up most of it.
+class ThumbnailStore {
+public:
+	static const QLatin1String constFileName;
+
+	static void enableDebug();
+
+	ThumbnailStore(const QString& fileName);
+	~ThumbnailStore();
+
+	QImage load(const QString& key);
+	bool save(const QString& key, const QImage& img);
+	// Remove the entries for prefix followed by a size, i.e. all sizes of one cover.
+	void removeAllSizes(const QString& prefix);
+	void clear();
+
+private:
+	struct Entry {
+		qint64 offset;// Start of data
+		quint32 length;
+		quint16 width;
+		quint16 height;
+		quint16 format;
+		qint64 recordSize;
+	};
+
+	struct Mapping {
+		Mapping(const QString& fileName, qint64 size);
+		~Mapping();
+		QFile file;
+		uchar* data;
+		qint64 size;
+	};
+
+	bool open();
+	void close();
+	void scan();
+	bool append(const QString& key, const QByteArray& data, quint16 width, quint16 height, quint16 format);
+	QSharedPointer<Mapping> mapping(qint64 end);
+	void compact();
+	static void releaseMapping(void* info);
+
+private:
+	QString fileName;
+	QFile file;
+	bool opened;
+	bool compacting;
+	quint64 generation;
+	qint64 wasted;
+	QHash<QString, Entry> entries;
+	QSharedPointer<Mapping> map;
+	QMutex mutex;
+	QWaitCondition compacted;
+};
+
+#endif
@@ -29,6 +29,7 @@
 #include "devices/cdparanoia.h"
 #include "devices/extractjob.h"
 #endif
+#include <QBuffer>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
@@ -43,6 +44,8 @@
 	if (HttpServer::debugEnabled()) qWarning() << "HttpSocket" << __FUNCTION__
 
 static const quint64 constMaxBuffer = 32768;
+static const qint64 constChunkSize = 65536;
+static const qint64 constMaxPendingBytes = 4 * constChunkSize;
 
 static QString detectMimeType(const QString& file)
 {
@@ -96,34 +99,24 @@ static QString detectMimeType(const QString& file)
 	return QString();
 }
 
-static void writeMimeType(const QString& mimeType, QTcpSocket* socket, qint32 from, qint32 size, bool allowSeek)
+static void writeResponseHeader(QTcpSocket* socket, const QString& mimeType, qint64 from, qint64 to, qint64 size, bool isRange)
 {
-	if (!mimeType.isEmpty()) {
-		QTextStream os(socket);
-		os.setAutoDetectUnicode(true);
-		if (allowSeek) {
-			if (0 == from) {
-				os << "HTTP/1.0 200 OK"
-				   << "\r\nAccept-Ranges: bytes"
-				   << "\r\nContent-Length: " << QString::number(size)
-				   << "\r\nContent-Type: " << mimeType << "\r\n\r\n";
-			}
-			else {
-				os << "HTTP/1.0 200 OK"
-				   << "\r\nAccept-Ranges: bytes"
-				   << "\r\nContent-Range: bytes " << QString::number(from) << "-" << QString::number(size - 1) << "/" << QString::number(size)
-				   << "\r\nContent-Length: " << QString::number(size - from)
-				   << "\r\nContent-Type: " << mimeType << "\r\n\r\n";
-			}
-			DBUG << mimeType << QString::number(size) << "Can seek";
-		}
-		else {
-			os << "HTTP/1.0 200 OK"
-			   << "\r\nContent-Length: " << QString::number(size)
-			   << "\r\nContent-Type: " << mimeType << "\r\n\r\n";
-			DBUG << mimeType << QString::number(size);
-		}
-	}
+	QTextStream os(socket);
+	os.setAutoDetectUnicode(true);
+	if (isRange) {
+		os << "HTTP/1.0 206 Partial Content"
+		   << "\r\nAccept-Ranges: bytes"
+		   << "\r\nContent-Range: bytes " << QString::number(from) << "-" << QString::number(to) << "/" << QString::number(size)
+		   << "\r\nContent-Length: " << QString::number((to - from) + 1)
+		   << "\r\nContent-Type: " << mimeType << "\r\n\r\n";
+	}
+	else {
+		os << "HTTP/1.0 200 OK"
+		   << "\r\nAccept-Ranges: bytes"
+		   << "\r\nContent-Length: " << QString::number(size)
+		   << "\r\nContent-Type: " << mimeType << "\r\n\r\n";
+	}
+	DBUG << mimeType << from << to << size << isRange;
 }
 
 static int getSep(const QByteArray& a, int pos)
@@ -160,24 +153,141 @@ static QList<QByteArray> split(const QByteArray& a)
 	return rv;
 }
 
-static void getRange(const QStringList& params, qint32& from, qint32& to)
+enum RangeType {
+	Range_None,
+	Range_Ok,
+	Range_Unsatisfiable
+};
+
+// Parse the value of a "Range:" header. Only the first range of a multi-range request is served, and
+// malformed values are ignored - as per RFC 7233 - so that the whole file is sent.
+static RangeType getRange(const QByteArray& header, qint64 size, qint64& from, qint64& to)
 {
-	for (const QString& str : params) {
-		if (str.startsWith("Range:")) {
-			int start = str.indexOf("bytes=");
-			if (start > 0) {
-				QStringList range = str.mid(start + 6).split("-", CANTATA_SKIP_EMPTY);
-				if (1 == range.length()) {
-					from = range.at(0).toLong();
-				}
-				else if (2 == range.length()) {
-					from = range.at(0).toLong();
-					to = range.at(1).toLong();
-				}
-			}
-			break;
+	int start = header.indexOf("bytes=");
+	if (start < 0) {
+		return Range_None;
+	}
+
+	QByteArray spec = header.mid(start + 6);
+	int comma = spec.indexOf(',');
+	if (comma >= 0) {
+		spec.truncate(comma);
+	}
+	int dash = spec.indexOf('-');
+	if (dash < 0) {
+		return Range_None;
+	}
+
+	QByteArray first = spec.left(dash).trimmed();
+	QByteArray last = spec.mid(dash + 1).trimmed();
+	bool ok = false;
+	if (first.isEmpty()) {// Suffix range, i.e. last N bytes
+		qint64 count = last.toLongLong(&ok);
+		if (!ok) {
+			return Range_None;
+		}
+		if (count <= 0 || size <= 0) {
+			return Range_Unsatisfiable;
+		}
+		from = qMax(Q_INT64_C(0), size - count);
+		to = size - 1;
+		return Range_Ok;
+	}
+
+	from = first.toLongLong(&ok);
+	if (!ok || from < 0) {
+		return Range_None;
+	}
+	if (last.isEmpty()) {
+		to = size - 1;
+	}
+	else {
+		to = last.toLongLong(&ok);
+		if (!ok || to < from) {
+			return Range_None;
 		}
+		to = qMin(to, size - 1);
 	}
+	return from < size ? Range_Ok : Range_Unsatisfiable;
+}
+
+// Each connection is a small state machine - the request is accumulated until its headers are complete, then the
+// response is streamed in chunks. A new chunk is only queued when the socket's write buffer has drained below
+// constMaxPendingBytes, so one slow (or paused) MPD output never stalls the other connections.
+struct HttpSocket::Client {
+	enum State {
+		ReadingRequest,
+		Streaming,
+		Closing
+	};
+
+	Client(QTcpSocket* s)
+		: socket(s), state(ReadingRequest), mapped(nullptr), pos(0), end(0)
+	{
+#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
+		cdparanoia = nullptr;
+		firstSector = 0;
+		nextSector = -1;
+#endif
+	}
+
+	~Client()
+	{
+		if (mapped) {
+			file.unmap(mapped);
+		}
+#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
+		delete cdparanoia;
+#endif
+	}
+
+	// Queue the next chunk, returns number of bytes queued or -1 on error
+	qint64 writeChunk();
+
+	QTcpSocket* socket;
+	State state;
+	QByteArray request;
+	QFile file;
+	uchar* mapped;// Whole file, if it could be mapped
+	qint64 pos;   // Next byte to send
+	qint64 end;   // One past the last byte to send
+	QByteArray header;
+#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
+	// CD tracks are streamed as a WAV header followed by the raw sectors
+	CdParanoia* cdparanoia;
+	int firstSector;
+	int nextSector;
+#endif
+};
+
+qint64 HttpSocket::Client::writeChunk()
+{
+	qint64 len = qMin(constChunkSize, end - pos);
+#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
+	if (cdparanoia) {
+		if (pos < header.size()) {
+			return socket->write(header.constData() + pos, qMin(len, header.size() - pos));
+		}
+		qint64 offset = pos - header.size();
+		int sector = firstSector + (offset / CD_FRAMESIZE_RAW);
+		int skip = offset % CD_FRAMESIZE_RAW;
+		if (sector != nextSector) {
+			cdparanoia->seek(sector, SEEK_SET);
+		}
+		qint16* buf = cdparanoia->read();
+		if (!buf) {
+			nextSector = -1;
+			return -1;
+		}
+		nextSector = sector + 1;
+		return socket->write(((const char*)buf) + skip, qMin(len, (qint64)(CD_FRAMESIZE_RAW - skip)));
+	}
+#endif
+	if (mapped) {
+		return socket->write((const char*)mapped + pos, len);
+	}
+	QByteArray data = file.read(len);
+	return data.isEmpty() ? -1 : socket->write(data);
 }
 
 HttpSocket::HttpSocket(const QString& iface, quint16 port)
@@ -196,6 +306,11 @@ HttpSocket::HttpSocket(const QString& iface, quint16 port)
 	connect(this, SIGNAL(newConnection()), SLOT(handleNewConnection()));
 }
 
+HttpSocket::~HttpSocket()
+{
+	qDeleteAll(clients);
+}
+
 bool HttpSocket::openPort(quint16 p)
 {
 	setProxy(QNetworkProxy::NoProxy);
@@ -217,6 +332,10 @@ void HttpSocket::terminate()
 	DBUG;
 	terminated = true;
 	close();
+	const QList<QTcpSocket*> sockets = clients.keys();
+	for (QTcpSocket* socket : sockets) {
+		socket->abort();
+	}
 	deleteLater();
 }
 
@@ -243,7 +362,9 @@ void HttpSocket::handleNewConnection()
 			return;
 		}
 
+		clients.insert(socket, new Client(socket));
 		connect(socket, SIGNAL(readyRead()), this, SLOT(readClient()));
+		connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(sendData()));
 		connect(socket, SIGNAL(disconnected()), this, SLOT(discardClient()));
 	}
 }
@@ -255,172 +376,236 @@ void HttpSocket::readClient()
 	}
 
 	QTcpSocket* socket = static_cast<QTcpSocket*>(sender());
-	if (!socket) {
+	Client* client = socket ? clients.value(socket) : nullptr;
+	if (!client) {
+		return;
+	}
+
+	if (Client::ReadingRequest != client->state) {
+		// Only one request per connection, ignore anything else
+		socket->readAll();
 		return;
 	}
 
-	if (static_cast<size_t>(socket->bytesAvailable()) >= constMaxBuffer) {
+	client->request += socket->readAll();
+	if (static_cast<size_t>(client->request.length()) >= constMaxBuffer) {
 		// Request too large, reject
 		sendErrorResponse(socket, 400);
-		socket->close();
+		closeClient(client);
 		DBUG << "Request too large";
 		return;
 	}
 
-	if (socket->canReadLine()) {
-		QList<QByteArray> tokens = split(socket->readLine());// QRegularExpression("[ \r\n][ \r\n]*"));
-		if (tokens.length() >= 2 && "GET" == tokens[0]) {
-			static const QRegularExpression paramRegex("[\r\n][\r\n]*");
-			QStringList params = QString(socket->readAll()).split(paramRegex);
-
-			DBUG << "params" << params << "tokens" << tokens;
-			QUrl url(QUrl::fromEncoded(tokens[1]));
-			QUrlQuery q(url);
-			bool ok = false;
-			qint32 readBytesFrom = 0;
-			qint32 readBytesTo = 0;
-			getRange(params, readBytesFrom, readBytesTo);
-
-			DBUG << "readBytesFrom" << readBytesFrom << "readBytesTo" << readBytesTo;
-			if (q.hasQueryItem("cantata")) {
-				Song song = HttpServer::self()->decodeUrl(url);
-
-				if (!isCantataStream(song.file)) {
-					sendErrorResponse(socket, 400);
-					socket->close();
-					DBUG << "Not cantata stream file";
-					return;
-				}
-
-				if (song.isCdda()) {
-#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
-					QStringList parts = song.file.split("/", CANTATA_SKIP_EMPTY);
-					if (parts.length() >= 3) {
-						QString dev = QLatin1Char('/') + parts.at(1) + QLatin1Char('/') + parts.at(2);
-						CdParanoia cdparanoia(dev, false, false, true, Settings::self()->paranoiaOffset());
-
-						if (cdparanoia) {
-							int firstSector = cdparanoia.firstSectorOfTrack(song.id);
-							int lastSector = cdparanoia.lastSectorOfTrack(song.id);
-							qint32 totalSize = ((lastSector - firstSector) + 1) * CD_FRAMESIZE_RAW;
-							int count = 0;
-							bool writeHeader = 0 == readBytesFrom;// Only write header if we are not seeking...
-																  //                            int bytesToDiscard = 0; // Number of bytes to discard in first read sector due to range request in HTTP header
-																  //                            if (readBytesFrom>=ExtractJob::constWavHeaderSize) {
-																  //                                readBytesFrom-=ExtractJob::constWavHeaderSize;
-																  //                            }
-
-							//                            if (readBytesFrom>0) {
-							//                                int sectorsToSeek=readBytesFrom/CD_FRAMESIZE_RAW;
-							//                                firstSector+=sectorsToSeek;
-							//                                bytesToDiscard=readBytesFrom-(sectorsToSeek*CD_FRAMESIZE_RAW);
-							//                            }
-							cdparanoia.seek(firstSector, SEEK_SET);
-							ok = true;
-							writeMimeType(QLatin1String("audio/x-wav"), socket, readBytesFrom, totalSize + ExtractJob::constWavHeaderSize, false);
-							if (writeHeader) {
-								ExtractJob::writeWavHeader(*socket, totalSize);
-							}
-							bool stop = false;
-							while (!terminated && (firstSector + count) <= lastSector && !stop) {
-								qint16* buf = cdparanoia.read();
-								if (!buf) {
-									break;
-								}
-								char* buffer = (char*)buf;
-								qint32 writePos = 0;
-								qint32 toWrite = CD_FRAMESIZE_RAW;
-
-								//                                if (bytesToDiscard>0) {
-								//                                    int toSkip=qMin(toWrite, bytesToDiscard);
-								//                                    writePos=toSkip;
-								//                                    toWrite-=toSkip;
-								//                                    bytesToDiscard-=toSkip;
-								//                                }
-
-								if (toWrite > 0 && !write(socket, &buffer[writePos], toWrite, stop)) {
-									break;
-								}
-								count++;
-							}
-						}
-					}
-#endif
-				}
-				else if (!song.file.isEmpty()) {
+	if (client->request.contains("\r\n\r\n") || client->request.contains("\n\n")) {
+		handleRequest(client);
+	}
+}
+
+void HttpSocket::handleRequest(Client* client)
+{
+	QTcpSocket* socket = client->socket;
+	QList<QByteArray> lines = client->request.split('\n');
+	client->request.clear();
+
+	QList<QByteArray> tokens = split(lines.takeFirst());
+	if (tokens.length() < 2 || "GET" != tokens[0]) {
+		// Bad Request
+		sendErrorResponse(socket, 400);
+		closeClient(client);
+		DBUG << "Bad Request";
+		return;
+	}
+
+	QByteArray rangeHeader;
+	for (const QByteArray& line : lines) {
+		if (line.toLower().startsWith("range:")) {
+			rangeHeader = line.mid(6).trimmed();
+			break;
+		}
+	}
+
+	DBUG << "tokens" << tokens << "range" << rangeHeader;
+	QUrl url(QUrl::fromEncoded(tokens[1]));
+	QUrlQuery q(url);
+	bool ok = false;
+	QString mimeType;
+
+	if (q.hasQueryItem("cantata")) {
+		Song song = HttpServer::self()->decodeUrl(url);
+
+		if (!isCantataStream(song.file)) {
+			sendErrorResponse(socket, 400);
+			closeClient(client);
+			DBUG << "Not cantata stream file";
+			return;
+		}
+
+		if (song.isCdda()) {
+			ok = openCd(client, song);
+			mimeType = QLatin1String("audio/x-wav");
+		}
+		else if (!song.file.isEmpty()) {
+			ok = openFile(client, song, url, tokens[1]);
+			mimeType = detectMimeType(song.file);
+		}
+	}
+
+	if (!ok) {
+		sendErrorResponse(socket, 404);
+		closeClient(client);
+		return;
+	}
+
+	if (mimeType.isEmpty()) {
+		mimeType = QLatin1String("application/octet-stream");
+	}
+
+	qint64 size = client->end;
+	qint64 from = 0;
+	qint64 to = size - 1;
+	RangeType range = rangeHeader.isEmpty() ? Range_None : getRange(rangeHeader, size, from, to);
+	DBUG << "size" << size << "from" << from << "to" << to << range;
+
+	if (Range_Unsatisfiable == range) {
+		QTextStream os(socket);
+		os << "HTTP/1.0 416 Requested Range Not Satisfiable"
+		   << "\r\nContent-Range: bytes */" << QString::number(size) << "\r\n\r\n";
+		closeClient(client);
+		return;
+	}
+
+	if (Range_Ok == range && from > 0 && !client->mapped && client->file.isOpen() && !client->file.seek(from)) {
+		sendErrorResponse(socket, 404);
+		closeClient(client);
+		return;
+	}
+
+	writeResponseHeader(socket, mimeType, from, to, size, Range_Ok == range);
+	client->pos = from;
+	client->end = to + 1;
+	client->state = Client::Streaming;
+	sendData(client);
+}
+
+// Opens song.file, and sets client->end to its size
+bool HttpSocket::openFile(Client* client, Song& song, const QUrl& url, const QByteArray& path)
+{
 #ifdef Q_OS_WIN
-					if (tokens[1].startsWith("//") && !song.file.startsWith(QLatin1String("//")) && !QFile::exists(song.file)) {
-						QString share = QLatin1String("//") + url.host() + song.file;
-						if (QFile::exists(share)) {
-							song.file = share;
-							DBUG << "fixed share-path" << song.file;
-						}
-					}
+	if (path.startsWith("//") && !song.file.startsWith(QLatin1String("//")) && !QFile::exists(song.file)) {
+		QString share = QLatin1String("//") + url.host() + song.file;
+		if (QFile::exists(share)) {
+			song.file = share;
+			DBUG << "fixed share-path" << song.file;
+		}
+	}
+#else
+	Q_UNUSED(url)
+	Q_UNUSED(path)
 #endif
 
-					QFile f(song.file);
-
-					if (f.open(QIODevice::ReadOnly)) {
-						qint32 totalBytes = f.size();
-
-						writeMimeType(detectMimeType(song.file), socket, readBytesFrom, totalBytes, true);
-						ok = true;
-						qint32 readPos = 0;
-						qint32 bytesRead = 0;
-
-						if (0 != readBytesFrom) {
-							if (!f.seek(readBytesFrom)) {
-								ok = false;
-							}
-							bytesRead += readBytesFrom;
-						}
-
-						if (0 != readBytesTo && readBytesTo > readBytesFrom && readBytesTo != totalBytes) {
-							totalBytes -= (totalBytes - readBytesTo);
-						}
-
-						if (ok) {
-							static const int constChunkSize = 32768;
-							char buffer[constChunkSize];
-							bool stop = false;
-							do {
-								bytesRead = f.read(buffer, constChunkSize);
-								readPos += bytesRead;
-								if (!write(socket, buffer, bytesRead, stop) || f.atEnd()) {
-									break;
-								}
-							} while (readPos < totalBytes && !stop && !terminated);
-						}
-					}
-					else {
-						DBUG << "Failed to open" << song.file;
-					}
-				}
-			}
+	client->file.setFileName(song.file);
+	if (!client->file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+		DBUG << "Failed to open" << song.file;
+		return false;
+	}
+	client->end = client->file.size();
+	// Map the file so that chunks go straight from the page cache into the socket, and fall back to
+	// read() if this is not possible.
+	if (client->end > 0) {
+		client->mapped = client->file.map(0, client->end);
+	}
+	DBUG << song.file << client->end << (client->mapped ? "mapped" : "not mapped");
+	return true;
+}
 
-			if (!ok) {
-				sendErrorResponse(socket, 404);
-			}
+// Opens CD track, and sets client->end to the size of the WAV stream (header + sectors)
+bool HttpSocket::openCd(Client* client, const Song& song)
+{
+#if defined CDDB_FOUND || defined MusicBrainz5_FOUND
+	QStringList parts = song.file.split("/", CANTATA_SKIP_EMPTY);
+	if (parts.length() < 3) {
+		return false;
+	}
 
-			socket->close();
+	QString dev = QLatin1Char('/') + parts.at(1) + QLatin1Char('/') + parts.at(2);
+	CdParanoia* cdparanoia = new CdParanoia(dev, false, false, true, Settings::self()->paranoiaOffset());
+	if (!*cdparanoia) {
+		delete cdparanoia;
+		return false;
+	}
+
+	client->cdparanoia = cdparanoia;
+	client->firstSector = cdparanoia->firstSectorOfTrack(song.id);
+	int lastSector = cdparanoia->lastSectorOfTrack(song.id);
+	qint32 totalSize = ((lastSector - client->firstSector) + 1) * CD_FRAMESIZE_RAW;
 
-			if (QTcpSocket::UnconnectedState == socket->state()) {
-				socket->deleteLater();
+	QBuffer buffer(&client->header);
+	buffer.open(QIODevice::WriteOnly);
+	ExtractJob::writeWavHeader(buffer, totalSize);
+	buffer.close();
+	client->end = client->header.size() + totalSize;
+	return true;
+#else
+	Q_UNUSED(client)
+	Q_UNUSED(song)
+	return false;
+#endif
+}
+
+void HttpSocket::sendData()
+{
+	Client* client = clients.value(static_cast<QTcpSocket*>(sender()));
+	if (client) {
+		sendData(client);
+	}
+}
+
+void HttpSocket::sendData(Client* client)
+{
+	if (terminated || Client::Streaming != client->state) {
+		return;
+	}
+
+	while (client->pos < client->end && client->socket->bytesToWrite() < constMaxPendingBytes) {
+		qint64 written = client->writeChunk();
+		if (written <= 0) {
+			DBUG << "Failed to send data" << client->pos << client->end;
+			QTcpSocket* socket = client->socket;
+			socket->abort();
+			if (clients.contains(socket)) {
+				removeClient(socket);
 			}
-		}
-		else {
-			// Bad Request
-			sendErrorResponse(socket, 400);
-			socket->close();
-			DBUG << "Bad Request";
 			return;
 		}
+		client->pos += written;
+	}
+
+	if (client->pos >= client->end) {
+		closeClient(client);
 	}
 }
 
+void HttpSocket::closeClient(Client* client)
+{
+	QTcpSocket* socket = client->socket;
+	client->state = Client::Closing;
+	// Any data still in the socket's buffer will be written before the connection is closed. If there is none,
+	// then disconnected() is emitted immediately - and client will already have been removed.
+	socket->disconnectFromHost();
+	if (QAbstractSocket::UnconnectedState == socket->state() && clients.contains(socket)) {
+		removeClient(socket);
+	}
+}
+
+void HttpSocket::removeClient(QTcpSocket* socket)
+{
+	delete clients.take(socket);
+	socket->deleteLater();
+}
+
 void HttpSocket::discardClient()
 {
-	static_cast<QTcpSocket*>(sender())->deleteLater();
+	removeClient(static_cast<QTcpSocket*>(sender()));
 }
 
 void HttpSocket::mpdAddress(const QString& a)
@@ -482,30 +667,4 @@ void HttpSocket::removedIds(const QSet<qint32>& ids)
 	}
 }
 
-bool HttpSocket::write(QTcpSocket* socket, char* buffer, qint32 bytesRead, bool& stop)
-{
-	if (bytesRead < 0 || terminated) {
-		return false;
-	}
-
-	qint32 writePos = 0;
-	do {
-		qint32 bytesWritten = socket->write(&buffer[writePos], bytesRead - writePos);
-		if (terminated || -1 == bytesWritten) {
-			stop = true;
-			break;
-		}
-		socket->flush();
-		writePos += bytesWritten;
-	} while (writePos < bytesRead);
-
-	if (QAbstractSocket::ConnectedState == socket->state()) {
-		socket->waitForBytesWritten();
-	}
-	if (QAbstractSocket::ConnectedState != socket->state()) {
-		return false;
-	}
-	return true;
-}
-
 #include "moc_httpsocket.cpp"
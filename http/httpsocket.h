@@ -24,6 +24,7 @@
 #ifndef _HTTP_SOCKET_H_
 #define _HTTP_SOCKET_H_
 
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QSet>
@@ -32,13 +33,14 @@
 struct Song;
 class QHostAddress;
 class QTcpSocket;
+class QUrl;
 
 class HttpSocket : public QTcpServer {
 	Q_OBJECT
 
 public:
 	HttpSocket(const QString& iface, quint16 port);
-	~HttpSocket() override {}
+	~HttpSocket() override;
 
 	QString configuredInterface() { return cfgInterface; }
 	quint16 boundPort();
@@ -48,23 +50,32 @@ public Q_SLOTS:
 	void mpdAddress(const QString& a);
 
 private:
+	struct Client;
+
 	bool openPort(quint16 p);
 	bool isCantataStream(const QString& file) const;
 	void sendErrorResponse(QTcpSocket* socket, int code);
+	void handleRequest(Client* client);
+	bool openFile(Client* client, Song& song, const QUrl& url, const QByteArray& path);
+	bool openCd(Client* client, const Song& song);
+	void closeClient(Client* client);
+	void removeClient(QTcpSocket* socket);
 
 private Q_SLOTS:
 	void handleNewConnection();
 	void readClient();
 	void discardClient();
+	void sendData();
 	void cantataStreams(const QStringList& files);
 	void cantataStreams(const QList<Song>& songs, bool isUpdate);
 	void removedIds(const QSet<qint32>& ids);
 
 private:
-	bool write(QTcpSocket* socket, char* buffer, qint32 bytesRead, bool& stop);
+	void sendData(Client* client);
 	void setUrlAddress();
 
 private:
+	QHash<QTcpSocket*, Client*> clients;
 	QSet<QString> newlyAddedFiles;  // Holds cantata strema filenames as added to MPD via "add"
 	QMap<qint32, QString> streamIds;// Maps MPD playqueue song ID to fileName
 	QString cfgInterface;
@@ -33,7 +33,9 @@
 #include "musiclibrarymodel.h"
 #include <QElapsedTimer>
 #include <QFile>
+#include <QSaveFile>
 #include <QXmlStreamReader>
+#include <QtEndian>
 #include <QXmlStreamWriter>
 //#define TIME_XML_FILE_LOADING
 #ifdef TIME_XML_FILE_LOADING
@@ -486,6 +488,322 @@ bool MusicLibraryItemRoot::fromXML(QXmlStreamReader& reader, const QString& base
 	return valid;
 }
 
+// Binary cache. This replaces the XML cache for devices - the XML is only read to import old caches.
+// Layout (all integers are little-endian):
+//   CacheHeader
+//   String index - stringCount x { quint32 offset, quint32 length } into the UTF-8 string data
+//   String data
+//   Songs        - songCount x CacheSongRecord, whose text fields are string indexes
+// String 0 is always the empty string. The file is memory mapped when read, and each string is only
+// decoded the first time it is referenced - so artist, album and genre names are shared between songs.
+static const char constCacheMagic[8] = { 'C', 'A', 'N', 'T', 'L', 'I', 'B', '\0' };
+static const quint32 constCacheVersion = 1;
+
+enum CacheString {
+	Str_File,
+	Str_Title,
+	Str_Artist,
+	Str_AlbumArtist,
+	Str_Album,
+	Str_Composer,
+	Str_MbAlbumId,
+	Str_AlbumSort,
+	Str_ArtistSort,
+	Str_AlbumArtistSort,
+	Str_Genre,
+	Str_Count = Str_Genre + Song::constNumGenres
+};
+
+struct CacheHeader {
+	char magic[8];
+	quint32 version;
+	quint32 fileSize;
+	quint32 songCount;
+	quint32 stringCount;
+	quint32 stringIndexOffset;
+	quint32 stringDataOffset;
+	quint32 songsOffset;
+	quint32 reserved;
+};
+
+struct CacheSongRecord {
+	quint32 strings[Str_Count];
+	qint32 size;
+	quint16 time;
+	quint16 track;
+	quint16 year;
+	quint16 origYear;
+	quint8 disc;
+	quint8 type;
+	quint8 guessed;
+	quint8 pad;
+};
+
+static_assert(sizeof(CacheHeader) == 40, "Unexpected cache header size");
+static_assert(sizeof(CacheSongRecord) == (Str_Count * 4) + 16, "Unexpected cache record size");
+
+bool MusicLibraryItemRoot::toCache(const QString& filename, MusicLibraryProgressMonitor* prog) const
+{
+	if (isFlat) {
+		return false;
+	}
+
+	// If saving device cache, and we have NO items, then remove cache file...
+	if (0 == childCount()) {
+		if (QFile::exists(filename)) {
+			QFile::remove(filename);
+		}
+		return true;
+	}
+
+	quint64 total = 0;
+	quint64 count = 0;
+	int percent = 0;
+	QElapsedTimer timer;
+	if (prog) {
+		prog->writeProgress(0.0);
+		timer.start();
+	}
+
+	for (const MusicLibraryItem* a : childItems()) {
+		for (const MusicLibraryItem* al : static_cast<const MusicLibraryItemArtist*>(a)->childItems()) {
+			total += al->childCount();
+		}
+	}
+
+	QHash<QString, quint32> stringIds;
+	QList<QByteArray> strings;
+	quint32 stringDataSize = 0;
+	strings.append(QByteArray());
+	auto stringId = [&](const QString& str) -> quint32 {
+		if (str.isEmpty()) {
+			return 0;
+		}
+		QHash<QString, quint32>::ConstIterator it = stringIds.constFind(str);
+		if (stringIds.constEnd() != it) {
+			return it.value();
+		}
+		quint32 id = strings.count();
+		strings.append(str.toUtf8());
+		stringDataSize += strings.last().size();
+		stringIds.insert(str, id);
+		return id;
+	};
+
+	QVector<CacheSongRecord> records;
+	records.reserve(total);
+	for (const MusicLibraryItem* a : childItems()) {
+		for (const MusicLibraryItem* al : static_cast<const MusicLibraryItemArtist*>(a)->childItems()) {
+			if (prog && prog->wasStopped()) {
+				return false;
+			}
+			for (const MusicLibraryItem* t : static_cast<const MusicLibraryItemAlbum*>(al)->childItems()) {
+				const MusicLibraryItemSong* track = static_cast<const MusicLibraryItemSong*>(t);
+				const Song& song = track->song();
+				CacheSongRecord rec;
+				memset(&rec, 0, sizeof(CacheSongRecord));
+				rec.strings[Str_File] = qToLittleEndian(stringId(track->file()));
+				rec.strings[Str_Title] = qToLittleEndian(stringId(song.title));
+				rec.strings[Str_Artist] = qToLittleEndian(stringId(song.artist));
+				rec.strings[Str_AlbumArtist] = qToLittleEndian(stringId(song.albumartist));
+				rec.strings[Str_Album] = qToLittleEndian(stringId(song.album));
+				rec.strings[Str_Composer] = qToLittleEndian(stringId(song.hasComposer() ? song.composer() : QString()));
+				rec.strings[Str_MbAlbumId] = qToLittleEndian(stringId(song.hasMbAlbumId() ? song.mbAlbumId() : QString()));
+				rec.strings[Str_AlbumSort] = qToLittleEndian(stringId(song.hasAlbumSort() ? song.albumSort() : QString()));
+				rec.strings[Str_ArtistSort] = qToLittleEndian(stringId(song.hasArtistSort() ? song.artistSort() : QString()));
+				rec.strings[Str_AlbumArtistSort] = qToLittleEndian(stringId(song.hasAlbumArtistSort() ? song.albumArtistSort() : QString()));
+				for (int i = 0; i < Song::constNumGenres; ++i) {
+					if (song.genres[i] != Song::unknown()) {
+						rec.strings[Str_Genre + i] = qToLittleEndian(stringId(song.genres[i]));
+					}
+				}
+				rec.size = qToLittleEndian(song.size);
+				rec.time = qToLittleEndian(song.time);
+				rec.track = qToLittleEndian(song.track);
+				rec.year = qToLittleEndian(song.year);
+				rec.origYear = qToLittleEndian(song.origYear);
+				rec.disc = song.disc;
+				rec.type = song.type;
+				rec.guessed = song.guessed ? 1 : 0;
+				records.append(rec);
+				if (prog && total > 0) {
+					count++;
+					int pc = ((count * 100.0) / (total * 1.0)) + 0.5;
+					if (pc != percent && timer.elapsed() >= 250) {
+						prog->writeProgress(pc);
+						timer.restart();
+						percent = pc;
+					}
+				}
+			}
+		}
+	}
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+	quint32 stringIndexOffset = sizeof(CacheHeader);
+	quint32 stringDataOffset = stringIndexOffset + (strings.count() * 2 * sizeof(quint32));
+	quint32 songsOffset = (stringDataOffset + stringDataSize + 3) & ~3u;
+	memcpy(header.magic, constCacheMagic, sizeof(constCacheMagic));
+	header.version = qToLittleEndian(constCacheVersion);
+	header.fileSize = qToLittleEndian(quint32(songsOffset + (records.count() * sizeof(CacheSongRecord))));
+	header.songCount = qToLittleEndian(quint32(records.count()));
+	header.stringCount = qToLittleEndian(quint32(strings.count()));
+	header.stringIndexOffset = qToLittleEndian(stringIndexOffset);
+	header.stringDataOffset = qToLittleEndian(stringDataOffset);
+	header.songsOffset = qToLittleEndian(songsOffset);
+
+	QByteArray index;
+	index.reserve(stringDataOffset - stringIndexOffset);
+	quint32 offset = 0;
+	for (const QByteArray& str : strings) {
+		quint32 entry[2] = { qToLittleEndian(offset), qToLittleEndian(quint32(str.size())) };
+		index.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+		offset += str.size();
+	}
+
+	// Write to a temporary file, and only replace the existing cache once everything has been written.
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+	file.write(index);
+	for (const QByteArray& str : strings) {
+		file.write(str);
+	}
+	file.write(QByteArray(songsOffset - (stringDataOffset + stringDataSize), '\0'));
+	file.write(reinterpret_cast<const char*>(records.constData()), records.count() * sizeof(CacheSongRecord));
+	if (prog && prog->wasStopped()) {
+		file.cancelWriting();
+	}
+	return file.commit();
+}
+
+bool MusicLibraryItemRoot::fromCache(const QString& filename, const QString& baseFolder, MusicLibraryProgressMonitor* prog)
+{
+	if (isFlat) {
+		return false;
+	}
+
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(CacheHeader)) || file.size() > 0xFFFFFFFF) {
+		return false;
+	}
+
+	QByteArray buffer;
+	const uchar* data = file.map(0, file.size());
+	if (!data) {
+		buffer = file.readAll();
+		data = reinterpret_cast<const uchar*>(buffer.constData());
+	}
+
+	CacheHeader header;
+	memcpy(&header, data, sizeof(CacheHeader));
+	quint64 fileSize = file.size();
+	quint32 songCount = qFromLittleEndian(header.songCount);
+	quint32 stringCount = qFromLittleEndian(header.stringCount);
+	quint32 stringIndexOffset = qFromLittleEndian(header.stringIndexOffset);
+	quint32 stringDataOffset = qFromLittleEndian(header.stringDataOffset);
+	quint32 songsOffset = qFromLittleEndian(header.songsOffset);
+	if (0 != memcmp(header.magic, constCacheMagic, sizeof(constCacheMagic)) || constCacheVersion != qFromLittleEndian(header.version) || fileSize != qFromLittleEndian(header.fileSize) || 0 == stringCount || stringIndexOffset + (quint64(stringCount) * 2 * sizeof(quint32)) > stringDataOffset || stringDataOffset > songsOffset || songsOffset + (quint64(songCount) * sizeof(CacheSongRecord)) != fileSize) {
+		return false;
+	}
+
+	QVector<QString> strings(stringCount);
+	QVector<bool> decoded(stringCount, false);
+	bool valid = true;
+	auto string = [&](quint32 id) -> QString {
+		id = qFromLittleEndian(id);
+		if (id >= stringCount) {
+			valid = false;
+			return QString();
+		}
+		if (!decoded.at(id)) {
+			quint32 entry[2];
+			memcpy(entry, data + stringIndexOffset + (id * sizeof(entry)), sizeof(entry));
+			quint32 offset = qFromLittleEndian(entry[0]);
+			quint32 length = qFromLittleEndian(entry[1]);
+			if (quint64(stringDataOffset) + offset + length > songsOffset) {
+				valid = false;
+				return QString();
+			}
+			strings[id] = QString::fromUtf8(reinterpret_cast<const char*>(data + stringDataOffset + offset), length);
+			decoded[id] = true;
+		}
+		return strings.at(id);
+	};
+
+	quint64 count = 0;
+	int percent = 0;
+	QElapsedTimer timer;
+	if (prog) {
+		prog->readProgress(0.0);
+		timer.start();
+	}
+
+	for (quint32 i = 0; i < songCount && valid && (!prog || !prog->wasStopped()); ++i) {
+		CacheSongRecord rec;
+		memcpy(&rec, data + songsOffset + (i * sizeof(CacheSongRecord)), sizeof(CacheSongRecord));
+		Song song;
+		song.file = string(rec.strings[Str_File]);
+		if (!baseFolder.isEmpty() && song.file.startsWith(baseFolder)) {
+			song.file = song.file.mid(baseFolder.length());
+		}
+		song.title = string(rec.strings[Str_Title]);
+		song.artist = string(rec.strings[Str_Artist]);
+		song.albumartist = string(rec.strings[Str_AlbumArtist]);
+		song.album = string(rec.strings[Str_Album]);
+		if (rec.strings[Str_Composer]) {
+			song.setComposer(string(rec.strings[Str_Composer]));
+		}
+		if (rec.strings[Str_MbAlbumId]) {
+			song.setMbAlbumId(string(rec.strings[Str_MbAlbumId]));
+		}
+		if (rec.strings[Str_AlbumSort]) {
+			song.setAlbumSort(string(rec.strings[Str_AlbumSort]));
+		}
+		if (rec.strings[Str_ArtistSort]) {
+			song.setArtistSort(string(rec.strings[Str_ArtistSort]));
+		}
+		if (rec.strings[Str_AlbumArtistSort]) {
+			song.setAlbumArtistSort(string(rec.strings[Str_AlbumArtistSort]));
+		}
+		for (int g = 0; g < Song::constNumGenres && rec.strings[Str_Genre + g]; ++g) {
+			song.addGenre(string(rec.strings[Str_Genre + g]));
+		}
+		song.size = qFromLittleEndian(rec.size);
+		song.time = qFromLittleEndian(rec.time);
+		song.track = qFromLittleEndian(rec.track);
+		song.year = qFromLittleEndian(rec.year);
+		song.origYear = qFromLittleEndian(rec.origYear);
+		song.disc = rec.disc;
+		song.type = rec.type <= Song::LocalFile ? static_cast<Song::Type>(rec.type) : Song::Standard;
+		song.guessed = 0 != rec.guessed;
+		if (!valid) {
+			break;
+		}
+
+		song.populateSorts();
+		MusicLibraryItemAlbum* albumItem = artist(song)->album(song);
+		albumItem->append(new MusicLibraryItemSong(song, albumItem));
+		if (prog && songCount > 0) {
+			count++;
+			int pc = ((count * 100.0) / (songCount * 1.0)) + 0.5;
+			if (pc != percent && timer.elapsed() >= 250) {
+				prog->readProgress(pc);
+				timer.restart();
+				percent = pc;
+			}
+		}
+	}
+
+	if (!valid) {
+		clearItems();
+	}
+	return valid && (!prog || !prog->wasStopped());
+}
+
 void MusicLibraryItemRoot::add(const QSet<Song>& songs)
 {
 	if (isFlat) {
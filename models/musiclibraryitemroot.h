@@ -82,6 +82,8 @@ public:
 	void toXML(QXmlStreamWriter& writer, MusicLibraryProgressMonitor* prog = nullptr) const;
 	bool fromXML(const QString& filename, const QString& baseFolder = QString(), MusicLibraryProgressMonitor* prog = nullptr, MusicLibraryErrorMonitor* em = nullptr);
 	bool fromXML(QXmlStreamReader& reader, const QString& baseFolder = QString(), MusicLibraryProgressMonitor* prog = nullptr, MusicLibraryErrorMonitor* em = nullptr);
+	bool toCache(const QString& filename, MusicLibraryProgressMonitor* prog = nullptr) const;
+	bool fromCache(const QString& filename, const QString& baseFolder = QString(), MusicLibraryProgressMonitor* prog = nullptr);
 	Type itemType() const override { return Type_Root; }
 	void add(const QSet<Song>& songs);
 	bool supportsAlbumArtistTag() const { return supportsAlbumArtist; }
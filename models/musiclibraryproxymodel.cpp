@@ -80,6 +80,12 @@ bool MusicLibraryProxyModel::filterAcceptsSong(const MusicLibraryItem* item) con
 	return matchesFilter(static_cast<const MusicLibraryItemSong*>(item)->song());
 }
 
+const Song* MusicLibraryProxyModel::sourceSong(const QModelIndex& sourceIndex) const
+{
+	const MusicLibraryItem* item = static_cast<const MusicLibraryItem*>(sourceIndex.internalPointer());
+	return item && MusicLibraryItem::Type_Song == item->itemType() ? &static_cast<const MusicLibraryItemSong*>(item)->song() : nullptr;
+}
+
 bool MusicLibraryProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
 {
 	if (!filterEnabled) {
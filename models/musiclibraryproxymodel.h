@@ -39,6 +39,9 @@ public:
 	bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
 	bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
 
+protected:
+	const Song* sourceSong(const QModelIndex& sourceIndex) const override;
+
 private:
 	bool filterAcceptsRoot(const MusicLibraryItem* item) const;
 	bool filterAcceptsArtist(const MusicLibraryItem* item) const;
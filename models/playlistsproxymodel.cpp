@@ -69,6 +69,12 @@ bool PlaylistsProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sou
 	return false;
 }
 
+const Song* PlaylistsProxyModel::sourceSong(const QModelIndex& sourceIndex) const
+{
+	PlaylistsModel::Item* item = static_cast<PlaylistsModel::Item*>(sourceIndex.internalPointer());
+	return item && !item->isPlaylist() ? static_cast<PlaylistsModel::SongItem*>(item) : nullptr;
+}
+
 bool PlaylistsProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
 {
 	PlaylistsModel::Item* l = static_cast<PlaylistsModel::Item*>(left.internalPointer());
@@ -37,6 +37,9 @@ public:
 	bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
 	static bool compareNames(const QString& l, const QString& r) { return Utils::compare(l, r) < 0; }
 	bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+protected:
+	const Song* sourceSong(const QModelIndex& sourceIndex) const override;
 };
 
 #endif
@@ -39,6 +39,7 @@
 #include "support/actioncollection.h"
 #include "support/globalstatic.h"
 #include "support/icon.h"
+#include "support/perfstats.h"
 #include "support/utils.h"
 #include "widgets/groupedview.h"
 #include "widgets/icons.h"
@@ -65,6 +66,7 @@
 #include <QUrlQuery>
 #include <QXmlStreamReader>
 #include <algorithm>
+#include <vector>
 
 GLOBAL_STATIC(PlayQueueModel, instance)
 static QCollator collator = QCollator();
@@ -410,7 +412,7 @@ QString PlayQueueModel::headerText(int col)
 }
 
 PlayQueueModel::PlayQueueModel(QObject* parent)
-	: QAbstractItemModel(parent), currentSongId(-1), currentSongRowNum(-1), time(0), mpdState(MPDState_Inactive), stopAfterCurrent(false), stopAfterTrackId(-1), undoLimit(10), undoEnabled(undoLimit > 0), lastCommand(Cmd_Other), dropAdjust(0)
+	: QAbstractItemModel(parent), indexValid(false), fileIndexValid(false), currentSongId(-1), currentSongRowNum(-1), time(0), mpdState(MPDState_Inactive), stopAfterCurrent(false), stopAfterTrackId(-1), undoLimit(10), undoEnabled(undoLimit > 0), lastCommand(Cmd_Other), dropAdjust(0)
 {
 	collator.setNumericMode(true);
 	collator.setIgnorePunctuation(true);
@@ -434,6 +436,7 @@ PlayQueueModel::PlayQueueModel(QObject* parent)
 	connect(this, SIGNAL(addAndPlay(QString)), MPDConnection::self(), SLOT(addAndPlay(QString)));
 	connect(this, SIGNAL(startPlayingSongId(qint32)), MPDConnection::self(), SLOT(startPlayingSongId(qint32)));
 	connect(this, SIGNAL(getRating(QString)), MPDConnection::self(), SLOT(getRating(QString)));
+	connect(this, SIGNAL(getRatings(QStringList)), MPDConnection::self(), SLOT(getRatings(QStringList)));
 	connect(this, SIGNAL(setRating(QStringList, quint8)), MPDConnection::self(), SLOT(setRating(QStringList, quint8)));
 	connect(MPDConnection::self(), SIGNAL(rating(QString, quint8)), SLOT(ratingResult(QString, quint8)));
 	connect(MPDConnection::self(), SIGNAL(stickerDbChanged()), SLOT(stickerDbChanged()));
@@ -1027,11 +1030,8 @@ qint32 PlayQueueModel::getSongId(const QString& file) const
 		}
 	}
 	else {
-		for (const Song& s : songs) {
-			if (s.file == file) {
-				return s.id;
-			}
-		}
+		buildFileIndex();
+		return fileToId.value(file, -1);
 	}
 
 	return -1;
@@ -1044,13 +1044,8 @@ qint32 PlayQueueModel::getSongId(const QString& file) const
 
 qint32 PlayQueueModel::getRowById(qint32 id) const
 {
-	for (int i = 0; i < songs.size(); i++) {
-		if (songs.at(i).id == id) {
-			return i;
-		}
-	}
-
-	return -1;
+	buildIndex();
+	return idToRow.value(id, -1);
 }
 
 Song PlayQueueModel::getSongByRow(const qint32 row) const
@@ -1060,12 +1055,62 @@ Song PlayQueueModel::getSongByRow(const qint32 row) const
 
 Song PlayQueueModel::getSongById(qint32 id) const
 {
-	for (const Song& s : songs) {
-		if (s.id == id) {
-			return s;
-		}
+	qint32 row = getRowById(id);
+	return -1 == row ? Song() : songs.at(row);
+}
+
+// Update the rows of the entries from..to, called after rows have been inserted, removed, or moved. Views call
+// getRowById() from within the begin/end row signals, so this is cheaper than rebuilding the whole index.
+void PlayQueueModel::updateIndex(int from, int to)
+{
+	fileIndexValid = false;
+	if (!indexValid) {
+		return;
+	}
+	to = qMin(to, (int)songs.size() - 1);
+	for (int i = from; i <= to; ++i) {
+		idToRow.insert(songs.at(i).id, i);
+	}
+}
+
+// Remove the entries in rows from..to, called before these are removed from the list.
+void PlayQueueModel::removeFromIndex(int from, int to)
+{
+	fileIndexValid = false;
+	if (!indexValid) {
+		return;
+	}
+	for (int i = from; i <= to; ++i) {
+		idToRow.remove(songs.at(i).id);
 	}
-	return Song();
+}
+
+void PlayQueueModel::buildIndex() const
+{
+	if (indexValid) {
+		return;
+	}
+	idToRow.clear();
+	idToRow.reserve(songs.size());
+	for (int i = 0; i < songs.size(); ++i) {
+		idToRow.insert(songs.at(i).id, i);
+	}
+	indexValid = true;
+}
+
+void PlayQueueModel::buildFileIndex() const
+{
+	if (fileIndexValid) {
+		return;
+	}
+	fileToId.clear();
+	fileToId.reserve(songs.size());
+	// Iterate backwards, so that if a file is in the queue more than once we map to its first entry
+	for (int i = songs.size() - 1; i >= 0; --i) {
+		const Song& s = songs.at(i);
+		fileToId.insert(s.file, s.id);
+	}
+	fileIndexValid = true;
 }
 
 void PlayQueueModel::updateCurrentSong(quint32 id)
@@ -1101,6 +1146,7 @@ void PlayQueueModel::clear()
 {
 	beginResetModel();
 	songs.clear();
+	invalidateIndex();
 	ids.clear();
 	currentSongId = -1;
 	currentSongRowNum = 0;
@@ -1133,6 +1179,7 @@ void PlayQueueModel::setState(MPDState st)
 // Update playqueue with contents returned from MPD.
 void PlayQueueModel::update(const QList<Song>& songList, bool isComplete)
 {
+	PerfStats::Scope perf(PerfStats::Models, "PlayQueueModel::update");
 	currentSongRowNum = -1;
 	if (songList.isEmpty()) {
 		Song::clearKeyStore(MPDParseUtils::Loc_PlayQueue);
@@ -1157,6 +1204,7 @@ void PlayQueueModel::update(const QList<Song>& songList, bool isComplete)
 	if (songs.isEmpty() || songList.isEmpty()) {
 		beginResetModel();
 		songs = songList;
+		invalidateIndex();
 		ids = newIds;
 		endResetModel();
 		if (songList.isEmpty()) {
@@ -1164,77 +1212,197 @@ void PlayQueueModel::update(const QList<Song>& songList, bool isComplete)
 		}
 	}
 	else {
-		time = 0;
-
-		QSet<qint32> removed = ids - newIds;
-		for (qint32 id : removed) {
-			qint32 row = getRowById(id);
-			if (row != -1) {
-				beginRemoveRows(QModelIndex(), row, row);
-				songs.removeAt(row);
-				endRemoveRows();
-			}
+		applyChanges(songList);
+		ids = newIds;
+		if (-1 != stopAfterTrackId && !ids.contains(stopAfterTrackId)) {
+			stopAfterTrackId = -1;
 		}
-		for (qint32 i = 0; i < songList.count(); ++i) {
-			Song s = songList.at(i);
-			bool newSong = i >= songs.count();
-			Song currentSongAtPos = newSong ? Song() : songs.at(i);
-			bool isEmpty = s.isEmpty();
-
-			if (newSong || s.id != currentSongAtPos.id) {
-				qint32 existingPos = newSong ? -1 : getRowById(s.id);
-				if (-1 == existingPos) {
-					beginInsertRows(QModelIndex(), i, i);
-					songs.insert(i, s);
-					endInsertRows();
-				}
-				else {
-					beginMoveRows(QModelIndex(), existingPos, existingPos, QModelIndex(), i > existingPos ? i + 1 : i);
-					Song old = songs.takeAt(existingPos);
-					//                     old.pos=s.pos;
-					s.rating = old.rating;
-					s.time = old.time;
-					songs.insert(i, isEmpty ? old : s);
-					endMoveRows();
-				}
-			}
-			else if (isEmpty) {
-				s = currentSongAtPos;
+		emit statsUpdated(songs.size(), time);
+	}
+
+	saveHistory(prev);
+	shuffleAction->setEnabled(songs.count() > 1);
+	sortAction->setEnabled(songs.count() > 1);
+}
+
+// Fenwick tree, used to count entries before a given position in O(log n)
+class EntryCounter {
+public:
+	EntryCounter(int size)
+		: tree(size + 1, 0) {}
+	void add(int pos, int val)
+	{
+		for (++pos; pos < (int)tree.size(); pos += pos & -pos) {
+			tree[pos] += val;
+		}
+	}
+	// Number of entries in [0, pos)
+	int countBefore(int pos) const
+	{
+		int count = 0;
+		for (; pos > 0; pos -= pos & -pos) {
+			count += tree[pos];
+		}
+		return count;
+	}
+
+private:
+	std::vector<int> tree;
+};
+
+// Indexes (into 'seq') of a longest strictly increasing subsequence of 'seq'
+static QSet<int> longestIncreasing(const QList<int>& seq)
+{
+	QList<int> tails;// Index (in seq) of the smallest tail of each subsequence length
+	QList<int> prev;
+	prev.reserve(seq.size());
+	for (int i = 0; i < seq.size(); ++i) {
+		int lo = 0;
+		int hi = tails.size();
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (seq.at(tails.at(mid)) < seq.at(i)) {
+				lo = mid + 1;
 			}
 			else {
-				s.key = currentSongAtPos.key;
-				s.rating = currentSongAtPos.rating;
-				songs.replace(i, s);
-				if (s.title != currentSongAtPos.title || s.artist != currentSongAtPos.artist || s.name() != currentSongAtPos.name()) {
-					emit dataChanged(index(i, 0), index(i, columnCount(QModelIndex()) - 1));
-				}
+				hi = mid;
 			}
+		}
+		prev.append(lo > 0 ? tails.at(lo - 1) : -1);
+		if (lo == tails.size()) {
+			tails.append(i);
+		}
+		else {
+			tails[lo] = i;
+		}
+	}
+	QSet<int> lis;
+	for (int i = tails.isEmpty() ? -1 : tails.last(); -1 != i; i = prev.at(i)) {
+		lis.insert(i);
+	}
+	return lis;
+}
 
-			if (s.id == currentSongId) {
-				currentSongRowNum = i;
+// Turn the current queue into songList using as few row operations as possible. Removed entries are
+// dropped in contiguous blocks, then the entries forming the longest run that is still in the same relative
+// order stay where they are, all other existing entries are moved once, and new entries are inserted once.
+void PlayQueueModel::applyChanges(const QList<Song>& songList)
+{
+	time = 0;
+
+	QHash<qint32, int> newRows;
+	newRows.reserve(songList.size());
+	for (int i = 0; i < songList.size(); ++i) {
+		newRows.insert(songList.at(i).id, i);
+	}
+
+	for (int row = songs.size() - 1; row >= 0;) {
+		if (newRows.contains(songs.at(row).id)) {
+			--row;
+			continue;
+		}
+		int last = row;
+		while (row > 0 && !newRows.contains(songs.at(row - 1).id)) {
+			--row;
+		}
+		beginRemoveRows(QModelIndex(), row, last);
+		removeFromIndex(row, last);
+		songs.erase(songs.begin() + row, songs.begin() + last + 1);
+		updateIndex(row, songs.size() - 1);
+		endRemoveRows();
+		--row;
+	}
+
+	// Position of each (remaining) existing entry, and the order these appear in the new list
+	QHash<qint32, int> oldRows;
+	oldRows.reserve(songs.size());
+	for (int i = 0; i < songs.size(); ++i) {
+		oldRows.insert(songs.at(i).id, i);
+	}
+	QList<int> oldOrder;
+	QList<int> oldOrderNewRow;
+	for (int i = 0; i < songList.size(); ++i) {
+		QHash<qint32, int>::ConstIterator it = oldRows.constFind(songList.at(i).id);
+		if (it != oldRows.constEnd()) {
+			oldOrder.append(it.value());
+			oldOrderNewRow.append(i);
+		}
+	}
+	QSet<int> staying;
+	for (int i : longestIncreasing(oldOrder)) {
+		staying.insert(oldOrderNewRow.at(i));
+	}
+
+	// At each step the list holds the finished rows, plus the existing entries still to be placed - which remain in
+	// their original relative order. Entries are inserted just after the last finished row, which is before any
+	// remaining entry whose original position is >= cursor. Placed entries are tracked in 'placed' using slot 2*pos+1
+	// for entries that stay at their original position, and 2*cursor for entries that are inserted or moved.
+	int numOld = songs.size();
+	EntryCounter remaining(numOld);
+	EntryCounter placed(2 * numOld + 2);
+	for (int i = 0; i < numOld; ++i) {
+		remaining.add(i, 1);
+	}
+
+	int cursor = 0;
+	for (int i = 0; i < songList.size(); ++i) {
+		Song s = songList.at(i);
+		bool isEmpty = s.isEmpty();
+		QHash<qint32, int>::ConstIterator oldIt = oldRows.constFind(s.id);
+		int row = i + remaining.countBefore(cursor);
+
+		if (oldIt == oldRows.constEnd()) {
+			beginInsertRows(QModelIndex(), row, row);
+			songs.insert(row, s);
+			updateIndex(row, songs.size() - 1);
+			endInsertRows();
+			placed.add(2 * cursor, 1);
+		}
+		else if (staying.contains(i)) {
+			int orig = oldIt.value();
+			row = i + remaining.countBefore(orig);
+			const Song& current = songs.at(row);
+			if (isEmpty) {
+				s = current;
 			}
-			time += s.time;
+			else {
+				s.key = current.key;
+				s.rating = current.rating;
+				bool changed = s.title != current.title || s.artist != current.artist || s.name() != current.name();
+				songs.replace(row, s);
+				updateIndex(row, row);
+				if (changed) {
+					emit dataChanged(index(row, 0), index(row, columnCount(QModelIndex()) - 1));
+				}
+			}
+			remaining.add(orig, -1);
+			placed.add(2 * orig + 1, 1);
+			cursor = orig + 1;
 		}
-
-		if (songs.count() > songList.count()) {
-			int toBeRemoved = songs.count() - songList.count();
-			beginRemoveRows(QModelIndex(), songList.count(), songs.count() - 1);
-			for (int i = 0; i < toBeRemoved; ++i) {
-				songs.takeLast();
+		else {
+			int orig = oldIt.value();
+			int from = placed.countBefore(2 * orig + 1) + remaining.countBefore(orig);
+			// If the entry is before the insertion point, then taking it out moves that point up one row
+			int to = orig < cursor ? row - 1 : row;
+			beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+			Song old = songs.takeAt(from);
+			s.rating = old.rating;
+			s.time = old.time;
+			if (isEmpty) {
+				s = old;
 			}
-			endRemoveRows();
+			songs.insert(to, s);
+			updateIndex(qMin(from, to), qMax(from, to));
+			endMoveRows();
+			remaining.add(orig, -1);
+			placed.add(2 * cursor, 1);
 		}
 
-		ids = newIds;
-		if (-1 != stopAfterTrackId && !ids.contains(stopAfterTrackId)) {
-			stopAfterTrackId = -1;
+		if (s.id == currentSongId) {
+			currentSongRowNum = i;
 		}
-		emit statsUpdated(songs.size(), time);
+		time += s.time;
 	}
-
-	saveHistory(prev);
-	shuffleAction->setEnabled(songs.count() > 1);
-	sortAction->setEnabled(songs.count() > 1);
 }
 
 void PlayQueueModel::setStopAfterTrack(qint32 track)
@@ -1657,12 +1825,16 @@ void PlayQueueModel::stickerDbChanged()
 {
 	// Sticker DB changed, need to re-request ratings...
 	QSet<QString> requests;
+	QStringList files;
 	for (const Song& song : songs) {
 		if (Song::Standard == song.type && song.rating <= Song::Rating_Max && !requests.contains(song.file)) {
-			emit getRating(song.file);
+			files.append(song.file);
 			requests.insert(song.file);
 		}
 	}
+	if (!files.isEmpty()) {
+		emit getRatings(files);
+	}
 }
 
 void PlayQueueModel::undo()
@@ -1793,6 +1965,7 @@ void PlayQueueModel::updateDetails(const QList<Song>& updated)
 
 			if (updatedSong.title != current.title || updatedSong.artist != current.artist || updatedSong.name() != current.name()) {
 				songs.replace(i, updatedSong);
+				updateIndex(i, i);
 				updatedRows.append(i);
 				if (currentSongId == current.id) {
 					currentUpdated = true;
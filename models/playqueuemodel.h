@@ -32,6 +32,7 @@
 #include "mpd-interface/mpdstatus.h"
 #include "mpd-interface/song.h"
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QSet>
@@ -132,6 +133,12 @@ public:
 	void remove(const QList<Song>& rem);
 
 private:
+	void invalidateIndex() { indexValid = fileIndexValid = false; }
+	void updateIndex(int from, int to);
+	void removeFromIndex(int from, int to);
+	void buildIndex() const;
+	void buildFileIndex() const;
+	void applyChanges(const QList<Song>& songList);
 	void saveHistory(const QList<Song>& prevList);
 	void controlActions();
 	void addSortAction(const QString& name, const QString& key);
@@ -166,6 +173,7 @@ Q_SIGNALS:
 	void move(const QList<quint32>& items, const quint32 row, const quint32 size);
 	void setOrder(const QList<quint32>& items);
 	void getRating(const QString& file) const;
+	void getRatings(const QStringList& files) const;
 	void setRating(const QStringList& files, quint8 rating) const;
 	void statsUpdated(int songs, quint32 time);
 	void fetchingStreams();
@@ -182,6 +190,12 @@ Q_SIGNALS:
 private:
 	QList<Song> songs;
 	QSet<qint32> ids;
+	// Lookup tables for songs. Rows are kept up to date as the list is modified, and only rebuilt after a reset. Files
+	// are rebuilt on demand, as these map to the first entry of each file.
+	mutable QHash<qint32, qint32> idToRow;
+	mutable QHash<QString, qint32> fileToId;
+	mutable bool indexValid;
+	mutable bool fileIndexValid;
 	qint32 currentSongId;
 	mutable qint32 currentSongRowNum;
 	quint32 time;
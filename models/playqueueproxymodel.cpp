@@ -49,6 +49,11 @@ bool PlayQueueProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sou
 	return index.isValid() && matchesFilter(*static_cast<Song*>(index.internalPointer()));
 }
 
+const Song* PlayQueueProxyModel::sourceSong(const QModelIndex& sourceIndex) const
+{
+	return sourceIndex.isValid() ? static_cast<const Song*>(sourceIndex.internalPointer()) : nullptr;
+}
+
 QMimeData* PlayQueueProxyModel::mimeData(const QModelIndexList& indexes) const
 {
 	QModelIndexList sourceIndexes;
@@ -39,6 +39,9 @@ public:
 
 	QMimeData* mimeData(const QModelIndexList& indexes) const override;
 	bool dropMimeData(const QMimeData* data, Qt::DropAction action, int row, int column, const QModelIndex& parent) override;
+
+protected:
+	const Song* sourceSong(const QModelIndex& sourceIndex) const override;
 };
 
 #endif
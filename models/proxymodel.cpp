@@ -23,18 +23,39 @@
 
 #include "proxymodel.h"
 #include "gui/settings.h"
+#include "support/perfstats.h"
 #include <QChar>
 #include <QLatin1String>
 #include <QMap>
 #include <QMimeData>
 #include <QString>
 
-bool ProxyModel::matchesFilter(const Song& s) const
+// Fold a string for matching - whitespace simplified, case folded, and accents removed (e.g. "Ü" -> "u").
+// Characters are only reduced to their base if the rest of their decomposition is combining marks, so that
+// Hangul syllables, ligatures, etc. are left intact.
+QString ProxyModel::fold(const QString& str)
 {
-	if (yearFrom > 0 && yearTo > 0 && (s.year < yearFrom || s.year > yearTo)) {
-		return false;
+	QString folded = str.simplified();
+	for (int i = 0; i < folded.size(); ++i) {
+		QChar ch = folded.at(i);
+		while (ch.decompositionTag() != QChar::NoDecomposition) {
+			QString decomp = ch.decomposition();
+			bool marksOnly = true;
+			for (int d = 1; d < decomp.size() && marksOnly; ++d) {
+				marksOnly = decomp.at(d).isMark();
+			}
+			if (!marksOnly || decomp.isEmpty() || decomp.at(0) == ch) {
+				break;
+			}
+			ch = decomp.at(0);
+		}
+		folded[i] = ch;
 	}
+	return folded.toCaseFolded();
+}
 
+static QString searchKey(const Song& s)
+{
 	QStringList strings;
 
 	strings << s.albumArtist();
@@ -45,7 +66,34 @@ bool ProxyModel::matchesFilter(const Song& s) const
 		strings << s.composer();
 	}
 	strings << s.title << s.album;
-	return matchesFilter(strings);
+	// Filter strings never contain newlines, so a match cannot span fields
+	return ProxyModel::fold(strings.join(QLatin1Char('\n')));
+}
+
+bool ProxyModel::matchesFilter(const Song& s) const
+{
+	if (yearFrom > 0 && yearTo > 0 && (s.year < yearFrom || s.year > yearTo)) {
+		return false;
+	}
+	if (filterStrings.isEmpty()) {
+		return true;
+	}
+
+	QHash<const Song*, SearchKey>::Iterator it = searchKeys.find(&s);
+	if (it == searchKeys.end() || it.value().file != s.file) {
+		SearchKey entry = {s.file, searchKey(s), 0};
+		it = searchKeys.insert(&s, entry);
+	}
+	SearchKey& entry = it.value();
+	if (entry.rejected == filterSerial || (refining && entry.rejected + 1 == filterSerial)) {
+		entry.rejected = filterSerial;
+		return false;
+	}
+	if (matchesKey(entry.key)) {
+		return true;
+	}
+	entry.rejected = filterSerial;
+	return false;
 }
 
 bool ProxyModel::matchesFilter(const QStringList& strings) const
@@ -54,46 +102,73 @@ bool ProxyModel::matchesFilter(const QStringList& strings) const
 		return true;
 	}
 
+	return matchesKey(fold(strings.join(QLatin1Char('\n'))));
+}
+
+bool ProxyModel::matchesKey(const QString& key) const
+{
 	uint ums = unmatchedStrings;
 	int numStrings = filterStrings.count();
 
-	for (const QString& str : strings) {
-		QString candidate = str.simplified();
-		QString basic;
-		bool useBasic = false;
-
-		for (int i = 0; i < numStrings; ++i) {
-			const QString& f = filterStrings.at(i);
-			// Try to match string as entered by user...
-			if (candidate.contains(f, Qt::CaseInsensitive)) {
-				ums &= ~(1 << i);
-				if (0 == ums) {
-					return true;
-				}
-			}
-			else {
-				// Try converting string to basic - e.g. remove umlauts, etc...
-				if (basic.isEmpty()) {
-					basic = candidate;
-					for (int i = 0; i < basic.size(); ++i) {
-						if (basic.at(i).decompositionTag() != QChar::NoDecomposition) {
-							basic[i] = basic[i].decomposition().at(0);
-							useBasic = true;
-						}
-					}
-				}
-				if (useBasic && basic.contains(f, Qt::CaseInsensitive)) {
-					ums &= ~(1 << i);
-					if (0 == ums) {
-						return true;
-					}
-				}
+	for (int i = 0; i < numStrings; ++i) {
+		if (key.contains(filterStrings.at(i))) {
+			ums &= ~(1 << i);
+			if (0 == ums) {
+				return true;
 			}
 		}
 	}
 
 	return false;
 }
+
+void ProxyModel::setSourceModel(QAbstractItemModel* model)
+{
+	for (const QMetaObject::Connection& c : sourceConnections) {
+		disconnect(c);
+	}
+	sourceConnections.clear();
+	clearSearchKeys();
+	// Connect before QSortFilterProxyModel does, so that keys are forgotten before it re-filters any rows. Inserted and
+	// moved rows need nothing, as matchesFilter() checks that an address still holds the same song.
+	if (model) {
+		sourceConnections << connect(model, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { clearSearchKeys(); })
+		                  << connect(model, &QAbstractItemModel::layoutAboutToBeChanged, this, [this]() { clearSearchKeys(); });
+		sourceConnections << connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, [this](const QModelIndex& parent, int first, int last) {
+			forgetRows(parent, first, last, true);
+		});
+		sourceConnections << connect(model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+			if (topLeft.isValid() && bottomRight.isValid()) {
+				forgetRows(topLeft.parent(), topLeft.row(), bottomRight.row(), false);
+			}
+		});
+	}
+	QSortFilterProxyModel::setSourceModel(model);
+}
+
+void ProxyModel::clearSearchKeys()
+{
+	searchKeys.clear();
+}
+
+// Forget the keys of the songs in rows first..last of parent, and optionally those of their children.
+void ProxyModel::forgetRows(const QModelIndex& parent, int first, int last, bool children)
+{
+	if (searchKeys.isEmpty()) {
+		return;
+	}
+	const QAbstractItemModel* model = sourceModel();
+	for (int row = first; row <= last; ++row) {
+		const QModelIndex idx = model->index(row, 0, parent);
+		if (const Song* s = sourceSong(idx)) {
+			searchKeys.remove(s);
+		}
+		if (children && model->hasChildren(idx)) {
+			forgetRows(idx, 0, model->rowCount(idx) - 1, true);
+		}
+	}
+}
+
 //#include <QDebug>
 
 static const quint16 constMinYear = 1500;
@@ -108,7 +183,16 @@ bool ProxyModel::update(const QString& txt)
 		return false;
 	}
 
+	PerfStats::Scope perf(PerfStats::Models, "ProxyModel::update");
+	if (perf.isActive()) {
+		perf.setDetail(metaObject()->className());
+	}
+
 	bool wasEmpty = isEmpty();
+	// If text has only been added to, then anything that did not match before will not match now
+	bool refine = !origFilterText.isEmpty() && text.startsWith(origFilterText);
+	quint16 prevYearFrom = yearFrom;
+	quint16 prevYearTo = yearTo;
 	filterStrings.clear();
 	yearFrom = yearTo = 0;
 
@@ -134,9 +218,12 @@ bool ProxyModel::update(const QString& txt)
 				}
 			}
 		}
-		filterStrings.append(str);
+		filterStrings.append(fold(str));
 	}
 
+	refining = refine && yearFrom == prevYearFrom && yearTo == prevYearTo;
+	filterSerial++;
+
 	unmatchedStrings = 0;
 	const int n = qMin(filterStrings.count(), (int)(sizeof(uint) * 8));
 	for (int i = 0; i < n; ++i) {
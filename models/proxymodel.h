@@ -26,6 +26,7 @@
 
 #include "config.h"
 #include "mpd-interface/song.h"
+#include <QHash>
 #include <QSortFilterProxyModel>
 #include <QStringList>
 
@@ -33,7 +34,7 @@ class QMimeData;
 
 class ProxyModel : public QSortFilterProxyModel {
 public:
-	ProxyModel(QObject* parent) : QSortFilterProxyModel(parent), isSorted(false), filterEnabled(false), filter(nullptr) {}
+	ProxyModel(QObject* parent) : QSortFilterProxyModel(parent), isSorted(false), filterEnabled(false), unmatchedStrings(0), filter(nullptr), yearFrom(0), yearTo(0), filterSerial(1), refining(false) {}
 	~ProxyModel() override {}
 
 	bool update(const QString& text);
@@ -56,13 +57,25 @@ public:
 	QModelIndexList mapToSource(const QModelIndexList& list, bool leavesOnly = true) const;
 	QMimeData* mimeData(const QModelIndexList& indexes) const override;
 	QModelIndexList leaves(const QModelIndexList& list) const;
+	void setSourceModel(QAbstractItemModel* model) override;
+
+	static QString fold(const QString& str);
 
 protected:
 	bool matchesFilter(const Song& s) const;
 	bool matchesFilter(const QStringList& strings) const;
+	// Song held by an index of the source model, if any. Used to forget the search keys of changed and removed rows.
+	virtual const Song* sourceSong(const QModelIndex& sourceIndex) const
+	{
+		Q_UNUSED(sourceIndex)
+		return nullptr;
+	}
 
 private:
 	QModelIndexList leaves(const QModelIndex& idx) const;
+	bool matchesKey(const QString& key) const;
+	void clearSearchKeys();
+	void forgetRows(const QModelIndex& parent, int first, int last, bool children);
 
 protected:
 	bool isSorted;
@@ -74,6 +87,21 @@ protected:
 	const void* filter;
 	quint16 yearFrom;
 	quint16 yearTo;
+
+private:
+	struct SearchKey {
+		QString file;// Rows can move within the source model, so check the address still holds the same song
+		QString key;
+		quint32 rejected;// Serial of the last filter the song failed, or 0
+	};
+	// Folded search keys of songs, keyed on the address of the song within the source model. Keys of changed and
+	// removed rows are forgotten, and all are cleared when the source model is reset or its layout changes.
+	mutable QHash<const Song*, SearchKey> searchKeys;
+	// Incremented whenever the filter changes. If the filter text has only been extended (refining), then songs that
+	// failed the previous filter cannot match now.
+	quint32 filterSerial;
+	bool refining;
+	QList<QMetaObject::Connection> sourceConnections;
 };
 
 #endif
@@ -0,0 +1,88 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2017-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sqllibraryloader.h"
+#include "db/librarydb.h"
+#include "support/thread.h"
+#include <QDebug>
+
+static const int constBatchSize = 250;
+
+SqlLibraryLoader::SqlLibraryLoader(const QString& name)
+	: QObject(nullptr), dbName(name + QLatin1String("-loader")), db(nullptr), latest(0)
+{
+	qRegisterMetaType<SqlLibraryModel::Query>("SqlLibraryModel::Query");
+	qRegisterMetaType<SqlLibraryModel::Result>("SqlLibraryModel::Result");
+	thread = new Thread(metaObject()->className());
+	moveToThread(thread);
+	thread->start();
+	connect(this, SIGNAL(startQuery(SqlLibraryModel::Query)), this, SLOT(doQuery(SqlLibraryModel::Query)), Qt::QueuedConnection);
+}
+
+SqlLibraryLoader::~SqlLibraryLoader()
+{
+	// Database connection must be removed in the thread that created it
+	delete db;
+	thread->stop();
+}
+
+void SqlLibraryLoader::load(const SqlLibraryModel::Query& q)
+{
+	latest.storeRelease(q.generation);
+	emit startQuery(q);
+}
+
+void SqlLibraryLoader::doQuery(const SqlLibraryModel::Query& q)
+{
+	if (isStale(q.generation)) {
+		return;
+	}
+
+	if (!db) {
+		db = new LibraryDb(nullptr, dbName);
+	}
+
+	SqlLibraryModel::Result r;
+	r.generation = q.generation;
+	r.root = q.root;
+	QList<SqlLibraryModel::Item*> items;
+	if (db->openReadOnly(q.dbFile, q.version, q.instance)) {
+		db->setFilter(q.filter, q.genre);
+		items = SqlLibraryModel::createTopLevel(db, q.top, q.sort, q.root, r.categories);
+	}
+
+	// Always send the first batch, even if empty, as this is what replaces the model's contents
+	int pos = 0;
+	do {
+		if (pos > 0 && isStale(q.generation)) {
+			qDeleteAll(items.mid(pos));
+			return;
+		}
+		r.items = items.mid(pos, constBatchSize);
+		emit loaded(r);
+		r.categories.clear();// Only needed with first batch
+		pos += constBatchSize;
+	} while (pos < items.count());
+}
+
+#include "moc_sqllibraryloader.cpp"
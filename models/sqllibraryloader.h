@@ -0,0 +1,63 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2017-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SQL_LIBRARY_LOADER_H
+#define SQL_LIBRARY_LOADER_H
+
+#include "sqllibrarymodel.h"
+#include <QAtomicInteger>
+#include <QObject>
+
+class LibraryDb;
+class Thread;
+
+// Runs SqlLibraryModel's top level queries on a separate thread, using its own read-only database connection.
+class SqlLibraryLoader : public QObject {
+	Q_OBJECT
+
+public:
+	SqlLibraryLoader(const QString& name);
+	~SqlLibraryLoader() override;
+
+	// Queue query. Any earlier query that has not yet completed will be dropped.
+	void load(const SqlLibraryModel::Query& q);
+
+Q_SIGNALS:
+	// Results are delivered in batches, the receiver takes ownership of the items
+	void loaded(const SqlLibraryModel::Result& r);
+	void startQuery(const SqlLibraryModel::Query& q);
+
+private Q_SLOTS:
+	void doQuery(const SqlLibraryModel::Query& q);
+
+private:
+	bool isStale(quint32 generation) const { return generation != latest.loadAcquire(); }
+
+private:
+	Thread* thread;
+	QString dbName;
+	LibraryDb* db;
+	QAtomicInteger<quint32> latest;
+};
+
+#endif
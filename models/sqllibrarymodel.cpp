@@ -25,7 +25,9 @@
 #include "gui/settings.h"
 #include "playqueuemodel.h"
 #include "roles.h"
+#include "sqllibraryloader.h"
 #include "support/configuration.h"
+#include "support/perfstats.h"
 #include "support/utils.h"
 #include "widgets/icons.h"
 #include <QMimeData>
@@ -71,14 +73,25 @@ QString SqlLibraryModel::groupingStr(Type m)
 }
 
 SqlLibraryModel::SqlLibraryModel(LibraryDb* d, QObject* p, Type top)
-	: ActionModel(p), tl(top), root(nullptr), db(d), librarySort(LibraryDb::AS_YrAlAr), albumSort(LibraryDb::AS_AlArYr)
+	: ActionModel(p), tl(top), root(nullptr), db(d), librarySort(LibraryDb::AS_YrAlAr), albumSort(LibraryDb::AS_AlArYr), loader(nullptr), generation(0), pendingRoot(nullptr)
 {
 	connect(db, SIGNAL(libraryUpdated()), SLOT(libraryUpdated()));
 	connect(db, SIGNAL(error(QString)), this, SIGNAL(error(QString)));
 }
 
+SqlLibraryModel::~SqlLibraryModel()
+{
+	if (loader) {
+		loader->deleteLater();
+	}
+	delete pendingRoot;
+}
+
 void SqlLibraryModel::clear()
 {
+	generation++;
+	delete pendingRoot;
+	pendingRoot = nullptr;
 	beginResetModel();
 	delete root;
 	root = nullptr;
@@ -147,17 +160,16 @@ void SqlLibraryModel::save(Configuration& config)
 	config.set(constLibrarySortKey, LibraryDb::albumSortStr(librarySort));
 }
 
-void SqlLibraryModel::libraryUpdated()
+// Create the top level items - called from SqlLibraryLoader's thread, so must not touch the model.
+QList<SqlLibraryModel::Item*> SqlLibraryModel::createTopLevel(LibraryDb* db, Type top, LibraryDb::AlbumSort sort, CollectionItem* root, QStringList& categories)
 {
-	beginResetModel();
-	delete root;
-	root = new CollectionItem(T_Root, QString());
-	switch (tl) {
+	QList<Item*> items;
+	switch (top) {
 	case T_Genre: {
 		QList<LibraryDb::Genre> genres = db->getGenres();
 		if (!genres.isEmpty()) {
 			for (const LibraryDb::Genre& genre : genres) {
-				root->add(new CollectionItem(T_Genre, genre.name, genre.name, tr("%n Artist(s)", "", genre.artistCount), root));
+				items.append(new CollectionItem(T_Genre, genre.name, genre.name, tr("%n Artist(s)", "", genre.artistCount), root));
 			}
 		}
 		break;
@@ -166,14 +178,13 @@ void SqlLibraryModel::libraryUpdated()
 		QList<LibraryDb::Artist> artists = db->getArtists();
 		if (!artists.isEmpty()) {
 			for (const LibraryDb::Artist& artist : artists) {
-				root->add(new CollectionItem(T_Artist, artist.name, artist.name, tr("%n Album(s)", "", artist.albumCount), root));
+				items.append(new CollectionItem(T_Artist, artist.name, artist.name, tr("%n Album(s)", "", artist.albumCount), root));
 			}
 		}
 		break;
 	}
 	case T_Album: {
-		QList<LibraryDb::Album> albums = db->getAlbums(QString(), QString(), albumSort);
-		categories.clear();
+		QList<LibraryDb::Album> albums = db->getAlbums(QString(), QString(), sort);
 		if (!albums.isEmpty()) {
 			time_t now = time(nullptr);
 			const time_t aDay = 24 * 60 * 60;
@@ -189,7 +200,7 @@ void SqlLibraryModel::libraryUpdated()
 			QMap<QString, int> knownCats;
 			for (const LibraryDb::Album& album : albums) {
 				QString name;
-				switch (albumSort) {
+				switch (sort) {
 				case LibraryDb::AS_AlArYr:
 				case LibraryDb::AS_AlYrAr:
 					name = album.sort.isEmpty() ? album.name.at(0).toUpper() : album.sort.at(0).toUpper();
@@ -248,9 +259,9 @@ void SqlLibraryModel::libraryUpdated()
 				}
 
 				QString trackInfo = tr("%n Tracks (%1)", "", album.trackCount).arg(Utils::formatTime(album.duration, true));
-				root->add(new AlbumItem(T_Album == tl && album.identifyById ? QString() : album.artist,
-				                        album.id, Song::displayAlbum(album.name, album.year),
-				                        T_Album == tl ? album.artist : trackInfo, T_Album == tl ? trackInfo : QString(), root, cat));
+				items.append(new AlbumItem(T_Album == top && album.identifyById ? QString() : album.artist,
+				                           album.id, Song::displayAlbum(album.name, album.year),
+				                           T_Album == top ? album.artist : trackInfo, T_Album == top ? trackInfo : QString(), root, cat));
 			}
 		}
 		break;
@@ -258,13 +269,84 @@ void SqlLibraryModel::libraryUpdated()
 	default:
 		break;
 	}
+	return items;
+}
 
-	endResetModel();
+void SqlLibraryModel::libraryUpdated()
+{
+	generation++;
+	delete pendingRoot;
+	pendingRoot = nullptr;
+
+	if (0 == db->getCurrentVersion() || db->databaseFile().isEmpty()) {
+		// Nothing to query, so no point using the loader
+		beginResetModel();
+		delete root;
+		root = new CollectionItem(T_Root, QString());
+		categories.clear();
+		endResetModel();
+		return;
+	}
+
+	if (!loader) {
+		loader = new SqlLibraryLoader(metaObject()->className());
+		connect(loader, SIGNAL(loaded(SqlLibraryModel::Result)), this, SLOT(loaded(SqlLibraryModel::Result)));
+	}
+
+	// Existing items are shown until the first batch of results arrives
+	pendingRoot = new CollectionItem(T_Root, QString());
+	Query q;
+	q.generation = generation;
+	q.root = pendingRoot;
+	q.top = tl;
+	q.sort = T_Album == tl ? albumSort : librarySort;
+	q.filter = filter;
+	q.genre = genreFilter;
+	q.dbFile = db->databaseFile();
+	q.version = db->getCurrentVersion();
+	q.instance = db->databaseInstance();
+	loader->load(q);
+}
+
+void SqlLibraryModel::loaded(const SqlLibraryModel::Result& r)
+{
+	if (r.generation != generation) {
+		// Superseded by a later query, or by clear()
+		qDeleteAll(r.items);
+		return;
+	}
+
+	PerfStats::Scope perf(PerfStats::Models, "SqlLibraryModel::loaded");
+	if (r.root == pendingRoot) {
+		perf.setDetail("reset");
+		beginResetModel();
+		delete root;
+		root = pendingRoot;
+		pendingRoot = nullptr;
+		categories = r.categories;
+		for (Item* i : r.items) {
+			root->add(i);
+		}
+		endResetModel();
+	}
+	else if (r.root == root && !r.items.isEmpty()) {
+		perf.setDetail("insert");
+		beginInsertRows(QModelIndex(), root->getChildCount(), root->getChildCount() + r.items.count() - 1);
+		for (Item* i : r.items) {
+			root->add(i);
+		}
+		endInsertRows();
+	}
+	else {
+		qDeleteAll(r.items);
+	}
 }
 
 void SqlLibraryModel::search(const QString& str, const QString& genre)
 {
 	if (db->setFilter(str, genre)) {
+		filter = str;
+		genreFilter = genre;
 		libraryUpdated();
 	}
 }
@@ -31,6 +31,7 @@
 #include <QMap>
 
 class Configuration;
+class SqlLibraryLoader;
 
 class SqlLibraryModel : public ActionModel {
 	Q_OBJECT
@@ -124,7 +125,35 @@ public:
 		int category;
 	};
 
+	// Top level query, as run by SqlLibraryLoader
+	struct Query {
+		Query()
+			: generation(0), root(nullptr), top(T_Artist), sort(LibraryDb::AS_AlArYr), version(0), instance(0) {}
+		quint32 generation;
+		CollectionItem* root;// Root that the new items will belong to - not accessed by the loader
+		Type top;
+		LibraryDb::AlbumSort sort;
+		QString filter;
+		QString genre;
+		QString dbFile;
+		time_t version;
+		quint32 instance;
+	};
+
+	// A batch of top level items - the first batch replaces the model's root
+	struct Result {
+		Result()
+			: generation(0), root(nullptr) {}
+		quint32 generation;
+		CollectionItem* root;
+		QList<Item*> items;
+		QStringList categories;
+	};
+
+	static QList<Item*> createTopLevel(LibraryDb* db, Type top, LibraryDb::AlbumSort sort, CollectionItem* root, QStringList& categories);
+
 	SqlLibraryModel(LibraryDb* d, QObject* p, Type top = T_Artist);
+	~SqlLibraryModel() override;
 
 	void reload() { libraryUpdated(); }
 	void clear();
@@ -176,6 +205,9 @@ public Q_SLOTS:
 protected Q_SLOTS:
 	void libraryUpdated();
 
+private Q_SLOTS:
+	void loaded(const SqlLibraryModel::Result& r);
+
 private:
 	void populate(const QModelIndexList& list) const;
 	QModelIndexList children(const QModelIndex& parent) const;
@@ -190,6 +222,14 @@ protected:
 	LibraryDb::AlbumSort librarySort;
 	LibraryDb::AlbumSort albumSort;
 	QStringList categories;
+	SqlLibraryLoader* loader;
+	quint32 generation;        // Generation of the latest top level query
+	CollectionItem* pendingRoot;// Root for the latest query, until its first results arrive
+	QString filter;
+	QString genreFilter;
 };
 
+Q_DECLARE_METATYPE(SqlLibraryModel::Query)
+Q_DECLARE_METATYPE(SqlLibraryModel::Result)
+
 #endif
@@ -202,7 +202,7 @@ void StreamSearchModel::fetchMore(const QModelIndex& index)
 	StreamsModel::Item* item = toItem(index);
 	if (item->isCategory() && !item->url.isEmpty()) {
 		StreamsModel::CategoryItem* cat = static_cast<StreamsModel::CategoryItem*>(item);
-		NetworkJob* job = NetworkAccessManager::self()->get(cat->url);
+		NetworkJob* job = NetworkAccessManager::self()->getCached(cat->url, NetworkCache::Streams);
 		if (jobs.isEmpty()) {
 			emit loading();
 		}
@@ -293,7 +293,7 @@ void StreamSearchModel::search(const QString& searchTerm, bool stationsOnly)
 		}
 
 		searchUrl.setQuery(query);
-		NetworkJob* job = NetworkAccessManager::self()->get(searchUrl);
+		NetworkJob* job = NetworkAccessManager::self()->getCached(searchUrl, NetworkCache::Streams);
 		if (jobs.isEmpty()) {
 			emit loading();
 		}
@@ -475,7 +475,7 @@ NetworkJob* StreamsModel::ShoutCastCategoryItem::fetchSecondardyUrl()
 
 		QNetworkRequest req(url);
 		addHeaders(req);
-		NetworkJob* job = NetworkAccessManager::self()->get(req);
+		NetworkJob* job = NetworkAccessManager::self()->getCached(req, NetworkCache::Streams);
 		job->setProperty(constOrigUrlProperty, url.toString());
 		return job;
 	}
@@ -704,7 +704,7 @@ void StreamsModel::fetchMore(const QModelIndex& index)
 		if (!cat->isFavourites() && !loadCache(cat)) {
 			QNetworkRequest req = QNetworkRequest(cat->fullUrl());
 			cat->addHeaders(req);
-			NetworkJob* job = NetworkAccessManager::self()->get(req);
+			NetworkJob* job = NetworkAccessManager::self()->getCached(req, NetworkCache::Streams);
 			job->setProperty(constOrigUrlProperty, cat->fullUrl());
 			if (jobs.isEmpty()) {
 				emit loading();
@@ -34,6 +34,7 @@
 #include "gui/settings.h"
 #include "support/configuration.h"
 #include "support/globalstatic.h"
+#include "support/perfstats.h"
 #include "support/thread.h"
 #include <QCoreApplication>
 #include <QDate>
@@ -70,11 +71,22 @@ static const int constSocketCommsTimeout = 2000;
 static const int constMaxReadAttempts = 4;
 static const int constMaxFilesPerAddCommand = 2000;
 static const int constConnTimer = 5000;
+static const int constMaxDirsPerListCommand = 32;
+// New play queue entries are fetched as playlistinfo ranges, so we can cope with many more changes than the
+// model can (see constMaxPqChanges) before a complete playlistinfo is quicker.
+static const int constMaxPqChangesToFetch = 10000;
+static const int constLibrarySongsChunk = 200;
+static const int constMaxCoverChunkRequests = 8;
+// If at least this many ratings are needed, then read all ratings with one "sticker find"
+static const int constMinRatingsForFind = 20;
 
 static const QByteArray constOkValue("OK");
 static const QByteArray constOkMpdValue("OK MPD");
 static const QByteArray constOkNlValue("OK\n");
+static const QByteArray constListOkNlValue("list_OK\n");
 static const QByteArray constAckValue("ACK");
+static const QByteArray constBinaryKey("binary: ");
+static const QByteArray constDirectoryKey("directory: ");
 static const QByteArray constIdleChangedKey("changed: ");
 static const QByteArray constIdleDbValue("database");
 static const QByteArray constIdleUpdateValue("update");
@@ -108,6 +120,33 @@ static QByteArray log(const QByteArray& data)
 	}
 }
 
+// Name used to group a command's timings, e.g. "playlistinfo", or "list:add" for a command list of adds
+static QByteArray perfName(const QByteArray& command)
+{
+	int start = 0;
+	QByteArray prefix;
+	if (command.startsWith("command_list_")) {
+		start = command.indexOf('\n') + 1;
+		prefix = "list:";
+		if (0 == start) {
+			return command;
+		}
+	}
+	int end = start;
+	while (end < command.length() && ' ' != command.at(end) && '\n' != command.at(end)) {
+		++end;
+	}
+	return prefix + command.mid(start, end - start);
+}
+
+// Async timings run from when the command was written until its reply has been read
+static void recordAsync(const QByteArray& command, qint64 sent, const QByteArray& reply)
+{
+	if (sent >= 0 && PerfStats::enabled()) {
+		PerfStats::add(PerfStats::Mpd, "sendCommandAsync", sent, PerfStats::now() - sent, perfName(command), reply.size());
+	}
+}
+
 GLOBAL_STATIC(MPDConnection, instance)
 
 const QString MPDConnection::constModifiedSince = QLatin1String("modified-since");
@@ -126,11 +165,32 @@ QByteArray MPDConnection::encodeName(const QString& name)
 	return '\"' + name.toUtf8().replace("\\", "\\\\").replace("\"", "\\\"") + '\"';
 }
 
+// Split the reply to a command_list_ok_begin list into the replies of the individual commands
+static QList<QByteArray> splitListReply(const QByteArray& data)
+{
+	QList<QByteArray> replies;
+	int start = 0;
+	int pos = 0;
+	while (-1 != (pos = data.indexOf(constListOkNlValue, pos))) {
+		if (0 == pos || '\n' == data.at(pos - 1)) {
+			replies.append(data.mid(start, pos - start));
+			start = pos + constListOkNlValue.length();
+		}
+		pos += constListOkNlValue.length();
+	}
+	return replies;
+}
+
 static QByteArray readFromSocket(MpdSocket& socket, int timeout = constSocketCommsTimeout)
 {
 	QByteArray data;
 	int attempt = 0;
+	bool complete = false;
 	while (QAbstractSocket::ConnectedState == socket.state()) {
+		if (socket.takeReply(data)) {
+			complete = true;
+			break;
+		}
 		while (0 == socket.bytesAvailable() && QAbstractSocket::ConnectedState == socket.state()) {
 			DBUG << (void*)(&socket) << "Waiting for read data, attempt" << attempt;
 			if (socket.waitForReadyRead(timeout)) {
@@ -143,12 +203,9 @@ static QByteArray readFromSocket(MpdSocket& socket, int timeout = constSocketCom
 				return QByteArray();
 			}
 		}
-
-		data.append(socket.readAll());
-
-		if (data.endsWith(constOkNlValue) || data.startsWith(constOkValue) || data.startsWith(constAckValue)) {
-			break;
-		}
+	}
+	if (!complete) {
+		data = socket.takeBuffered();
 	}
 	DBUG << (void*)(&socket) << "Read:" << log(data) << ", socket state:" << socket.state();
 
@@ -252,7 +309,7 @@ void MPDConnectionDetails::setDirReadable()
 }
 
 MPDConnection::MPDConnection()
-	: isInitialConnect(true), thread(nullptr), ver(0), canUseStickers(false), sock(this), idleSocket(this), lastStatusPlayQueueVersion(0), lastUpdatePlayQueueVersion(0), state(State_Blank), isListingMusic(false), reconnectTimer(nullptr), reconnectStart(0), stopAfterCurrent(false), currentSongId(-1), songPos(0), unmuteVol(-1), isUpdatingDb(false), volumeFade(nullptr), fadeDuration(0), restoreVolume(-1)
+	: isInitialConnect(true), thread(nullptr), ver(0), canUseStickers(false), sock(this), idleSocket(this), lastStatusPlayQueueVersion(0), lastUpdatePlayQueueVersion(0), state(State_Blank), isListingMusic(false), reconnectTimer(nullptr), reconnectStart(0), stopAfterCurrent(false), currentSongId(-1), songPos(0), unmuteVol(-1), isUpdatingDb(false), volumeFade(nullptr), fadeDuration(0), restoreVolume(-1), holdCoverChunks(false), statusPollPending(false), allRatingsLoaded(false), ratingsGeneration(0), ratingFetchPending(false)
 {
 	qRegisterMetaType<time_t>("time_t");
 	qRegisterMetaType<Song>("Song");
@@ -302,7 +359,8 @@ void MPDConnection::start()
 		connTimer->setSingleShot(false);
 		moveToThread(thread);
 		connect(thread, SIGNAL(finished()), connTimer, SLOT(stop()));
-		connect(connTimer, SIGNAL(timeout()), SLOT(getStatus()));
+		connect(connTimer, SIGNAL(timeout()), SLOT(pollStatus()));
+		connect(&sock, SIGNAL(readyRead()), this, SLOT(commandDataReady()), Qt::QueuedConnection);
 		thread->start();
 	}
 }
@@ -477,6 +535,10 @@ void MPDConnection::disconnectFromMPD()
 {
 	DBUG << "disconnectFromMPD";
 	connTimer->stop();
+	cancelPendingCommands();
+	ratings.clear();
+	allRatingsLoaded = false;
+	ratingsGeneration++;
 	disconnect(&idleSocket, SIGNAL(stateChanged(QAbstractSocket::SocketState)), this, SLOT(onSocketStateChanged(QAbstractSocket::SocketState)));
 	disconnect(&idleSocket, SIGNAL(readyRead()), this, SLOT(idleDataReady()));
 	if (QAbstractSocket::ConnectedState == sock.state()) {
@@ -662,6 +724,7 @@ void MPDConnection::setDetails(const MPDConnectionDetails& d)
 MPDConnection::Response MPDConnection::sendCommand(const QByteArray& command, bool emitErrors, bool retry)
 {
 	connTimer->stop();
+	waitForPendingCommands();
 	static bool reconnected = false;// If we reconnect, and send playlistinfo - dont want that call causing reconnects, and recursion!
 	DBUG << (void*)(&sock) << "sendCommand:" << log(command) << emitErrors << retry;
 
@@ -692,6 +755,7 @@ MPDConnection::Response MPDConnection::sendCommand(const QByteArray& command, bo
 		}
 	}
 
+	qint64 perfStart = PerfStats::enabled() ? PerfStats::now() : -1;
 	Response response;
 	if (-1 == sock.write(command + '\n')) {
 		DBUG << "Failed to write";
@@ -706,6 +770,9 @@ MPDConnection::Response MPDConnection::sendCommand(const QByteArray& command, bo
 		DBUG << "Socket state after write:" << (int)sock.state();
 		response = readReply(sock, timeout);
 	}
+	if (perfStart >= 0) {
+		PerfStats::add(PerfStats::Mpd, "sendCommand", perfStart, PerfStats::now() - perfStart, perfName(command), response.data.size());
+	}
 
 	if (!response.ok) {
 		DBUG << log(command) << "failed";
@@ -779,6 +846,75 @@ MPDConnection::Response MPDConnection::sendCommand(const QByteArray& command, bo
 	return response;
 }
 
+// Write a command without waiting for its reply, handler is called once the reply has been read. Replies
+// arrive in the order commands were sent, and are read as they come in via commandDataReady(), so
+// several commands may be outstanding. Any errors are left to the handler.
+// Only cover chunks, rating stickers, and the periodic status poll are sent this way - everything else
+// uses sendCommand(), which first waits for any outstanding replies.
+bool MPDConnection::sendCommandAsync(const QByteArray& command, const ResponseHandler& handler)
+{
+	DBUG << (void*)(&sock) << "sendCommandAsync:" << log(command);
+	if (!isConnected() || QAbstractSocket::ConnectedState != sock.state() || -1 == sock.write(command + '\n')) {
+		DBUG << "Failed to write";
+		handler(Response(false));
+		return false;
+	}
+	pendingCommands.enqueue(PendingCommand(command, handler, PerfStats::enabled() ? PerfStats::now() : -1));
+	return true;
+}
+
+void MPDConnection::commandDataReady()
+{
+	// Replies to sendCommand() are read there, so only take data here if we are expecting it.
+	QByteArray data;
+	while (!pendingCommands.isEmpty() && sock.takeReply(data)) {
+		PendingCommand cmd = pendingCommands.dequeue();
+		recordAsync(cmd.command, cmd.sent, data);
+		cmd.handler(Response(data.endsWith(constOkNlValue), data));
+	}
+}
+
+// sendCommand() reads its reply straight after writing, so any outstanding replies need to be read first.
+// Cover chunk handlers would normally request further chunks as each reply is read, which would leave
+// sendCommand() waiting for the whole image - so these are held back, and resumed once back in the event loop.
+void MPDConnection::waitForPendingCommands()
+{
+	holdCoverChunks = true;
+	while (!pendingCommands.isEmpty()) {
+		QByteArray data = readFromSocket(sock);
+		PendingCommand cmd = pendingCommands.dequeue();
+		if (data.isEmpty()) {
+			cmd.handler(Response(false));
+			cancelPendingCommands();
+		}
+		else {
+			recordAsync(cmd.command, cmd.sent, data);
+			cmd.handler(Response(data.endsWith(constOkNlValue), data));
+		}
+	}
+	holdCoverChunks = false;
+	if (!heldCoverReads.isEmpty()) {
+		QMetaObject::invokeMethod(this, "resumeCoverReads", Qt::QueuedConnection);
+	}
+}
+
+void MPDConnection::resumeCoverReads()
+{
+	QList<QSharedPointer<CoverRead>> reads = heldCoverReads;
+	heldCoverReads.clear();
+	for (const QSharedPointer<CoverRead>& read : reads) {
+		requestCoverChunks(read);
+	}
+}
+
+void MPDConnection::cancelPendingCommands()
+{
+	while (!pendingCommands.isEmpty()) {
+		PendingCommand cmd = pendingCommands.dequeue();
+		cmd.handler(Response(false));
+	}
+}
+
 /*
  * Playlist commands
  */
@@ -1094,7 +1230,8 @@ void MPDConnection::currentSong()
 /*
  * Call "plchangesposid" to recieve a list of positions+ids that have been changed since the last update.
  * If we have ids in this list that we don't know about, then these are new songs - so we call
- * "playlistinfo <pos>" to get the song information.
+ * "playlistinfo <start>:<end>" for each run of new positions (all in one command list) to get the
+ * song information.
  *
  * Any songs that are know about, will actually be sent with empty data - as the playqueue model will
  * already hold these songs.
@@ -1119,7 +1256,13 @@ void MPDConnection::playListChanges()
 		emitStatusUpdated(sv);
 		QList<MPDParseUtils::IdPos> changes = MPDParseUtils::parseChanges(response.data);
 		if (!changes.isEmpty()) {
-			if (changes.count() > constMaxPqChanges) {
+			if (changes.count() > constMaxPqChangesToFetch) {
+				playListInfo();
+				return;
+			}
+			QSet<qint32> prevIds = Utils::listToSet(playQueueIds);
+			QHash<qint32, Song> newSongs;
+			if (!fetchNewPlayQueueSongs(changes, prevIds, newSongs)) {
 				playListInfo();
 				return;
 			}
@@ -1128,7 +1271,6 @@ void MPDConnection::playListChanges()
 			QList<Song> songs;
 			QList<Song> newCantataStreams;
 			QList<qint32> ids;
-			QSet<qint32> prevIds = Utils::listToSet(playQueueIds);
 			QSet<qint32> strmIds;
 
 			for (const MPDParseUtils::IdPos& idp : changes) {
@@ -1160,14 +1302,13 @@ void MPDConnection::playListChanges()
 				}
 				else {
 					// New song!
-					data = "playlistinfo ";
-					data += quote(idp.pos);
-					response = sendCommand(data);
-					if (!response.ok) {
+					QHash<qint32, Song>::ConstIterator it = newSongs.constFind(idp.id);
+					if (it == newSongs.constEnd()) {
+						// Queue changed again whilst we were reading it?
 						playListInfo();
 						return;
 					}
-					Song s = MPDParseUtils::parseSong(response.data, MPDParseUtils::Loc_PlayQueue);
+					Song s = it.value();
 					s.id = idp.id;
 					//                     s.pos=idp.pos;
 					songs.append(s);
@@ -1220,6 +1361,50 @@ void MPDConnection::playListChanges()
 	playListInfo();
 }
 
+bool MPDConnection::fetchNewPlayQueueSongs(const QList<MPDParseUtils::IdPos>& changes, const QSet<qint32>& prevIds, QHash<qint32, Song>& songs)
+{
+	// Build a "playlistinfo start:end" for each run of consecutive new positions
+	QByteArray cmd;
+	int numRanges = 0;
+	qint64 rangeStart = -1;
+	qint64 rangeEnd = -1;
+	for (const MPDParseUtils::IdPos& idp : changes) {
+		if (prevIds.contains(idp.id) && !streamIds.contains(idp.id)) {
+			continue;
+		}
+		if (-1 != rangeStart && idp.pos == rangeEnd) {
+			rangeEnd++;
+			continue;
+		}
+		if (-1 != rangeStart) {
+			cmd += "playlistinfo " + QByteArray::number(rangeStart) + ':' + QByteArray::number(rangeEnd) + '\n';
+			numRanges++;
+		}
+		rangeStart = idp.pos;
+		rangeEnd = rangeStart + 1;
+	}
+	if (-1 == rangeStart) {
+		return true;
+	}
+	cmd += "playlistinfo " + QByteArray::number(rangeStart) + ':' + QByteArray::number(rangeEnd);
+	numRanges++;
+	if (numRanges > 1) {
+		cmd = "command_list_begin\n" + cmd + "\ncommand_list_end";
+	}
+
+	DBUG << "Fetching new songs using" << numRanges << "range(s)";
+	Response response = sendCommand(cmd);
+	if (!response.ok) {
+		return false;
+	}
+	const QList<Song> fetched = MPDParseUtils::parseSongs(response.data, MPDParseUtils::Loc_PlayQueue);
+	songs.reserve(fetched.count());
+	for (const Song& s : fetched) {
+		songs.insert(s.id, s);
+	}
+	return true;
+}
+
 void MPDConnection::playListInfo()
 {
 	Response response = sendCommand("playlistinfo");
@@ -1509,39 +1694,63 @@ void MPDConnection::getStatus()
 {
 	Response response = sendCommand("status");
 	if (response.ok) {
-		MPDStatusValues sv = MPDParseUtils::parseStatus(response.data);
-		lastStatusPlayQueueVersion = sv.playlist;
-		if (details.partition != sv.partition) {
-			details.partition = sv.partition;
-			Settings::self()->saveConnectionDetails(details);
-			lastUpdatePlayQueueVersion = 0;
-			playQueueIds.clear();
-		}
-		if (currentSongId != sv.songId) {
-			stopVolumeFade();
-		}
-		if (stopAfterCurrent && (currentSongId != sv.songId || (songPos > 0 && sv.timeElapsed < (qint32)songPos))) {
-			stopVolumeFade();
-			if (sendCommand("stop").ok) {
-				sv.state = MPDState_Stopped;
-			}
-			toggleStopAfterCurrent(false);
-		}
-		currentSongId = sv.songId;
-		if (!isUpdatingDb && -1 != sv.updatingDb) {
-			isUpdatingDb = true;
-			emit updatingDatabase();
+		updateStatus(response.data);
+	}
+}
+
+// Called periodically whilst connected, so the reply is read as it arrives rather than waited for.
+void MPDConnection::pollStatus()
+{
+	if (statusPollPending) {
+		return;
+	}
+	statusPollPending = true;
+	sendCommandAsync("status", [this](const Response& response) {
+		statusPollPending = false;
+		if (response.ok) {
+			updateStatus(response.data);
 		}
-		else if (isUpdatingDb && -1 == sv.updatingDb) {
-			isUpdatingDb = false;
-			emit updatedDatabase();
+		else if (response.data.isEmpty() && connTimer->isActive()) {
+			// Not read as part of sendCommand() or a disconnect - so let the synchronous path reconnect, or report the error.
+			QMetaObject::invokeMethod(this, "getStatus", Qt::QueuedConnection);
 		}
-		emitStatusUpdated(sv);
+	});
+}
 
-		// If playlist length does not match number of IDs, then refresh
-		if (sv.playlistLength != static_cast<size_t>(playQueueIds.length())) {
-			playListInfo();
+void MPDConnection::updateStatus(const QByteArray& data)
+{
+	MPDStatusValues sv = MPDParseUtils::parseStatus(data);
+	lastStatusPlayQueueVersion = sv.playlist;
+	if (details.partition != sv.partition) {
+		details.partition = sv.partition;
+		Settings::self()->saveConnectionDetails(details);
+		lastUpdatePlayQueueVersion = 0;
+		playQueueIds.clear();
+	}
+	if (currentSongId != sv.songId) {
+		stopVolumeFade();
+	}
+	if (stopAfterCurrent && (currentSongId != sv.songId || (songPos > 0 && sv.timeElapsed < (qint32)songPos))) {
+		stopVolumeFade();
+		if (sendCommand("stop").ok) {
+			sv.state = MPDState_Stopped;
 		}
+		toggleStopAfterCurrent(false);
+	}
+	currentSongId = sv.songId;
+	if (!isUpdatingDb && -1 != sv.updatingDb) {
+		isUpdatingDb = true;
+		emit updatingDatabase();
+	}
+	else if (isUpdatingDb && -1 == sv.updatingDb) {
+		isUpdatingDb = false;
+		emit updatedDatabase();
+	}
+	emitStatusUpdated(sv);
+
+	// If playlist length does not match number of IDs, then refresh
+	if (sv.playlistLength != static_cast<size_t>(playQueueIds.length())) {
+		playListInfo();
 	}
 }
 
@@ -1562,80 +1771,119 @@ void MPDConnection::getTagTypes()
 	}
 }
 
-void MPDConnection::getCover(const Song& song)
+// Append the binary chunk of an albumart/readpicture reply to imageData. The total image size is
+// read from the first chunk. Returns the size of the chunk, or -1 if the reply is invalid.
+static int addCoverChunk(const QByteArray& data, bool firstChunk, int& imageSize, QByteArray& imageData)
 {
-	int dataToRead = -1;
-	int imageSize = 0;
-	QByteArray imageData;
-	bool firstRun = true;
-	QString path = Utils::getDir(song.file);
-	bool embedded = false;
-	while (dataToRead != 0) {
-		Response response;
-		if (embedded) {
-			response = sendCommand("readpicture " + encodeName(song.file) + " " + QByteArray::number(firstRun ? 0 : (imageSize - dataToRead)));
-		}
-		else {
-			response = sendCommand("albumart " + encodeName(path) + " " + QByteArray::number(firstRun ? 0 : (imageSize - dataToRead)));
-		}
-		if (!response.ok && !embedded && supportsReadPicture()) {
-			DBUG << "albumart query failed; trying embedded";
-			embedded = true;
-			continue;
-		}
-		else if (!response.ok) {
-			DBUG << "albumart query failed";
-			break;
-		}
+	static const QByteArray constSize("size: ");
 
-		static const QByteArray constSize("size: ");
-		static const QByteArray constBinary("binary: ");
+	auto sizeStart = strstr(data.constData(), constSize.constData());
+	if (!sizeStart) {
+		DBUG << "Failed to get size start";
+		return -1;
+	}
+	auto sizeEnd = strchr(sizeStart, '\n');
+	if (!sizeEnd) {
+		DBUG << "Failed to get size end";
+		return -1;
+	}
 
-		auto sizeStart = strstr(response.data.constData(), constSize.constData());
-		if (!sizeStart) {
-			DBUG << "Failed to get size start";
-			break;
-		}
-		auto sizeEnd = strchr(sizeStart, '\n');
-		if (!sizeEnd) {
-			DBUG << "Failed to get size end";
-			break;
-		}
+	auto chunkSizeStart = strstr(sizeEnd, constBinaryKey.constData());
+	if (!chunkSizeStart) {
+		DBUG << "Failed to get chunk size start";
+		return -1;
+	}
+	auto chunkSizeEnd = strchr(chunkSizeStart, '\n');
+	if (!chunkSizeEnd) {
+		DBUG << "Failed to chunk size end";
+		return -1;
+	}
 
-		auto chunkSizeStart = strstr(sizeEnd, constBinary.constData());
-		if (!chunkSizeStart) {
-			DBUG << "Failed to get chunk size start";
-			break;
-		}
-		auto chunkSizeEnd = strchr(chunkSizeStart, '\n');
-		if (!chunkSizeEnd) {
-			DBUG << "Failed to chunk size end";
-			break;
-		}
+	if (firstChunk) {
+		imageSize = QByteArray(sizeStart + constSize.length(), sizeEnd - (sizeStart + constSize.length())).toUInt();
+		imageData.reserve(imageSize);
+		DBUG << "image size" << imageSize;
+	}
 
-		if (firstRun) {
-			imageSize = QByteArray(sizeStart + constSize.length(), sizeEnd - (sizeStart + constSize.length())).toUInt();
-			imageData.reserve(imageSize);
-			dataToRead = imageSize;
-			firstRun = false;
-			DBUG << "image size" << imageSize;
-		}
+	int chunkSize = QByteArray(chunkSizeStart + constBinaryKey.length(), chunkSizeEnd - (chunkSizeStart + constBinaryKey.length())).toUInt();
+	DBUG << "chunk size" << chunkSize;
 
-		int chunkSize = QByteArray(chunkSizeStart + constBinary.length(), chunkSizeEnd - (chunkSizeStart + constBinary.length())).toUInt();
-		DBUG << "chunk size" << chunkSize;
+	int startOfChunk = (chunkSizeEnd + 1) - data.constData();
+	if (startOfChunk + chunkSize > data.length() || imageData.size() + chunkSize > imageSize) {
+		DBUG << "Invalid chunk size";
+		return -1;
+	}
 
-		int startOfChunk = (chunkSizeEnd + 1) - response.data.constData();
-		if (startOfChunk + chunkSize > response.data.length()) {
-			DBUG << "Invalid chunk size";
-			break;
-		}
+	imageData.append(chunkSizeEnd + 1, chunkSize);
+	return chunkSize;
+}
 
-		imageData.append(chunkSizeEnd + 1, chunkSize);
-		dataToRead -= chunkSize;
+struct MPDConnection::CoverRead {
+	Song song;
+	QByteArray command;// albumart, or readpicture, and the URI - the offset is appended per chunk
+	int imageSize = 0;
+	int chunkSize = 0;
+	int nextOffset = 0;
+	int outstanding = 0;
+	bool failed = false;
+	bool finished = false;
+	QByteArray imageData;
+};
+
+void MPDConnection::getCover(const Song& song)
+{
+	QByteArray command = "albumart " + encodeName(Utils::getDir(song.file)) + ' ';
+	Response response = sendCommand(command + '0');
+	if (!response.ok && supportsReadPicture()) {
+		DBUG << "albumart query failed; trying embedded";
+		command = "readpicture " + encodeName(song.file) + ' ';
+		response = sendCommand(command + '0');
+	}
+
+	QSharedPointer<CoverRead> read(new CoverRead);
+	read->song = song;
+	read->command = command;
+	if (!response.ok) {
+		DBUG << "albumart query failed";
+		read->failed = true;
+	}
+	else {
+		read->chunkSize = addCoverChunk(response.data, true, read->imageSize, read->imageData);
+		read->failed = read->chunkSize < 0 || (0 == read->chunkSize && read->imageData.size() < read->imageSize);
+		read->nextOffset = read->imageData.size();
+	}
+	requestCoverChunks(read);
+}
+
+// Once the chunk size is known, the remaining chunks are requested asynchronously - with several
+// requests outstanding at a time, so that we are not waiting for a round trip per chunk.
+void MPDConnection::requestCoverChunks(const QSharedPointer<CoverRead>& read)
+{
+	if (holdCoverChunks && !read->failed && read->nextOffset < read->imageSize) {
+		if (!heldCoverReads.contains(read)) {
+			heldCoverReads.append(read);
+		}
+		return;
+	}
+	while (!read->failed && read->outstanding < constMaxCoverChunkRequests && read->nextOffset < read->imageSize) {
+		int offset = read->nextOffset;
+		read->nextOffset += read->chunkSize;
+		read->outstanding++;
+		sendCommandAsync(read->command + QByteArray::number(offset), [this, read, offset](const Response& response) {
+			read->outstanding--;
+			if (!read->failed && (!response.ok || read->imageData.size() != offset || addCoverChunk(response.data, false, read->imageSize, read->imageData) <= 0)) {
+				DBUG << "albumart chunk query failed" << offset;
+				read->failed = true;
+			}
+			requestCoverChunks(read);
+		});
 	}
 
-	DBUG << dataToRead << imageData.size();
-	emit albumArt(song, 0 == dataToRead ? imageData : QByteArray());
+	if (!read->finished && 0 == read->outstanding && (read->failed || read->nextOffset >= read->imageSize)) {
+		DBUG << read->imageSize << read->imageData.size();
+		read->finished = true;
+		emit albumArt(read->song, !read->failed && read->imageData.size() == read->imageSize ? read->imageData : QByteArray());
+	}
 }
 
 /*
@@ -1744,6 +1992,9 @@ void MPDConnection::parseIdleReturn(const QByteArray& data)
 				outputs();
 			}
 			else if (constIdleStickerValue == value) {
+				ratings.clear();
+				allRatingsLoaded = false;
+				ratingsGeneration++;
 				emit stickerDbChanged();
 			}
 			else if (constIdleSubscriptionValue == value) {
@@ -1887,8 +2138,7 @@ void MPDConnection::loadLibrary()
 	DBUG << "loadLibrary";
 	isListingMusic = true;
 	emit updatingLibrary(dbUpdate);
-	QList<Song> songs;
-	recursivelyListDir("/", songs);
+	listLibrary();
 	emit updatedLibrary();
 	isListingMusic = false;
 }
@@ -2348,11 +2598,9 @@ void MPDConnection::toggleStopAfterCurrent(bool afterCurrent)
 	}
 }
 
-bool MPDConnection::recursivelyListDir(const QString& dir, QList<Song>& songs)
+bool MPDConnection::listLibrary()
 {
-	bool topLevel = "/" == dir || "" == dir;
-
-	if (topLevel && isMpd()) {
+	if (isMpd()) {
 		// UPnP database backend does not list separate metadata items, so if "list genre" returns
 		// empty response assume this is a UPnP backend and dont attempt to get rest of data...
 		// Although we dont use "list XXX", lsinfo will return duplciate items (due to the way most
@@ -2368,44 +2616,145 @@ bool MPDConnection::recursivelyListDir(const QString& dir, QList<Song>& songs)
 		}
 	}
 
-	Response response = sendCommand(topLevel
-	                                        ? serverInfo.getTopLevelLsinfo()
-	                                        : ("lsinfo " + encodeName(dir)));
-	if (response.ok) {
-		QStringList subDirs;
-		QList<Song> dirSongs;
-		MPDParseUtils::parseDirItems(response.data, details.dir, ver, dirSongs, dir, subDirs, MPDParseUtils::Loc_Library);
-		// If we have only 1 sug dir and its ".cue" then this is (probably) MPD's trat CUE as a directory
-		// therefore we ignore any files in this directory as they will be the source files of the CUE
-		if (1 != subDirs.size() || !subDirs.at(0).endsWith(".cue")) {
-			songs += dirSongs;
-			if (songs.count() >= 200) {
-				QCoreApplication::processEvents();
-				QList<Song>* copy = new QList<Song>();
-				*copy << songs;
-				emit librarySongs(copy);
-				songs.clear();
+	Response response = sendCommand(serverInfo.getTopLevelLsinfo());
+	if (!response.ok) {
+		return false;
+	}
+
+	// Folders are listed breadth-first from a queue. For MPD, up to constMaxDirsPerListCommand lsinfo commands
+	// are sent as a single command list, so that we only pay one round trip per batch rather than per folder.
+	QList<Song> songs;
+	QQueue<QString> dirs;
+	bool useCommandList = isMpd();
+	bool useListAll = isMpd();
+	addDirListing(response.data, "/", songs, dirs);
+
+	while (!dirs.isEmpty() && isConnected()) {
+		QStringList batch;
+		while (!dirs.isEmpty() && batch.size() < (useCommandList ? constMaxDirsPerListCommand : 1)) {
+			batch.append(dirs.dequeue());
+		}
+
+		if (useCommandList) {
+			QByteArray cmd = "command_list_ok_begin\n";
+			for (const QString& dir : batch) {
+				cmd += "lsinfo " + encodeName(dir) + '\n';
+			}
+			cmd += "command_list_end";
+			response = sendCommand(cmd, false);
+			if (response.ok) {
+				QList<QByteArray> replies = splitListReply(response.data);
+				if (replies.size() == batch.size()) {
+					for (int i = 0; i < batch.size(); ++i) {
+						addDirListing(replies.at(i), batch.at(i), songs, dirs);
+					}
+					continue;
+				}
 			}
+			DBUG << "Command list of" << batch.size() << "lsinfo commands failed, listing folders individually";
 		}
-		else {
-			DBUG << "IGNORING:" << dirSongs.size() << "track(s) as they are source files of cue?" << subDirs.at(0);
+
+		for (const QString& dir : batch) {
+			listDir(dir, songs, dirs, useListAll);
 		}
-		for (const QString& sub : subDirs) {
-			recursivelyListDir(sub, songs);
+	}
+
+	emitLibrarySongs(songs, true);
+	return true;
+}
+
+void MPDConnection::listDir(const QString& dir, QList<Song>& songs, QQueue<QString>& dirs, bool& useListAll)
+{
+	if (useListAll) {
+		// Try to get the whole sub-tree in one go. This will fail if the reply is larger than MPD's
+		// max_output_buffer_size - in which case dont try again for this listing.
+		Response response = sendCommand("listallinfo " + encodeName(dir), false, false);
+		if (response.ok) {
+			addTreeListing(response.data, dir, songs);
+			return;
 		}
+		DBUG << "listallinfo failed for" << dir << "- using lsinfo";
+		useListAll = false;
+	}
 
-		if (topLevel && !songs.isEmpty()) {
-			QList<Song>* copy = new QList<Song>();
-			*copy << songs;
-			emit librarySongs(copy);
+	Response response = sendCommand("lsinfo " + encodeName(dir));
+	if (response.ok) {
+		addDirListing(response.data, dir, songs, dirs);
+	}
+}
+
+void MPDConnection::addDirListing(const QByteArray& data, const QString& dir, QList<Song>& songs, QQueue<QString>& dirs)
+{
+	QStringList subDirs;
+	QList<Song> dirSongs;
+	MPDParseUtils::parseDirItems(data, details.dir, ver, dirSongs, dir, subDirs, MPDParseUtils::Loc_Library);
+	addDirSongs(dir, dirSongs, subDirs, songs);
+	for (const QString& sub : subDirs) {
+		dirs.enqueue(sub);
+	}
+}
+
+void MPDConnection::addTreeListing(const QByteArray& data, const QString& dir, QList<Song>& songs)
+{
+	// listallinfo outputs a folder's own entries directly after its "directory:" line, so split the reply
+	// into per-folder chunks - each of which can then be parsed as if it were an lsinfo reply.
+	QStringList folders;
+	QList<QByteArray> folderData;
+	QHash<QString, QStringList> subDirs;
+	int chunkStart = 0;
+	int pos = 0;
+	folders.append(dir);
+	while (pos < data.length()) {
+		int lineEnd = data.indexOf('\n', pos);
+		if (-1 == lineEnd) {
+			lineEnd = data.length();
 		}
-		return true;
+		if (0 == qstrncmp(data.constData() + pos, constDirectoryKey.constData(), constDirectoryKey.length())) {
+			folderData.append(data.mid(chunkStart, pos - chunkStart));
+			QString folder = QString::fromUtf8(data.constData() + pos + constDirectoryKey.length(), lineEnd - (pos + constDirectoryKey.length()));
+			int slash = folder.lastIndexOf('/');
+			subDirs[-1 == slash ? dir : folder.left(slash)].append(folder);
+			folders.append(folder);
+			chunkStart = lineEnd + 1;
+		}
+		pos = lineEnd + 1;
+	}
+	folderData.append(data.mid(chunkStart));
+
+	for (int i = 0; i < folders.size(); ++i) {
+		QStringList ignored;
+		QList<Song> dirSongs;
+		MPDParseUtils::parseDirItems(folderData.at(i), details.dir, ver, dirSongs, folders.at(i), ignored, MPDParseUtils::Loc_Library);
+		addDirSongs(folders.at(i), dirSongs, subDirs.value(folders.at(i)), songs);
+	}
+}
+
+void MPDConnection::addDirSongs(const QString& dir, const QList<Song>& dirSongs, const QStringList& subDirs, QList<Song>& songs)
+{
+	// If we have only 1 sug dir and its ".cue" then this is (probably) MPD's trat CUE as a directory
+	// therefore we ignore any files in this directory as they will be the source files of the CUE
+	if (1 != subDirs.size() || !subDirs.at(0).endsWith(".cue")) {
+		songs += dirSongs;
+		emitLibrarySongs(songs, false);
 	}
 	else {
-		return false;
+		DBUG << "IGNORING:" << dirSongs.size() << "track(s) in" << dir << "as they are source files of cue?" << subDirs.at(0);
 	}
 }
 
+void MPDConnection::emitLibrarySongs(QList<Song>& songs, bool all)
+{
+	if (songs.isEmpty() || (!all && songs.count() < constLibrarySongsChunk)) {
+		return;
+	}
+	if (!all) {
+		QCoreApplication::processEvents();
+	}
+	QList<Song>* copy = new QList<Song>();
+	copy->swap(songs);
+	emit librarySongs(copy);
+}
+
 QStringList MPDConnection::getPlaylistFiles(const QString& name)
 {
 	QStringList files;
@@ -2558,9 +2907,11 @@ void MPDConnection::setRating(const QString& file, quint8 val)
 	}
 
 	if (ok) {
+		ratings.insert(file, val);
 		emit rating(file, val);
 	}
 	else {
+		ratings.remove(file);
 		getRating(file);
 	}
 }
@@ -2606,6 +2957,9 @@ void MPDConnection::setRating(const QStringList& files, quint8 val)
 		if (!ok) {
 			break;
 		}
+		for (const QString& f : list) {
+			ratings.insert(f, val);
+		}
 	}
 
 	if (!ok && 0 == val) {
@@ -2613,25 +2967,83 @@ void MPDConnection::setRating(const QStringList& files, quint8 val)
 	}
 }
 
+static quint8 toRating(const QByteArray& val)
+{
+	uint r = val.toUInt();
+	return r > Song::Rating_Max ? 0 : r;
+}
+
 void MPDConnection::getRating(const QString& file)
 {
-	quint8 r = 0;
-	if (canUseStickers) {
-		Response resp = sendCommand("sticker get song " + encodeName(file) + ' ' + constRatingSticker, false);
-		if (resp.ok) {
-			QByteArray val = MPDParseUtils::parseSticker(resp.data, constRatingSticker);
-			if (!val.isEmpty()) {
-				r = val.toUInt();
-			}
+	getRatings(QStringList() << file);
+}
+
+// Requests are answered from the cache where possible, the rest are collected and fetched together
+// once any other queued requests have been received.
+void MPDConnection::getRatings(const QStringList& files)
+{
+	for (const QString& file : files) {
+		QHash<QString, quint8>::ConstIterator it = ratings.constFind(file);
+		if (it != ratings.constEnd()) {
+			emit rating(file, it.value());
 		}
-		else {// Ignore errors about uknown sticker...
-			clearError();
+		else if (!canUseStickers || allRatingsLoaded) {
+			emit rating(file, 0);
 		}
-		if (r > Song::Rating_Max) {
-			r = 0;
+		else {
+			ratingRequests.insert(file);
 		}
 	}
-	emit rating(file, r);
+
+	if (!ratingRequests.isEmpty() && !ratingFetchPending) {
+		ratingFetchPending = true;
+		QMetaObject::invokeMethod(this, "fetchRatings", Qt::QueuedConnection);
+	}
+}
+
+void MPDConnection::fetchRatings()
+{
+	ratingFetchPending = false;
+	QSet<QString> files = ratingRequests;
+	ratingRequests.clear();
+	if (files.isEmpty()) {
+		return;
+	}
+
+	if (files.count() >= constMinRatingsForFind) {
+		DBUG << "Read all ratings for" << files.count() << "files";
+		Response resp = sendCommand("sticker find song \"\" " + constRatingSticker, false);
+		if (resp.ok) {
+			ratings.clear();
+			const QList<MPDParseUtils::Sticker> stickers = MPDParseUtils::parseStickers(resp.data, constRatingSticker);
+			for (const MPDParseUtils::Sticker& s : stickers) {
+				ratings.insert(QString::fromUtf8(s.file), toRating(s.value));
+			}
+			allRatingsLoaded = true;
+			for (const QString& file : files) {
+				emit rating(file, ratings.value(file, 0));
+			}
+			return;
+		}
+		clearError();
+	}
+
+	// Files without a rating give an error, which would abort a command list - so pipeline separate commands instead.
+	quint32 generation = ratingsGeneration;
+	for (const QString& file : files) {
+		sendCommandAsync("sticker get song " + encodeName(file) + ' ' + constRatingSticker, [this, file, generation](const Response& resp) {
+			if (generation != ratingsGeneration) {
+				// Sticker database changed since this was sent, so the reply may be stale - ask again.
+				getRatings(QStringList() << file);
+				return;
+			}
+			quint8 r = resp.ok ? toRating(MPDParseUtils::parseSticker(resp.data, constRatingSticker)) : 0;
+			if (resp.ok || !resp.data.isEmpty()) {// Dont cache if we failed to read a reply
+				ratings.insert(file, r);
+			}
+			emit rating(file, r);
+		});
+	}
 }
 
 void MPDConnection::getStickerSupport()
@@ -2724,7 +3136,7 @@ void MPDConnection::determineIfaceIp()
 }
 
 MpdSocket::MpdSocket(QObject* parent)
-	: QObject(parent), tcp(nullptr), local(nullptr)
+	: QObject(parent), tcp(nullptr), local(nullptr), replyScanPos(0), binaryToSkip(0)
 {
 }
 
@@ -2737,6 +3149,7 @@ MpdSocket::~MpdSocket()
 void MpdSocket::connectToHost(const QString& hostName, quint16 port, QIODevice::OpenMode mode)
 {
 	DBUG << "connectToHost" << hostName << port;
+	clearReplyBuffer();
 	if (hostName.startsWith('/') || hostName.startsWith('~') /* || hostName.startsWith('@')*/) {
 		deleteTcp();
 		if (!local) {
@@ -2763,6 +3176,66 @@ void MpdSocket::connectToHost(const QString& hostName, quint16 port, QIODevice::
 	}
 }
 
+bool MpdSocket::takeReply(QByteArray& reply)
+{
+	if (bytesAvailable() > 0) {
+		replyBuffer.append(readAll());
+	}
+
+	while (replyScanPos < replyBuffer.size()) {
+		if (binaryToSkip > 0) {
+			qint64 skip = qMin(binaryToSkip, (qint64)(replyBuffer.size() - replyScanPos));
+			replyScanPos += skip;
+			binaryToSkip -= skip;
+			continue;
+		}
+
+		const char* line = replyBuffer.constData() + replyScanPos;
+		const char* eol = static_cast<const char*>(memchr(line, '\n', replyBuffer.size() - replyScanPos));
+		if (!eol) {
+			// Partial line, check again once the rest has been received
+			return false;
+		}
+
+		int lineLen = eol - line;
+		int lineEnd = replyScanPos + lineLen + 1;
+		if ((lineLen >= constOkValue.length() && 0 == qstrncmp(line, constOkValue.constData(), constOkValue.length())) || (lineLen >= constAckValue.length() && 0 == qstrncmp(line, constAckValue.constData(), constAckValue.length()))) {
+			if (lineEnd == replyBuffer.size()) {
+				reply = replyBuffer;
+				replyBuffer.clear();
+			}
+			else {
+				// Replies to pipelined commands follow on
+				reply = replyBuffer.left(lineEnd);
+				replyBuffer.remove(0, lineEnd);
+			}
+			replyScanPos = 0;
+			return true;
+		}
+
+		if (lineLen > constBinaryKey.length() && 0 == qstrncmp(line, constBinaryKey.constData(), constBinaryKey.length())) {
+			// Binary data, and the newline following it, can contain anything - so skip over it
+			binaryToSkip = QByteArray(line + constBinaryKey.length(), lineLen - constBinaryKey.length()).toLongLong() + 1;
+		}
+		replyScanPos = lineEnd;
+	}
+	return false;
+}
+
+QByteArray MpdSocket::takeBuffered()
+{
+	QByteArray data = replyBuffer;
+	clearReplyBuffer();
+	return data;
+}
+
+void MpdSocket::clearReplyBuffer()
+{
+	replyBuffer.clear();
+	replyScanPos = 0;
+	binaryToSkip = 0;
+}
+
 void MpdSocket::localStateChanged(QLocalSocket::LocalSocketState state)
 {
 	emit stateChanged((QAbstractSocket::SocketState)state);
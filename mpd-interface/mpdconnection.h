@@ -28,6 +28,7 @@
 #define MPDCONNECTION_H
 
 #include "config.h"
+#include "mpdparseutils.h"
 #include "mpdstats.h"
 #include "mpdstatus.h"
 #include "output.h"
@@ -41,8 +42,10 @@
 #include <QNetworkProxy>
 #include <QQueue>
 #include <QSet>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QTcpSocket>
+#include <functional>
 #include <time.h>
 
 class QTimer;
@@ -73,6 +76,7 @@ public:
 		else if (local) {
 			local->close();
 		}
+		clearReplyBuffer();
 	}
 	int write(const QByteArray& data)
 	{
@@ -140,6 +144,12 @@ public:
 				? (QAbstractSocket::SocketError)local->error()
 				: QAbstractSocket::UnknownSocketError;
 	}
+	// Append any received data to the reply buffer, and take the first complete reply from it.
+	// Only data that has not been checked before is scanned for the terminating OK/ACK line.
+	bool takeReply(QByteArray& reply);
+	// Take whatever has been buffered of an incomplete reply.
+	QByteArray takeBuffered();
+	bool hasBufferedReply() const { return !replyBuffer.isEmpty(); }
 Q_SIGNALS:
 	void stateChanged(QAbstractSocket::SocketState state);
 	void readyRead();
@@ -150,10 +160,14 @@ private Q_SLOTS:
 private:
 	void deleteTcp();
 	void deleteLocal();
+	void clearReplyBuffer();
 
 private:
 	QTcpSocket* tcp;
 	QLocalSocket* local;
+	QByteArray replyBuffer;
+	int replyScanPos;    // Start of the first line that has not been checked
+	qint64 binaryToSkip; // Remaining bytes of a "binary: " chunk, these are never checked for OK/ACK
 };
 
 struct MPDConnectionDetails {
@@ -271,6 +285,7 @@ public:
 		bool ok;
 		QByteArray data;
 	};
+	typedef std::function<void(const Response&)> ResponseHandler;
 
 	static void enableDebug();
 
@@ -407,6 +422,7 @@ public Q_SLOTS:
 	void setRating(const QString& file, quint8 val);
 	void setRating(const QStringList& files, quint8 val);
 	void getRating(const QString& file);
+	void getRatings(const QStringList& files);
 
 	void seek(qint32 offset = 0);
 
@@ -471,6 +487,10 @@ Q_SIGNALS:
 
 private Q_SLOTS:
 	void idleDataReady();
+	void commandDataReady();
+	void resumeCoverReads();
+	void pollStatus();
+	void fetchRatings();
 	void onSocketStateChanged(QAbstractSocket::SocketState socketState);
 
 private:
@@ -487,11 +507,23 @@ private:
 	void disconnectFromMPD();
 	ConnectionReturn connectToMPD(MpdSocket& socket, bool enableIdle = false);
 	Response sendCommand(const QByteArray& command, bool emitErrors = true, bool retry = true);
+	bool sendCommandAsync(const QByteArray& command, const ResponseHandler& handler);
+	void waitForPendingCommands();
+	void cancelPendingCommands();
+	struct CoverRead;
+	void requestCoverChunks(const QSharedPointer<CoverRead>& read);
 	void initialize();
 	void parseIdleReturn(const QByteArray& data);
+	void updateStatus(const QByteArray& data);
 	bool doMoveInPlaylist(const QString& name, const QList<quint32>& items, quint32 pos, quint32 size);
 	void toggleStopAfterCurrent(bool afterCurrent);
-	bool recursivelyListDir(const QString& dir, QList<Song>& songs);
+	bool fetchNewPlayQueueSongs(const QList<MPDParseUtils::IdPos>& changes, const QSet<qint32>& prevIds, QHash<qint32, Song>& songs);
+	bool listLibrary();
+	void listDir(const QString& dir, QList<Song>& songs, QQueue<QString>& dirs, bool& useListAll);
+	void addDirListing(const QByteArray& data, const QString& dir, QList<Song>& songs, QQueue<QString>& dirs);
+	void addTreeListing(const QByteArray& data, const QString& dir, QList<Song>& songs);
+	void addDirSongs(const QString& dir, const QList<Song>& dirSongs, const QStringList& subDirs, QList<Song>& songs);
+	void emitLibrarySongs(QList<Song>& songs, bool all);
 	QStringList getPlaylistFiles(const QString& name);
 	QStringList getAllFiles(const QString& dir);
 	bool checkRemoteDynamicSupport();
@@ -503,7 +535,6 @@ private:
 	void stopVolumeFade();
 	void emitStatusUpdated(MPDStatusValues& v);
 	void clearError();
-	void getRatings(QList<Song>& songs);
 	void getStickerSupport();
 	void playFirstTrack(bool emitErrors);
 	void determineIfaceIp();
@@ -524,6 +555,27 @@ private:
 	QTimer* connTimer;
 	QByteArray dynamicId;
 	QQueue<QByteArray> idleSocketCommandQueue;
+	// Commands written to sock whose replies have not been read yet, in the order they were sent
+	struct PendingCommand {
+		PendingCommand(const QByteArray& c = QByteArray(), const ResponseHandler& h = ResponseHandler(), qint64 s = -1)
+			: command(c), handler(h), sent(s) {}
+		QByteArray command;
+		ResponseHandler handler;
+		qint64 sent;// PerfStats time, or -1 if not recording
+	};
+	QQueue<PendingCommand> pendingCommands;
+	// Cover reads whose next chunks are held back whilst sendCommand() drains the replies above
+	bool holdCoverChunks;
+	bool statusPollPending;
+	QList<QSharedPointer<CoverRead>> heldCoverReads;
+	// Ratings read from MPD, cleared when the sticker database changes. Once all have been loaded (via
+	// "sticker find") any file not listed has no rating.
+	QHash<QString, quint8> ratings;
+	bool allRatingsLoaded;
+	// Incremented whenever ratings is cleared, so that replies to requests sent before then are not cached
+	quint32 ratingsGeneration;
+	QSet<QString> ratingRequests;
+	bool ratingFetchPending;
 
 	// The three items are used so that we can do quick playqueue updates...
 	QList<qint32> playQueueIds;
@@ -33,6 +33,7 @@
 #include "partition.h"
 #include "playlist.h"
 #include "song.h"
+#include <QDateTime>
 #include <QFile>
 #include <QList>
 #include <QString>
@@ -45,6 +46,7 @@
 #include "mpdconnection.h"
 #include "support/utils.h"
 #include <algorithm>
+#include <cstring>
 
 #include <QDebug>
 static bool debugEnabled = false;
@@ -55,30 +57,8 @@ void MPDParseUtils::enableDebug()
 	debugEnabled = true;
 }
 
-static const QByteArray constTimeKey("Time: ");
-static const QByteArray constAlbumKey("Album: ");
-static const QByteArray constArtistKey("Artist: ");
-static const QByteArray constAlbumArtistKey("AlbumArtist: ");
-static const QByteArray constGroupingKey("Grouping: ");
-static const QByteArray constAlbumSortKey("AlbumSort: ");
-static const QByteArray constArtistSortKey("ArtistSort: ");
-static const QByteArray constAlbumArtistSortKey("AlbumArtistSort: ");
-static const QByteArray constComposerKey("Composer: ");
-static const QByteArray constPerformerKey("Performer: ");
-static const QByteArray constCommentKey("Comment: ");
-static const QByteArray constTitleKey("Title: ");
-static const QByteArray constTrackKey("Track: ");
-static const QByteArray constIdKey("Id: ");
-static const QByteArray constDiscKey("Disc: ");
-static const QByteArray constDateKey("Date: ");
-static const QByteArray constOriginalDateKey("OriginalDate: ");
-static const QByteArray constGenreKey("Genre: ");
-static const QByteArray constNameKey("Name: ");
-static const QByteArray constPriorityKey("Prio: ");
-static const QByteArray constAlbumId("MUSICBRAINZ_ALBUMID: ");
 static const QByteArray constFileKey("file: ");
 static const QByteArray constPlaylistKey("playlist: ");
-static const QByteArray constDirectoryKey("directory: ");
 static const QByteArray constPartitionKey("partition: ");
 static const QByteArray constOutputIdKey("outputid: ");
 static const QByteArray constOutputNameKey("outputname: ");
@@ -330,111 +310,336 @@ static QSet<QString> constStdProtocols = QSet<QString>() << constHttpProtocol
 														 << QLatin1String("rtmpt://")
 														 << QLatin1String("rtmps://");
 
-Song MPDParseUtils::parseSong(const QList<QByteArray>& lines, Location location)
-{
-	Song song;
-	for (const QByteArray& line : lines) {
-		if (line.startsWith(constFileKey)) {
-			song.file = QString::fromUtf8(line.mid(constFileKey.length()));
-		}
-		else if (line.startsWith(constTimeKey)) {
-			song.time = line.mid(constTimeKey.length()).toUInt();
-		}
-		else if (line.startsWith(constAlbumKey)) {
-			song.album = QString::fromUtf8(line.mid(constAlbumKey.length()));
-		}
-		else if (line.startsWith(constArtistKey)) {
-			song.artist = QString::fromUtf8(line.mid(constArtistKey.length()));
-		}
-		else if (line.startsWith(constAlbumArtistKey)) {
-			song.albumartist = QString::fromUtf8(line.mid(constAlbumArtistKey.length()));
-		}
-		else if (line.startsWith(constGroupingKey)) {
-			song.setGrouping(QString::fromUtf8(line.mid(constGroupingKey.length())));
-		}
-		else if (line.startsWith(constComposerKey)) {
-			song.setComposer(QString::fromUtf8(line.mid(constComposerKey.length())));
-		}
-		else if (line.startsWith(constTitleKey)) {
-			song.title = QString::fromUtf8(line.mid(constTitleKey.length()));
-		}
-		else if (line.startsWith(constTrackKey)) {
-			int v = line.mid(constTrackKey.length()).split('/').at(0).toInt();
-			song.track = v < 0 ? 0 : v;
-		}
-		else if (Loc_Library != location && Loc_Search != location && line.startsWith(constIdKey)) {
-			song.id = line.mid(constIdKey.length()).toUInt();
-		}
-		else if (line.startsWith(constDiscKey)) {
-			int v = line.mid(constDiscKey.length()).split('/').at(0).toInt();
-			song.disc = v < 0 ? 0 : v;
-		}
-		else if (line.startsWith(constDateKey)) {
-			QByteArray value = line.mid(constDateKey.length());
-			int v = value.length() > 4 ? value.left(4).toUInt() : value.toUInt();
-			song.year = v < 0 ? 0 : v;
-		}
-		else if (line.startsWith(constOriginalDateKey)) {
-			QByteArray value = line.mid(constOriginalDateKey.length());
-			int v = value.length() > 4 ? value.left(4).toUInt() : value.toUInt();
-			song.origYear = v < 0 ? 0 : v;
-		}
-		else if (line.startsWith(constGenreKey)) {
-			song.addGenre(QString::fromUtf8(line.mid(constGenreKey.length())));
-		}
-		else if (line.startsWith(constNameKey)) {
-			song.setName(QString::fromUtf8(line.mid(constNameKey.length())));
-		}
-		else if (line.startsWith(constPlaylistKey)) {
-			song.file = QString::fromUtf8(line.mid(constPlaylistKey.length()));
-			song.title = Utils::getFile(song.file);
-			song.type = Song::Playlist;
-		}
-		else if (line.startsWith(constAlbumId)) {
-			song.setMbAlbumId(line.mid(constAlbumId.length()));
+namespace {
+// Walks an MPD reply in place - key and value point into the original buffer,
+// so no per-line QByteArray (or split() list) is created.
+class ReplyReader {
+public:
+	explicit ReplyReader(const QByteArray& data)
+		: pos(data.constData()), end(data.constData() + data.size())
+	{
+	}
+
+	// Move to the next "key: value" line, lines without a key (OK, list_OK, etc.) are skipped.
+	bool next()
+	{
+		while (pos < end) {
+			const char* eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+			const char* lineEnd = eol ? eol : end;
+			const char* line = pos;
+			pos = eol ? eol + 1 : end;
+
+			const char* sep = static_cast<const char*>(memchr(line, ':', lineEnd - line));
+			if (sep && sep + 1 < lineEnd && ' ' == sep[1]) {
+				key = line;
+				keyLen = sep - line;
+				value = sep + 2;
+				valueLen = lineEnd - value;
+				return true;
+			}
 		}
-		else if ((Loc_Search == location || Loc_Library == location) && line.startsWith(constLastModifiedKey)) {
-			song.lastModified = QDateTime::fromString(QString::fromUtf8(line.mid(constLastModifiedKey.length())), Qt::ISODate).toSecsSinceEpoch();
+		return false;
+	}
+
+	const char* key = nullptr;
+	int keyLen = 0;
+	const char* value = nullptr;
+	int valueLen = 0;
+
+private:
+	const char* pos;
+	const char* end;
+};
+
+enum SongKey {
+	Key_Unknown,
+	Key_File,
+	Key_Time,
+	Key_Album,
+	Key_Artist,
+	Key_AlbumArtist,
+	Key_Grouping,
+	Key_Composer,
+	Key_Title,
+	Key_Track,
+	Key_Id,
+	Key_Disc,
+	Key_Date,
+	Key_OriginalDate,
+	Key_Genre,
+	Key_Name,
+	Key_Playlist,
+	Key_MbAlbumId,
+	Key_LastModified,
+	Key_Performer,
+	Key_Priority,
+	Key_Comment,
+	Key_AlbumSort,
+	Key_ArtistSort,
+	Key_AlbumArtistSort,
+	Key_Directory
+};
+}// namespace
+
+template<int N>
+static inline bool keyIs(const char* key, const char (&name)[N])
+{
+	return 0 == memcmp(key, name, N - 1);
+}
+
+// Key lengths are nearly unique, so dispatch on length first and then confirm with a single compare.
+static SongKey songKey(const char* key, int len)
+{
+	switch (len) {
+	case 2:
+		return keyIs(key, "Id") ? Key_Id : Key_Unknown;
+	case 4:
+		switch (key[0]) {
+		case 'f': return keyIs(key, "file") ? Key_File : Key_Unknown;
+		case 'T': return keyIs(key, "Time") ? Key_Time : Key_Unknown;
+		case 'D': return keyIs(key, "Disc") ? Key_Disc : keyIs(key, "Date") ? Key_Date : Key_Unknown;
+		case 'N': return keyIs(key, "Name") ? Key_Name : Key_Unknown;
+		case 'P': return keyIs(key, "Prio") ? Key_Priority : Key_Unknown;
+		default: return Key_Unknown;
+		}
+	case 5:
+		switch (key[0]) {
+		case 'A': return keyIs(key, "Album") ? Key_Album : Key_Unknown;
+		case 'T': return keyIs(key, "Title") ? Key_Title : keyIs(key, "Track") ? Key_Track : Key_Unknown;
+		case 'G': return keyIs(key, "Genre") ? Key_Genre : Key_Unknown;
+		default: return Key_Unknown;
+		}
+	case 6:
+		return keyIs(key, "Artist") ? Key_Artist : Key_Unknown;
+	case 7:
+		return keyIs(key, "Comment") ? Key_Comment : Key_Unknown;
+	case 8:
+		switch (key[0]) {
+		case 'G': return keyIs(key, "Grouping") ? Key_Grouping : Key_Unknown;
+		case 'C': return keyIs(key, "Composer") ? Key_Composer : Key_Unknown;
+		case 'p': return keyIs(key, "playlist") ? Key_Playlist : Key_Unknown;
+		default: return Key_Unknown;
+		}
+	case 9:
+		switch (key[0]) {
+		case 'A': return keyIs(key, "AlbumSort") ? Key_AlbumSort : Key_Unknown;
+		case 'P': return keyIs(key, "Performer") ? Key_Performer : Key_Unknown;
+		case 'd': return keyIs(key, "directory") ? Key_Directory : Key_Unknown;
+		default: return Key_Unknown;
+		}
+	case 10:
+		return keyIs(key, "ArtistSort") ? Key_ArtistSort : Key_Unknown;
+	case 11:
+		return keyIs(key, "AlbumArtist") ? Key_AlbumArtist : Key_Unknown;
+	case 12:
+		return keyIs(key, "OriginalDate") ? Key_OriginalDate : Key_Unknown;
+	case 13:
+		return keyIs(key, "Last-Modified") ? Key_LastModified : Key_Unknown;
+	case 15:
+		return keyIs(key, "AlbumArtistSort") ? Key_AlbumArtistSort : Key_Unknown;
+	case 19:
+		return keyIs(key, "MUSICBRAINZ_ALBUMID") ? Key_MbAlbumId : Key_Unknown;
+	default:
+		return Key_Unknown;
+	}
+}
+
+// Leading digits of value, e.g. "3/12" -> 3. Negative, or non-numeric, values give 0.
+static uint toUInt(const char* value, int len)
+{
+	int i = 0;
+	while (i < len && ' ' == value[i]) {
+		++i;
+	}
+	uint v = 0;
+	for (; i < len && value[i] >= '0' && value[i] <= '9'; ++i) {
+		v = (v * 10) + (value[i] - '0');
+	}
+	return v;
+}
+
+static inline QString toString(const char* value, int len)
+{
+	return QString::fromUtf8(value, len);
+}
+
+static const qint64 constUnixEpochJulianDay = 2440588;
+
+// MPD always sends Last-Modified as "YYYY-MM-DDTHH:MM:SSZ", so decode that directly and
+// only fall back to QDateTime for anything else.
+static uint toSecsSinceEpoch(const char* value, int len)
+{
+	if (20 == len && '-' == value[4] && '-' == value[7] && 'T' == value[10] && ':' == value[13] && ':' == value[16] && 'Z' == value[19]) {
+		QDate date(toUInt(value, 4), toUInt(value + 5, 2), toUInt(value + 8, 2));
+		if (date.isValid()) {
+			return ((date.toJulianDay() - constUnixEpochJulianDay) * 86400) + (toUInt(value + 11, 2) * 3600) + (toUInt(value + 14, 2) * 60) + toUInt(value + 17, 2);
 		}
-		else if ((Loc_Search == location || Loc_Playlists == location || Loc_PlayQueue == location) && line.startsWith(constPerformerKey)) {
+	}
+	return QDateTime::fromString(QString::fromLatin1(value, len), Qt::ISODate).toSecsSinceEpoch();
+}
+
+static void setSongValue(Song& song, SongKey key, const char* value, int len, MPDParseUtils::Location location)
+{
+	switch (key) {
+	case Key_File:
+		song.file = toString(value, len);
+		break;
+	case Key_Time:
+		song.time = toUInt(value, len);
+		break;
+	case Key_Album:
+		song.album = toString(value, len);
+		break;
+	case Key_Artist:
+		song.artist = toString(value, len);
+		break;
+	case Key_AlbumArtist:
+		song.albumartist = toString(value, len);
+		break;
+	case Key_Grouping:
+		song.setGrouping(toString(value, len));
+		break;
+	case Key_Composer:
+		song.setComposer(toString(value, len));
+		break;
+	case Key_Title:
+		song.title = toString(value, len);
+		break;
+	case Key_Track:
+		song.track = toUInt(value, len);
+		break;
+	case Key_Id:
+		if (MPDParseUtils::Loc_Library != location && MPDParseUtils::Loc_Search != location) {
+			song.id = toUInt(value, len);
+		}
+		break;
+	case Key_Disc:
+		song.disc = toUInt(value, len);
+		break;
+	case Key_Date:
+		song.year = toUInt(value, qMin(len, 4));
+		break;
+	case Key_OriginalDate:
+		song.origYear = toUInt(value, qMin(len, 4));
+		break;
+	case Key_Genre:
+		song.addGenre(toString(value, len));
+		break;
+	case Key_Name:
+		song.setName(toString(value, len));
+		break;
+	case Key_Playlist:
+		song.file = toString(value, len);
+		song.title = Utils::getFile(song.file);
+		song.type = Song::Playlist;
+		break;
+	case Key_MbAlbumId:
+		song.setMbAlbumId(toString(value, len));
+		break;
+	case Key_LastModified:
+		if (MPDParseUtils::Loc_Search == location || MPDParseUtils::Loc_Library == location) {
+			song.lastModified = toSecsSinceEpoch(value, len);
+		}
+		break;
+	case Key_Performer:
+		if (MPDParseUtils::Loc_Search == location || MPDParseUtils::Loc_Playlists == location || MPDParseUtils::Loc_PlayQueue == location) {
 			if (song.hasPerformer()) {
-				song.setPerformer(song.performer() + QLatin1String(", ") + QString::fromUtf8(line.mid(constPerformerKey.length())));
+				song.setPerformer(song.performer() + QLatin1String(", ") + toString(value, len));
 			}
 			else {
-				song.setPerformer(QString::fromUtf8(line.mid(constPerformerKey.length())));
-			}
-		}
-		else if (Loc_PlayQueue == location) {
-			if (line.startsWith(constPriorityKey)) {
-				song.priority = line.mid(constPriorityKey.length()).toUInt();
-			}
-			else if (line.startsWith(constCommentKey)) {
-				song.setComment(QString::fromUtf8(line.mid(constCommentKey.length())));
+				song.setPerformer(toString(value, len));
 			}
 		}
-		else if (Loc_Library == location) {
-			if (line.startsWith(constAlbumSortKey)) {
-				song.setAlbumSort(QString::fromUtf8(line.mid(constAlbumSortKey.length())));
+		break;
+	case Key_Priority:
+		if (MPDParseUtils::Loc_PlayQueue == location) {
+			song.priority = toUInt(value, len);
+		}
+		break;
+	case Key_Comment:
+		if (MPDParseUtils::Loc_PlayQueue == location) {
+			song.setComment(toString(value, len));
+		}
+		break;
+	case Key_AlbumSort:
+		if (MPDParseUtils::Loc_Library == location) {
+			song.setAlbumSort(toString(value, len));
+		}
+		break;
+	case Key_ArtistSort:
+		if (MPDParseUtils::Loc_Library == location) {
+			song.setArtistSort(toString(value, len));
+		}
+		break;
+	case Key_AlbumArtistSort:
+		if (MPDParseUtils::Loc_Library == location) {
+			song.setAlbumArtistSort(toString(value, len));
+		}
+		break;
+	case Key_Directory:
+	case Key_Unknown:
+		break;
+	}
+}
+
+namespace {
+// Reads consecutive songs from a reply. Each song is made up of the lines from one "file:"
+// line (or "playlist:" line, if playlistsStartSongs is set) up to the next.
+class SongReader {
+public:
+	SongReader(const QByteArray& data, MPDParseUtils::Location location, bool playlistsStartSongs, QStringList* dirs = nullptr)
+		: reader(data), location(location), playlistsStartSongs(playlistsStartSongs), dirs(dirs)
+	{
+	}
+
+	// Returns the raw song, before any post-processing.
+	bool next(Song& song)
+	{
+		bool haveLines = false;
+		song = Song();
+		while (pending || reader.next()) {
+			SongKey key = pending ? pendingKey : songKey(reader.key, reader.keyLen);
+			if (!pending && (Key_File == key || (Key_Playlist == key && playlistsStartSongs)) && haveLines) {
+				pending = true;
+				pendingKey = key;
+				return true;
 			}
-			else if (line.startsWith(constArtistSortKey)) {
-				song.setArtistSort(QString::fromUtf8(line.mid(constArtistSortKey.length())));
+			pending = false;
+			haveLines = true;
+			if (Key_Directory == key) {
+				if (dirs) {
+					dirs->append(toString(reader.value, reader.valueLen));
+				}
 			}
-			else if (line.startsWith(constAlbumArtistSortKey)) {
-				song.setAlbumArtistSort(QString::fromUtf8(line.mid(constAlbumArtistSortKey.length())));
+			else {
+				setSongValue(song, key, reader.value, reader.valueLen, location);
 			}
 		}
+		return haveLines;
 	}
 
+private:
+	ReplyReader reader;
+	MPDParseUtils::Location location;
+	bool playlistsStartSongs;
+	QStringList* dirs;
+	bool pending = false;
+	SongKey pendingKey = Key_Unknown;
+};
+}// namespace
+
+static void finishSong(Song& song, MPDParseUtils::Location location)
+{
 	if (Song::Playlist != song.type && song.genres[0].isEmpty()) {
 		song.addGenre(Song::unknown());
 	}
 
-	if (Loc_Library == location) {
+	if (MPDParseUtils::Loc_Library == location) {
 		song.guessTags();
 		song.fillEmptyFields();
 	}
-	else if (Loc_Streams == location) {
-		song.setName(getAndRemoveStreamName(song.file, true));
+	else if (MPDParseUtils::Loc_Streams == location) {
+		song.setName(MPDParseUtils::getAndRemoveStreamName(song.file, true));
 	}
 	else {
 		QString origFile = song.file;
@@ -486,7 +691,7 @@ Song MPDParseUtils::parseSong(const QList<QByteArray>& lines, Location location)
 						modifiedFile = true;
 					}
 					else {
-						QString name = getAndRemoveStreamName(song.file);
+						QString name = MPDParseUtils::getAndRemoveStreamName(song.file);
 						if (!name.isEmpty()) {
 							song.setName(name);
 						}
@@ -496,7 +701,7 @@ Song MPDParseUtils::parseSong(const QList<QByteArray>& lines, Location location)
 					}
 				}
 			}
-			else if (Loc_PlayQueue == location && Song::Standard == song.type && !singleTracksFolders.isEmpty() && singleTracksFolders.contains(Utils::getDir(song.file, false))) {
+			else if (MPDParseUtils::Loc_PlayQueue == location && Song::Standard == song.type && !singleTracksFolders.isEmpty() && singleTracksFolders.contains(Utils::getDir(song.file, false))) {
 				song.setFromSingleTracks();
 				song.fillEmptyFields();
 			}
@@ -519,31 +724,29 @@ Song MPDParseUtils::parseSong(const QList<QByteArray>& lines, Location location)
 			song.albumartist = song.artist = PodcastService::constName;
 		}
 	}
+}
+
+Song MPDParseUtils::parseSong(const QByteArray& data, Location location)
+{
+	Song song;
+	ReplyReader reader(data);
+	while (reader.next()) {
+		setSongValue(song, songKey(reader.key, reader.keyLen), reader.value, reader.valueLen, location);
+	}
+	finishSong(song, location);
 	return song;
 }
 
 QList<Song> MPDParseUtils::parseSongs(const QByteArray& data, Location location)
 {
 	QList<Song> songs;
-	QList<QByteArray> currentItem;
-	QList<QByteArray> lines = data.split('\n');
-	int amountOfLines = lines.size();
+	SongReader reader(data, location, false);
+	Song song;
 
-	for (int i = 0; i < amountOfLines; i++) {
-		const QByteArray& line = lines.at(i);
-		// Skip the "OK" line, this is NOT a song!!!
-		if (constOkValue == line) {
-			continue;
-		}
-		if (!line.isEmpty()) {
-			currentItem.append(line);
-		}
-		if (i == lines.size() - 1 || lines.at(i + 1).startsWith(constFileKey)) {
-			Song song = parseSong(currentItem, location);
-			if (!song.file.isEmpty()) {
-				songs.append(song);
-			}
-			currentItem.clear();
+	while (reader.next(song)) {
+		finishSong(song, location);
+		if (!song.file.isEmpty()) {
+			songs.append(song);
 		}
 	}
 
@@ -632,196 +835,187 @@ MPDParseUtils::MessageMap MPDParseUtils::parseMessages(const QByteArray& data)
 
 void MPDParseUtils::parseDirItems(const QByteArray& data, const QString& mpdDir, long mpdVersion, QList<Song>& songList, const QString& dir, QStringList& subDirs, Location loc)
 {
-	QList<QByteArray> currentItem;
-	QList<QByteArray> lines = data.split('\n');
-	int amountOfLines = lines.size();
 	bool parsePlaylists = "/" != dir && "" != dir;
 	bool setSingleTracks = parsePlaylists && singleTracksFolders.contains(dir) && Loc_Browse != loc;
 	QList<Song> songs;
+	SongReader reader(data, Loc_Library, true, &subDirs);
+	Song currentSong;
 
-	for (int i = 0; i < amountOfLines; i++) {
-		const QByteArray& line = lines.at(i);
-		if (line.startsWith(constDirectoryKey)) {
-			subDirs.append(QString::fromUtf8(line.mid(constDirectoryKey.length())));
-		}
-		currentItem.append(line);
-		if (i == amountOfLines - 1 || lines.at(i + 1).startsWith(constFileKey) || lines.at(i + 1).startsWith(constPlaylistKey)) {
-			Song currentSong = parseSong(currentItem, Loc_Library);
-			currentItem.clear();
-			if (currentSong.file.isEmpty()) {
+	while (reader.next(currentSong)) {
+		finishSong(currentSong, Loc_Library);
+		if (currentSong.file.isEmpty()) {
+			continue;
+		}
+
+		DBUG << currentSong.file;
+		if (Song::Playlist == currentSong.type) {
+			// lsinfo will return all stored playlists - but this is deprecated.
+			if (!parsePlaylists) {
 				continue;
 			}
 
-			DBUG << currentSong.file;
-			if (Song::Playlist == currentSong.type) {
-				// lsinfo will return all stored playlists - but this is deprecated.
-				if (!parsePlaylists) {
-					continue;
+			if (!currentSong.isCueFile()) {
+				// In Folders/Browse, we can list all playlists
+				if (Loc_Browse == loc) {
+					songs.append(currentSong);
 				}
+				// Only add CUE files to library listing...
+				continue;
+			}
 
-				if (!currentSong.isCueFile()) {
-					// In Folders/Browse, we can list all playlists
-					if (Loc_Browse == loc) {
-						songs.append(currentSong);
-					}
-					// Only add CUE files to library listing...
+			switch (cueSupport) {
+			case Cue_Ignore:
+				continue;
+				break;
+			case Cue_Parse:
+				if (Loc_Browse == loc) {
+					songs.append(currentSong);
+				}
+				if (Loc_Library != loc) {
 					continue;
 				}
+				break;
+			case Cue_ListButDontParse:
+				if (Loc_Browse == loc) {
+					songs.append(currentSong);
+				}
+			default:
+				continue;
+				break;
+			}
+
+			// No source files for CUE file..
+			if (songs.isEmpty()) {
+				continue;
+			}
 
-				switch (cueSupport) {
-				case Cue_Ignore:
+			Song firstSong = songs.at(0);
+			QList<Song> cueSongs;  // List of songs from cue file
+			QSet<QString> cueFiles;// List of source (flac, mp3, etc) files referenced in cue file
+
+			DBUG << "Got playlist item" << currentSong.file;
+
+			bool canSplitCue = mpdVersion >= CANTATA_MAKE_VERSION(0, 17, 0);
+			bool parseCue = canSplitCue && currentSong.isCueFile() && !mpdDir.startsWith(constHttpProtocol) && QFile::exists(mpdDir + currentSong.file);
+			bool cueParseStatus = false;
+			double lastTrackIndex = 0.0;
+			if (parseCue) {
+				DBUG << "Parsing cue file:" << currentSong.file << "mpdDir:" << mpdDir;
+				cueParseStatus = CueFile::parse(currentSong.file, mpdDir, cueSongs, cueFiles, lastTrackIndex);
+				if (!cueParseStatus) {
+					DBUG << "Failed to parse cue file!";
 					continue;
-					break;
-				case Cue_Parse:
-					if (Loc_Browse == loc) {
-						songs.append(currentSong);
-					}
-					if (Loc_Library != loc) {
-						continue;
-					}
-					break;
-				case Cue_ListButDontParse:
-					if (Loc_Browse == loc) {
-						songs.append(currentSong);
+				}
+				else
+					DBUG << "Parsed cue file, songs:" << cueSongs.count() << "files:" << cueFiles;
+			}
+			if (cueParseStatus && cueSongs.count() >= songs.count() && (cueFiles.count() < cueSongs.count() || (firstSong.albumArtist().isEmpty() && firstSong.album.isEmpty()))) {
+
+				bool canUseThisCueFile = true;
+				for (const Song& s : cueSongs) {
+					if (!QFile::exists(mpdDir + s.name())) {
+						DBUG << QString(mpdDir + s.name()) << "is referenced in cue file, but does not exist in MPD folder";
+						canUseThisCueFile = false;
+						break;
 					}
-				default:
-					continue;
-					break;
 				}
 
-				// No source files for CUE file..
-				if (songs.isEmpty()) {
+				if (!canUseThisCueFile) {
 					continue;
 				}
 
-				Song firstSong = songs.at(0);
-				QList<Song> cueSongs;  // List of songs from cue file
-				QSet<QString> cueFiles;// List of source (flac, mp3, etc) files referenced in cue file
-
-				DBUG << "Got playlist item" << currentSong.file;
-
-				bool canSplitCue = mpdVersion >= CANTATA_MAKE_VERSION(0, 17, 0);
-				bool parseCue = canSplitCue && currentSong.isCueFile() && !mpdDir.startsWith(constHttpProtocol) && QFile::exists(mpdDir + currentSong.file);
-				bool cueParseStatus = false;
-				double lastTrackIndex = 0.0;
-				if (parseCue) {
-					DBUG << "Parsing cue file:" << currentSong.file << "mpdDir:" << mpdDir;
-					cueParseStatus = CueFile::parse(currentSong.file, mpdDir, cueSongs, cueFiles, lastTrackIndex);
-					if (!cueParseStatus) {
-						DBUG << "Failed to parse cue file!";
-						continue;
-					}
-					else
-						DBUG << "Parsed cue file, songs:" << cueSongs.count() << "files:" << cueFiles;
-				}
-				if (cueParseStatus && cueSongs.count() >= songs.count() && (cueFiles.count() < cueSongs.count() || (firstSong.albumArtist().isEmpty() && firstSong.album.isEmpty()))) {
+				bool canUseCueFileTracks = false;
+				QList<Song> fixedCueSongs;// Songs taken from cueSongs that have been updated...
 
-					bool canUseThisCueFile = true;
-					for (const Song& s : cueSongs) {
-						if (!QFile::exists(mpdDir + s.name())) {
-							DBUG << QString(mpdDir + s.name()) << "is referenced in cue file, but does not exist in MPD folder";
-							canUseThisCueFile = false;
-							break;
-						}
+				if (songs.size() == cueFiles.size()) {
+					quint32 albumTime = 0;
+					QMap<QString, Song> origFiles;
+					for (const Song& s : songs) {
+						origFiles.insert(s.file, s);
+						albumTime += s.time;
 					}
-
-					if (!canUseThisCueFile) {
-						continue;
-					}
-
-					bool canUseCueFileTracks = false;
-					QList<Song> fixedCueSongs;// Songs taken from cueSongs that have been updated...
-
-					if (songs.size() == cueFiles.size()) {
-						quint32 albumTime = 0;
-						QMap<QString, Song> origFiles;
-						for (const Song& s : songs) {
-							origFiles.insert(s.file, s);
-							albumTime += s.time;
+					DBUG << "Original files:" << origFiles.keys();
+
+					bool setTimeFromSource = origFiles.size() == cueSongs.size();
+					DBUG << "setTimeFromSource" << setTimeFromSource << "at" << albumTime << "#c" << cueFiles.size();
+					for (const Song& orig : cueSongs) {
+						Song s = orig;
+						Song albumSong = origFiles[s.name()];
+						s.setName(QString());// CueFile has placed source file name here!
+						if (s.artist.isEmpty() && !albumSong.artist.isEmpty()) {
+							s.artist = albumSong.artist;
+							DBUG << "Get artist from album" << albumSong.artist;
 						}
-						DBUG << "Original files:" << origFiles.keys();
-
-						bool setTimeFromSource = origFiles.size() == cueSongs.size();
-						DBUG << "setTimeFromSource" << setTimeFromSource << "at" << albumTime << "#c" << cueFiles.size();
-						for (const Song& orig : cueSongs) {
-							Song s = orig;
-							Song albumSong = origFiles[s.name()];
-							s.setName(QString());// CueFile has placed source file name here!
-							if (s.artist.isEmpty() && !albumSong.artist.isEmpty()) {
-								s.artist = albumSong.artist;
-								DBUG << "Get artist from album" << albumSong.artist;
-							}
-							if (s.composer().isEmpty() && !albumSong.composer().isEmpty()) {
-								s.setComposer(albumSong.composer());
-								DBUG << "Get composer from album" << albumSong.composer();
-							}
-							if (s.album.isEmpty() && !albumSong.album.isEmpty()) {
-								s.album = albumSong.album;
-								DBUG << "Get album from album" << albumSong.album;
-							}
-							if (s.albumartist.isEmpty() && !albumSong.albumartist.isEmpty()) {
-								s.albumartist = albumSong.albumartist;
-								DBUG << "Get albumartist from album" << albumSong.albumartist;
-							}
-							if (0 == s.year && 0 != albumSong.year) {
-								s.year = albumSong.year;
-								DBUG << "Get year from album" << albumSong.year;
-							}
-							if (0 == s.time && setTimeFromSource) {
-								s.time = albumSong.time;
-							}
-							else if (0 == s.time && 1 == cueFiles.size()) {
-								DBUG << "Set time of last track" << s.title << s.time << albumTime << (lastTrackIndex / 1000.0);
-								// Try to set duration of last track by subtracting previous track durations from album duration...
-								s.time = albumTime - (lastTrackIndex / 1000.0);
-							}
-							DBUG << s.title << s.time;
-							fixedCueSongs.append(s);
+						if (s.composer().isEmpty() && !albumSong.composer().isEmpty()) {
+							s.setComposer(albumSong.composer());
+							DBUG << "Get composer from album" << albumSong.composer();
 						}
-						canUseCueFileTracks = true;
-					}
-					else
-						DBUG << "ERROR: file count mismatch" << songs.size() << cueFiles.size();
-
-					if (!canUseCueFileTracks) {
-						// Album had a different number of source files to the CUE file. If so, then we need to ensure
-						// all tracks have meta data - otherwise just fallback to listing file + cue
-						for (const Song& orig : cueSongs) {
-							Song s = orig;
-							s.setName(QString());// CueFile has placed source file name here!
-							if (s.artist.isEmpty() || s.album.isEmpty()) {
-								break;
-							}
-							fixedCueSongs.append(s);
+						if (s.album.isEmpty() && !albumSong.album.isEmpty()) {
+							s.album = albumSong.album;
+							DBUG << "Get album from album" << albumSong.album;
 						}
-
-						if (fixedCueSongs.count() == cueSongs.count()) {
-							canUseCueFileTracks = true;
+						if (s.albumartist.isEmpty() && !albumSong.albumartist.isEmpty()) {
+							s.albumartist = albumSong.albumartist;
+							DBUG << "Get albumartist from album" << albumSong.albumartist;
 						}
-						else
-							DBUG << "ERROR: Not all cue tracks had meta data";
+						if (0 == s.year && 0 != albumSong.year) {
+							s.year = albumSong.year;
+							DBUG << "Get year from album" << albumSong.year;
+						}
+						if (0 == s.time && setTimeFromSource) {
+							s.time = albumSong.time;
+						}
+						else if (0 == s.time && 1 == cueFiles.size()) {
+							DBUG << "Set time of last track" << s.title << s.time << albumTime << (lastTrackIndex / 1000.0);
+							// Try to set duration of last track by subtracting previous track durations from album duration...
+							s.time = albumTime - (lastTrackIndex / 1000.0);
+						}
+						DBUG << s.title << s.time;
+						fixedCueSongs.append(s);
+					}
+					canUseCueFileTracks = true;
+				}
+				else
+					DBUG << "ERROR: file count mismatch" << songs.size() << cueFiles.size();
+
+				if (!canUseCueFileTracks) {
+					// Album had a different number of source files to the CUE file. If so, then we need to ensure
+					// all tracks have meta data - otherwise just fallback to listing file + cue
+					for (const Song& orig : cueSongs) {
+						Song s = orig;
+						s.setName(QString());// CueFile has placed source file name here!
+						if (s.artist.isEmpty() || s.album.isEmpty()) {
+							break;
+						}
+						fixedCueSongs.append(s);
 					}
 
-					if (canUseCueFileTracks) {
-						songs = fixedCueSongs;
+					if (fixedCueSongs.count() == cueSongs.count()) {
+						canUseCueFileTracks = true;
 					}
-					continue;
+					else
+						DBUG << "ERROR: Not all cue tracks had meta data";
 				}
 
-				if (!firstSong.albumArtist().isEmpty() && !firstSong.album.isEmpty()) {
-					currentSong.albumartist = firstSong.albumArtist();
-					currentSong.album = firstSong.album;
-					songs.append(currentSong);
+				if (canUseCueFileTracks) {
+					songs = fixedCueSongs;
 				}
+				continue;
 			}
-			else {
-				if (setSingleTracks) {
-					currentSong.setFromSingleTracks();
-				}
-				currentSong.fillEmptyFields();
+
+			if (!firstSong.albumArtist().isEmpty() && !firstSong.album.isEmpty()) {
+				currentSong.albumartist = firstSong.albumArtist();
+				currentSong.album = firstSong.album;
 				songs.append(currentSong);
 			}
 		}
+		else {
+			if (setSingleTracks) {
+				currentSong.setFromSingleTracks();
+			}
+			currentSong.fillEmptyFields();
+			songs.append(currentSong);
+		}
 	}
 	if (Loc_Browse == loc) {
 		QList<Song> sngs;
@@ -38,6 +38,7 @@ static bool debugEnabled = false;
 void NetworkAccessManager::enableDebug()
 {
 	debugEnabled = true;
+	NetworkCache::enableDebug();
 }
 
 static bool networkAccessEnabled = true;
@@ -136,6 +137,7 @@ void NetworkJob::jobFinished()
 		for (const QByteArray& header : headers) {
 			newReq.setRawHeader(header, origReq.rawHeader(header));
 		}
+		newReq.setAttribute(NetworkCache::constCategoryAttribute, origReq.attribute(NetworkCache::constCategoryAttribute));
 		QNetworkReply* newJob = static_cast<QNetworkAccessManager*>(j->manager())->get(newReq);
 		DBUG << j->url().toString() << "redirected to" << newJob->url().toString();
 
@@ -183,10 +185,13 @@ void NetworkJob::handleReadyRead()
 GLOBAL_STATIC(NetworkAccessManager, instance)
 
 NetworkAccessManager::NetworkAccessManager(QObject* parent)
-	: QNetworkAccessManager(parent)
+	: QNetworkAccessManager(parent), networkCache(nullptr)
 {
 	if (networkAccessEnabled) {
 		NetworkProxyFactory::self();
+		// Each manager needs its own cache object, but these all share the same store
+		networkCache = new NetworkCache(this);
+		setCache(networkCache);
 	}
 }
 
@@ -256,6 +261,21 @@ QNetworkReply* NetworkAccessManager::postFormData(QNetworkRequest req, const QBy
 	}
 }
 
+// Only GET requests that have been given a cache category use the cache, everything else (e.g. podcast
+// episodes, stream playlists) always goes to the network.
+QNetworkReply* NetworkAccessManager::createRequest(Operation op, const QNetworkRequest& req, QIODevice* outgoingData)
+{
+	if (networkCache && GetOperation == op && NetworkCache::hasCategory(req)) {
+		networkCache->requested(req);
+		return QNetworkAccessManager::createRequest(op, req, outgoingData);
+	}
+
+	QNetworkRequest request = req;
+	request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+	request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+	return QNetworkAccessManager::createRequest(op, request, outgoingData);
+}
+
 void NetworkAccessManager::replyFinished()
 {
 	NetworkJob* job = static_cast<NetworkJob*>(sender());
@@ -24,6 +24,7 @@
 #ifndef NETWORK_ACCESS_MANAGER_H
 #define NETWORK_ACCESS_MANAGER_H
 
+#include "networkcache.h"
 #include <QMap>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -100,10 +101,18 @@ public:
 
 	NetworkJob* get(const QNetworkRequest& req, int timeout = 0);
 	NetworkJob* get(const QUrl& url, int timeout = 0) { return get(QNetworkRequest(url), timeout); }
+	// As above, but the response may be served from, and is stored in, the HTTP cache
+	NetworkJob* getCached(QNetworkRequest req, NetworkCache::Category cat, int timeout = 0)
+	{
+		NetworkCache::setCategory(req, cat);
+		return get(req, timeout);
+	}
+	NetworkJob* getCached(const QUrl& url, NetworkCache::Category cat, int timeout = 0) { return getCached(QNetworkRequest(url), cat, timeout); }
 	QNetworkReply* postFormData(QNetworkRequest req, const QByteArray& data);
 	QNetworkReply* postFormData(const QUrl& url, const QByteArray& data) { return postFormData(QNetworkRequest(url), data); }
 
 protected:
+	QNetworkReply* createRequest(Operation op, const QNetworkRequest& req, QIODevice* outgoingData = nullptr) override;
 	void timerEvent(QTimerEvent* e) override;
 
 private Q_SLOTS:
@@ -111,6 +120,7 @@ private Q_SLOTS:
 
 private:
 	QMap<NetworkJob*, int> timers;
+	NetworkCache* networkCache;
 	friend class NetworkJob;
 };
 
@@ -0,0 +1,508 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "networkcache.h"
+#include "support/perfstats.h"
+#include "support/utils.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+
+#include <QDebug>
+static bool debugEnabled = false;
+#define DBUG \
+	if (debugEnabled) qWarning() << "NetworkCache" << __FUNCTION__
+void NetworkCache::enableDebug()
+{
+	debugEnabled = true;
+}
+
+const QLatin1String NetworkCache::constCacheDir("http/");
+const QLatin1String NetworkCache::constExt(".http");
+const QNetworkRequest::Attribute NetworkCache::constCategoryAttribute = (QNetworkRequest::Attribute)(QNetworkRequest::User + 1);
+
+static const quint32 constMagic = 0x434e4331;// CNC1
+// Responses larger than this fraction of a category's quota are not stored
+static const int constMaxEntryFraction = 8;
+
+static PerfStats::Counter perfCounters[NetworkCache::NumCategories] = {
+		{PerfStats::Network, "http:context"},
+		{PerfStats::Network, "http:streams"},
+		{PerfStats::Network, "http:podcasts"},
+		{PerfStats::Network, "http:covers"}};
+
+namespace {
+struct Entry {
+	NetworkCache::Category category = NetworkCache::Context;
+	qint64 size = 0;
+	qint64 lastAccess = 0;
+};
+
+// Index of all stored responses, shared by every NetworkCache instance. Files are named after the hash
+// of their URL, and their modification time is used to record when they were last used - so that the
+// least recently used order survives restarts.
+class Store {
+public:
+	Store()
+		: loaded(false)
+	{
+		quotas[NetworkCache::Context] = 20 * 1024 * 1024;
+		quotas[NetworkCache::Streams] = 10 * 1024 * 1024;
+		quotas[NetworkCache::Podcasts] = 10 * 1024 * 1024;
+		quotas[NetworkCache::Covers] = 10 * 1024 * 1024;
+		for (int i = 0; i < NetworkCache::NumCategories; ++i) {
+			sizes[i] = 0;
+		}
+	}
+
+	static QByteArray key(const QUrl& url) { return QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex(); }
+
+	QString dirName(NetworkCache::Category cat) const
+	{
+		return baseDir + QLatin1String(NetworkCache::categoryName(cat)) + Utils::constDirSep;
+	}
+
+	QString fileName(NetworkCache::Category cat, const QByteArray& k) const
+	{
+		return dirName(cat) + QString::fromLatin1(k) + NetworkCache::constExt;
+	}
+
+	// Must be called with mutex locked
+	void load()
+	{
+		if (loaded) {
+			return;
+		}
+		loaded = true;
+		if (baseDir.isEmpty()) {
+			baseDir = Utils::cacheDir(NetworkCache::constCacheDir, true);
+		}
+		for (int i = 0; i < NetworkCache::NumCategories; ++i) {
+			NetworkCache::Category cat = (NetworkCache::Category)i;
+			const QFileInfoList files = QDir(dirName(cat)).entryInfoList(QStringList() << QLatin1Char('*') + NetworkCache::constExt, QDir::Files);
+			for (const QFileInfo& info : files) {
+				Entry e;
+				e.category = cat;
+				e.size = info.size();
+				e.lastAccess = info.lastModified().toMSecsSinceEpoch();
+				entries.insert(info.completeBaseName().toLatin1(), e);
+				sizes[cat] += e.size;
+			}
+		}
+		DBUG << baseDir << entries.count();
+		for (int i = 0; i < NetworkCache::NumCategories; ++i) {
+			evict((NetworkCache::Category)i, 0);
+		}
+	}
+
+	// Read a stored response, body may be null if only the meta-data is required. Must be called with mutex locked.
+	bool read(const QUrl& url, QNetworkCacheMetaData& md, QByteArray* body, bool touch)
+	{
+		load();
+		QByteArray k = key(url);
+		QHash<QByteArray, Entry>::Iterator it = entries.find(k);
+		if (it == entries.end()) {
+			return false;
+		}
+		QFile f(fileName(it.value().category, k));
+		if (!f.open(QIODevice::ReadOnly)) {
+			// Removed from under us, e.g. via the cache settings page
+			removeEntry(it);
+			return false;
+		}
+		QDataStream stream(&f);
+		quint32 magic = 0;
+		stream >> magic;
+		if (constMagic != magic) {
+			f.close();
+			removeEntry(it);
+			return false;
+		}
+		stream >> md;
+		if (body) {
+			QByteArray compressed;
+			stream >> compressed;
+			*body = qUncompress(compressed);
+		}
+		if (QDataStream::Ok != stream.status() || md.url() != url) {
+			f.close();
+			removeEntry(it);
+			return false;
+		}
+		if (touch) {
+			QDateTime now = QDateTime::currentDateTime();
+			it.value().lastAccess = now.toMSecsSinceEpoch();
+			f.close();
+			if (f.open(QIODevice::ReadWrite)) {
+				f.setFileTime(now, QFileDevice::FileModificationTime);
+			}
+		}
+		return true;
+	}
+
+	// Must be called with mutex locked
+	bool write(NetworkCache::Category cat, const QNetworkCacheMetaData& md, const QByteArray& body, bool compressed = false)
+	{
+		load();
+		QByteArray data = compressed ? body : qCompress(body);
+		QByteArray k = key(md.url());
+		QHash<QByteArray, Entry>::Iterator it = entries.find(k);
+		if (it != entries.end()) {
+			cat = it.value().category;
+		}
+		if (data.size() > quotas[cat] / constMaxEntryFraction) {
+			DBUG << "too large" << md.url().toString() << data.size();
+			if (it != entries.end()) {
+				removeEntry(it);
+			}
+			return false;
+		}
+
+		QDir().mkpath(dirName(cat));
+		QSaveFile f(fileName(cat, k));
+		if (!f.open(QIODevice::WriteOnly)) {
+			return false;
+		}
+		QDataStream stream(&f);
+		stream << constMagic << md << data;
+		if (QDataStream::Ok != stream.status() || !f.commit()) {
+			return false;
+		}
+
+		Entry e;
+		e.category = cat;
+		e.size = QFileInfo(fileName(cat, k)).size();
+		e.lastAccess = QDateTime::currentMSecsSinceEpoch();
+		if (it != entries.end()) {
+			sizes[cat] -= it.value().size;
+			it.value() = e;
+		}
+		else {
+			entries.insert(k, e);
+		}
+		sizes[cat] += e.size;
+		evict(cat, 0);
+		return true;
+	}
+
+	// Replace the meta-data of a stored response, keeping its body. Must be called with mutex locked.
+	void updateMetaData(const QNetworkCacheMetaData& md)
+	{
+		load();
+		QByteArray k = key(md.url());
+		QHash<QByteArray, Entry>::Iterator it = entries.find(k);
+		if (it == entries.end()) {
+			return;
+		}
+		QFile f(fileName(it.value().category, k));
+		if (!f.open(QIODevice::ReadOnly)) {
+			removeEntry(it);
+			return;
+		}
+		QDataStream stream(&f);
+		quint32 magic = 0;
+		QNetworkCacheMetaData old;
+		QByteArray data;
+		stream >> magic >> old >> data;
+		f.close();
+		if (constMagic != magic || QDataStream::Ok != stream.status()) {
+			removeEntry(it);
+			return;
+		}
+		write(it.value().category, md, data, true);
+	}
+
+	// Remove least recently used responses until the category has room for the given number of bytes. Must be
+	// called with mutex locked.
+	void evict(NetworkCache::Category cat, qint64 required)
+	{
+		while (sizes[cat] + required > quotas[cat]) {
+			QHash<QByteArray, Entry>::Iterator oldest = entries.end();
+			for (QHash<QByteArray, Entry>::Iterator it = entries.begin(), end = entries.end(); it != end; ++it) {
+				if (it.value().category == cat && (oldest == entries.end() || it.value().lastAccess < oldest.value().lastAccess)) {
+					oldest = it;
+				}
+			}
+			if (oldest == entries.end()) {
+				break;
+			}
+			DBUG << "evict" << NetworkCache::categoryName(cat) << oldest.key();
+			removeEntry(oldest);
+			stats[cat].evicted++;
+		}
+	}
+
+	// Must be called with mutex locked
+	void removeEntry(QHash<QByteArray, Entry>::Iterator it)
+	{
+		QFile::remove(fileName(it.value().category, it.key()));
+		sizes[it.value().category] -= it.value().size;
+		entries.erase(it);
+	}
+
+	bool remove(const QUrl& url)
+	{
+		load();
+		QHash<QByteArray, Entry>::Iterator it = entries.find(key(url));
+		if (it == entries.end()) {
+			return false;
+		}
+		removeEntry(it);
+		return true;
+	}
+
+	void clear()
+	{
+		load();
+		while (!entries.isEmpty()) {
+			removeEntry(entries.begin());
+		}
+	}
+
+	qint64 totalSize()
+	{
+		load();
+		qint64 total = 0;
+		for (int i = 0; i < NetworkCache::NumCategories; ++i) {
+			total += sizes[i];
+		}
+		return total;
+	}
+
+	QMutex mutex;
+	bool loaded;
+	QString baseDir;
+	QHash<QByteArray, Entry> entries;
+	qint64 sizes[NetworkCache::NumCategories];
+	qint64 quotas[NetworkCache::NumCategories];
+	NetworkCache::Stats stats[NetworkCache::NumCategories];
+};
+}// namespace
+
+static Store& store()
+{
+	static Store s;
+	return s;
+}
+
+const char* NetworkCache::categoryName(Category cat)
+{
+	switch (cat) {
+	case Context: return "context";
+	case Streams: return "streams";
+	case Podcasts: return "podcasts";
+	case Covers: return "covers";
+	default: return "other";
+	}
+}
+
+void NetworkCache::setCategory(QNetworkRequest& req, Category cat)
+{
+	req.setAttribute(constCategoryAttribute, (int)cat);
+}
+
+bool NetworkCache::hasCategory(const QNetworkRequest& req)
+{
+	return req.attribute(constCategoryAttribute).isValid();
+}
+
+void NetworkCache::setQuota(Category cat, qint64 bytes)
+{
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	s.quotas[cat] = bytes;
+	if (s.loaded) {
+		s.evict(cat, 0);
+	}
+}
+
+NetworkCache::Stats NetworkCache::stats(Category cat)
+{
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	Stats st = s.stats[cat];
+	st.size = s.sizes[cat];
+	st.quota = s.quotas[cat];
+	return st;
+}
+
+void NetworkCache::setDirectory(const QString& dir)
+{
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	s.baseDir = Utils::fixPath(dir);
+}
+
+NetworkCache::NetworkCache(QObject* parent)
+	: QAbstractNetworkCache(parent)
+{
+}
+
+NetworkCache::~NetworkCache()
+{
+	for (QIODevice* dev : pending.keys()) {
+		delete dev;
+	}
+}
+
+void NetworkCache::requested(const QNetworkRequest& req)
+{
+	QVariant cat = req.attribute(constCategoryAttribute);
+	if (cat.isValid()) {
+		// Entries are removed once a response is stored or served, but uncacheable responses leave theirs behind
+		if (categories.count() > 1000) {
+			categories.clear();
+		}
+		categories.insert(req.url(), (Category)cat.toInt());
+	}
+}
+
+QNetworkCacheMetaData NetworkCache::metaData(const QUrl& url)
+{
+	QNetworkCacheMetaData md;
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	if (!s.read(url, md, nullptr, false)) {
+		QHash<QUrl, Category>::ConstIterator it = categories.constFind(url);
+		if (it != categories.constEnd()) {
+			s.stats[it.value()].misses++;
+			perfCounters[it.value()].miss();
+		}
+		DBUG << "miss" << url.toString();
+		return QNetworkCacheMetaData();
+	}
+	return md;
+}
+
+void NetworkCache::updateMetaData(const QNetworkCacheMetaData& metaData)
+{
+	// Called when the server replies 304, or the response headers change
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	s.updateMetaData(metaData);
+	validated.insert(metaData.url());
+}
+
+QIODevice* NetworkCache::data(const QUrl& url)
+{
+	QNetworkCacheMetaData md;
+	QByteArray body;
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	if (!s.read(url, md, &body, true)) {
+		return nullptr;
+	}
+	QHash<QByteArray, Entry>::ConstIterator it = s.entries.constFind(Store::key(url));
+	if (it != s.entries.constEnd()) {
+		Category cat = it.value().category;
+		if (validated.remove(url)) {
+			s.stats[cat].validated++;
+			DBUG << "validated" << url.toString();
+		}
+		else {
+			s.stats[cat].hits++;
+			DBUG << "hit" << url.toString();
+		}
+		perfCounters[cat].hit();
+	}
+	categories.remove(url);
+
+	QBuffer* buffer = new QBuffer();
+	buffer->setData(body);
+	buffer->open(QIODevice::ReadOnly);
+	return buffer;
+}
+
+bool NetworkCache::remove(const QUrl& url)
+{
+	// Also used to discard a device returned by prepare(), if the reply fails
+	for (QHash<QIODevice*, Pending>::Iterator it = pending.begin(); it != pending.end();) {
+		if (it.value().metaData.url() == url) {
+			delete it.key();
+			it = pending.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	validated.remove(url);
+	return s.remove(url);
+}
+
+qint64 NetworkCache::cacheSize() const
+{
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	return s.totalSize();
+}
+
+QIODevice* NetworkCache::prepare(const QNetworkCacheMetaData& metaData)
+{
+	QHash<QUrl, Category>::Iterator it = categories.find(metaData.url());
+	if (it == categories.end() || !metaData.isValid() || !metaData.saveToDisk()) {
+		return nullptr;
+	}
+	Pending p;
+	p.metaData = metaData;
+	p.category = it.value();
+	categories.erase(it);
+
+	QBuffer* buffer = new QBuffer();
+	buffer->open(QIODevice::ReadWrite);
+	pending.insert(buffer, p);
+	return buffer;
+}
+
+void NetworkCache::insert(QIODevice* device)
+{
+	QHash<QIODevice*, Pending>::Iterator it = pending.find(device);
+	if (it == pending.end()) {
+		return;
+	}
+	QBuffer* buffer = static_cast<QBuffer*>(device);
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	if (s.write(it.value().category, it.value().metaData, buffer->data())) {
+		s.stats[it.value().category].stored++;
+		DBUG << "stored" << it.value().metaData.url().toString() << buffer->size();
+	}
+	pending.erase(it);
+	delete device;
+}
+
+void NetworkCache::clear()
+{
+	Store& s = store();
+	QMutexLocker locker(&s.mutex);
+	s.clear();
+}
+
+#include "moc_networkcache.cpp"
@@ -0,0 +1,103 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef NETWORK_CACHE_H
+#define NETWORK_CACHE_H
+
+#include <QAbstractNetworkCache>
+#include <QHash>
+#include <QNetworkRequest>
+#include <QSet>
+#include <QUrl>
+
+// HTTP response cache, shared by all NetworkAccessManager instances (in any thread). Responses are only
+// stored for requests that have been given a category, via setCategory(), and each category has its own
+// size quota - beyond which the least recently used responses are removed.
+//
+// Expiry and validation are handled by QNetworkAccessManager, i.e. fresh responses are served straight
+// from the cache, and stale ones are re-requested with If-None-Match/If-Modified-Since.
+class NetworkCache : public QAbstractNetworkCache {
+	Q_OBJECT
+
+public:
+	enum Category {
+		Context,
+		Streams,
+		Podcasts,
+		Covers,
+
+		NumCategories
+	};
+
+	struct Stats {
+		quint64 hits = 0;     // Served from the cache, without contacting the server
+		quint64 validated = 0;// Server confirmed that the cached response is still valid
+		quint64 misses = 0;   // Not cached, or the server returned a new response
+		quint64 stored = 0;
+		quint64 evicted = 0;
+		qint64 size = 0;
+		qint64 quota = 0;
+	};
+
+	static const QLatin1String constCacheDir;
+	static const QLatin1String constExt;
+	static const QNetworkRequest::Attribute constCategoryAttribute;
+
+	static void enableDebug();
+	static const char* categoryName(Category cat);
+	static void setCategory(QNetworkRequest& req, Category cat);
+	static bool hasCategory(const QNetworkRequest& req);
+	static void setQuota(Category cat, qint64 bytes);
+	static Stats stats(Category cat);
+	// Store responses somewhere other than the user's cache folder (e.g. for testing), must be
+	// called before any request is made.
+	static void setDirectory(const QString& dir);
+
+	NetworkCache(QObject* parent = nullptr);
+	~NetworkCache() override;
+
+	// Called as a request is made, so that its response is stored under the correct category
+	void requested(const QNetworkRequest& req);
+
+	QNetworkCacheMetaData metaData(const QUrl& url) override;
+	void updateMetaData(const QNetworkCacheMetaData& metaData) override;
+	QIODevice* data(const QUrl& url) override;
+	bool remove(const QUrl& url) override;
+	qint64 cacheSize() const override;
+	QIODevice* prepare(const QNetworkCacheMetaData& metaData) override;
+	void insert(QIODevice* device) override;
+
+public Q_SLOTS:
+	void clear() override;
+
+private:
+	struct Pending {
+		QNetworkCacheMetaData metaData;
+		Category category;
+	};
+	QHash<QUrl, Category> categories;
+	QHash<QIODevice*, Pending> pending;
+	QSet<QUrl> validated;
+};
+
+#endif
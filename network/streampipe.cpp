@@ -0,0 +1,137 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "streampipe.h"
+#include <string.h>
+
+StreamPipe::StreamPipe(qint64 lim, QObject* p)
+	: QIODevice(p), readPos(0), limit(lim), finished(false), aborted(false), full(false)
+{
+	// Unbuffered, as QIODevice's own buffer is not thread safe - and would double the memory used
+	open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+StreamPipe::~StreamPipe()
+{
+	abort();
+}
+
+qint64 StreamPipe::space() const
+{
+	QMutexLocker locker(&mutex);
+	qint64 avail = limit - (buffer.size() - readPos);
+	if (avail <= 0) {
+		full = true;
+		return 0;
+	}
+	return avail;
+}
+
+void StreamPipe::append(const QByteArray& data)
+{
+	if (data.isEmpty()) {
+		return;
+	}
+	QMutexLocker locker(&mutex);
+	if (finished || aborted) {
+		return;
+	}
+	if (readPos > 0 && readPos >= buffer.size() / 2) {
+		buffer.remove(0, readPos);
+		readPos = 0;
+	}
+	buffer.append(data);
+	dataAdded.wakeAll();
+}
+
+void StreamPipe::finish()
+{
+	QMutexLocker locker(&mutex);
+	finished = true;
+	dataAdded.wakeAll();
+}
+
+void StreamPipe::abort()
+{
+	QMutexLocker locker(&mutex);
+	aborted = true;
+	buffer.clear();
+	readPos = 0;
+	dataAdded.wakeAll();
+}
+
+bool StreamPipe::isAborted() const
+{
+	QMutexLocker locker(&mutex);
+	return aborted;
+}
+
+qint64 StreamPipe::bytesAvailable() const
+{
+	QMutexLocker locker(&mutex);
+	return buffer.size() - readPos;
+}
+
+bool StreamPipe::atEnd() const
+{
+	QMutexLocker locker(&mutex);
+	return aborted || (finished && readPos >= buffer.size());
+}
+
+qint64 StreamPipe::readData(char* data, qint64 maxlen)
+{
+	QMutexLocker locker(&mutex);
+	while (!aborted && !finished && readPos >= buffer.size()) {
+		dataAdded.wait(&mutex);
+	}
+	// An aborted stream is reported as having ended, and not as an error, as KCompressionDevice does
+	// not handle the underlying device failing. Callers should check isAborted().
+	if (aborted) {
+		return 0;
+	}
+
+	qint64 len = qMin(maxlen, (qint64)(buffer.size() - readPos));
+	if (len > 0) {
+		memcpy(data, buffer.constData() + readPos, len);
+		readPos += len;
+	}
+
+	bool notify = full && (buffer.size() - readPos) < limit / 2;
+	if (notify) {
+		full = false;
+	}
+	locker.unlock();
+	if (notify) {
+		emit spaceAvailable();
+	}
+	return len;
+}
+
+qint64 StreamPipe::writeData(const char* data, qint64 len)
+{
+	Q_UNUSED(data)
+	Q_UNUSED(len)
+	return -1;
+}
+
+#include "moc_streampipe.cpp"
@@ -0,0 +1,79 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef STREAM_PIPE_H
+#define STREAM_PIPE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Passes downloaded data to a consumer in another thread. Data is added, in the thread that owns the
+// download, via append() - and read, in the consumer's thread, via the usual QIODevice API. Reads block
+// until data is available, so that the consumer (e.g. KCompressionDevice and QXmlStreamReader) can
+// process the download as it arrives.
+//
+// At most limit bytes are held, once space() is 0 the writer should stop reading from the network
+// until spaceAvailable() is emitted. This keeps memory usage bounded if the consumer is slower than
+// the download.
+class StreamPipe : public QIODevice {
+	Q_OBJECT
+public:
+	StreamPipe(qint64 lim, QObject* p = nullptr);
+	~StreamPipe() override;
+
+	// Writer side
+	qint64 space() const;
+	void append(const QByteArray& data);
+	// No more data will be appended, reads return 0 once the buffer is empty
+	void finish();
+	// Download failed or was cancelled, any pending read returns at once
+	void abort();
+	bool isAborted() const;
+
+	// Reader side
+	bool isSequential() const override { return true; }
+	qint64 bytesAvailable() const override;
+	bool atEnd() const override;
+
+Q_SIGNALS:
+	// Emitted, from the reader's thread, when there is room for more data after space() has returned 0
+	void spaceAvailable();
+
+protected:
+	qint64 readData(char* data, qint64 maxlen) override;
+	qint64 writeData(const char* data, qint64 len) override;
+
+private:
+	mutable QMutex mutex;
+	QWaitCondition dataAdded;
+	QByteArray buffer;
+	int readPos;
+	qint64 limit;
+	bool finished;
+	bool aborted;
+	mutable bool full;// space() returned 0, so spaceAvailable() is wanted
+};
+
+#endif
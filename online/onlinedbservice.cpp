@@ -26,7 +26,9 @@
 #include "gui/covers.h"
 #include "models/roles.h"
 #include "network/networkaccessmanager.h"
-#include <QBuffer>
+#include "network/streampipe.h"
+#include "support/thread.h"
+#include <QNetworkReply>
 #include <QXmlStreamReader>
 #ifdef BUNDLED_KARCHIVE
 #include <kcompressiondevice.h>
@@ -34,62 +36,86 @@
 #include <KCompressionDevice>
 #endif
 
+// Maximum amount of compressed data held between the download and the parser, and in the network reply itself
+static const qint64 constStreamBufferSize = 1024 * 1024;
+
 OnlineXmlParser::OnlineXmlParser()
 {
 	thread = new Thread(metaObject()->className());
 	moveToThread(thread);
 	thread->start();
-	connect(this, SIGNAL(startParsing(NetworkJob*)), this, SLOT(doParsing(NetworkJob*)));
+	connect(this, SIGNAL(startParsing(QIODevice*)), this, SLOT(doParsing(QIODevice*)));
 }
 
 OnlineXmlParser::~OnlineXmlParser()
 {
 }
 
-void OnlineXmlParser::start(NetworkJob* job)
+void OnlineXmlParser::start(QIODevice* dev)
 {
-	emit startParsing(job);
+	emit startParsing(dev);
 }
 
-void OnlineXmlParser::doParsing(NetworkJob* job)
+void OnlineXmlParser::stop()
 {
-    QByteArray compressed = job->actualJob()->readAll();
-
-    QBuffer buffer(&compressed);
-    buffer.open(QIODevice::ReadOnly);
+	if (thread) {
+		thread->stop();
+		thread->wait();
+	}
+}
 
-    KCompressionDevice dev(&buffer, false, KCompressionDevice::GZip);
-    if (!dev.open(QIODevice::ReadOnly)) {
-        emit error(tr("Failed to parse"));
-        emit abortUpdate();
-        emit complete();
-        return;
-    }
+void OnlineXmlParser::doParsing(QIODevice* dev)
+{
+	KCompressionDevice gz(dev, false, KCompressionDevice::GZip);
+	if (!gz.open(QIODevice::ReadOnly)) {
+		emit error(tr("Failed to parse"));
+		emit abortUpdate();
+		emit complete();
+		return;
+	}
 
-    QByteArray decompressed = dev.readAll();
-    QXmlStreamReader reader(decompressed);
+	// Data is inflated and parsed as it is read, so neither the download nor the inflated listing is held in memory
+	QXmlStreamReader reader(&gz);
 
-    emit startUpdate();
+	emit startUpdate();
 
-    int artistCount = parse(reader);
+	int artistCount = parse(reader);
+	// If the download failed part way through, or was cancelled, then the listing will be truncated
+	bool truncated = QXmlStreamReader::PrematureEndOfDocumentError == reader.error();
+	StreamPipe* pipe = qobject_cast<StreamPipe*>(dev);
+	bool cancelled = pipe && pipe->isAborted();
 
-    if (artistCount > 0) {
-        emit endUpdate();
-        emit stats(artistCount);
-    } else {
-        emit error(tr("Failed to parse"));
-        emit abortUpdate();
-    }
+	if (artistCount > 0 && !truncated && !cancelled) {
+		emit endUpdate();
+		emit stats(artistCount);
+	}
+	else {
+		if (!cancelled) {
+			emit error(tr("Failed to parse"));
+		}
+		emit abortUpdate();
+	}
 
-    emit complete();
+	emit complete();
 }
 
 OnlineDbService::OnlineDbService(LibraryDb* d, QObject* p)
-	: SqlLibraryModel(d, p, T_Genre), lastPc(-1), job(nullptr)
+	: SqlLibraryModel(d, p, T_Genre), lastPc(-1), job(nullptr), jobFinished(false), parser(nullptr), pipe(nullptr)
 {
 	connect(Covers::self(), SIGNAL(cover(Song, QImage, QString)), this, SLOT(cover(Song, QImage, QString)));
 }
 
+OnlineDbService::~OnlineDbService()
+{
+	if (parser) {
+		// Parser may be blocked reading the pipe, so abort this - and wait for the parser to finish before the
+		// pipe (a child of this) is deleted.
+		pipe->abort();
+		parser->stop();
+		delete parser;
+	}
+}
+
 QVariant OnlineDbService::data(const QModelIndex& index, int role) const
 {
 	if (!index.isValid()) {
@@ -130,12 +156,14 @@ void OnlineDbService::open()
 
 void OnlineDbService::download(bool redownload)
 {
-	if (job) {
+	if (job || pipe) {
 		return;
 	}
 	if (redownload || !previouslyDownloaded()) {
 		job = NetworkAccessManager::self()->get(QUrl(listingUrl()));
+		jobFinished = false;
 		connect(job, SIGNAL(downloadPercent(int)), this, SLOT(downloadPercent(int)));
+		connect(job, SIGNAL(readyRead()), this, SLOT(downloadData()));
 		connect(job, SIGNAL(finished()), this, SLOT(downloadFinished()));
 		lastPc = -1;
 		downloadPercent(0);
@@ -148,7 +176,13 @@ void OnlineDbService::abort()
 		job->cancelAndDelete();
 		job = nullptr;
 	}
-	db->abortUpdate();
+	if (pipe) {
+		// Parser will stop, and roll back the update, once it reads the end of the pipe
+		pipe->abort();
+	}
+	else {
+		db->abortUpdate();
+	}
 }
 
 void OnlineDbService::cover(const Song& song, const QImage& img, const QString& file)
@@ -184,6 +218,37 @@ void OnlineDbService::downloadPercent(int pc)
 	}
 }
 
+// Pass as much of the download to the parser as it has room for. QNetworkReply's read buffer is also limited, so
+// when the parser falls behind the download is paused - until the parser signals that it has space again.
+void OnlineDbService::downloadData()
+{
+	if (!job) {
+		return;
+	}
+	if (!pipe) {
+		QVariant status = job->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+		if (!job->ok() || (status.isValid() && status.toInt() >= 400)) {
+			// Error pages are not parsed, downloadFinished() reports the failure
+			return;
+		}
+		startParser();
+	}
+	if (job->actualJob()) {
+		job->actualJob()->setReadBufferSize(constStreamBufferSize);
+	}
+
+	for (qint64 space = pipe->space(); space > 0 && job->bytesAvailable() > 0; space = pipe->space()) {
+		pipe->append(job->read(space));
+	}
+
+	if (jobFinished && job->bytesAvailable() <= 0) {
+		pipe->finish();
+		job->deleteLater();
+		job = nullptr;
+		updateStatus(tr("Parsing music list...."));
+	}
+}
+
 void OnlineDbService::downloadFinished()
 {
 	NetworkJob* reply = qobject_cast<NetworkJob*>(sender());
@@ -197,29 +262,60 @@ void OnlineDbService::downloadFinished()
 	}
 
 	if (reply->ok()) {
-		// Ensure DB is created
-		static_cast<OnlineDb*>(db)->create();
-		updateStatus(tr("Parsing music list...."));
-		OnlineXmlParser* parser = createParser();
-		db->clear();
-		connect(parser, SIGNAL(startUpdate()), static_cast<OnlineDb*>(db), SLOT(startUpdate()));
-		connect(parser, SIGNAL(endUpdate()), static_cast<OnlineDb*>(db), SLOT(endUpdate()));
-		connect(parser, SIGNAL(abortUpdate()), static_cast<OnlineDb*>(db), SLOT(abortUpdate()));
-		connect(parser, SIGNAL(stats(int)), static_cast<OnlineDb*>(db), SLOT(insertStats(int)));
-		connect(parser, SIGNAL(coverUrl(QString, QString, QString)), static_cast<OnlineDb*>(db), SLOT(storeCoverUrl(QString, QString, QString)));
-		connect(parser, SIGNAL(songs(QList<Song>*)), static_cast<OnlineDb*>(db), SLOT(insertSongs(QList<Song>*)));
-		connect(parser, SIGNAL(complete()), job, SLOT(deleteLater()));
-		connect(parser, SIGNAL(complete()), this, SLOT(updateStats()));
-		connect(parser, SIGNAL(error(QString)), this, SIGNAL(error(QString)));
-		connect(parser, SIGNAL(complete()), parser, SLOT(deleteLater()));
-		parser->start(reply);
+		jobFinished = true;
+		// Pass on whatever the parser has not yet been given, or start it now if the listing arrived all at once
+		downloadData();
+		return;
+	}
+
+	reply->deleteLater();
+	job = nullptr;
+	if (pipe) {
+		pipe->abort();
 	}
 	else {
-		reply->deleteLater();
 		updateStatus(QString());
-		emit error(tr("Failed to download"));
 	}
-	job = nullptr;
+	emit error(tr("Failed to download"));
+}
+
+void OnlineDbService::startParser()
+{
+	// Ensure DB is created
+	static_cast<OnlineDb*>(db)->create();
+	parser = createParser();
+	db->clear();
+	pipe = new StreamPipe(constStreamBufferSize, this);
+	connect(pipe, SIGNAL(spaceAvailable()), this, SLOT(downloadData()), Qt::QueuedConnection);
+	connect(parser, SIGNAL(startUpdate()), static_cast<OnlineDb*>(db), SLOT(startUpdate()));
+	connect(parser, SIGNAL(endUpdate()), static_cast<OnlineDb*>(db), SLOT(endUpdate()));
+	connect(parser, SIGNAL(abortUpdate()), static_cast<OnlineDb*>(db), SLOT(cancelUpdate()));
+	connect(parser, SIGNAL(stats(int)), static_cast<OnlineDb*>(db), SLOT(insertStats(int)));
+	connect(parser, SIGNAL(coverUrl(QString, QString, QString)), static_cast<OnlineDb*>(db), SLOT(storeCoverUrl(QString, QString, QString)));
+	connect(parser, SIGNAL(songs(QList<Song>*)), static_cast<OnlineDb*>(db), SLOT(storeSongs(QList<Song>*)));
+	connect(parser, SIGNAL(complete()), this, SLOT(parsingComplete()));
+	connect(parser, SIGNAL(error(QString)), this, SIGNAL(error(QString)));
+	parser->start(pipe);
+}
+
+void OnlineDbService::parsingComplete()
+{
+	if (job) {
+		// Parser gave up before the download finished
+		job->cancelAndDelete();
+		job = nullptr;
+	}
+	if (parser) {
+		// complete() is the parser's last signal, so this will not wait long
+		parser->stop();
+		delete parser;
+		parser = nullptr;
+	}
+	if (pipe) {
+		pipe->deleteLater();
+		pipe = nullptr;
+	}
+	updateStats();
 }
 
 void OnlineDbService::updateStats()
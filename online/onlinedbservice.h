@@ -26,9 +26,12 @@
 
 #include "models/sqllibrarymodel.h"
 #include "onlineservice.h"
+#include <QPointer>
 
 class NetworkJob;
+class StreamPipe;
 class Thread;
+class QIODevice;
 class QXmlStreamReader;
 struct Song;
 
@@ -37,7 +40,10 @@ class OnlineXmlParser : public QObject {
 public:
 	OnlineXmlParser();
 	~OnlineXmlParser() override;
-	void start(NetworkJob* job);
+	// Parse the gzip compressed listing read from dev. Reading blocks, so this happens in the parser's thread.
+	void start(QIODevice* dev);
+	// Wait for parsing to end, and stop the thread. The device must have been finished, or aborted, first.
+	void stop();
 	virtual int parse(QXmlStreamReader& xml) = 0;
 Q_SIGNALS:
 	void songs(QList<Song>* s);
@@ -48,20 +54,20 @@ Q_SIGNALS:
 	void stats(int numArtists);
 	void complete();
 	void error(const QString& msg);
-	void startParsing(NetworkJob* job);
+	void startParsing(QIODevice* dev);
 
 private Q_SLOTS:
-	void doParsing(NetworkJob* job);
+	void doParsing(QIODevice* dev);
 
 private:
-	Thread* thread;
+	QPointer<Thread> thread;// ThreadCleaner::stopAll() deletes the thread on exit
 };
 
 class OnlineDbService : public SqlLibraryModel, public OnlineService {
 	Q_OBJECT
 public:
 	OnlineDbService(LibraryDb* d, QObject* p);
-	~OnlineDbService() override {}
+	~OnlineDbService() override;
 
 	void createDb();
 	QVariant data(const QModelIndex& index, int role) const override;
@@ -84,14 +90,22 @@ private Q_SLOTS:
 	void cover(const Song& song, const QImage& img, const QString& file);
 	void updateStatus(const QString& msg);
 	void downloadPercent(int pc);
+	void downloadData();
 	void downloadFinished();
+	void parsingComplete();
 	void updateStats();
 
+private:
+	void startParser();
+
 protected:
 	int lastPc;
 	QString status;
 	QString stats;
 	NetworkJob* job;
+	bool jobFinished;
+	OnlineXmlParser* parser;
+	StreamPipe* pipe;
 };
 
 #endif
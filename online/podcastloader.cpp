@@ -0,0 +1,129 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "podcastloader.h"
+#include "support/thread.h"
+#include <QDir>
+#include <QFile>
+
+PodcastLoader::PodcastLoader()
+	: QObject(nullptr), latest(0)
+{
+	qRegisterMetaType<PodcastService::Podcast*>("PodcastService::Podcast*");
+	thread = new Thread(metaObject()->className());
+	moveToThread(thread);
+	thread->start();
+	connect(this, SIGNAL(startLoad(QString, QString, quint32)), this, SLOT(doLoad(QString, QString, quint32)), Qt::QueuedConnection);
+	connect(this, SIGNAL(writeRequested()), this, SLOT(writePending()), Qt::QueuedConnection);
+}
+
+PodcastLoader::~PodcastLoader()
+{
+	qDeleteAll(toSave);
+}
+
+void PodcastLoader::load(const QString& dir, const QString& downloadPath, quint32 generation)
+{
+	latest.storeRelease(generation);
+	emit startLoad(dir, downloadPath, generation);
+}
+
+void PodcastLoader::save(PodcastService::Podcast* podcast)
+{
+	QMutexLocker locker(&mutex);
+	bool wasEmpty = toSave.isEmpty() && toRemove.isEmpty();
+	delete toSave.take(podcast->fileName);
+	toSave.insert(podcast->fileName, podcast);
+	toRemove.remove(podcast->fileName);
+	if (wasEmpty) {
+		emit writeRequested();
+	}
+}
+
+void PodcastLoader::remove(const QString& fileName, const QString& imageFile)
+{
+	QMutexLocker locker(&mutex);
+	bool wasEmpty = toSave.isEmpty() && toRemove.isEmpty();
+	delete toSave.take(fileName);
+	toRemove.insert(fileName, imageFile);
+	if (wasEmpty) {
+		emit writeRequested();
+	}
+}
+
+void PodcastLoader::stop()
+{
+	// Once the thread has finished any outstanding changes can be written from the calling thread
+	thread->stop();
+	thread->wait();
+	writePending();
+}
+
+void PodcastLoader::doLoad(const QString& dir, const QString& downloadPath, quint32 generation)
+{
+	if (isStale(generation)) {
+		return;
+	}
+
+	QStringList entries = QDir(dir).entryList(QStringList() << QLatin1Char('*') + PodcastService::constFileExt, QDir::Files | QDir::Readable | QDir::NoDot | QDir::NoDotDot);
+	PodcastService::LocalFiles localFiles;
+	for (const QString& e : entries) {
+		if (isStale(generation)) {
+			return;
+		}
+		PodcastService::Podcast* podcast = new PodcastService::Podcast(dir + e);
+		if (podcast->load(downloadPath, localFiles)) {
+			emit loaded(generation, podcast);
+		}
+		else {
+			delete podcast;
+		}
+	}
+	emit finished(generation);
+}
+
+void PodcastLoader::writePending()
+{
+	mutex.lock();
+	QMap<QString, PodcastService::Podcast*> saves = toSave;
+	QMap<QString, QString> removals = toRemove;
+	toSave.clear();
+	toRemove.clear();
+	mutex.unlock();
+
+	for (PodcastService::Podcast* podcast : saves) {
+		podcast->save();
+	}
+	qDeleteAll(saves);
+
+	for (auto it = removals.constBegin(), end = removals.constEnd(); it != end; ++it) {
+		if (QFile::exists(it.key())) {
+			QFile::remove(it.key());
+		}
+		if (!it.value().isEmpty() && QFile::exists(it.value())) {
+			QFile::remove(it.value());
+		}
+	}
+}
+
+#include "moc_podcastloader.cpp"
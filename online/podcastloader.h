@@ -0,0 +1,80 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PODCAST_LOADER_H
+#define PODCAST_LOADER_H
+
+#include "podcastservice.h"
+#include <QAtomicInteger>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+
+class Thread;
+
+// Reads, and writes, PodcastService's podcast files on a separate thread.
+//
+// Podcasts are loaded one at a time, and passed back via loaded() as each is read, so that the
+// model can be filled in feed by feed. Saves are given a copy of the podcast, and queued - if a
+// podcast is saved again before the earlier save has been written, only the latest copy is
+// written.
+class PodcastLoader : public QObject {
+	Q_OBJECT
+
+public:
+	PodcastLoader();
+	~PodcastLoader() override;
+
+	// Load all podcast files in dir. Any earlier load that has not yet completed is dropped.
+	void load(const QString& dir, const QString& downloadPath, quint32 generation);
+	// Drop any outstanding load
+	void cancel(quint32 generation) { latest.storeRelease(generation); }
+	// Takes ownership of podcast, which must be a copy not referenced by the model
+	void save(PodcastService::Podcast* podcast);
+	void remove(const QString& fileName, const QString& imageFile);
+	// Stop the thread, and then write out any outstanding changes
+	void stop();
+
+Q_SIGNALS:
+	// Receiver takes ownership of podcast
+	void loaded(quint32 generation, PodcastService::Podcast* podcast);
+	void finished(quint32 generation);
+	void startLoad(const QString& dir, const QString& downloadPath, quint32 generation);
+	void writeRequested();
+
+private Q_SLOTS:
+	void doLoad(const QString& dir, const QString& downloadPath, quint32 generation);
+	void writePending();
+
+private:
+	bool isStale(quint32 generation) const { return generation != latest.loadAcquire(); }
+
+private:
+	Thread* thread;
+	QAtomicInteger<quint32> latest;
+	QMutex mutex;
+	QMap<QString, PodcastService::Podcast*> toSave;// Keyed on file name
+	QMap<QString, QString> toRemove;               // File name to image file
+};
+
+#endif
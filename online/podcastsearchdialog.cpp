@@ -161,7 +161,7 @@ void PodcastPage::fetch(const QUrl& url)
 	cancel();
 	tree->clear();
 	spinner->start();
-	job = NetworkAccessManager::self()->get(url);
+	job = NetworkAccessManager::self()->getCached(url, NetworkCache::Podcasts);
 	connect(job, SIGNAL(finished()), this, SLOT(jobFinished()));
 }
 
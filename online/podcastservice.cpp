@@ -22,6 +22,7 @@
  */
 
 #include "podcastservice.h"
+#include "podcastloader.h"
 #include "config.h"
 #include "gui/settings.h"
 #include "gui/stdactions.h"
@@ -146,7 +147,7 @@ bool PodcastService::Proxy::filterAcceptsRow(int sourceRow, const QModelIndex& s
 }
 
 const QLatin1String PodcastService::constName("podcasts");
-static const QLatin1String constExt(".xml.gz");
+const QLatin1String PodcastService::constFileExt(".xml.gz");
 static const char* constNewFeedProperty = "new-feed";
 static const char* constRssUrlProperty = "rss-url";
 static const char* constDestProperty = "dest";
@@ -156,12 +157,12 @@ static QString generateFileName(const QUrl& url, bool creatingNew)
 {
 	QString hash = QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Md5).toHex();
 	QString dir = Utils::dataDir(PodcastService::constName, true);
-	QString fileName = dir + hash + constExt;
+	QString fileName = dir + hash + PodcastService::constFileExt;
 
 	if (creatingNew) {
 		int i = 0;
 		while (QFile::exists(fileName) && i < 100) {
-			fileName = dir + hash + QChar('_') + QString::number(i) + constExt;
+			fileName = dir + hash + QChar('_') + QString::number(i) + PodcastService::constFileExt;
 			i++;
 		}
 	}
@@ -237,7 +238,7 @@ Song PodcastService::Episode::toSong() const
 PodcastService::Podcast::Podcast(const QString& f)
 	: unplayedCount(0), fileName(f), imageFile(f)
 {
-	imageFile = imageFile.replace(constExt, ".jpg");
+	imageFile = imageFile.replace(constFileExt, ".jpg");
 }
 
 static QLatin1String constTopTag("podcast");
@@ -253,7 +254,26 @@ static QLatin1String constPlayedAttribute("played");
 static QLatin1String constLocalAttribute("local");
 static QLatin1String constTrue("true");
 
-bool PodcastService::Podcast::load()
+bool PodcastService::LocalFiles::exists(const QString& file)
+{
+	int pos = file.lastIndexOf(Utils::constDirSep);
+	if (pos < 0) {
+		return QFile::exists(file);
+	}
+
+	QString dir = file.left(pos + 1);
+	QHash<QString, QSet<QString> >::ConstIterator it = dirs.constFind(dir);
+	if (it == dirs.constEnd()) {
+		QSet<QString> names;
+		for (const QString& name : QDir(dir).entryList(QDir::Files | QDir::Hidden | QDir::System)) {
+			names.insert(name);
+		}
+		it = dirs.insert(dir, names);
+	}
+	return it.value().contains(file.mid(pos + 1));
+}
+
+bool PodcastService::Podcast::load(const QString& downloadPath, LocalFiles& localFiles)
 {
 	if (fileName.isEmpty()) {
 		return false;
@@ -267,7 +287,7 @@ bool PodcastService::Podcast::load()
 	QXmlStreamReader reader(&file);
 	unplayedCount = 0;
 
-	QString podPath = Settings::self()->podcastDownloadPath();
+	QString podPath = downloadPath;
 	while (!reader.atEnd()) {
 		reader.readNext();
 		if (!reader.error() && reader.isStartElement()) {
@@ -297,12 +317,12 @@ bool PodcastService::Podcast::load()
 					ep->duration = time.isEmpty() ? 0 : time.toUInt();
 					ep->played = constTrue == attributes.value(constPlayedAttribute).toString();
 					ep->descr = attributes.value(constDescrAttribute).toString();
-					if (!localFile.isEmpty() && QFile::exists(localFile)) {
+					if (!localFile.isEmpty() && localFiles.exists(localFile)) {
 						ep->localFile = localFile;
 					}
 					else if (!podPath.isEmpty()) {
 						QString localPath = podPath + episodeFileName(ep->url);
-						if (QFile::exists(localPath)) {
+						if (localFiles.exists(localPath)) {
 							ep->localFile = localPath;
 						}
 					}
@@ -359,6 +379,23 @@ bool PodcastService::Podcast::save() const
 	return true;
 }
 
+PodcastService::Podcast* PodcastService::Podcast::snapshot() const
+{
+	Podcast* copy = new Podcast(fileName);
+	copy->name = name;
+	copy->descr = descr;
+	copy->url = url;
+	copy->imageFile = imageFile;
+	copy->imageUrl = imageUrl;
+	copy->unplayedCount = unplayedCount;
+	for (const Episode* ep : episodes) {
+		Episode* e = new Episode(*ep);
+		e->parent = copy;
+		copy->episodes.append(e);
+	}
+	return copy;
+}
+
 void PodcastService::Podcast::add(Episode* ep)
 {
 	ep->parent = this;
@@ -393,16 +430,6 @@ void PodcastService::Podcast::setUnplayedCount()
 	}
 }
 
-void PodcastService::Podcast::removeFiles()
-{
-	if (!fileName.isEmpty() && QFile::exists(fileName)) {
-		QFile::remove(fileName);
-	}
-	if (!imageFile.isEmpty() && QFile::exists(imageFile)) {
-		QFile::remove(imageFile);
-	}
-}
-
 const Song& PodcastService::Podcast::coverSong()
 {
 	if (song.isEmpty()) {
@@ -419,8 +446,15 @@ const Song& PodcastService::Podcast::coverSong()
 }
 
 PodcastService::PodcastService()
-	: ActionModel(nullptr), downloadJob(nullptr), rssUpdateTimer(nullptr)
-{
+	: ActionModel(nullptr), downloadJob(nullptr), rssUpdateTimer(nullptr), loadGeneration(0)
+{
+	loader = new PodcastLoader();
+	connect(loader, SIGNAL(loaded(quint32, PodcastService::Podcast*)), this, SLOT(podcastLoaded(quint32, PodcastService::Podcast*)));
+	connect(loader, SIGNAL(finished(quint32)), this, SLOT(loadFinished(quint32)));
+	saveTimer = new QTimer(this);
+	saveTimer->setSingleShot(true);
+	saveTimer->setInterval(500);
+	connect(saveTimer, SIGNAL(timeout()), this, SLOT(saveModified()));
 	QMetaObject::invokeMethod(this, "loadAll", Qt::QueuedConnection);
 	icn = Icon::fa(fa::fa_solid, fa::fa_rss_square);
 	useCovers(name(), true);
@@ -739,6 +773,8 @@ Song& PodcastService::fixPath(Song& song) const
 void PodcastService::clear()
 {
 	cancelAllJobs();
+	saveModified();
+	loader->cancel(++loadGeneration);
 	beginResetModel();
 	qDeleteAll(podcasts);
 	podcasts.clear();
@@ -748,25 +784,55 @@ void PodcastService::clear()
 
 void PodcastService::loadAll()
 {
-	beginResetModel();
 	QString dir = Utils::dataDir(constName);
 
 	if (!dir.isEmpty()) {
-		QDir d(dir);
-		QStringList entries = d.entryList(QStringList() << "*" + constExt, QDir::Files | QDir::Readable | QDir::NoDot | QDir::NoDotDot);
-		for (const QString& e : entries) {
-			Podcast* podcast = new Podcast(dir + e);
-			if (podcast->load()) {
-				podcasts.append(podcast);
-			}
-			else {
-				delete podcast;
-			}
-		}
+		// Podcasts are read on the loader's thread, and added to the model as each is loaded
+		loader->load(dir, Settings::self()->podcastDownloadPath(), ++loadGeneration);
+	}
+}
+
+void PodcastService::podcastLoaded(quint32 generation, PodcastService::Podcast* podcast)
+{
+	// May have subscribed to this podcast whilst loading
+	if (generation != loadGeneration || getPodcast(podcast->url)) {
+		delete podcast;
+		return;
+	}
+	beginInsertRows(QModelIndex(), podcasts.count(), podcasts.count());
+	podcasts.append(podcast);
+	endInsertRows();
+}
+
+void PodcastService::loadFinished(quint32 generation)
+{
+	if (generation == loadGeneration) {
 		startRssUpdateTimer();
+		emit dataChanged(QModelIndex(), QModelIndex());
 	}
-	endResetModel();
-	emit dataChanged(QModelIndex(), QModelIndex());
+}
+
+void PodcastService::saveLater(Podcast* pod)
+{
+	unsaved.insert(pod);
+	if (!saveTimer->isActive()) {
+		saveTimer->start();
+	}
+}
+
+void PodcastService::saveModified()
+{
+	saveTimer->stop();
+	for (Podcast* pod : unsaved) {
+		loader->save(pod->snapshot());
+	}
+	unsaved.clear();
+}
+
+void PodcastService::stop()
+{
+	saveModified();
+	loader->stop();
 }
 
 void PodcastService::cancelAll()
@@ -828,7 +894,7 @@ void PodcastService::rssJobFinished()
 			Podcast* podcast = new Podcast();
 			podcast->url = j->origUrl();
 			podcast->fileName = podcast->imageFile = generateFileName(podcast->url, true);
-			podcast->imageFile = podcast->imageFile.replace(constExt, ".jpg");
+			podcast->imageFile = podcast->imageFile.replace(constFileExt, ".jpg");
 			podcast->imageUrl = ch.image.toString();
 			podcast->name = ch.name;
 			podcast->descr = ch.description;
@@ -838,6 +904,7 @@ void PodcastService::rssJobFinished()
 			if (!podPath.isEmpty()) {
 				podPath = Utils::fixPath(podPath) + Utils::fixPath(encodeName(podcast->name));
 			}
+			LocalFiles localFiles;
 
 			for (const RssParser::Episode& ep : ch.episodes) {
 				Episode* episode = new Episode(ep.publicationDate, ep.name, ep.url, podcast);
@@ -846,13 +913,13 @@ void PodcastService::rssJobFinished()
 				if (!podPath.isEmpty()) {
 					// Check if we had subscribed to this before, and downloaded episodes...
 					QString localPath = podPath + episodeFileName(episode->url);
-					if (QFile::exists(localPath)) {
+					if (localFiles.exists(localPath)) {
 						episode->localFile = localPath;
 					}
 				}
 				podcast->add(episode);
 			}
-			podcast->save();
+			saveLater(podcast);
 			beginInsertRows(QModelIndex(), podcasts.count(), podcasts.count());
 			podcasts.append(podcast);
 			emit dataChanged(QModelIndex(), QModelIndex());
@@ -915,7 +982,7 @@ void PodcastService::rssJobFinished()
 				}
 
 				podcast->setUnplayedCount();
-				podcast->save();
+				saveLater(podcast);
 				emit dataChanged(podcastIndex, podcastIndex);
 			}
 		}
@@ -961,7 +1028,8 @@ void PodcastService::unSubscribe(Podcast* podcast)
 		}
 		cancelDownloads(episodes);
 		beginRemoveRows(QModelIndex(), row, row);
-		podcast->removeFiles();
+		unsaved.remove(podcast);
+		loader->remove(podcast->fileName, podcast->imageFile);
 		delete podcasts.takeAt(row);
 		endRemoveRows();
 		emit dataChanged(QModelIndex(), QModelIndex());
@@ -1014,7 +1082,7 @@ bool PodcastService::processingUrl(const QUrl& url) const
 
 void PodcastService::addUrl(const QUrl& url, bool isNew)
 {
-	NetworkJob* job = NetworkAccessManager::self()->get(url);
+	NetworkJob* job = NetworkAccessManager::self()->getCached(url, NetworkCache::Podcasts);
 	connect(job, SIGNAL(finished()), this, SLOT(rssJobFinished()));
 	job->setProperty(constNewFeedProperty, isNew);
 	rssJobs.append(job);
@@ -1072,7 +1140,7 @@ void PodcastService::deleteDownloadedPodcasts(Podcast* pod, const QList<Episode*
 	if (modified) {
 		QModelIndex idx = createIndex(podcasts.indexOf(pod), 0, (void*)pod);
 		emit dataChanged(idx, idx);
-		pod->save();
+		saveLater(pod);
 	}
 }
 
@@ -1096,7 +1164,7 @@ void PodcastService::setPodcastsAsListened(Podcast* pod, const QList<Episode*>&
 	if (modified) {
 		QModelIndex idx = createIndex(podcasts.indexOf(pod), 0, (void*)pod);
 		emit dataChanged(idx, idx);
-		pod->save();
+		saveLater(pod);
 	}
 }
 
@@ -1241,7 +1309,7 @@ void PodcastService::downloadJobFinished()
 					Episode* episode = pod->getEpisode(job->origUrl());
 					if (episode) {
 						episode->localFile = dest;
-						pod->save();
+						saveLater(pod);
 						QModelIndex idx = createIndex(pod->episodes.indexOf(episode), 0, (void*)episode);
 						emit dataChanged(idx, idx);
 					}
@@ -1395,7 +1463,7 @@ void PodcastService::currentMpdSong(const Song& s)
 						QModelIndex idx = createIndex(podcast->episodes.indexOf(episode), 0, (void*)episode);
 						emit dataChanged(idx, idx);
 						podcast->unplayedCount--;
-						podcast->save();
+						saveLater(podcast);
 						idx = createIndex(podcasts.indexOf(podcast), 0, (void*)podcast);
 						emit dataChanged(idx, idx);
 					}
@@ -29,6 +29,7 @@
 #include "mpd-interface/song.h"
 #include "onlineservice.h"
 #include <QDateTime>
+#include <QHash>
 #include <QLatin1String>
 #include <QList>
 #include <QSet>
@@ -36,6 +37,7 @@
 
 class QTimer;
 class NetworkJob;
+class PodcastLoader;
 
 class PodcastService : public ActionModel, public OnlineService {
 	Q_OBJECT
@@ -50,6 +52,15 @@ public:
 		QUrl url;
 	};
 
+	// Checks for downloaded episodes, listing each folder once rather than checking each file
+	class LocalFiles {
+	public:
+		bool exists(const QString& file);
+
+	private:
+		QHash<QString, QSet<QString> > dirs;
+	};
+
 	struct Podcast;
 	struct Episode : public Item {
 		enum DownloadState {
@@ -73,13 +84,14 @@ public:
 		Podcast(const QString& f = QString());
 		~Podcast() override { qDeleteAll(episodes); }
 		bool isPodcast() const override { return true; }
-		bool load();
+		bool load(const QString& downloadPath, LocalFiles& localFiles);
 		bool save() const;
+		// Deep copy, so that the podcast can be saved on another thread
+		Podcast* snapshot() const;
 		void add(Episode* ep);
 		void add(QList<Episode*>& eps);
 		Episode* getEpisode(const QUrl& epUrl) const;
 		void setUnplayedCount();
-		void removeFiles();
 		const Song& coverSong();
 
 		QList<Episode*> episodes;
@@ -107,6 +119,7 @@ public:
 	};
 
 	static const QLatin1String constName;
+	static const QLatin1String constFileExt;
 
 	static PodcastService* self();
 
@@ -165,6 +178,8 @@ public:
 	void startRssUpdateTimer();
 	void stopRssUpdateTimer();
 	bool exportSubscriptions(const QString& name);
+	// Write any unsaved changes, called on exit
+	void stop();
 	Action* refreshAct() { return refreshAction; }
 
 Q_SIGNALS:
@@ -180,9 +195,13 @@ private:
 	void doNextDownload();
 	void updateEpisode(const QUrl& rssUrl, const QUrl& url, int pc);
 	void clearPartialDownloads();
+	void saveLater(Podcast* pod);
 
 private Q_SLOTS:
 	void loadAll();
+	void podcastLoaded(quint32 generation, PodcastService::Podcast* podcast);
+	void loadFinished(quint32 generation);
+	void saveModified();
 	void rssJobFinished();
 	void updateRss();
 	void currentMpdSong(const Song& s);
@@ -209,6 +228,10 @@ private:
 	QDateTime lastDelete;
 	QSet<QUrl> updateUrls;
 	Action* refreshAction;
+	PodcastLoader* loader;
+	quint32 loadGeneration;
+	QSet<Podcast*> unsaved;// Podcasts with changes not yet passed to loader
+	QTimer* saveTimer;
 	static QString iconFile;
 };
 
@@ -26,16 +26,41 @@
 #include <QApplication>
 #include <QProcess>
 
-AlbumScanner::AlbumScanner(const QMap<int, QString>& files)
-	: proc(0)
+const QString AlbumScanner::constCacheDir = QLatin1String("replaygain");
+
+static QString cacheFile()
 {
-	QMap<int, QString>::ConstIterator it = files.constBegin();
-	QMap<int, QString>::ConstIterator end = files.constEnd();
+	return Utils::cacheDir(AlbumScanner::constCacheDir, true) + QLatin1String("scans.cache");
+}
 
-	for (int i = 0; it != end; ++it, ++i) {
-		fileNames.append(it.value());
-		trackIndexMap[i] = it.key();
+// Albums are passed one file per line, separated by an empty line
+static void writeAlbums(QProcess* proc, const QList<QMap<int, QString>>& albums)
+{
+	for (const QMap<int, QString>& album : albums) {
+		for (const QString& file : album) {
+			proc->write(file.toUtf8() + '\n');
+		}
+		proc->write("\n");
+	}
+	proc->closeWriteChannel();
+}
+
+void AlbumScanner::refreshCache(const QList<QMap<int, QString>>& albumFiles)
+{
+	if (albumFiles.isEmpty()) {
+		return;
 	}
+	QProcess* proc = new QProcess(QApplication::instance());
+	connect(proc, SIGNAL(finished(int)), proc, SLOT(deleteLater()));
+	connect(proc, SIGNAL(errorOccurred(QProcess::ProcessError)), proc, SLOT(deleteLater()));
+	proc->start(Utils::helper(QLatin1String("cantata-replaygain")), QStringList() << QLatin1String("--cache") << cacheFile() << QLatin1String("--refresh"),
+	            QProcess::WriteOnly);
+	writeAlbums(proc, albumFiles);
+}
+
+AlbumScanner::AlbumScanner(const QList<QMap<int, QString>>& albumFiles)
+	: proc(0), albums(albumFiles)
+{
 }
 
 AlbumScanner::~AlbumScanner()
@@ -43,6 +68,20 @@ AlbumScanner::~AlbumScanner()
 	stop();
 }
 
+QMap<int, AlbumScanner::Values> AlbumScanner::tracks(int album) const
+{
+	// Map the scanner's track numbers back to the caller's indexes
+	QMap<int, Values> vals;
+	if (album >= 0 && album < albums.count()) {
+		QList<int> indexes = albums.at(album).keys();
+		const QMap<int, Values>& scanned = trackValues[album];
+		for (int i = 0; i < indexes.count(); ++i) {
+			vals.insert(indexes.at(i), scanned.value(i));
+		}
+	}
+	return vals;
+}
+
 void AlbumScanner::start()
 {
 	if (!proc) {
@@ -51,7 +90,9 @@ void AlbumScanner::start()
 		proc->setReadChannel(QProcess::StandardOutput);
 		connect(proc, SIGNAL(finished(int)), this, SLOT(procFinished()));
 		connect(proc, SIGNAL(readyReadStandardOutput()), this, SLOT(read()));
-		proc->start(Utils::helper(QLatin1String("cantata-replaygain")), fileNames, QProcess::ReadOnly);
+		proc->start(Utils::helper(QLatin1String("cantata-replaygain")), QStringList() << QLatin1String("--cache") << cacheFile() << QLatin1String("--albums"),
+		            QProcess::ReadWrite);
+		writeAlbums(proc, albums);
 	}
 }
 
@@ -76,36 +117,37 @@ void AlbumScanner::read()
 		return;
 	}
 
-	QString output = proc->readAllStandardOutput().data();
-	if (output.isEmpty()) {
-		return;
-	}
-
-	QStringList lines = output.split("\n", CANTATA_SKIP_EMPTY);
-
-	for (const QString& line : lines) {
+	while (proc->canReadLine()) {
+		QString line = QString::fromUtf8(proc->readLine()).trimmed();
 		if (line.startsWith(constProgLine)) {
 			emit progress(line.mid(constProgLine.length()).toUInt());
 		}
 		else if (line.startsWith(constTrackLine)) {
+			// TRACK: <album> <track> <gain> <peak>
 			QStringList parts = line.mid(constTrackLine.length()).split(" ", CANTATA_SKIP_EMPTY);
-			if (!parts.isEmpty()) {
-				int num = parts[0].toUInt();
+			if (parts.length() >= 2) {
 				Values vals;
-				if (parts.length() >= 3) {
-					vals.gain = parts[1].toDouble();
-					vals.peak = parts[2].toDouble();
+				if (parts.length() >= 4) {
+					vals.gain = parts[2].toDouble();
+					vals.peak = parts[3].toDouble();
 					vals.ok = true;
 				}
-				tracks[trackIndexMap[num]] = vals;
+				trackValues[parts[0].toInt()][parts[1].toInt()] = vals;
 			}
 		}
 		else if (line.startsWith(constAlbumLine)) {
+			// ALBUM: <album> <gain> <peak>
 			QStringList parts = line.mid(constAlbumLine.length()).split(" ", CANTATA_SKIP_EMPTY);
-			if (parts.length() >= 2) {
-				album.gain = parts[0].toDouble();
-				album.peak = parts[1].toDouble();
-				album.ok = true;
+			if (!parts.isEmpty()) {
+				int album = parts[0].toInt();
+				Values vals;
+				if (parts.length() >= 3) {
+					vals.gain = parts[1].toDouble();
+					vals.peak = parts[2].toDouble();
+					vals.ok = true;
+				}
+				albumValues[album] = vals;
+				emit albumScanned(album);
 			}
 		}
 	}
@@ -113,6 +155,7 @@ void AlbumScanner::read()
 
 void AlbumScanner::procFinished()
 {
+	read();
 	setFinished(true);
 	emit done();
 }
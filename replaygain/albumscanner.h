@@ -30,10 +30,13 @@
 
 class QProcess;
 
+// Scans any number of albums, via a single cantata-replaygain process - which scans them in parallel.
 class AlbumScanner : public Job {
 	Q_OBJECT
 
 public:
+	static const QString constCacheDir;
+
 	struct Values {
 		Values() : gain(0.0), peak(0.0), ok(false) {}
 		double gain;
@@ -41,12 +44,21 @@ public:
 		bool ok;
 	};
 
-	AlbumScanner(const QMap<int, QString>& files);
+	// Update the scanner's cached results for these albums once their ReplayGain tags have been written, so that
+	// they are not re-scanned next time just because the tags changed the files.
+	static void refreshCache(const QList<QMap<int, QString>>& albumFiles);
+
+	AlbumScanner(const QList<QMap<int, QString>>& albumFiles);
 	~AlbumScanner();
 	virtual void start();
 	virtual void stop();
-	const Values& albumValues() const { return album; }
-	const QMap<int, Values> trackValues() const { return tracks; }
+	int albumCount() const { return albums.count(); }
+	bool albumWasScanned(int album) const { return albumValues.contains(album); }
+	Values album(int album) const { return albumValues.value(album); }
+	QMap<int, Values> tracks(int album) const;
+
+Q_SIGNALS:
+	void albumScanned(int album);
 
 private Q_SLOTS:
 	void read();
@@ -54,10 +66,9 @@ private Q_SLOTS:
 
 private:
 	QProcess* proc;
-	Values album;
-	QMap<int, Values> tracks;
-	QMap<int, int> trackIndexMap;
-	QStringList fileNames;
+	QList<QMap<int, QString>> albums;
+	QMap<int, Values> albumValues;
+	QMap<int, QMap<int, Values>> trackValues;
 };
 
 #endif
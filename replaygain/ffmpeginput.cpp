@@ -28,6 +28,7 @@ extern "C" {
 #endif
 #include "ebur128.h"
 #include "ffmpeginput.h"
+#include "sampleconvert.h"
 #include <QByteArray>
 #include <QFile>
 #include <QList>
@@ -476,71 +477,33 @@ write_to_buffer:;
 		return 0;
 	}
 
+	const SampleConvert::Kernels& kernels = SampleConvert::kernels();
+	uint8_t** ed = handle->frame->extended_data;
 	switch (handle->codecContext->sample_fmt) {
-	case AV_SAMPLE_FMT_S16: {
-		int16_t* dataShort = (int16_t*)handle->frame->extended_data[0];
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			handle->buffer[i] = ((float)dataShort[i]) / qMax(-(float)SHRT_MIN, (float)SHRT_MAX);
-		}
+	case AV_SAMPLE_FMT_S16:
+		kernels.s16(handle->buffer, (const int16_t*)ed[0], numberRead * numChannels);
 		break;
-	}
-	case AV_SAMPLE_FMT_S32: {
-		int32_t* dataInt = (int32_t*)handle->frame->extended_data[0];
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			handle->buffer[i] = ((float)dataInt[i]) / qMax(-(float)INT_MIN, (float)INT_MAX);
-		}
+	case AV_SAMPLE_FMT_S32:
+		kernels.s32(handle->buffer, (const int32_t*)ed[0], numberRead * numChannels);
 		break;
-	}
-	case AV_SAMPLE_FMT_FLT: {
-		float* dataFloat = (float*)handle->frame->extended_data[0];
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			handle->buffer[i] = dataFloat[i];
-		}
+	case AV_SAMPLE_FMT_FLT:
+		memcpy(handle->buffer, ed[0], numberRead * numChannels * sizeof(float));
 		break;
-	}
-	case AV_SAMPLE_FMT_DBL: {
-		double* dataDouble = (double*)handle->frame->extended_data[0];
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			handle->buffer[i] = (float)dataDouble[i];
-		}
+	case AV_SAMPLE_FMT_DBL:
+		kernels.dbl(handle->buffer, (const double*)ed[0], numberRead * numChannels);
 		break;
-	}
-	case AV_SAMPLE_FMT_S16P: {
-		uint8_t** ed = handle->frame->extended_data;
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			int currentChannel = i / handle->frame->nb_samples;
-			int currentSample = i % handle->frame->nb_samples;
-			handle->buffer[currentSample * numChannels + currentChannel] = ((float)((int16_t*)ed[currentChannel])[currentSample]) / qMax(-(float)SHRT_MIN, (float)SHRT_MAX);
-		}
+	case AV_SAMPLE_FMT_S16P:
+		kernels.s16p(handle->buffer, (const int16_t* const*)ed, numChannels, numberRead);
 		break;
-	}
-	case AV_SAMPLE_FMT_S32P: {
-		uint8_t** ed = handle->frame->extended_data;
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			int currentChannel = i / handle->frame->nb_samples;
-			int currentSample = i % handle->frame->nb_samples;
-			handle->buffer[currentSample * numChannels + currentChannel] = ((float)((int32_t*)ed[currentChannel])[currentSample]) / qMax(-(float)INT_MIN, (float)INT_MAX);
-		}
+	case AV_SAMPLE_FMT_S32P:
+		kernels.s32p(handle->buffer, (const int32_t* const*)ed, numChannels, numberRead);
 		break;
-	}
-	case AV_SAMPLE_FMT_FLTP: {
-		uint8_t** ed = handle->frame->extended_data;
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			int currentChannel = i / handle->frame->nb_samples;
-			int currentSample = i % handle->frame->nb_samples;
-			handle->buffer[currentSample * numChannels + currentChannel] = ((float*)ed[currentChannel])[currentSample];
-		}
+	case AV_SAMPLE_FMT_FLTP:
+		kernels.fltp(handle->buffer, (const float* const*)ed, numChannels, numberRead);
 		break;
-	}
-	case AV_SAMPLE_FMT_DBLP: {
-		uint8_t** ed = handle->frame->extended_data;
-		for (int i = 0; i < handle->frame->nb_samples * numChannels; ++i) {
-			int currentChannel = i / handle->frame->nb_samples;
-			int currentSample = i % handle->frame->nb_samples;
-			handle->buffer[currentSample * numChannels + currentChannel] = ((double*)ed[currentChannel])[currentSample];
-		}
+	case AV_SAMPLE_FMT_DBLP:
+		kernels.dblp(handle->buffer, (const double* const*)ed, numChannels, numberRead);
 		break;
-	}
 	case AV_SAMPLE_FMT_U8:
 	case AV_SAMPLE_FMT_NONE:
 	case AV_SAMPLE_FMT_NB:
@@ -635,38 +598,22 @@ next_frame:
 		goto next_frame;
 	}
 	switch (handle->codecContext->sample_fmt) {
-	case SAMPLE_FMT_S16: {
-		int16_t* dataShort = (int16_t*)handle->audioBuffer;
+	case SAMPLE_FMT_S16:
 		numberRead = (size_t)dataSize / sizeof(int16_t) / (size_t)handle->codecContext->channels;
-		for (unsigned int i = 0; i < (size_t)dataSize / sizeof(int16_t); ++i) {
-			handle->buffer[i] = ((float)dataShort[i]) / qMax(-(float)SHRT_MIN, (float)SHRT_MAX);
-		}
+		SampleConvert::kernels().s16(handle->buffer, (const int16_t*)handle->audioBuffer, (size_t)dataSize / sizeof(int16_t));
 		break;
-	}
-	case SAMPLE_FMT_S32: {
-		int32_t* dataInt = (int32_t*)handle->audioBuffer;
+	case SAMPLE_FMT_S32:
 		numberRead = (size_t)dataSize / sizeof(int32_t) / (size_t)handle->codecContext->channels;
-		for (unsigned int i = 0; i < (size_t)dataSize / sizeof(int32_t); ++i) {
-			handle->buffer[i] = ((float)dataInt[i]) / qMax(-(float)INT_MIN, (float)INT_MAX);
-		}
+		SampleConvert::kernels().s32(handle->buffer, (const int32_t*)handle->audioBuffer, (size_t)dataSize / sizeof(int32_t));
 		break;
-	}
-	case SAMPLE_FMT_FLT: {
-		float* dataFloat = (float*)handle->audioBuffer;
+	case SAMPLE_FMT_FLT:
 		numberRead = (size_t)dataSize / sizeof(float) / (size_t)handle->codecContext->channels;
-		for (unsigned int i = 0; i < (size_t)dataSize / sizeof(float); ++i) {
-			handle->buffer[i] = dataFloat[i];
-		}
+		memcpy(handle->buffer, handle->audioBuffer, (size_t)dataSize);
 		break;
-	}
-	case SAMPLE_FMT_DBL: {
-		double* dataDouble = (double*)handle->audioBuffer;
+	case SAMPLE_FMT_DBL:
 		numberRead = (size_t)dataSize / sizeof(double) / (size_t)handle->codecContext->channels;
-		for (unsigned int i = 0; i < (size_t)dataSize / sizeof(double); ++i) {
-			handle->buffer[i] = (float)dataDouble[i];
-		}
+		SampleConvert::kernels().dbl(handle->buffer, (const double*)handle->audioBuffer, (size_t)dataSize / sizeof(double));
 		break;
-	}
 	case SAMPLE_FMT_U8:
 	case SAMPLE_FMT_NONE:
 	case SAMPLE_FMT_NB:
@@ -27,20 +27,72 @@
 #include <QTimer>
 #include <stdio.h>
 
+// Usage:
+//   cantata-replaygain [--cache <file>] <file 1..N>   Scan the files as a single album
+//   cantata-replaygain [--cache <file>] --albums      Read albums from stdin - one file per line, with albums
+//                                                     separated by an empty line
+//   cantata-replaygain --cache <file> --refresh       Read albums from stdin, as above, and update their cache
+//                                                     entries to match the files - after their tags were written
 int main(int argc, char* argv[])
 {
-	if (argc < 2) {
-		printf("Usage: %s <file 1..N>\n", argv[0]);
+	QString cacheFile;
+	bool multipleAlbums = false;
+	bool refresh = false;
+	QStringList fileNames;
+	for (int i = 1; i < argc; ++i) {
+		QString arg = QString::fromUtf8(argv[i]);
+		if (fileNames.isEmpty() && QLatin1String("--cache") == arg && i + 1 < argc) {
+			cacheFile = QString::fromUtf8(argv[++i]);
+		}
+		else if (fileNames.isEmpty() && QLatin1String("--albums") == arg) {
+			multipleAlbums = true;
+		}
+		else if (fileNames.isEmpty() && QLatin1String("--refresh") == arg) {
+			multipleAlbums = refresh = true;
+		}
+		else {
+			fileNames.append(arg);
+		}
+	}
+
+	if (fileNames.isEmpty() && !multipleAlbums) {
+		printf("Usage: %s [--cache <file>] <file 1..N>\n       %s [--cache <file>] --albums\n", argv[0], argv[0]);
 		return -1;
 	}
 
-	QStringList fileNames;
-	for (int i = 0; i < argc - 1; ++i) {
-		fileNames.append(QString::fromUtf8(argv[i + 1]));
+	QList<QStringList> albums;
+	if (multipleAlbums) {
+		QFile in;
+		if (in.open(stdin, QIODevice::ReadOnly)) {
+			QStringList album;
+			while (!in.atEnd()) {
+				QString line = QString::fromUtf8(in.readLine()).remove(QLatin1Char('\n'));
+				if (line.isEmpty()) {
+					if (!album.isEmpty()) {
+						albums.append(album);
+						album.clear();
+					}
+				}
+				else {
+					album.append(line);
+				}
+			}
+			if (!album.isEmpty()) {
+				albums.append(album);
+			}
+		}
+	}
+	else {
+		albums.append(fileNames);
+	}
+
+	if (refresh) {
+		ScanEngine(cacheFile).refresh(albums);
+		return 0;
 	}
 
 	QCoreApplication app(argc, argv);
-	ReplayGain* rg = new ReplayGain(fileNames);
+	ReplayGain* rg = new ReplayGain(albums, multipleAlbums, cacheFile);
 	QTimer::singleShot(0, rg, SLOT(scan()));
 	return app.exec();
 }
@@ -22,7 +22,7 @@
  */
 
 #include "replaygain.h"
-#include "jobcontroller.h"
+#include "trackscanner.h"
 #include <QCoreApplication>
 #include <stdio.h>
 
@@ -32,70 +32,31 @@ static QString formatDouble(double d)
 	return QString::number(d, 'f', 10).replace(",", ".");
 }
 
-ReplayGain::ReplayGain(const QStringList& fileNames)
-	: QObject(0), files(fileNames), lastProgress(-1), totalScanned(0)
+ReplayGain::ReplayGain(const QList<QStringList>& albumFiles, bool multipleAlbums, const QString& cacheFile)
+	: QObject(0), albums(albumFiles), multiple(multipleAlbums), engine(cacheFile), lastProgress(-1)
 {
 	TrackScanner::init();
-	JobController::self()->setMaxActive(8);
 }
 
 ReplayGain::~ReplayGain()
 {
-	clearScanners();
 }
 
 void ReplayGain::scan()
 {
-	for (int i = 0; i < files.count(); ++i) {
-		if (scanners.count() < 100) {
-			createScanner(i);
-		}
-		else {
-			toScan.append(i);
-		}
-	}
-}
-
-void ReplayGain::createScanner(int index)
-{
-	TrackScanner* s = new TrackScanner(index);
-	s->setFile(files.at(index));
-	connect(s, SIGNAL(progress(int)), this, SLOT(scannerProgress(int)));
-	connect(s, SIGNAL(done()), this, SLOT(scannerDone()));
-	scanners.insert(index, s);
-	JobController::self()->add(s);
-}
-
-void ReplayGain::clearScanners()
-{
-	JobController::self()->cancel();
-	QMap<int, TrackScanner*>::ConstIterator it(scanners.constBegin());
-	QMap<int, TrackScanner*>::ConstIterator end(scanners.constEnd());
-
-	for (; it != end; ++it) {
-		it.value()->stop();
+	QList<ScanEngine::Album> toScan;
+	for (const QStringList& files : albums) {
+		ScanEngine::Album album;
+		album.files = files;
+		toScan.append(album);
 	}
-	scanners.clear();
-	toScan.clear();
-	tracks.clear();
+	engine.scan(toScan, this);
+	QCoreApplication::exit(0);
 }
 
-void ReplayGain::showProgress()
+void ReplayGain::progress(int pc)
 {
-	int finished = 0;
-	Q_UNUSED(finished)
-	quint64 totalProgress = 0;
-	QMap<int, Track>::iterator it = tracks.begin();
-	QMap<int, Track>::iterator end = tracks.end();
-
-	for (; it != end; ++it) {
-		if ((*it).finished) {
-			finished++;
-		}
-		totalProgress += (*it).finished ? 100 : (*it).progress;
-	}
-	int progress = (totalProgress / files.count()) + 0.5;
-	progress = (progress / 5) * 5;
+	int progress = (pc / 5) * 5;
 	if (progress != lastProgress) {
 		lastProgress = progress;
 		printf("PROGRESS: %02d\n", lastProgress);
@@ -103,70 +64,29 @@ void ReplayGain::showProgress()
 	}
 }
 
-void ReplayGain::showResults()
+void ReplayGain::albumScanned(int index, const ScanEngine::Album& album)
 {
-	QList<TrackScanner*> okScanners;
-	for (int i = 0; i < files.count(); ++i) {
-		TrackScanner* s = scanners[i];
-		const Track& t = tracks[i];
-		if (t.success && s->ok()) {
-			printf("TRACK: %d %s %s\n", i, formatDouble(TrackScanner::reference(s->results().loudness)).toLatin1().constData(),
-			       formatDouble(s->results().peakValue()).toLatin1().constData());
-			okScanners.append(s);
+	// When scanning multiple albums, each line is prefixed by the index of the album it relates to
+	QByteArray prefix = multiple ? QByteArray::number(index) + ' ' : QByteArray();
+	for (int i = 0; i < album.tracks.count(); ++i) {
+		const ScanEngine::Values& track = album.tracks.at(i);
+		if (track.ok) {
+			printf("TRACK: %s%d %s %s\n", prefix.constData(), i, formatDouble(track.gain).toLatin1().constData(),
+			       formatDouble(track.peak).toLatin1().constData());
 		}
 		else {
-			printf("TRACK: %d FAILED\n", i);
+			printf("TRACK: %s%d FAILED\n", prefix.constData(), i);
 		}
 	}
 
-	if (okScanners.isEmpty()) {
-		printf("ALBUM: FAILED\n");
+	if (album.album.ok) {
+		printf("ALBUM: %s%s %s\n", prefix.constData(), formatDouble(album.album.gain).toLatin1().constData(),
+		       formatDouble(album.album.peak).toLatin1().constData());
 	}
 	else {
-		TrackScanner::Data album = TrackScanner::global(okScanners);
-		printf("ALBUM: %s %s\n", formatDouble(TrackScanner::reference(album.loudness)).toLatin1().constData(),
-		       formatDouble(album.peak).toLatin1().constData());
+		printf("ALBUM: %sFAILED\n", prefix.constData());
 	}
 	fflush(stdout);
-
-	QCoreApplication::exit(0);
-}
-
-void ReplayGain::scannerProgress(int p)
-{
-	TrackScanner* s = qobject_cast<TrackScanner*>(sender());
-	if (!s) {
-		return;
-	}
-
-	tracks[s->index()].progress = p;
-	showProgress();
-}
-
-void ReplayGain::scannerDone()
-{
-	TrackScanner* s = qobject_cast<TrackScanner*>(sender());
-	if (!s) {
-		return;
-	}
-	Track& track = tracks[s->index()];
-	if (!track.finished) {
-		track.finished = true;
-		track.success = s->success();
-		track.progress = 100;
-		showProgress();
-		totalScanned++;
-	}
-
-	if (toScan.isEmpty()) {
-		if (totalScanned == files.count()) {
-			showResults();
-		}
-	}
-	else {
-		int index = toScan.takeAt(0);
-		createScanner(index);
-	}
 }
 
 #include "moc_replaygain.cpp"
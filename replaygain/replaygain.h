@@ -25,46 +25,29 @@
 #define _REPLAYGAIN_H_
 
 #include "config.h"
-#include "trackscanner.h"
+#include "scanengine.h"
 #include <QList>
-#include <QMap>
 #include <QObject>
 #include <QStringList>
 
-class ReplayGain : public QObject {
+class ReplayGain : public QObject, public ScanEngine::Listener {
 	Q_OBJECT
 
 public:
-	ReplayGain(const QStringList& fileNames);
+	ReplayGain(const QList<QStringList>& albumFiles, bool multipleAlbums, const QString& cacheFile);
 	virtual ~ReplayGain();
 
+	void progress(int pc) override;
+	void albumScanned(int index, const ScanEngine::Album& album) override;
+
 public Q_SLOTS:
 	void scan();
 
 private:
-	void createScanner(int index);
-	void clearScanners();
-	void showProgress();
-	void showResults();
-
-private Q_SLOTS:
-	void scannerProgress(int p);
-	void scannerDone();
-
-private:
-	struct Track {
-		Track() : progress(0), finished(false), success(false) {}
-		unsigned char progress;
-		bool finished : 1;
-		bool success : 1;
-	};
-
-	QStringList files;
-	QMap<int, TrackScanner*> scanners;
-	QList<int> toScan;
-	QMap<int, Track> tracks;
+	QList<QStringList> albums;
+	bool multiple;
+	ScanEngine engine;
 	int lastProgress;
-	int totalScanned;
 };
 
 #endif
@@ -70,7 +70,7 @@ static inline void setResizeMode(QHeaderView* hdr, int idx, QHeaderView::ResizeM
 }
 
 RgDialog::RgDialog(QWidget* parent)
-	: SongDialog(parent, "RgDialog", QSize(800, 400)), state(State_Idle), totalToScan(0), tagReader(0), autoScanTags(false)
+	: SongDialog(parent, "RgDialog", QSize(800, 400)), state(State_Idle), scanner(0), tagReader(0), autoScanTags(false)
 {
 	iCount++;
 	setButtons(User1 | Ok | Cancel);
@@ -137,7 +137,7 @@ RgDialog::RgDialog(QWidget* parent)
 
 RgDialog::~RgDialog()
 {
-	clearScanners();
+	clearScanner();
 	iCount--;
 }
 
@@ -271,8 +271,7 @@ void RgDialog::startScanning()
 	progress->setVisible(true);
 	statusLabel->setText(tr("Scanning tracks..."));
 	statusLabel->setVisible(true);
-	clearScanners();
-	totalToScan = 0;
+	clearScanner();
 	QMap<QString, QList<int>> groupedTracks;
 	for (int i = 0; i < origSongs.count(); ++i) {
 		if (!removedItems.contains(i) && (all || !origTags.contains(i))) {
@@ -282,14 +281,20 @@ void RgDialog::startScanning()
 			groupedTracks[aa.isEmpty() && al.isEmpty() ? (Utils::getFile(sng.file) + " -- " + QString::number(i)) : (sng.albumArtist() + " -- " + sng.album)].append(i);
 		}
 	}
+
+	QList<QMap<int, QString>> albums;
 	QMap<QString, QList<int>>::ConstIterator it(groupedTracks.constBegin());
 	QMap<QString, QList<int>>::ConstIterator end(groupedTracks.constEnd());
 
 	for (; it != end; ++it) {
-		createScanner(*it);
-		totalToScan++;
+		QMap<int, QString> fileMap;
+		for (int i : *it) {
+			fileMap[i] = origSongs.at(i).filePath(base);
+		}
+		albums.append(fileMap);
 	}
-	progress->setRange(0, 100 * totalToScan);
+	createScanner(albums);
+	progress->setRange(0, 100);
 }
 
 void RgDialog::stopScanning()
@@ -300,31 +305,26 @@ void RgDialog::stopScanning()
 	statusLabel->setVisible(false);
 
 	JobController::self()->cancel();
-	clearScanners();
+	clearScanner();
 	setButtonGuiItem(Cancel, StdGuiItem::close());
 }
 
-void RgDialog::createScanner(const QList<int>& indexes)
+void RgDialog::createScanner(const QList<QMap<int, QString>>& albums)
 {
-	QMap<int, QString> fileMap;
-	for (int i : indexes) {
-		fileMap[i] = origSongs.at(i).filePath(base);
-	}
-
-	AlbumScanner* s = new AlbumScanner(fileMap);
-	connect(s, SIGNAL(progress(int)), this, SLOT(scannerProgress(int)));
-	connect(s, SIGNAL(done()), this, SLOT(scannerDone()));
-	scanners[s] = 0;
-	JobController::self()->add(s);
+	scanner = new AlbumScanner(albums);
+	scannedAlbums = albums;
+	connect(scanner, SIGNAL(progress(int)), this, SLOT(scannerProgress(int)));
+	connect(scanner, SIGNAL(albumScanned(int)), this, SLOT(albumScanned(int)));
+	connect(scanner, SIGNAL(done()), this, SLOT(scannerDone()));
+	JobController::self()->add(scanner);
 }
 
-void RgDialog::clearScanners()
+void RgDialog::clearScanner()
 {
-	QList<AlbumScanner*> scannerList = scanners.keys();
-	for (AlbumScanner* sc : scannerList) {
-		sc->stop();
+	if (scanner) {
+		scanner->stop();
+		scanner = 0;
 	}
-	scanners.clear();
 }
 
 void RgDialog::startReadingTags()
@@ -379,12 +379,24 @@ bool RgDialog::saveTags()
 
 	int count = 0;
 	bool someTimedout = false;
+	QList<QPair<QString, Tags::ReplayGain>> requests;
 	QMap<int, Tags::ReplayGain>::ConstIterator it = tagsToSave.constBegin();
 	QMap<int, Tags::ReplayGain>::ConstIterator end = tagsToSave.constEnd();
 
 	for (; it != end; ++it) {
-		QString filePath = origSongs.at(it.key()).filePath(base);
-		switch (Tags::updateReplaygain(filePath, it.value())) {
+		requests.append(qMakePair(origSongs.at(it.key()).filePath(base), it.value()));
+	}
+
+	QList<int> results = Tags::updateReplaygainBatch(requests, [&](int, int) {
+		progress->setValue(progress->value() + 1);
+		if (0 == count++ % 10) {
+			QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+		}
+	});
+
+	for (int i = 0; i < results.count(); ++i) {
+		const QString& filePath = requests.at(i).first;
+		switch (results.at(i)) {
 		case Tags::Update_Failed:
 			failed.append(filePath);
 			break;
@@ -394,44 +406,23 @@ bool RgDialog::saveTags()
 		default:
 			break;
 		}
-
-		progress->setValue(progress->value() + 1);
-		if (0 == count++ % 10) {
-			QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-		}
 	}
 
 	if (failed.count()) {
 		MessageBox::errorListEx(this, tr("Failed to update the tags of the following tracks:"), failed);
 	}
+	AlbumScanner::refreshCache(scannedAlbums);
 
 	return !someTimedout;
 }
 
 void RgDialog::updateView()
 {
-	int finished = 0;
-	quint64 totalProgress = 0;
-	QMap<AlbumScanner*, int>::ConstIterator it = scanners.constBegin();
-	QMap<AlbumScanner*, int>::ConstIterator end = scanners.constEnd();
-
-	for (; it != end; ++it) {
-		if (100 == it.value()) {
-			finished++;
-		}
-		totalProgress += (*it);
-	}
-
-	if (finished == totalToScan) {
-		progress->setVisible(false);
-		statusLabel->setVisible(false);
-		state = State_Idle;
-		setButtonGuiItem(Cancel, StdGuiItem::close());
-		enableButton(Ok, !tagsToSave.isEmpty());
-	}
-	else {
-		progress->setValue(totalProgress);
-	}
+	progress->setVisible(false);
+	statusLabel->setVisible(false);
+	state = State_Idle;
+	setButtonGuiItem(Cancel, StdGuiItem::close());
+	enableButton(Ok, !tagsToSave.isEmpty());
 }
 
 #ifdef ENABLE_DEVICES_SUPPORT
@@ -460,28 +451,33 @@ Device* RgDialog::getDevice(const QString& udi, QWidget* p)
 void RgDialog::scannerProgress(int p)
 {
 	AlbumScanner* s = qobject_cast<AlbumScanner*>(sender());
-	if (!s) {
+	if (!s || s != scanner) {
 		return;
 	}
 
-	scanners[s] = p;
-	updateView();
+	progress->setValue(p);
 }
 
-void RgDialog::scannerDone()
+void RgDialog::albumScanned(int album)
 {
 	AlbumScanner* s = qobject_cast<AlbumScanner*>(sender());
-	if (!s) {
+	if (!s || s != scanner) {
 		return;
 	}
 
-	const QMap<int, AlbumScanner::Values>& trackValues = s->trackValues();
+	showResults(s, album);
+}
+
+void RgDialog::showResults(AlbumScanner* s, int album)
+{
+	const AlbumScanner::Values albumValues = s->album(album);
+	const QMap<int, AlbumScanner::Values> trackValues = s->tracks(album);
 	QMap<int, AlbumScanner::Values>::ConstIterator it(trackValues.constBegin());
 	QMap<int, AlbumScanner::Values>::ConstIterator end(trackValues.constEnd());
 
-	if (s->success()) {
+	if (s->albumWasScanned(album)) {
 		for (; it != end; ++it) {
-			Tags::ReplayGain updatedTags(it.value().gain, s->albumValues().gain, it.value().peak, s->albumValues().peak);
+			Tags::ReplayGain updatedTags(it.value().gain, albumValues.gain, it.value().peak, albumValues.peak);
 			QTreeWidgetItem* item = view->topLevelItem(it.key());
 			if (it.value().ok) {
 				item->setText(COL_TRACKGAIN, tr("%1 dB").arg(Utils::formatNumber(updatedTags.trackGain, 2)));
@@ -493,7 +489,7 @@ void RgDialog::scannerDone()
 				item->setText(COL_TRACKGAIN, tr("Failed"));
 				item->setText(COL_TRACKPEAK, tr("Failed"));
 			}
-			if (s->albumValues().ok) {
+			if (albumValues.ok) {
 				item->setText(COL_ALBUMGAIN, tr("%1 dB").arg(Utils::formatNumber(updatedTags.albumGain, 2)));
 				if (!Utils::equal(updatedTags.albumPeak, 0.0)) {
 					item->setText(COL_ALBUMPEAK, Utils::formatNumber(updatedTags.albumPeak, 6));
@@ -567,8 +563,22 @@ void RgDialog::scannerDone()
 			tagsToSave.remove(it.key());
 		}
 	}
+}
+
+void RgDialog::scannerDone()
+{
+	AlbumScanner* s = qobject_cast<AlbumScanner*>(sender());
+	if (!s || s != scanner) {
+		return;
+	}
 
-	scanners[s] = 100;
+	// Any albums that were not reported have failed
+	for (int album = 0; album < s->albumCount(); ++album) {
+		if (!s->albumWasScanned(album)) {
+			showResults(s, album);
+		}
+	}
+	scanner = 0;
 	updateView();
 	JobController::self()->finishedWith(s);
 }
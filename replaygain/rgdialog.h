@@ -59,11 +59,12 @@ private:
 	void slotButtonClicked(int button);
 	void startScanning();
 	void stopScanning();
-	void createScanner(const QList<int>& indexes);
-	void clearScanners();
+	void createScanner(const QList<QMap<int, QString>>& albums);
+	void clearScanner();
 	void startReadingTags();
 	void stopReadingTags();
 	bool saveTags();
+	void showResults(AlbumScanner* s, int album);
 	void updateView();
 #ifdef ENABLE_DEVICES_SUPPORT
 	Device* getDevice(const QString& udi, QWidget* p);
@@ -72,6 +73,7 @@ private:
 
 private Q_SLOTS:
 	void scannerProgress(int p);
+	void albumScanned(int album);
 	void scannerDone();
 	void songTags(int index, Tags::ReplayGain tags);
 	void tagReaderDone();
@@ -96,8 +98,8 @@ private:
 	QString base;
 	QList<Song> origSongs;
 
-	QMap<AlbumScanner*, int> scanners;
-	int totalToScan;
+	AlbumScanner* scanner;
+	QList<QMap<int, QString>> scannedAlbums;
 
 	QMap<int, Tags::ReplayGain> origTags;
 	QMap<int, Tags::ReplayGain> tagsToSave;
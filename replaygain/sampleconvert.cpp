@@ -0,0 +1,427 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sampleconvert.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SAMPLE_CONVERT_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 versions are compiled with a per-function target, and only used if the CPU supports them.
+#define SAMPLE_CONVERT_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SAMPLE_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace SampleConvert {
+
+static const float constS16Scale = 1.0f / 32768.0f;
+static const float constS32Scale = 1.0f / 2147483648.0f;
+
+template<typename T>
+static inline float toFloat(T v);
+template<>
+inline float toFloat<int16_t>(int16_t v) { return v * constS16Scale; }
+template<>
+inline float toFloat<int32_t>(int32_t v) { return v * constS32Scale; }
+template<>
+inline float toFloat<float>(float v) { return v; }
+template<>
+inline float toFloat<double>(double v) { return (float)v; }
+
+// Scalar versions. The vectorised versions use these for any samples remaining after their last full block.
+template<typename T>
+static inline void convertTail(float* dst, const T* src, size_t from, size_t count)
+{
+	for (size_t i = from; i < count; ++i) {
+		dst[i] = toFloat(src[i]);
+	}
+}
+
+template<typename T>
+static inline void interleaveTail(float* dst, const T* const* planes, unsigned int channels, size_t from, size_t frames)
+{
+	for (unsigned int c = 0; c < channels; ++c) {
+		const T* src = planes[c];
+		float* out = dst + c;
+		for (size_t i = from; i < frames; ++i) {
+			out[i * channels] = toFloat(src[i]);
+		}
+	}
+}
+
+static inline float peakTail(const float* src, size_t from, size_t count, float peak)
+{
+	for (size_t i = from; i < count; ++i) {
+		float v = fabsf(src[i]);
+		if (v > peak) {
+			peak = v;
+		}
+	}
+	return peak;
+}
+
+template<typename T>
+static void convertScalar(float* dst, const T* src, size_t count)
+{
+	convertTail(dst, src, 0, count);
+}
+
+template<typename T>
+static void interleaveScalar(float* dst, const T* const* planes, unsigned int channels, size_t frames)
+{
+	interleaveTail(dst, planes, channels, 0, frames);
+}
+
+static float peakScalar(const float* src, size_t count)
+{
+	return peakTail(src, 0, count, 0.0f);
+}
+
+static const Kernels constScalarKernels = {
+		convertScalar<int16_t>,
+		convertScalar<int32_t>,
+		convertScalar<double>,
+		interleaveScalar<int16_t>,
+		interleaveScalar<int32_t>,
+		interleaveScalar<float>,
+		interleaveScalar<double>,
+		peakScalar};
+
+#ifdef SAMPLE_CONVERT_SSE2
+static inline __m128 load4Sse2(const int16_t* src)
+{
+	__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), _mm_set1_ps(constS16Scale));
+}
+
+static inline __m128 load4Sse2(const int32_t* src)
+{
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))), _mm_set1_ps(constS32Scale));
+}
+
+static inline __m128 load4Sse2(const float* src)
+{
+	return _mm_loadu_ps(src);
+}
+
+static inline __m128 load4Sse2(const double* src)
+{
+	return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src)), _mm_cvtpd_ps(_mm_loadu_pd(src + 2)));
+}
+
+template<typename T>
+static void convertSse2(float* dst, const T* src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, load4Sse2(src + i));
+	}
+	convertTail(dst, src, i, count);
+}
+
+template<typename T>
+static void interleaveSse2(float* dst, const T* const* planes, unsigned int channels, size_t frames)
+{
+	if (1 == channels) {
+		convertSse2(dst, planes[0], frames);
+		return;
+	}
+	size_t i = 0;
+	if (2 == channels) {
+		for (; i + 4 <= frames; i += 4) {
+			__m128 l = load4Sse2(planes[0] + i);
+			__m128 r = load4Sse2(planes[1] + i);
+			_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+		}
+	}
+	interleaveTail(dst, planes, channels, i, frames);
+}
+
+static inline float horizontalMaxSse2(__m128 m)
+{
+	m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+	m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(m);
+}
+
+static float peakSse2(const float* src, size_t count)
+{
+	const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 m = _mm_setzero_ps();
+	size_t i = 0;
+	// Current maximum is the 2nd operand, so that NaNs are ignored - as per peakTail()
+	for (; i + 4 <= count; i += 4) {
+		m = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(src + i), mask), m);
+	}
+	return peakTail(src, i, count, horizontalMaxSse2(m));
+}
+
+static const Kernels constSse2Kernels = {
+		convertSse2<int16_t>,
+		convertSse2<int32_t>,
+		convertSse2<double>,
+		interleaveSse2<int16_t>,
+		interleaveSse2<int32_t>,
+		interleaveSse2<float>,
+		interleaveSse2<double>,
+		peakSse2};
+#endif
+
+#ifdef SAMPLE_CONVERT_AVX2
+AVX2_TARGET static inline __m256 load8Avx2(const int16_t* src)
+{
+	__m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(constS16Scale));
+}
+
+AVX2_TARGET static inline __m256 load8Avx2(const int32_t* src)
+{
+	__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(constS32Scale));
+}
+
+AVX2_TARGET static inline __m256 load8Avx2(const float* src)
+{
+	return _mm256_loadu_ps(src);
+}
+
+AVX2_TARGET static inline __m256 load8Avx2(const double* src)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(src))),
+	                            _mm256_cvtpd_ps(_mm256_loadu_pd(src + 4)), 1);
+}
+
+template<typename T>
+AVX2_TARGET static void convertAvx2(float* dst, const T* src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, load8Avx2(src + i));
+	}
+	convertTail(dst, src, i, count);
+}
+
+template<typename T>
+AVX2_TARGET static void interleaveAvx2(float* dst, const T* const* planes, unsigned int channels, size_t frames)
+{
+	if (1 == channels) {
+		convertAvx2(dst, planes[0], frames);
+		return;
+	}
+	size_t i = 0;
+	if (2 == channels) {
+		for (; i + 8 <= frames; i += 8) {
+			__m256 l = load8Avx2(planes[0] + i);
+			__m256 r = load8Avx2(planes[1] + i);
+			// unpack works within each 128-bit lane, so the lanes need to be re-ordered afterwards
+			__m256 lo = _mm256_unpacklo_ps(l, r);
+			__m256 hi = _mm256_unpackhi_ps(l, r);
+			_mm256_storeu_ps(dst + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(dst + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+	}
+	interleaveTail(dst, planes, channels, i, frames);
+}
+
+AVX2_TARGET static float peakAvx2(const float* src, size_t count)
+{
+	const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 m = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		m = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(src + i), mask), m);
+	}
+	__m128 m4 = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+	m4 = _mm_max_ps(m4, _mm_shuffle_ps(m4, m4, _MM_SHUFFLE(1, 0, 3, 2)));
+	m4 = _mm_max_ps(m4, _mm_shuffle_ps(m4, m4, _MM_SHUFFLE(2, 3, 0, 1)));
+	return peakTail(src, i, count, _mm_cvtss_f32(m4));
+}
+
+static const Kernels constAvx2Kernels = {
+		convertAvx2<int16_t>,
+		convertAvx2<int32_t>,
+		convertAvx2<double>,
+		interleaveAvx2<int16_t>,
+		interleaveAvx2<int32_t>,
+		interleaveAvx2<float>,
+		interleaveAvx2<double>,
+		peakAvx2};
+#endif
+
+#ifdef SAMPLE_CONVERT_NEON
+static inline float32x4_t load4Neon(const int16_t* src)
+{
+	return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src))), constS16Scale);
+}
+
+static inline float32x4_t load4Neon(const int32_t* src)
+{
+	return vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src)), constS32Scale);
+}
+
+static inline float32x4_t load4Neon(const float* src)
+{
+	return vld1q_f32(src);
+}
+
+static inline float32x4_t load4Neon(const double* src)
+{
+	return vcombine_f32(vcvt_f32_f64(vld1q_f64(src)), vcvt_f32_f64(vld1q_f64(src + 2)));
+}
+
+template<typename T>
+static void convertNeon(float* dst, const T* src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dst + i, load4Neon(src + i));
+	}
+	convertTail(dst, src, i, count);
+}
+
+template<typename T>
+static void interleaveNeon(float* dst, const T* const* planes, unsigned int channels, size_t frames)
+{
+	if (1 == channels) {
+		convertNeon(dst, planes[0], frames);
+		return;
+	}
+	size_t i = 0;
+	if (2 == channels) {
+		for (; i + 4 <= frames; i += 4) {
+			float32x4x2_t lr;
+			lr.val[0] = load4Neon(planes[0] + i);
+			lr.val[1] = load4Neon(planes[1] + i);
+			vst2q_f32(dst + i * 2, lr);
+		}
+	}
+	interleaveTail(dst, planes, channels, i, frames);
+}
+
+static float peakNeon(const float* src, size_t count)
+{
+	float32x4_t m = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	// maxnm ignores NaNs - as per peakTail()
+	for (; i + 4 <= count; i += 4) {
+		m = vmaxnmq_f32(m, vabsq_f32(vld1q_f32(src + i)));
+	}
+	return peakTail(src, i, count, vmaxnmvq_f32(m));
+}
+
+static const Kernels constNeonKernels = {
+		convertNeon<int16_t>,
+		convertNeon<int32_t>,
+		convertNeon<double>,
+		interleaveNeon<int16_t>,
+		interleaveNeon<int32_t>,
+		interleaveNeon<float>,
+		interleaveNeon<double>,
+		peakNeon};
+#endif
+
+bool isSupported(Impl impl)
+{
+	switch (impl) {
+	case Scalar:
+		return true;
+#ifdef SAMPLE_CONVERT_SSE2
+	case Sse2:
+		return true;
+#endif
+#ifdef SAMPLE_CONVERT_AVX2
+	case Avx2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+#ifdef SAMPLE_CONVERT_NEON
+	case Neon:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* name(Impl impl)
+{
+	switch (impl) {
+	case Sse2:
+		return "sse2";
+	case Avx2:
+		return "avx2";
+	case Neon:
+		return "neon";
+	default:
+		return "scalar";
+	}
+}
+
+const Kernels& kernels(Impl impl)
+{
+	if (!isSupported(impl)) {
+		return constScalarKernels;
+	}
+	switch (impl) {
+#ifdef SAMPLE_CONVERT_SSE2
+	case Sse2:
+		return constSse2Kernels;
+#endif
+#ifdef SAMPLE_CONVERT_AVX2
+	case Avx2:
+		return constAvx2Kernels;
+#endif
+#ifdef SAMPLE_CONVERT_NEON
+	case Neon:
+		return constNeonKernels;
+#endif
+	default:
+		return constScalarKernels;
+	}
+}
+
+static Impl bestImpl()
+{
+	const Impl order[] = {Avx2, Sse2, Neon};
+	for (Impl impl: order) {
+		if (isSupported(impl)) {
+			return impl;
+		}
+	}
+	return Scalar;
+}
+
+const Kernels& kernels()
+{
+	static const Kernels& best = kernels(bestImpl());
+	return best;
+}
+
+}// namespace SampleConvert
@@ -0,0 +1,63 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SAMPLE_CONVERT_H_
+#define _SAMPLE_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conversion of decoded audio into the interleaved float samples that ebur128 consumes, and detection of
+// the sample peak of such a buffer. Each kernel has a plain C++ version, and vectorised versions for
+// SSE2/AVX2 (x86) and NEON (ARM). The best version supported by the CPU is picked at runtime, the others
+// are only of use to the benchmark.
+//
+// Integer samples are scaled by 2^-15 (16-bit) or 2^-31 (32-bit), so all versions produce identical output.
+namespace SampleConvert {
+enum Impl {
+	Scalar,
+	Sse2,
+	Avx2,
+	Neon
+};
+
+struct Kernels {
+	void (*s16)(float* dst, const int16_t* src, size_t count);
+	void (*s32)(float* dst, const int32_t* src, size_t count);
+	void (*dbl)(float* dst, const double* src, size_t count);
+	void (*s16p)(float* dst, const int16_t* const* planes, unsigned int channels, size_t frames);
+	void (*s32p)(float* dst, const int32_t* const* planes, unsigned int channels, size_t frames);
+	void (*fltp)(float* dst, const float* const* planes, unsigned int channels, size_t frames);
+	void (*dblp)(float* dst, const double* const* planes, unsigned int channels, size_t frames);
+	float (*peak)(const float* src, size_t count);
+};
+
+extern bool isSupported(Impl impl);
+extern const char* name(Impl impl);
+// Kernels of the given implementation, or the scalar ones if this is not supported.
+extern const Kernels& kernels(Impl impl);
+// Kernels of the best supported implementation.
+extern const Kernels& kernels();
+}// namespace SampleConvert
+
+#endif
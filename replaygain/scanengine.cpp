@@ -0,0 +1,384 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "scanengine.h"
+#include "trackscanner.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+
+// Tracks queued per worker. Decoding a track takes far longer than queueing one, so this only needs to be large
+// enough for workers to have something to steal.
+static const int constQueueCapacity = 16;
+// Save the cache after this many albums have been scanned, so that little is lost if the scan is cancelled
+// (i.e. this process is terminated)
+static const int constCacheSaveInterval = 25;
+static const quint32 constCacheMagic = 0x43524743;// "CRGC"
+static const quint32 constCacheVersion = 1;
+
+static QDataStream& operator<<(QDataStream& stream, const ScanEngine::Values& v)
+{
+	stream << v.gain << v.peak << v.ok;
+	return stream;
+}
+
+static QDataStream& operator>>(QDataStream& stream, ScanEngine::Values& v)
+{
+	stream >> v.gain >> v.peak >> v.ok;
+	return stream;
+}
+
+static inline QString cacheKey(const QStringList& files)
+{
+	return files.join(QLatin1Char('\n'));
+}
+
+ScanEngine::ScanEngine(const QString& cache)
+	: cacheFile(cache), unsavedEntries(0), allQueued(false), aborted(false), totalTracks(0), scannedTracks(0), lastProgress(-1), listener(nullptr)
+{
+	loadCache();
+}
+
+ScanEngine::~ScanEngine()
+{
+	saveCache();
+}
+
+void ScanEngine::scan(QList<Album>& albums, Listener* l)
+{
+	listener = l;
+	states.clear();
+	states.resize(albums.count());
+	totalTracks = scannedTracks = 0;
+	lastProgress = -1;
+	allQueued = false;
+
+	QList<int> toScan;
+	for (int i = 0; i < albums.count(); ++i) {
+		Album& album = albums[i];
+		if (fromCache(album)) {
+			if (listener) {
+				QMutexLocker locker(&listenerMutex);
+				listener->albumScanned(i, album);
+			}
+			continue;
+		}
+		AlbumState& state = states[i];
+		state.album.files = album.files;
+		for (int t = 0; t < album.files.count(); ++t) {
+			state.album.tracks.append(Values());
+			state.scanners.append(nullptr);
+		}
+		state.remaining = album.files.count();
+		totalTracks += album.files.count();
+		toScan.append(i);
+	}
+
+	if (!toScan.isEmpty()) {
+		QThreadPool pool;
+		pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+		queues.clear();
+		queues.resize(pool.maxThreadCount());
+		for (int w = 0; w < queues.count(); ++w) {
+			pool.start([this, w]() { work(w); });
+		}
+
+		int worker = 0;
+		for (int i : toScan) {
+			if (aborted) {
+				break;
+			}
+			for (int t = 0; t < albums.at(i).files.count() && !aborted; ++t) {
+				push(worker, Task { i, t });
+			}
+			worker = (worker + 1) % queues.count();
+		}
+
+		{
+			QMutexLocker locker(&queueMutex);
+			allQueued = true;
+			notEmpty.wakeAll();
+		}
+		pool.waitForDone();
+
+		for (int i : toScan) {
+			albums[i] = states.at(i).album;
+		}
+	}
+	states.clear();
+	saveCache();
+	listener = nullptr;
+}
+
+void ScanEngine::abort()
+{
+	QMutexLocker locker(&queueMutex);
+	aborted = true;
+	notEmpty.wakeAll();
+	notFull.wakeAll();
+}
+
+void ScanEngine::push(int worker, const Task& task)
+{
+	QMutexLocker locker(&queueMutex);
+	// Prefer the requested worker, so that an album's tracks stay together, but use any queue with space
+	// rather than wait.
+	int target = worker;
+	while (queues.at(target).size() >= (size_t)constQueueCapacity && !aborted) {
+		for (int w = 0; w < queues.count(); ++w) {
+			if (queues.at(w).size() < (size_t)constQueueCapacity) {
+				target = w;
+				break;
+			}
+		}
+		if (queues.at(target).size() >= (size_t)constQueueCapacity) {
+			notFull.wait(&queueMutex);
+		}
+	}
+	queues[target].push_back(task);
+	notEmpty.wakeOne();
+}
+
+bool ScanEngine::pop(int worker, Task& task)
+{
+	QMutexLocker locker(&queueMutex);
+	for (;;) {
+		if (aborted) {
+			return false;
+		}
+		if (!queues.at(worker).empty()) {
+			task = queues[worker].front();
+			queues[worker].pop_front();
+			notFull.wakeAll();
+			return true;
+		}
+
+		// Own queue is empty, so steal from the back of the longest queue
+		int victim = -1;
+		for (int w = 0; w < queues.count(); ++w) {
+			if (w != worker && !queues.at(w).empty() && (-1 == victim || queues.at(w).size() > queues.at(victim).size())) {
+				victim = w;
+			}
+		}
+		if (-1 != victim) {
+			task = queues[victim].back();
+			queues[victim].pop_back();
+			notFull.wakeAll();
+			return true;
+		}
+
+		if (allQueued) {
+			return false;
+		}
+		notEmpty.wait(&queueMutex);
+	}
+}
+
+void ScanEngine::work(int worker)
+{
+	Task task;
+	while (pop(worker, task)) {
+		TrackScanner* scanner = new TrackScanner(task.track);
+		scanner->setFile(states.at(task.album).album.files.at(task.track));
+		scanner->setFinished(scanner->scan());
+		trackScanned(task.album, task.track, scanner);
+	}
+}
+
+void ScanEngine::trackScanned(int album, int track, TrackScanner* scanner)
+{
+	bool complete = false;
+	int pc = -1;
+	{
+		QMutexLocker locker(&stateMutex);
+		AlbumState& state = states[album];
+		state.scanners[track] = scanner;
+		complete = 0 == --state.remaining;
+		scannedTracks++;
+		int progress = totalTracks > 0 ? ((scannedTracks * 100.0) / totalTracks) + 0.5 : 100;
+		if (progress != lastProgress) {
+			lastProgress = pc = progress;
+		}
+	}
+
+	if (complete) {
+		albumScanned(album);
+	}
+	if (pc >= 0 && listener) {
+		QMutexLocker locker(&listenerMutex);
+		listener->progress(pc);
+	}
+}
+
+void ScanEngine::albumScanned(int index)
+{
+	// Only the worker that scanned the album's last track gets here, so no other thread touches this state now.
+	AlbumState& state = states[index];
+	QList<TrackScanner*> okScanners;
+	for (int i = 0; i < state.scanners.count(); ++i) {
+		TrackScanner* s = state.scanners.at(i);
+		Values& v = state.album.tracks[i];
+		if (s->success() && s->ok()) {
+			v.gain = TrackScanner::reference(s->results().loudness);
+			v.peak = s->results().peakValue();
+			v.ok = true;
+			okScanners.append(s);
+		}
+	}
+
+	if (!okScanners.isEmpty()) {
+		TrackScanner::Data album = TrackScanner::global(okScanners);
+		state.album.album.gain = TrackScanner::reference(album.loudness);
+		state.album.album.peak = album.peak;
+		state.album.album.ok = true;
+	}
+	qDeleteAll(state.scanners);
+	state.scanners.clear();
+
+	if (aborted) {
+		return;
+	}
+	toCache(state.album);
+	if (listener) {
+		QMutexLocker locker(&listenerMutex);
+		listener->albumScanned(index, state.album);
+	}
+}
+
+void ScanEngine::loadCache()
+{
+	if (cacheFile.isEmpty()) {
+		return;
+	}
+	QFile file(cacheFile);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QDataStream stream(&file);
+	quint32 magic = 0;
+	quint32 version = 0;
+	quint32 count = 0;
+	stream >> magic >> version >> count;
+	if (constCacheMagic != magic || constCacheVersion != version) {
+		return;
+	}
+	for (quint32 i = 0; i < count && QDataStream::Ok == stream.status(); ++i) {
+		QString key;
+		CacheEntry entry;
+		stream >> key >> entry.modified >> entry.sizes >> entry.tracks >> entry.album;
+		// There must be one size, and one modification time, per track
+		if (QDataStream::Ok == stream.status() && entry.sizes.count() == entry.tracks.count() && entry.modified.count() == entry.tracks.count()) {
+			cache.insert(key, entry);
+		}
+	}
+}
+
+void ScanEngine::saveCache()
+{
+	QMutexLocker locker(&cacheMutex);
+	if (cacheFile.isEmpty() || 0 == unsavedEntries) {
+		return;
+	}
+	QSaveFile file(cacheFile);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	QDataStream stream(&file);
+	stream << constCacheMagic << constCacheVersion << quint32(cache.count());
+	QHash<QString, CacheEntry>::ConstIterator it = cache.constBegin();
+	QHash<QString, CacheEntry>::ConstIterator end = cache.constEnd();
+	for (; it != end; ++it) {
+		stream << it.key() << it.value().modified << it.value().sizes << it.value().tracks << it.value().album;
+	}
+	if (file.commit()) {
+		unsavedEntries = 0;
+	}
+}
+
+void ScanEngine::refresh(const QList<QStringList>& albums)
+{
+	QMutexLocker locker(&cacheMutex);
+	for (const QStringList& files : albums) {
+		QHash<QString, CacheEntry>::Iterator it = cache.find(cacheKey(files));
+		if (cache.end() == it || it.value().tracks.count() != files.count()) {
+			continue;
+		}
+		it.value().modified.clear();
+		it.value().sizes.clear();
+		for (const QString& f : files) {
+			QFileInfo info(f);
+			it.value().modified.append(info.lastModified().toMSecsSinceEpoch());
+			it.value().sizes.append(info.size());
+		}
+		unsavedEntries++;
+	}
+}
+
+bool ScanEngine::fromCache(Album& album) const
+{
+	if (cacheFile.isEmpty()) {
+		return false;
+	}
+	QHash<QString, CacheEntry>::ConstIterator it = cache.constFind(cacheKey(album.files));
+	const int count = album.files.count();
+	if (cache.constEnd() == it || it.value().tracks.count() != count || it.value().sizes.count() != count || it.value().modified.count() != count) {
+		return false;
+	}
+	for (int i = 0; i < album.files.count(); ++i) {
+		QFileInfo info(album.files.at(i));
+		if (!info.exists() || info.size() != it.value().sizes.at(i) || info.lastModified().toMSecsSinceEpoch() != it.value().modified.at(i)) {
+			return false;
+		}
+	}
+	album.tracks = it.value().tracks;
+	album.album = it.value().album;
+	return true;
+}
+
+void ScanEngine::toCache(const Album& album)
+{
+	if (cacheFile.isEmpty() || !album.album.ok) {
+		return;
+	}
+	CacheEntry entry;
+	for (const QString& f : album.files) {
+		QFileInfo info(f);
+		entry.modified.append(info.lastModified().toMSecsSinceEpoch());
+		entry.sizes.append(info.size());
+	}
+	entry.tracks = album.tracks;
+	entry.album = album.album;
+
+	bool save = false;
+	{
+		QMutexLocker locker(&cacheMutex);
+		cache.insert(cacheKey(album.files), entry);
+		save = ++unsavedEntries >= constCacheSaveInterval;
+	}
+	if (save) {
+		saveCache();
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _SCAN_ENGINE_H_
+#define _SCAN_ENGINE_H_
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+
+class TrackScanner;
+
+// Scans any number of albums within the one process. Tracks are decoded and measured by a pool of worker
+// threads, each with its own bounded queue. All of an album's tracks are queued on the same worker, so that
+// albums complete - and their ebur128 states are released - as early as possible. Idle workers steal tracks
+// from the back of the other queues.
+//
+// Results may be persisted to a cache file. An album is only re-scanned if one of its files has changed
+// (modification time or size), as the album values need the ebur128 states of all of its tracks.
+class ScanEngine {
+public:
+	struct Values {
+		Values() : gain(0.0), peak(0.0), ok(false) {}
+		double gain;
+		double peak;
+		bool ok;
+	};
+
+	struct Album {
+		QStringList files;
+		QList<Values> tracks;
+		Values album;
+	};
+
+	class Listener {
+	public:
+		virtual ~Listener() {}
+		virtual void progress(int pc) = 0;
+		virtual void albumScanned(int index, const Album& album) = 0;
+	};
+
+	ScanEngine(const QString& cache = QString());
+	~ScanEngine();
+
+	// Blocks until all albums have been scanned. Listener calls are serialised, but are made from the
+	// worker threads.
+	void scan(QList<Album>& albums, Listener* l);
+	void abort();
+	// Update the cached modification times and sizes of these albums' files to their current values. Used once
+	// the ReplayGain tags have been written, as this changes the files but not the audio that was scanned.
+	void refresh(const QList<QStringList>& albums);
+
+private:
+	struct Task {
+		int album;
+		int track;
+	};
+
+	struct AlbumState {
+		AlbumState() : remaining(0) {}
+		Album album;
+		QList<TrackScanner*> scanners;
+		int remaining;
+	};
+
+	struct CacheEntry {
+		QList<qint64> modified;
+		QList<qint64> sizes;
+		QList<Values> tracks;
+		Values album;
+	};
+
+	void push(int worker, const Task& task);
+	bool pop(int worker, Task& task);
+	void work(int worker);
+	void trackScanned(int album, int track, TrackScanner* scanner);
+	void albumScanned(int album);
+	void loadCache();
+	void saveCache();
+	bool fromCache(Album& album) const;
+	void toCache(const Album& album);
+
+private:
+	QString cacheFile;
+	QHash<QString, CacheEntry> cache;
+	int unsavedEntries;
+	QMutex cacheMutex;
+
+	QMutex queueMutex;
+	QWaitCondition notEmpty;
+	QWaitCondition notFull;
+	QVector<std::deque<Task>> queues;
+	bool allQueued;
+	std::atomic<bool> aborted;
+
+	QMutex stateMutex;
+	QVector<AlbumState> states;
+	int totalTracks;
+	int scannedTracks;
+	int lastProgress;
+
+	QMutex listenerMutex;
+	Listener* listener;
+};
+
+#endif
@@ -29,15 +29,25 @@ void TagReader::setDetails(const QList<Song>& s, const QString& dir)
 	baseDir = dir;
 }
 
+// Tags are read in batches, so that the helper can read several files at once - but not so large a batch that
+// aborting takes a long time.
+static const int constBatchSize = 32;
+
 void TagReader::run()
 {
-	for (int i = 0; i < songs.count(); ++i) {
+	for (int i = 0; i < songs.count(); i += constBatchSize) {
 		if (abortRequested) {
 			setFinished(false);
 			return;
 		}
 
-		emit progress(i, Tags::readReplaygain(baseDir + songs.at(i).file));
+		QStringList files;
+		for (int j = i; j < songs.count() && j < i + constBatchSize; ++j) {
+			files.append(baseDir + songs.at(j).file);
+		}
+		Tags::readReplaygainBatch(files, [this, i](int index, const Tags::ReplayGain& rg) {
+			emit progress(i + index, rg);
+		});
 	}
 	setFinished(true);
 }
@@ -23,6 +23,7 @@
 
 #include "trackscanner.h"
 #include "config.h"
+#include "sampleconvert.h"
 #ifdef MPG123_FOUND
 #include "mpg123input.h"
 #endif
@@ -109,7 +110,7 @@ void TrackScanner::setFile(const QString& fileName)
 	file = fileName;
 }
 
-void TrackScanner::run()
+bool TrackScanner::scan()
 {
 	bool ffmpegIsFloat = false;
 #ifdef FFMPEG_FOUND
@@ -142,11 +143,10 @@ void TrackScanner::run()
 #endif
 
 	if (!input) {
-		setFinishedStatus(false);
-		return;
+		return false;
 	}
 
-	state = ebur128_init(input->channels(), input->sampleRate(), EBUR128_MODE_M | EBUR128_MODE_I | EBUR128_MODE_SAMPLE_PEAK);
+	state = ebur128_init(input->channels(), input->sampleRate(), EBUR128_MODE_M | EBUR128_MODE_I);
 
 	int* channelMap = new int[state->channels];
 	if (input->setChannelMap(channelMap)) {
@@ -161,25 +161,28 @@ void TrackScanner::run()
 	//    ebur128_set_channel(state, 0, EBUR128_DUAL_MONO);
 	//}
 
+	// Sample peak is measured here, rather than by ebur128, so that the vectorised kernel can be used.
+	const SampleConvert::Kernels& kernels = SampleConvert::kernels();
 	size_t numFramesRead = 0;
 	size_t totalRead = 0;
 	input->allocateBuffer();
 	while ((numFramesRead = input->readFrames())) {
 		if (abortRequested) {
-			setFinishedStatus(false);
-			return;
+			return closeInput(false);
 		}
 		totalRead += numFramesRead;
 		emit progress((int)((totalRead * 100.0 / input->totalFrames()) + 0.5));
 		if (ebur128_add_frames_float(state, input->buffer(), numFramesRead)) {
-			setFinishedStatus(false);
-			return;
+			return closeInput(false);
+		}
+		double sp = kernels.peak(input->buffer(), numFramesRead * state->channels);
+		if (sp > data.peak) {
+			data.peak = sp;
 		}
 	}
 
 	if (abortRequested) {
-		setFinishedStatus(false);
-		return;
+		return closeInput(false);
 	}
 
 	ebur128_loudness_global(state, &data.loudness);
@@ -188,15 +191,6 @@ void TrackScanner::run()
 	//         if (result) abort();
 	//     }
 
-	if (EBUR128_MODE_SAMPLE_PEAK == (state->mode & EBUR128_MODE_SAMPLE_PEAK)) {
-		for (unsigned i = 0; i < state->channels; ++i) {
-			double sp;
-			ebur128_sample_peak(state, i, &sp);
-			if (sp > data.peak) {
-				data.peak = sp;
-			}
-		}
-	}
 	if (EBUR128_MODE_TRUE_PEAK == (state->mode & EBUR128_MODE_TRUE_PEAK)) {
 		for (unsigned i = 0; i < state->channels; ++i) {
 			double tp;
@@ -206,14 +200,19 @@ void TrackScanner::run()
 			}
 		}
 	}
-	setFinishedStatus(true);
+	return closeInput(true);
+}
+
+void TrackScanner::run()
+{
+	setFinished(scan());
 }
 
-void TrackScanner::setFinishedStatus(bool f)
+bool TrackScanner::closeInput(bool ok)
 {
 	delete input;
 	input = 0;
-	setFinished(f);
+	return ok;
 }
 
 #include "moc_trackscanner.cpp"
@@ -54,13 +54,16 @@ public:
 	~TrackScanner();
 
 	void setFile(const QString& fileName);
+	// Decode and measure the file in the calling thread. The ebur128 state is kept, so that the album
+	// values can be calculated via global()
+	bool scan();
 	const Data& results() const { return data; }
 	int index() const { return idx; }
 	bool ok() const { return data.peakValue() > 0.00001; }
 
 private:
 	void run();
-	void setFinishedStatus(bool f);
+	bool closeInput(bool ok);
 
 private:
 	int idx;
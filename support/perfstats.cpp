@@ -0,0 +1,286 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "perfstats.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QThread>
+#include <memory>
+#include <string.h>
+
+namespace PerfStats {
+namespace Private {
+bool active = false;
+}
+
+static const quint64 constRingSize = 16384;// Must be a power of 2
+static const int constMaxDetail = 47;
+
+// Slots are claimed with a single atomic increment, and each is guarded by a sequence number so
+// that readers can spot (and skip) one that is being written. seq is 2*(index+1) once complete.
+struct Slot {
+	std::atomic<quint64> seq{0};
+	const char* name = nullptr;
+	qint64 start = 0;
+	qint64 duration = 0;
+	qint64 bytes = 0;
+	quintptr thread = 0;
+	quint8 category = 0;
+	quint8 detailLen = 0;
+	char detail[constMaxDetail];
+};
+
+static std::unique_ptr<Slot[]> ring;
+static std::atomic<quint64> head{0};
+static std::atomic<quint64> clearedAt{0};
+static QElapsedTimer timer;
+static quintptr mainThread = 0;
+
+static QMutex& counterMutex()
+{
+	static QMutex mutex;
+	return mutex;
+}
+
+static QList<Counter*>& counters()
+{
+	static QList<Counter*> list;
+	return list;
+}
+
+void setEnabled(bool e)
+{
+	if (e && !ring) {
+		ring.reset(new Slot[constRingSize]);
+		timer.start();
+		mainThread = (quintptr)QThread::currentThreadId();
+	}
+	Private::active = e;
+}
+
+qint64 now()
+{
+	return timer.nsecsElapsed();
+}
+
+const char* categoryName(Category cat)
+{
+	switch (cat) {
+	case Mpd: return "MPD";
+	case Database: return "Database";
+	case Covers: return "Covers";
+	case Models: return "Models";
+	case Network: return "Network";
+	default: return "Unknown";
+	}
+}
+
+void add(Category cat, const char* name, qint64 start, qint64 duration, const QByteArray& detail, qint64 bytes)
+{
+	if (!Private::active) {
+		return;
+	}
+	quint64 index = head.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = ring[index & (constRingSize - 1)];
+	slot.seq.store((2 * index) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.name = name;
+	slot.start = start;
+	slot.duration = duration;
+	slot.bytes = bytes;
+	slot.thread = (quintptr)QThread::currentThreadId();
+	slot.category = (quint8)cat;
+	slot.detailLen = (quint8)qMin((int)detail.size(), constMaxDetail);
+	if (slot.detailLen) {
+		memcpy(slot.detail, detail.constData(), slot.detailLen);
+	}
+	slot.seq.store(2 * (index + 1), std::memory_order_release);
+}
+
+void clear()
+{
+	clearedAt.store(head.load(std::memory_order_acquire), std::memory_order_release);
+	QMutexLocker locker(&counterMutex());
+	for (Counter* c : counters()) {
+		c->reset();
+	}
+}
+
+QList<Event> events(quint64* dropped)
+{
+	QList<Event> list;
+	if (!ring) {
+		if (dropped) {
+			*dropped = 0;
+		}
+		return list;
+	}
+
+	quint64 end = head.load(std::memory_order_acquire);
+	quint64 from = clearedAt.load(std::memory_order_acquire);
+	if (dropped) {
+		*dropped = end - from > constRingSize ? end - from - constRingSize : 0;
+	}
+	if (end - from > constRingSize) {
+		from = end - constRingSize;
+	}
+	list.reserve((int)(end - from));
+	for (quint64 index = from; index < end; ++index) {
+		const Slot& slot = ring[index & (constRingSize - 1)];
+		quint64 seq = slot.seq.load(std::memory_order_acquire);
+		if (seq != 2 * (index + 1)) {
+			continue;// Still being written, or already reused
+		}
+		Event ev;
+		ev.category = (Category)slot.category;
+		ev.name = slot.name;
+		ev.start = slot.start;
+		ev.duration = slot.duration;
+		ev.bytes = slot.bytes;
+		ev.thread = slot.thread;
+		ev.detail = QByteArray(slot.detail, slot.detailLen);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) == seq) {
+			list.append(ev);
+		}
+	}
+	return list;
+}
+
+QList<Summary> summarise()
+{
+	QMap<QString, Summary> map;
+	const QList<Event> evs = events();
+	for (const Event& ev : evs) {
+		QString detail = QString::fromUtf8(ev.detail);
+		QString key = QString::number(ev.category) + QLatin1Char('/') + QLatin1String(ev.name) + QLatin1Char('/') + detail;
+		Summary& s = map[key];
+		if (0 == s.count) {
+			s.category = ev.category;
+			s.name = QLatin1String(ev.name);
+			s.detail = detail;
+		}
+		s.count++;
+		s.totalNs += ev.duration;
+		s.maxNs = qMax(s.maxNs, ev.duration);
+		s.bytes += ev.bytes;
+	}
+
+	QMutexLocker locker(&counterMutex());
+	for (const Counter* c : counters()) {
+		QString key = QString::number(c->category()) + QLatin1Char('/') + QLatin1String(c->name()) + QLatin1Char('/');
+		Summary& s = map[key];
+		s.category = c->category();
+		s.name = QLatin1String(c->name());
+		s.hits = c->hitCount();
+		s.misses = c->missCount();
+	}
+	return map.values();
+}
+
+bool exportTrace(const QString& fileName)
+{
+	QJsonArray trace;
+	QHash<quintptr, int> threadIds;
+	const QList<Event> evs = events();
+
+	for (const Event& ev : evs) {
+		int tid = threadIds.value(ev.thread, -1);
+		if (-1 == tid) {
+			tid = threadIds.count() + 1;
+			threadIds.insert(ev.thread, tid);
+			QJsonObject meta;
+			meta["name"] = QLatin1String("thread_name");
+			meta["ph"] = QLatin1String("M");
+			meta["pid"] = 1;
+			meta["tid"] = tid;
+			meta["args"] = QJsonObject({{"name", ev.thread == mainThread ? QStringLiteral("Main") : QString::number(tid)}});
+			trace.append(meta);
+		}
+
+		QJsonObject obj;
+		QString name = QLatin1String(ev.name);
+		if (!ev.detail.isEmpty()) {
+			name += QLatin1Char(' ') + QString::fromUtf8(ev.detail);
+		}
+		obj["name"] = name;
+		obj["cat"] = QLatin1String(categoryName(ev.category));
+		obj["ph"] = QLatin1String("X");
+		obj["ts"] = ev.start / 1000.0;
+		obj["dur"] = ev.duration / 1000.0;
+		obj["pid"] = 1;
+		obj["tid"] = tid;
+		if (ev.bytes > 0) {
+			obj["args"] = QJsonObject({{"bytes", ev.bytes}});
+		}
+		trace.append(obj);
+	}
+
+	// Cache counters are cumulative, so are written as a single sample at the end of the trace
+	qint64 end = evs.isEmpty() ? now() : (evs.last().start + evs.last().duration);
+	{
+		QMutexLocker locker(&counterMutex());
+		for (const Counter* c : counters()) {
+			QJsonObject obj;
+			obj["name"] = QLatin1String(c->name());
+			obj["cat"] = QLatin1String(categoryName(c->category()));
+			obj["ph"] = QLatin1String("C");
+			obj["ts"] = end / 1000.0;
+			obj["pid"] = 1;
+			obj["args"] = QJsonObject({{"hits", (qint64)c->hitCount()}, {"misses", (qint64)c->missCount()}});
+			trace.append(obj);
+		}
+	}
+
+	QJsonObject root;
+	root["traceEvents"] = trace;
+	root["displayTimeUnit"] = QLatin1String("ms");
+	root["otherData"] = QJsonObject({{"application", QCoreApplication::applicationName()}, {"version", QCoreApplication::applicationVersion()}});
+
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	return f.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) > 0;
+}
+
+Counter::Counter(Category c, const char* n)
+	: cat(c), counterName(n), hits(0), misses(0)
+{
+	QMutexLocker locker(&counterMutex());
+	counters().append(this);
+}
+
+Counter::~Counter()
+{
+	QMutexLocker locker(&counterMutex());
+	counters().removeAll(this);
+}
+}// namespace PerfStats
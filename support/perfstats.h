@@ -0,0 +1,159 @@
+/*
+ * Cantata
+ *
+ * Copyright (c) 2011-2022 Craig Drummond <craig.p.drummond@gmail.com>
+ *
+ * ----
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <atomic>
+
+// Timing instrumentation for hot paths (MPD commands, library queries, cover cache, model updates).
+// Events are written into a fixed size lock-free ring buffer, so only the most recent ones are kept.
+// Recording is off unless Cantata is started with --perf, in which case each instrumented call
+// costs no more than a check of a boolean.
+namespace PerfStats {
+enum Category {
+	Mpd,
+	Database,
+	Covers,
+	Models,
+	Network,
+
+	NumCategories
+};
+
+struct Event {
+	Category category = Mpd;
+	const char* name = nullptr;
+	QByteArray detail;
+	qint64 start = 0;// ns since recording was enabled
+	qint64 duration = 0;
+	qint64 bytes = 0;
+	quintptr thread = 0;
+};
+
+struct Summary {
+	Category category = Mpd;
+	QString name;
+	QString detail;
+	quint64 count = 0;
+	qint64 totalNs = 0;
+	qint64 maxNs = 0;
+	qint64 bytes = 0;
+	quint64 hits = 0;
+	quint64 misses = 0;
+};
+
+namespace Private {
+extern bool active;
+}
+
+inline bool enabled() { return Private::active; }
+// Must be called before any other threads are started
+void setEnabled(bool e);
+qint64 now();
+const char* categoryName(Category cat);
+
+// name must be a string literal (or otherwise outlive the recording), detail is truncated
+void add(Category cat, const char* name, qint64 start, qint64 duration, const QByteArray& detail = QByteArray(), qint64 bytes = 0);
+void clear();
+// Events still held in the ring buffer, oldest first. dropped is set to the number overwritten since clear()
+QList<Event> events(quint64* dropped = nullptr);
+QList<Summary> summarise();
+bool exportTrace(const QString& fileName);
+
+// Times the enclosing block
+class Scope {
+public:
+	Scope(Category c, const char* n)
+		: cat(c), name(n), start(enabled() ? now() : -1), bytes(0) {}
+	~Scope()
+	{
+		if (start >= 0) {
+			add(cat, name, start, now() - start, detail, bytes);
+		}
+	}
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+	bool isActive() const { return start >= 0; }
+	void setDetail(const QByteArray& d)
+	{
+		if (start >= 0) {
+			detail = d;
+		}
+	}
+	void setBytes(qint64 b) { bytes = b; }
+
+private:
+	Category cat;
+	const char* name;
+	qint64 start;
+	qint64 bytes;
+	QByteArray detail;
+};
+
+// Cumulative hit/miss counts for a cache. These are not stored in the ring buffer, as cache lookups
+// happen far too often (e.g. on each paint) and would push everything else out of it.
+class Counter {
+public:
+	Counter(Category c, const char* n);
+	~Counter();
+	Counter(const Counter&) = delete;
+	Counter& operator=(const Counter&) = delete;
+
+	void hit()
+	{
+		if (enabled()) {
+			hits.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	void miss()
+	{
+		if (enabled()) {
+			misses.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	void record(bool isHit) { isHit ? hit() : miss(); }
+
+	Category category() const { return cat; }
+	const char* name() const { return counterName; }
+	quint64 hitCount() const { return hits.load(std::memory_order_relaxed); }
+	quint64 missCount() const { return misses.load(std::memory_order_relaxed); }
+	void reset()
+	{
+		hits.store(0, std::memory_order_relaxed);
+		misses.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	Category cat;
+	const char* counterName;
+	std::atomic<quint64> hits;
+	std::atomic<quint64> misses;
+};
+}// namespace PerfStats
+
+#endif
@@ -805,20 +805,28 @@ void TagEditor::writeRatings()
 	}
 
 	if (isAll) {
-		progress->setVisible(true);
-		progress->setRange(0, edited.count());
+		QList<QPair<QString, int>> requests;
+		QStringList files;
 		QStringList failed;
 		for (int i = 1; i < edited.count(); ++i) {
-			progress->setValue(i + 1);
-			if (i && 0 == i % 10) {
-				QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-			}
 			Song s = edited.at(i);
 			if (s.rating <= Song::Rating_Max) {
-				Tags::Update status = Tags::updateRating(s.filePath(baseDir), s.rating);
-				if (Tags::Update_Failed == status || Tags::Update_BadFile == status) {
-					failed.append(s.file);
-				}
+				requests.append(qMakePair(s.filePath(baseDir), int(s.rating)));
+				files.append(s.file);
+			}
+		}
+		progress->setVisible(true);
+		progress->setRange(0, requests.count());
+		int count = 0;
+		QList<int> results = Tags::updateRatingBatch(requests, [&](int, int) {
+			progress->setValue(++count);
+			if (0 == count % 10) {
+				QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+			}
+		});
+		for (int i = 0; i < results.count(); ++i) {
+			if (Tags::Update_Failed == results.at(i) || Tags::Update_BadFile == results.at(i)) {
+				failed.append(files.at(i));
 			}
 		}
 		progress->setVisible(false);
@@ -1124,7 +1132,6 @@ bool TagEditor::applyUpdates()
 #endif
 		opts.load(MPDConnectionDetails::configGroupName(MPDConnection::self()->getDetails().name), true);
 
-	int toSave = editedIndexes.count();
 	bool renameFiles = false;
 	QList<Song> updatedSongs;
 
@@ -1135,19 +1142,11 @@ bool TagEditor::applyUpdates()
 	enableButton(User1, false);
 	enableButton(User2, false);
 	enableButton(User3, false);
-	progress->setVisible(true);
-	progress->setRange(1, toSave);
-
-	int count = 0;
+	QList<Tags::UpdateRequest> requests;
+	QStringList files;
 	bool someTimedout = false;
 	bool isLocal = false;
 	for (int idx : editedIndexes) {
-		progress->setValue(progress->value() + 1);
-
-		if (0 == count++ % 10) {
-			QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-		}
-
 		if (skipFirst && 0 == idx) {
 			continue;
 		}
@@ -1165,11 +1164,32 @@ bool TagEditor::applyUpdates()
 			continue;
 		}
 
-		QString file = orig.filePath();
-		QString afile = orig.filePath(baseDir);
-		splitGenres(orig);
-		splitGenres(edit);
-		switch (Tags::update(afile, orig, edit, -1, commentSupport)) {
+		Tags::UpdateRequest req;
+		req.fileName = orig.filePath(baseDir);
+		req.from = orig;
+		req.to = edit;
+		req.saveComment = commentSupport;
+		splitGenres(req.from);
+		splitGenres(req.to);
+		requests.append(req);
+		files.append(orig.filePath());
+	}
+
+	progress->setVisible(true);
+	progress->setRange(0, qMax(1, requests.count()));
+	int count = 0;
+	QList<int> results = Tags::updateBatch(requests, [&](int, int) {
+		progress->setValue(++count);
+		if (0 == count % 10) {
+			QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+		}
+	});
+
+	for (int i = 0; i < results.count(); ++i) {
+		const Song& orig = requests.at(i).from;
+		Song edit = requests.at(i).to;
+		const QString& file = files.at(i);
+		switch (results.at(i)) {
 		case Tags::Update_Modified:
 			edit.setComment(QString());
 #ifdef ENABLE_DEVICES_SUPPORT
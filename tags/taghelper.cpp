@@ -23,13 +23,19 @@
 
 #include "taghelper.h"
 #include "tags.h"
+#include <QAtomicInt>
 #include <QCoreApplication>
 #include <QDataStream>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QMutex>
+#include <QSet>
 #include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVariant>
+#include <QWaitCondition>
+#include <functional>
 #ifdef Q_OS_WIN
 #include <windows.h>
 #else
@@ -120,7 +126,14 @@ void TagHelper::process()
 	QString request;
 	QString fileName;
 
-	inStream >> request >> fileName;
+	inStream >> request;
+	if (request.endsWith(QLatin1String("Batch"))) {
+		processBatch(request, inStream);
+		data.clear();
+		dataSize = 0;
+		return;
+	}
+	inStream >> fileName;
 
 	DBUG << "REQ" << request << fileName;
 	if (QLatin1String("read") == request) {
@@ -179,6 +192,107 @@ void TagHelper::process()
 		qApp->exit();
 	}
 
+	writeResponse(response);
+	data.clear();
+	dataSize = 0;
+}
+
+static const int constMaxBatchThreads = 8;
+
+void TagHelper::processBatch(const QString& request, QDataStream& inStream)
+{
+	qint32 count = 0;
+	inStream >> count;
+	DBUG << "REQ" << request << count;
+
+	QList<std::function<void(QDataStream&)>> jobs;
+	QSet<QString> fileNames;
+	for (qint32 i = 0; i < count; ++i) {
+		QString fileName;
+		inStream >> fileName;
+		fileNames.insert(fileName);
+		if (QLatin1String("readBatch") == request) {
+			jobs.append([fileName](QDataStream& out) { out << Tags::read(fileName); });
+		}
+		else if (QLatin1String("updateBatch") == request) {
+			Song from;
+			Song to;
+			int id3Ver;
+			bool saveComment;
+			inStream >> from >> to >> id3Ver >> saveComment;
+			jobs.append([fileName, from, to, id3Ver, saveComment](QDataStream& out) { out << (int)Tags::update(fileName, from, to, id3Ver, saveComment); });
+		}
+		else if (QLatin1String("readReplaygainBatch") == request) {
+			jobs.append([fileName](QDataStream& out) { out << Tags::readReplaygain(fileName); });
+		}
+		else if (QLatin1String("updateReplaygainBatch") == request) {
+			Tags::ReplayGain rg;
+			inStream >> rg;
+			jobs.append([fileName, rg](QDataStream& out) { out << (int)Tags::updateReplaygain(fileName, rg); });
+		}
+		else if (QLatin1String("updateRatingBatch") == request) {
+			int rating = -1;
+			inStream >> rating;
+			jobs.append([fileName, rating](QDataStream& out) { out << (int)Tags::updateRating(fileName, rating); });
+		}
+		else {
+			qApp->exit();
+			return;
+		}
+	}
+
+	if (QDataStream::Ok != inStream.status()) {
+		qApp->exit();
+		return;
+	}
+
+	// Files are processed by a pool of threads, and each reply is sent as soon as its file has been processed.
+	// If the same file is listed more than once, then process the batch serially - so that writes to the one
+	// file cannot overlap.
+	QThreadPool pool;
+	QMutex mutex;
+	QWaitCondition cond;
+	QList<QByteArray> replies;
+	QAtomicInt next(0);
+	pool.setMaxThreadCount(fileNames.count() == jobs.count() ? qBound(1, QThread::idealThreadCount(), constMaxBatchThreads) : 1);
+	for (int i = 0; i < qMin(jobs.count(), pool.maxThreadCount()); ++i) {
+		pool.start([&]() {
+			for (;;) {
+				int index = next.fetchAndAddOrdered(1);
+				if (index >= jobs.count()) {
+					return;
+				}
+				QByteArray response;
+				QDataStream outStream(&response, QIODevice::WriteOnly);
+				outStream << qint32(index);
+				jobs.at(index)(outStream);
+				QMutexLocker locker(&mutex);
+				replies.append(response);
+				cond.wakeOne();
+			}
+		});
+	}
+
+	for (int i = 0; i < jobs.count(); ++i) {
+		QByteArray response;
+		{
+			QMutexLocker locker(&mutex);
+			while (replies.isEmpty()) {
+				cond.wait(&mutex);
+			}
+			response = replies.takeFirst();
+		}
+		writeResponse(response);
+		// The event loop is blocked until the batch completes, so make sure replies are actually sent now.
+		if (socket->bytesToWrite() > 0) {
+			socket->waitForBytesWritten(1000);
+		}
+	}
+	pool.waitForDone();
+}
+
+void TagHelper::writeResponse(const QByteArray& response)
+{
 	DBUG << "RESP" << response.size();
 	QDataStream writeStream(socket);
 	writeStream << qint32(response.length());
@@ -186,8 +300,6 @@ void TagHelper::process()
 		writeStream.writeRawData(response.data(), response.length());
 	}
 	socket->flush();
-	data.clear();
-	dataSize = 0;
 }
 
 #include "moc_taghelper.cpp"
@@ -27,6 +27,7 @@
 #include <QByteArray>
 #include <QObject>
 
+class QDataStream;
 class QLocalSocket;
 
 class TagHelper : public QObject {
@@ -44,6 +45,8 @@ private Q_SLOTS:
 
 private:
 	void process();
+	void processBatch(const QString& request, QDataStream& inStream);
+	void writeResponse(const QByteArray& response);
 
 private:
 	int parentPid;
@@ -47,7 +47,7 @@ void TagHelperIface::enableDebug()
 GLOBAL_STATIC(TagHelperIface, instance)
 
 TagHelperIface::TagHelperIface()
-	: msgStatus(true), dataSize(0), awaitingResponse(false), thread(nullptr), proc(nullptr), server(nullptr), sock(nullptr)
+	: msgStatus(true), dataSize(0), awaitingResponse(false), thread(nullptr), batchRemaining(0), proc(nullptr), server(nullptr), sock(nullptr)
 {
 	qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError");
 	thread = new Thread(metaObject()->className());
@@ -278,6 +278,105 @@ QMap<QString, QString> TagHelperIface::readAll(const QString& fileName)
 	return resp;
 }
 
+QList<Song> TagHelperIface::readBatch(const QStringList& fileNames, const std::function<void(int, const Song&)>& progress)
+{
+	DBUG << fileNames.count();
+	QList<Song> resp;
+	if (fileNames.isEmpty()) {
+		return resp;
+	}
+	for (int i = 0; i < fileNames.count(); ++i) {
+		resp.append(Song());
+	}
+	sendBatch(QString(__FUNCTION__), fileNames.count(), [&](int index, QDataStream& outStream) { outStream << fileNames.at(index); }, [&](int index, QDataStream& inStream) {
+		inStream >> resp[index];
+		if (progress) {
+			progress(index, resp.at(index));
+		}
+	});
+	return resp;
+}
+
+QList<int> TagHelperIface::updateBatch(const QList<UpdateRequest>& requests, const std::function<void(int, int)>& progress)
+{
+	DBUG << requests.count();
+	QList<int> resp;
+	if (requests.isEmpty()) {
+		return resp;
+	}
+	for (int i = 0; i < requests.count(); ++i) {
+		resp.append(Tags::Update_BadFile);
+	}
+	auto writer = [&](int index, QDataStream& outStream) {
+		const UpdateRequest& req = requests.at(index);
+		outStream << req.fileName << req.from << req.to << req.id3Ver << req.saveComment;
+	};
+	sendBatch(QString(__FUNCTION__), requests.count(), writer, [&](int index, QDataStream& inStream) {
+		inStream >> resp[index];
+		if (progress) {
+			progress(index, resp.at(index));
+		}
+	});
+	return resp;
+}
+
+QList<Tags::ReplayGain> TagHelperIface::readReplaygainBatch(const QStringList& fileNames, const std::function<void(int, const Tags::ReplayGain&)>& progress)
+{
+	DBUG << fileNames.count();
+	QList<Tags::ReplayGain> resp;
+	if (fileNames.isEmpty()) {
+		return resp;
+	}
+	for (int i = 0; i < fileNames.count(); ++i) {
+		resp.append(Tags::ReplayGain());
+	}
+	sendBatch(QString(__FUNCTION__), fileNames.count(), [&](int index, QDataStream& outStream) { outStream << fileNames.at(index); }, [&](int index, QDataStream& inStream) {
+		inStream >> resp[index];
+		if (progress) {
+			progress(index, resp.at(index));
+		}
+	});
+	return resp;
+}
+
+QList<int> TagHelperIface::updateReplaygainBatch(const QList<QPair<QString, Tags::ReplayGain>>& requests, const std::function<void(int, int)>& progress)
+{
+	DBUG << requests.count();
+	QList<int> resp;
+	if (requests.isEmpty()) {
+		return resp;
+	}
+	for (int i = 0; i < requests.count(); ++i) {
+		resp.append(Tags::Update_BadFile);
+	}
+	sendBatch(QString(__FUNCTION__), requests.count(), [&](int index, QDataStream& outStream) { outStream << requests.at(index).first << requests.at(index).second; }, [&](int index, QDataStream& inStream) {
+		inStream >> resp[index];
+		if (progress) {
+			progress(index, resp.at(index));
+		}
+	});
+	return resp;
+}
+
+QList<int> TagHelperIface::updateRatingBatch(const QList<QPair<QString, int>>& requests, const std::function<void(int, int)>& progress)
+{
+	DBUG << requests.count();
+	QList<int> resp;
+	if (requests.isEmpty()) {
+		return resp;
+	}
+	for (int i = 0; i < requests.count(); ++i) {
+		resp.append(Tags::Update_BadFile);
+	}
+	sendBatch(QString(__FUNCTION__), requests.count(), [&](int index, QDataStream& outStream) { outStream << requests.at(index).first << requests.at(index).second; }, [&](int index, QDataStream& inStream) {
+		inStream >> resp[index];
+		if (progress) {
+			progress(index, resp.at(index));
+		}
+	});
+	return resp;
+}
+
 TagHelperIface::Reply TagHelperIface::sendMessage(const QByteArray& msg)
 {
 	QMutexLocker locker(&mutex);
@@ -291,6 +390,63 @@ TagHelperIface::Reply TagHelperIface::sendMessage(const QByteArray& msg)
 	return reply;
 }
 
+// Number of files sent to the helper in one message. Progress handlers are only called between messages, once
+// the mutex has been released - as they may process events, and so cause other (non-batch) requests to be made.
+static const int constBatchChunk = 32;
+
+bool TagHelperIface::sendBatch(const QString& request, int count, const std::function<void(int, QDataStream&)>& writer,
+                               const std::function<void(int, QDataStream&)>& handler)
+{
+	for (int start = 0; start < count; start += constBatchChunk) {
+		int chunk = qMin(constBatchChunk, count - start);
+		QByteArray msg;
+		QDataStream outStream(&msg, QIODevice::WriteOnly);
+		outStream << request << qint32(chunk);
+		for (int i = 0; i < chunk; ++i) {
+			writer(start + i, outStream);
+		}
+
+		QList<QByteArray> replies;
+		bool ok = true;
+		{
+			QMutexLocker locker(&mutex);
+			data = msg;
+			{
+				QMutexLocker batchLocker(&batchMutex);
+				batchReplies.clear();
+				batchRemaining = chunk;
+			}
+			metaObject()->invokeMethod(this, "sendMsg", Qt::QueuedConnection);
+			for (int i = 0; i < chunk; ++i) {
+				sema.acquire();
+				QMutexLocker batchLocker(&batchMutex);
+				if (batchReplies.isEmpty()) {
+					// Semaphore was released without a reply, so helper has failed...
+					DBUG << "Batch failed after" << (start + i) << "of" << count;
+					batchRemaining = 0;
+					ok = false;
+					break;
+				}
+				replies.append(batchReplies.takeFirst());
+			}
+		}
+
+		for (const QByteArray& reply : replies) {
+			QDataStream inStream(reply);
+			qint32 index = -1;
+			inStream >> index;
+			if (index >= 0 && index < chunk) {
+				handler(start + index, inStream);
+			}
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+	DBUG << "Batch complete" << count;
+	return true;
+}
+
 static const int constMaxWait = 5000;
 
 bool TagHelperIface::startHelper()
@@ -426,6 +582,23 @@ void TagHelperIface::dataReady()
 		data += sock->read(dataSize - data.length());
 		if (data.length() == dataSize) {
 			DBUG << "Response fully received";
+			QMutexLocker batchLocker(&batchMutex);
+			if (batchRemaining > 0) {
+				// Pass batch replies on one at a time, so that the caller can report progress
+				batchReplies.append(data);
+				data.clear();
+				dataSize = 0;
+				if (0 == --batchRemaining) {
+					awaitingResponse = false;
+					msgStatus = true;
+				}
+				sema.release();
+				if (awaitingResponse) {
+					continue;
+				}
+				break;
+			}
+			batchLocker.unlock();
 			setStatus(true);
 			break;
 		}
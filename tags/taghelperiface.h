@@ -26,11 +26,16 @@
 
 #include "mpd-interface/song.h"
 #include <QImage>
+#include <QList>
 #include <QMap>
 #include <QMutex>
+#include <QPair>
 #include <QSemaphore>
 #include <QString>
+#include <QStringList>
+#include <functional>
 
+class QDataStream;
 class QLocalServer;
 class QLocalSocket;
 class QProcess;
@@ -52,6 +57,14 @@ public:
 		QByteArray data;
 	};
 
+	struct UpdateRequest {
+		QString fileName;
+		Song from;
+		Song to;
+		int id3Ver = -1;
+		bool saveComment = false;
+	};
+
 	TagHelperIface();
 	void stop();
 	Song read(const QString& fileName);
@@ -68,9 +81,21 @@ public:
 	int updateRating(const QString& fileName, int rating);
 	QMap<QString, QString> readAll(const QString& fileName);
 
+	// Batch requests. The helper processes each batch with several threads, and replies per file as soon as
+	// that file is done - so replies arrive in any order. Files are sent in chunks, and once each chunk has completed
+	// its replies are passed to the (optional) progress handler, in the calling thread, along with the index of the
+	// file each relates to. The handler is called without any lock held, so it may make further tag requests.
+	QList<Song> readBatch(const QStringList& fileNames, const std::function<void(int, const Song&)>& progress = nullptr);
+	QList<int> updateBatch(const QList<UpdateRequest>& requests, const std::function<void(int, int)>& progress = nullptr);
+	QList<Tags::ReplayGain> readReplaygainBatch(const QStringList& fileNames, const std::function<void(int, const Tags::ReplayGain&)>& progress = nullptr);
+	QList<int> updateReplaygainBatch(const QList<QPair<QString, Tags::ReplayGain>>& requests, const std::function<void(int, int)>& progress = nullptr);
+	QList<int> updateRatingBatch(const QList<QPair<QString, int>>& requests, const std::function<void(int, int)>& progress = nullptr);
+
 private:
 	bool helperIsRunning();
 	Reply sendMessage(const QByteArray& msg);
+	bool sendBatch(const QString& request, int count, const std::function<void(int, QDataStream&)>& writer,
+	               const std::function<void(int, QDataStream&)>& handler);
 	bool startHelper();
 	void setStatus(bool st);
 
@@ -89,6 +114,9 @@ private:
 	bool awaitingResponse;
 	Thread* thread;
 	QSemaphore sema;
+	QMutex batchMutex;
+	int batchRemaining;
+	QList<QByteArray> batchReplies;
 	QProcess* proc;
 	QLocalServer* server;
 	QLocalSocket* sock;
@@ -196,11 +196,13 @@ struct RgTagsStrings {
 
 static void ensureFileTypeResolvers()
 {
-	static bool alreadyAdded = false;
-	if (!alreadyAdded) {
-		alreadyAdded = true;
+	// Batch requests are processed by several threads, so rely upon the (thread-safe) initialisation
+	// of function statics to only add the resolver once.
+	static const bool added = []() {
 		TagLib::FileRef::addFileTypeResolver(new Meta::Tag::FileTypeResolver());
-	}
+		return true;
+	}();
+	Q_UNUSED(added)
 }
 
 static TagLib::FileRef getFileRef(const QString& path)
@@ -77,6 +77,12 @@ inline QString oggMimeType(const QString& fileName) { return TagHelperIface::sel
 inline int readRating(const QString& fileName) { return TagHelperIface::self()->readRating(fileName); }
 inline Update updateRating(const QString& fileName, int rating) { return (Update)TagHelperIface::self()->updateRating(fileName, rating); }
 inline QMap<QString, QString> readAll(const QString& fileName) { return TagHelperIface::self()->readAll(fileName); }
+typedef TagHelperIface::UpdateRequest UpdateRequest;
+inline QList<Song> readBatch(const QStringList& fileNames, const std::function<void(int, const Song&)>& progress = nullptr) { return TagHelperIface::self()->readBatch(fileNames, progress); }
+inline QList<int> updateBatch(const QList<UpdateRequest>& requests, const std::function<void(int, int)>& progress = nullptr) { return TagHelperIface::self()->updateBatch(requests, progress); }
+inline QList<ReplayGain> readReplaygainBatch(const QStringList& fileNames, const std::function<void(int, const ReplayGain&)>& progress = nullptr) { return TagHelperIface::self()->readReplaygainBatch(fileNames, progress); }
+inline QList<int> updateReplaygainBatch(const QList<QPair<QString, ReplayGain>>& requests, const std::function<void(int, int)>& progress = nullptr) { return TagHelperIface::self()->updateReplaygainBatch(requests, progress); }
+inline QList<int> updateRatingBatch(const QList<QPair<QString, int>>& requests, const std::function<void(int, int)>& progress = nullptr) { return TagHelperIface::self()->updateRatingBatch(requests, progress); }
 #else
 inline void init() {}
 inline void stop() {}
@@ -744,47 +744,9 @@ void GroupedView::coverLoaded(const Song& song, int size)
 	if (filterActive || !isVisible() || size != constCoverSize || song.isArtistImageRequest() || song.isComposerImageRequest()) {
 		return;
 	}
-	quint32 count = model()->rowCount();
-	quint16 lastKey = Song::Null_Key;
-	QString albumArtist = song.albumArtist();
-	QString album = song.album;
-
-	for (quint32 i = 0; i < count; ++i) {
-		QModelIndex index = model()->index(i, 0);
-		if (!index.isValid()) {
-			continue;
-		}
-		if (isMultiLevel && model()->hasChildren(index)) {
-			lastKey = Song::Null_Key;
-			quint32 childCount = model()->rowCount(index);
-			for (quint32 c = 0; c < childCount; ++c) {
-				QModelIndex child = model()->index(c, 0, index);
-				if (!child.isValid()) {
-					continue;
-				}
-				quint16 key = child.data(Cantata::Role_Key).toUInt();
-
-				if (key != lastKey && !isRowHidden(c, index)) {
-					Song song = child.data(Cantata::Role_Song).value<Song>();
-					if (song.albumArtist() == albumArtist && song.album == album) {
-						dataChanged(child, child);
-					}
-				}
-				lastKey = key;
-			}
-		}
-		else {
-			quint16 key = index.data(Cantata::Role_Key).toUInt();
-
-			if (key != lastKey && !isRowHidden(i, QModelIndex())) {
-				Song song = index.data(Cantata::Role_Song).value<Song>();
-				if (song.albumArtist() == albumArtist && song.album == album) {
-					dataChanged(index, index);
-				}
-			}
-			lastKey = key;
-		}
-	}
+	// Repaint all visible items, not just those of this album, so that any whose cover is still waiting to
+	// be loaded ask for it again - otherwise the cover loader would take these to have scrolled out of view.
+	viewport()->update();
 }
 
 void GroupedView::collectionRemoved(quint32 key)
@@ -1764,7 +1764,9 @@ void ItemView::coverLoaded(const Song& song, int size)
 {
 	Q_UNUSED(song)
 
-	if (Mode_BasicTree == mode || Mode_GroupedTree == mode || !isVisible() || (Mode_IconTop == mode && size != zoomedSize(listView, gridCoverSize)) || (Mode_IconTop != mode && Mode_Categorized != mode && size != listCoverSize)
+	// Tree modes are repainted too, so that any visible item whose cover is still waiting to be loaded asks for it
+	// again - otherwise the cover loader would take it to have scrolled out of view.
+	if (!isVisible() || (Mode_IconTop == mode && size != zoomedSize(listView, gridCoverSize)) || (Mode_IconTop != mode && Mode_Categorized != mode && size != listCoverSize)
 	    || (Mode_Categorized == mode && size != zoomedSize(categorizedView, gridCoverSize))
 	) {
 		return;